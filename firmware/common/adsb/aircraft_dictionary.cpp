@@ -9,9 +9,31 @@
 #include "unit_conversions.hh"
 
 const float kRadiansToDegrees = 360.0f / (2.0f * M_PI);
+const float kNmPerDegreeLatitude = 60.0f;
 
 /**
- * Aircraft
+ * Approximates the distance between two nearby positions by treating the Earth as flat around the first one. Good to a
+ * few percent over the few hundred nautical miles that a receiver covers.
+ * @param[in] lat_a_deg Latitude of the first position, in degrees.
+ * @param[in] lon_a_deg Longitude of the first position, in degrees.
+ * @param[in] lat_b_deg Latitude of the second position, in degrees.
+ * @param[in] lon_b_deg Longitude of the second position, in degrees.
+ * @retval Distance in nautical miles.
+ */
+static float ApproxDistanceNm(float lat_a_deg, float lon_a_deg, float lat_b_deg, float lon_b_deg) {
+    float d_lon_deg = lon_b_deg - lon_a_deg;
+    if (d_lon_deg > 180.0f) {
+        d_lon_deg -= 360.0f;
+    } else if (d_lon_deg < -180.0f) {
+        d_lon_deg += 360.0f;
+    }
+    float d_lat_nm = (lat_b_deg - lat_a_deg) * kNmPerDegreeLatitude;
+    float d_lon_nm = d_lon_deg * kNmPerDegreeLatitude * cosf(lat_a_deg / kRadiansToDegrees);
+    return sqrtf(d_lat_nm * d_lat_nm + d_lon_nm * d_lon_nm);
+}
+
+/**
+ * Aircraft and AircraftMetadata
  */
 
 Aircraft::Aircraft(uint32_t icao_address_in) : icao_address(icao_address_in) {
@@ -22,85 +44,123 @@ Aircraft::Aircraft() {
     // memset(callsign, '\0', kCallSignMaxNumChars + 1);  // clear out callsign string, including extra EOS character
 }
 
-bool Aircraft::DecodePosition() {
+/**
+ * Checks whether two binary angles are within a few counts of each other. Global and local decodes of the same packet
+ * can differ by a count due to rounding, but are off by a whole CPR zone if either one is wrong.
+ */
+static inline bool BinaryAnglesAreClose(int32_t a, int32_t b) {
+    const int32_t kToleranceBinaryAngle = 16;
+    int32_t difference = static_cast<int32_t>(static_cast<uint32_t>(a) - static_cast<uint32_t>(b));
+    return difference <= kToleranceBinaryAngle && difference >= -kToleranceBinaryAngle;
+}
+
+bool AircraftMetadata::DecodePosition(Aircraft &aircraft) {
     if (!(last_odd_packet_.received_timestamp_ms > 0 && last_even_packet_.received_timestamp_ms > 0)) {
-        CONSOLE_WARNING("Aircraft::DecodePosition",
-                        "Unable to decode position without receiving an odd and even packet pair.\r\n");
+        CONSOLE_WARNING_DEFERRED("AircraftMetadata::DecodePosition",
+                                 "Unable to decode position without receiving an odd and even packet pair.\r\n");
         return false;  // need both an even and an odd packet to be able to decode position
     }
-
-    // Equation 5.6
-    int32_t lat_zone_index = floorf(59.0f * last_even_packet_.lat_cpr - 60.0f * last_odd_packet_.lat_cpr + 0.5f);
-
-    bool calculate_odd =
-        last_odd_packet_.calculated_timestamp_ms > last_odd_packet_.received_timestamp_ms ? false : true;
-    bool calculate_even =
-        last_even_packet_.calculated_timestamp_ms > last_even_packet_.received_timestamp_ms ? false : true;
-
-    if (calculate_odd) {
-        // Equation 5.7
-        last_odd_packet_.lat = kCPRdLatOdd * ((lat_zone_index % 59) + last_odd_packet_.lat_cpr);
-        // Equation 5.8: wrap latitude to between -90 and +90 degrees.
-        last_odd_packet_.lat = WrapCPRDecodeLatitude(last_odd_packet_.lat);
-        // Calculate NL, which will be used later to calculate the number of longitude zones in this latitude band.
-        last_odd_packet_.nl_cpr = CalcNLCPRFromLat(last_odd_packet_.lat);
-        last_odd_packet_.calculated_timestamp_ms = get_time_since_boot_ms();
-    }
-
-    if (calculate_even) {
-        // Equation 5.7
-        last_even_packet_.lat = kCPRdLatEven * ((lat_zone_index % 60) + last_even_packet_.lat_cpr);
-        // Equation 5.8: wrap latitude to between -90 and +90 degrees.
-        last_even_packet_.lat = WrapCPRDecodeLatitude(last_even_packet_.lat);
-        // Calculate NL, which will be used later to calculate the number of longitude zones in this latitude band.
-        last_even_packet_.nl_cpr = CalcNLCPRFromLat(last_even_packet_.lat);
-        last_even_packet_.calculated_timestamp_ms = get_time_since_boot_ms();
-    }
-
-    /**
-     * Unhandled edge case:
-     *
-     * Even and odd packets are both received, everything up to this point gets calculated. The calculated position
-     * ends up being invalid because the number of longitude bands disagrees at the last step. Then, a new odd packet
-     * arrives with a lat_cpr that would change the lat_zone_index. This should change the lat of the previously
-     * calculated even packet, but this won't be refreshed until the next even packet is received. Could result in
-     * some delay in getting a valid position when crossing over between latitude zones.
-     *
-     * Solution would be to trigger a re-ingestion of the old even packet as soon as it's known that it was calculated
-     * incorrectly.
-     */
-
-    if (last_odd_packet_.nl_cpr != last_even_packet_.nl_cpr) {
-        // Invalidate position if position pair is split across different latitude bands.
-        WriteBitFlag(BitFlag::kBitFlagPositionValid, false);  // keep last known good coordinates, but mark as invalid
-        CONSOLE_WARNING("Aircraft::DecodePosition",
-                        "NL_cpr disagrees between odd (%d) and even (%d) packets. Can't decode "
-                        "position.\r\n",
-                        last_odd_packet_.nl_cpr, last_even_packet_.nl_cpr);
+    if (!CPRPairIsFresh()) {
+        CONSOLE_WARNING_DEFERRED("AircraftMetadata::DecodePosition",
+                                 "Odd and even packets were received too far apart to decode position.\r\n");
         return false;
     }
 
-    // From here on out, can just focus on the most recent packet since that's what we're using for our position.
+    // Decode the position of whichever packet was received last.
     bool received_odd_last = last_odd_packet_.received_timestamp_ms > last_even_packet_.received_timestamp_ms;
-    CPRPacket &last_packet = received_odd_last ? last_odd_packet_ : last_even_packet_;
-    latitude_deg = last_packet.lat;  // Publish latitude.
+    int32_t lat, lon;
+    if (!DecodeCPRGlobal(last_even_packet_.n_lat, last_even_packet_.n_lon, last_odd_packet_.n_lat,
+                         last_odd_packet_.n_lon, received_odd_last, lat, lon)) {
+        // Invalidate position if position pair is split across different latitude bands.
+        // Keep last known good coordinates, but mark as invalid.
+        aircraft.WriteBitFlag(Aircraft::BitFlag::kBitFlagPositionValid, false);
+        CONSOLE_WARNING_DEFERRED("AircraftMetadata::DecodePosition",
+                                 "Odd and even packets are from different latitude bands. Can't decode position.\r\n");
+        return false;
+    }
 
-    // Equation 5.10
-    int32_t lon_zone_index = floorf(last_even_packet_.lon_cpr * (last_packet.nl_cpr - 1) -
-                                    last_odd_packet_.lon_cpr * last_packet.nl_cpr + 0.5f);
+    // An aircraft can't move half a CPR zone (~180NM) in kCPRMaxReferenceAgeMs, so a global decode that disagrees with
+    // a recent verified position means the pair straddled a zone boundary or one of the packets was corrupted.
+    int32_t recent_lat, recent_lon, local_lat, local_lon;
+    if (position_verified_ && GetRecentPosition(recent_lat, recent_lon)) {
+        CPRPacket &last_packet = received_odd_last ? last_odd_packet_ : last_even_packet_;
+        if (!DecodeCPRLocal(last_packet.n_lat, last_packet.n_lon, received_odd_last, false, recent_lat, recent_lon,
+                            local_lat, local_lon) ||
+            !BinaryAnglesAreClose(lat, local_lat) || !BinaryAnglesAreClose(lon, local_lon)) {
+            CONSOLE_WARNING_DEFERRED("AircraftMetadata::DecodePosition",
+                                     "Decoded position jumped too far from the last known position.\r\n");
+            return false;
+        }
+    }
+    PublishPosition(aircraft, lat, lon, true);
+    return true;
+}
 
-    // Equation 5.11: Use nl_lat_cpr to calculate actual number of longitude zones
-    uint16_t num_lon_zones = received_odd_last ? MAX(last_packet.nl_cpr - 1, 1) : MAX(last_packet.nl_cpr, 1);
-    // Equation 5.12: longitude zone size
-    float d_lon = 360.0f / num_lon_zones;
+bool AircraftMetadata::DecodePositionLocal(Aircraft &aircraft, uint32_t n_lat_cpr, uint32_t n_lon_cpr, bool odd,
+                                           bool surface) {
+    int32_t reference_lat, reference_lon, lat, lon;
+    // An unverified position could be in the wrong zone, so it isn't chained off of until a global decode confirms it.
+    if (!position_verified_ || !GetRecentPosition(reference_lat, reference_lon) ||
+        !DecodeCPRLocal(n_lat_cpr, n_lon_cpr, odd, surface, reference_lat, reference_lon, lat, lon)) {
+        return false;
+    }
+    PublishPosition(aircraft, lat, lon, true);  // As trustworthy as the verified reference.
+    return true;
+}
 
-    // Equation 5.13 (calc longitude), 5.15 (wrap longitude to between -180 and +180 degrees)
-    longitude_deg = WrapCPRDecodeLongitude(d_lon * ((lon_zone_index % num_lon_zones) + last_packet.lon_cpr));
-    WriteBitFlag(BitFlag::kBitFlagPositionValid, true);  // TODO: Add "reasonable validation" that position is valid.
+bool AircraftMetadata::DecodePositionLocal(Aircraft &aircraft, uint32_t n_lat_cpr, uint32_t n_lon_cpr, bool odd,
+                                           bool surface, int32_t reference_lat, int32_t reference_lon) {
+    int32_t lat, lon;
+    if (!DecodeCPRLocal(n_lat_cpr, n_lon_cpr, odd, surface, reference_lat, reference_lon, lat, lon)) {
+        return false;
+    }
+    if (ApproxDistanceNm(BinaryAngleToDegrees(reference_lat), BinaryAngleToDegrees(reference_lon),
+                         BinaryAngleToDegrees(lat), BinaryAngleToDegrees(lon)) >
+        (surface ? kCPRMaxSurfaceReceiverRangeNm : kCPRMaxAirborneReceiverRangeNm)) {
+        return false;  // Out of range of the receiver, probably decoded into the wrong zone.
+    }
+    PublishPosition(aircraft, lat, lon, false);
     return true;
 }
 
-bool Aircraft::SetCPRLatLon(uint32_t n_lat_cpr, uint32_t n_lon_cpr, bool odd, bool redigesting) {
+bool AircraftMetadata::GetRecentPosition(int32_t &lat, int32_t &lon) const {
+    lat = position_lat_;
+    lon = position_lon_;
+    return position_timestamp_ms_ > 0 && get_time_since_boot_ms() - position_timestamp_ms_ < kCPRMaxReferenceAgeMs;
+}
+
+void AircraftMetadata::PublishPosition(Aircraft &aircraft, int32_t lat, int32_t lon, bool verified) {
+    position_lat_ = lat;
+    position_lon_ = lon;
+    position_timestamp_ms_ = get_time_since_boot_ms();
+    position_verified_ = verified;
+    aircraft.latitude_deg = BinaryAngleToDegrees(lat);
+    aircraft.longitude_deg = BinaryAngleToDegrees(lon);
+    aircraft.WriteBitFlag(Aircraft::BitFlag::kBitFlagPositionValid, true);
+}
+
+void AircraftMetadata::IncrementNumFramesReceived(bool is_extended_squitter) {
+    uint32_t interval = get_time_since_boot_ms() / kMetricsIntervalMs;
+    if (interval != metrics_interval_) {
+        // Roll over. Counts are only carried over if they came from the interval right before this one.
+        metrics_ = interval == metrics_interval_ + 1 ? metrics_counter_ : Aircraft::Metrics();
+        metrics_counter_ = Aircraft::Metrics();
+        metrics_interval_ = interval;
+    }
+    is_extended_squitter ? metrics_counter_.valid_extended_squitter_frames++ : metrics_counter_.valid_squitter_frames++;
+}
+
+Aircraft::Metrics AircraftMetadata::GetMetrics() const {
+    uint32_t interval = get_time_since_boot_ms() / kMetricsIntervalMs;
+    if (interval == metrics_interval_) {
+        return metrics_;  // Still counting the current interval.
+    } else if (interval == metrics_interval_ + 1) {
+        return metrics_counter_;  // Counter is from the last complete interval but hasn't been rolled over yet.
+    }
+    return Aircraft::Metrics();  // No frames were received during the last complete interval.
+}
+
+bool AircraftMetadata::SetCPRLatLon(uint32_t n_lat_cpr, uint32_t n_lon_cpr, bool odd, bool redigesting) {
     if (n_lat_cpr > kCPRLatLonMaxCount || n_lon_cpr > kCPRLatLonMaxCount) {
         return false;  // counts out of bounds, don't parse
     }
@@ -109,9 +169,6 @@ bool Aircraft::SetCPRLatLon(uint32_t n_lat_cpr, uint32_t n_lon_cpr, bool odd, bo
     packet.received_timestamp_ms = get_time_since_boot_ms();
     packet.n_lat = n_lat_cpr;
     packet.n_lon = n_lon_cpr;
-    // Equation 5.5
-    packet.lat_cpr = static_cast<float>(n_lat_cpr) / kCPRLatLonMaxCount;
-    packet.lon_cpr = static_cast<float>(n_lon_cpr) / kCPRLatLonMaxCount;
 
     return true;
 }
@@ -121,18 +178,20 @@ bool Aircraft::SetCPRLatLon(uint32_t n_lat_cpr, uint32_t n_lon_cpr, bool odd, bo
  */
 
 void AircraftDictionary::Init() {
-    dict.clear();  // Remove all aircraft from the unordered map.
+    dict.Clear();  // Remove all aircraft from the map.
+    aircraft_by_age_.Clear();
 }
 
 void AircraftDictionary::Update(uint32_t timestamp_ms) {
-    // Iterate over each key-value pair in the unordered_map. Prune if stale, update metrics if still fresh.
-    for (auto it = dict.begin(); it != dict.end(); /* No increment here */) {
-        if (timestamp_ms - it->second.last_message_timestamp_ms > config_.aircraft_prune_interval_ms) {
-            it = dict.erase(it);  // Remove stale aircraft entry.
-        } else {
-            it->second.UpdateMetrics();
-            it++;  // Move to the next aircraft entry.
+    // Prune stale aircraft, starting from the oldest. Stop at the first aircraft that is still fresh, since all the
+    // aircraft after it are newer. Per-aircraft metrics roll over lazily, so fresh aircraft don't need to be visited.
+    for (uint16_t index = aircraft_by_age_.GetOldest(); index != StaticLRUList<kMaxNumAircraft>::kInvalidIndex;
+         index = aircraft_by_age_.GetOldest()) {
+        Aircraft *it = dict.begin() + index;
+        if (timestamp_ms - it->last_message_timestamp_ms <= config_.aircraft_prune_interval_ms) {
+            break;
         }
+        EraseAircraft(it);  // Remove stale aircraft entry. Last aircraft gets moved into its place.
     }
 
     // Update aggregate statistics.
@@ -148,9 +207,10 @@ bool AircraftDictionary::IngestDecodedTransponderPacket(DecodedTransponderPacket
             if (source > 0) {
                 metrics_counter_.raw_squitter_frames_by_source[source]++;
             }
-            if (ContainsAircraft(packet.GetICAOAddress())) {
+            if (packet.IsValiditySettled() ? packet.IsValid() : ContainsAircraft(packet.GetICAOAddress())) {
                 // Packet is a 56-bit Squitter packet that is incapable of validating itself, and its CRC was validated
-                // against the ICAO addresses in the aircraft dictionary.
+                // against the ICAO addresses in the aircraft dictionary (this one, or the one on the device that
+                // decoded it).
                 metrics_counter_.valid_squitter_frames++;
                 if (source > 0) {
                     metrics_counter_.valid_squitter_frames_by_source[source]++;
@@ -171,12 +231,18 @@ bool AircraftDictionary::IngestDecodedTransponderPacket(DecodedTransponderPacket
                 if (source > 0) {
                     metrics_counter_.valid_extended_squitter_frames_by_source[source]++;
                 }
+                if (packet.GetNumCorrectedBits() > 0) {
+                    metrics_counter_.corrected_extended_squitter_frames++;
+                    if (source > 0) {
+                        metrics_counter_.corrected_extended_squitter_frames_by_source[source]++;
+                    }
+                }
             } else {
                 return false;  // Extended squitter frame failed CRC.
             }
             break;
         default:
-            CONSOLE_ERROR(
+            CONSOLE_ERROR_DEFERRED(
                 "AircraftDictionary::IngestDecodedTransponderPacket",
                 "Received packet with unrecognized bitlength %d, expected %d (Squiter) or %d (Extended Squitter).",
                 packet.GetBufferLenBits(), DecodedTransponderPacket::kSquitterPacketLenBits,
@@ -210,71 +276,72 @@ bool AircraftDictionary::IngestDecodedTransponderPacket(DecodedTransponderPacket
             break;
 
         default:
-            CONSOLE_WARNING("AircraftDictionary::IngestDecodedTransponderPacket",
-                            "Encountered unexpected downlink format %d.", downlink_format);
+            CONSOLE_WARNING_DEFERRED("AircraftDictionary::IngestDecodedTransponderPacket",
+                                     "Encountered unexpected downlink format %d.", downlink_format);
             return false;
     }
     return true;
 }
 
 bool AircraftDictionary::IngestModeAPacket(ModeAPacket packet) {
-    if (!packet.IsValid() || packet.GetDownlinkFormat() != ModeAPacket::kDownlinkFormatIdentityReply) {
+    if (!packet.IsValid() || packet.GetDownlinkFormat() != DecodedTransponderPacket::kDownlinkFormatIdentityReply) {
         return false;
     }
 
     uint32_t icao_address = packet.GetICAOAddress();
     Aircraft *aircraft_ptr = GetAircraftPtr(icao_address);
     if (aircraft_ptr == nullptr) {
-        CONSOLE_WARNING("AircraftDictionary::IngestModeAPacket",
-                        "Unable to find or create new aircraft with ICAO address 0x%lx in dictionary.\r\n",
-                        icao_address);
+        CONSOLE_WARNING_DEFERRED("AircraftDictionary::IngestModeAPacket",
+                                 "Unable to find or create new aircraft with ICAO address 0x%lx in dictionary.\r\n",
+                                 icao_address);
         return false;  // unable to find or create new aircraft in dictionary
     }
     aircraft_ptr->WriteBitFlag(Aircraft::BitFlag::kBitFlagIsAirborne, packet.IsAirborne());
     aircraft_ptr->WriteBitFlag(Aircraft::BitFlag::kBitFlagAlert, packet.HasAlert());
     aircraft_ptr->WriteBitFlag(Aircraft::BitFlag::kBitFlagIdent, packet.HasIdent());
     aircraft_ptr->squawk = packet.GetSquawk();
-    aircraft_ptr->IncrementNumFramesReceived(false);
+    GetAircraftMetadata(*aircraft_ptr).IncrementNumFramesReceived(false);
 
     return true;
 }
 
 bool AircraftDictionary::IngestModeCPacket(ModeCPacket packet) {
-    if (!packet.IsValid() || packet.GetDownlinkFormat() != ModeCPacket::kDownlinkFormatAltitudeReply) {
+    if (!packet.IsValid() || packet.GetDownlinkFormat() != DecodedTransponderPacket::kDownlinkFormatAltitudeReply) {
         return false;
     }
 
     uint32_t icao_address = packet.GetICAOAddress();
     Aircraft *aircraft_ptr = GetAircraftPtr(icao_address);
     if (aircraft_ptr == nullptr) {
-        CONSOLE_WARNING("AircraftDictionary::IngestModeCPacket",
-                        "Unable to find or create new aircraft with ICAO address 0x%lx in dictionary.\r\n",
-                        icao_address);
+        CONSOLE_WARNING_DEFERRED("AircraftDictionary::IngestModeCPacket",
+                                 "Unable to find or create new aircraft with ICAO address 0x%lx in dictionary.\r\n",
+                                 icao_address);
         return false;  // unable to find or create new aircraft in dictionary
     }
     aircraft_ptr->WriteBitFlag(Aircraft::BitFlag::kBitFlagIsAirborne, packet.IsAirborne());
     aircraft_ptr->WriteBitFlag(Aircraft::BitFlag::kBitFlagAlert, packet.HasAlert());
     aircraft_ptr->WriteBitFlag(Aircraft::BitFlag::kBitFlagIdent, packet.HasIdent());
     aircraft_ptr->baro_altitude_ft = packet.GetAltitudeFt();
-    aircraft_ptr->IncrementNumFramesReceived(false);
+    GetAircraftMetadata(*aircraft_ptr).IncrementNumFramesReceived(false);
 
     return true;
 }
 
 bool AircraftDictionary::IngestADSBPacket(ADSBPacket packet) {
-    if (!packet.IsValid() || packet.GetDownlinkFormat() != ADSBPacket::kDownlinkFormatExtendedSquitter) {
+    if (!packet.IsValid() || packet.GetDownlinkFormat() != DecodedTransponderPacket::kDownlinkFormatExtendedSquitter) {
         return false;  // Only allow valid DF17 packets.
     }
 
     uint32_t icao_address = packet.GetICAOAddress();
     Aircraft *aircraft_ptr = GetAircraftPtr(icao_address);
     if (aircraft_ptr == nullptr) {
-        CONSOLE_WARNING("AircraftDictionary::IngestADSBPacket",
-                        "Unable to find or create new aircraft with ICAO address 0x%lx in dictionary.\r\n",
-                        icao_address);
+        CONSOLE_WARNING_DEFERRED("AircraftDictionary::IngestADSBPacket",
+                                 "Unable to find or create new aircraft with ICAO address 0x%lx in dictionary.\r\n",
+                                 icao_address);
         return false;  // unable to find or create new aircraft in dictionary
     }
-    aircraft_ptr->last_message_timestamp_ms = get_time_since_boot_ms();
+    RefreshAircraft(*aircraft_ptr, get_time_since_boot_ms());
+    AircraftMetadata &metadata = GetAircraftMetadata(*aircraft_ptr);
 
     bool ret = false;
     uint16_t typecode = packet.GetTypeCode();
@@ -283,13 +350,13 @@ bool AircraftDictionary::IngestADSBPacket(ADSBPacket packet) {
         case ADSBPacket::kTypeCodeAircraftID + 1:  // TC = 2 (Aircraft Identification)
         case ADSBPacket::kTypeCodeAircraftID + 2:  // TC = 3 (Aircraft Identification)
         case ADSBPacket::kTypeCodeAircraftID + 3:  // TC = 4 (Aircraft Identification)
-            ret = ApplyAircraftIDMessage(*aircraft_ptr, packet);
+            ret = ApplyAircraftIDMessage(*aircraft_ptr, metadata, packet);
             break;
         case ADSBPacket::kTypeCodeSurfacePosition:      // TC = 5 (Surface Position)
         case ADSBPacket::kTypeCodeSurfacePosition + 1:  // TC = 6 (Surface Position)
         case ADSBPacket::kTypeCodeSurfacePosition + 2:  // TC = 7 (Surface Position)
         case ADSBPacket::kTypeCodeSurfacePosition + 3:  // TC = 8 (Surface Position)
-            ret = ApplySurfacePositionMessage(*aircraft_ptr, packet);
+            ret = ApplySurfacePositionMessage(*aircraft_ptr, metadata, packet);
             break;
         case ADSBPacket::kTypeCodeAirbornePositionBaroAlt:      // TC = 9 (Airborne Position w/ Baro Altitude)
         case ADSBPacket::kTypeCodeAirbornePositionBaroAlt + 1:  // TC = 10 (Airborne Position w/ Baro Altitude)
@@ -304,10 +371,10 @@ bool AircraftDictionary::IngestADSBPacket(ADSBPacket packet) {
         case ADSBPacket::kTypeCodeAirbornePositionGNSSAlt:      // TC = 20 (Airborne Position w/ GNSS Altitude)
         case ADSBPacket::kTypeCodeAirbornePositionGNSSAlt + 1:  // TC = 21 (Airborne Position w/ GNSS Altitude)
         case ADSBPacket::kTypeCodeAirbornePositionGNSSAlt + 2:  // TC = 22 (Airborne Position w/ GNSS Altitude)
-            ret = ApplyAirbornePositionMessage(*aircraft_ptr, packet);
+            ret = ApplyAirbornePositionMessage(*aircraft_ptr, metadata, packet);
             break;
         case ADSBPacket::kTypeCodeAirborneVelocities:  // TC = 19 (Airborne Velocities)
-            ret = ApplyAirborneVelocitiesMessage(*aircraft_ptr, packet);
+            ret = ApplyAirborneVelocitiesMessage(*aircraft_ptr, metadata, packet);
             break;
         case ADSBPacket::kTypeCodeReserved:      // TC = 23 (Reserved)
         case ADSBPacket::kTypeCodeReserved + 1:  // TC = 24 (Reserved)
@@ -317,79 +384,107 @@ bool AircraftDictionary::IngestADSBPacket(ADSBPacket packet) {
             ret = false;
             break;
         case ADSBPacket::kTypeCodeAircraftStatus:  // TC = 28 (Aircraft Status)
-            ret = ApplyAircraftStatusMessage(*aircraft_ptr, packet);
+            ret = ApplyAircraftStatusMessage(*aircraft_ptr, metadata, packet);
             break;
         case ADSBPacket::kTypeCodeTargetStateAndStatusInfo:  // TC = 29 (Target state and status info)
-            ret = ApplyTargetStateAndStatusInfoMessage(*aircraft_ptr, packet);
+            ret = ApplyTargetStateAndStatusInfoMessage(*aircraft_ptr, metadata, packet);
             break;
         case ADSBPacket::kTypeCodeAircraftOperationStatus:  // TC = 31 (Aircraft operation status)
-            ret = ApplyAircraftOperationStatusMessage(*aircraft_ptr, packet);
+            ret = ApplyAircraftOperationStatusMessage(*aircraft_ptr, metadata, packet);
             break;
         default:
-            CONSOLE_WARNING("AircraftDictionary::IngestADSBPacket",
-                            "Received ADSB message with unsupported typecode %d.", typecode);
+            CONSOLE_WARNING_DEFERRED("AircraftDictionary::IngestADSBPacket",
+                                     "Received ADSB message with unsupported typecode %d.", typecode);
             ret = false;  // kTypeCodeInvalid, etc.
     }
-    if (ret) aircraft_ptr->IncrementNumFramesReceived(true);  // Count the received Mode S frame.
+    if (ret) metadata.IncrementNumFramesReceived(true);  // Count the received Mode S frame.
     return ret;
 }
 
-uint16_t AircraftDictionary::GetNumAircraft() { return dict.size(); }
+uint16_t AircraftDictionary::GetNumAircraft() { return dict.Size(); }
 
-bool AircraftDictionary::InsertAircraft(const Aircraft &aircraft) {
-    auto itr = dict.find(aircraft.icao_address);
-    if (itr != dict.end()) {
-        // Overwriting an existing aircraft
-        itr->second = aircraft;
-        return true;
+bool AircraftDictionary::InsertAircraft(const Aircraft &aircraft, const AircraftMetadata &metadata) {
+    Aircraft *aircraft_ptr = dict.Find(aircraft.icao_address);
+    if (aircraft_ptr != nullptr) {
+        aircraft_by_age_.Remove(dict.GetIndex(aircraft_ptr));  // Overwriting an aircraft can change its age.
     }
-
-    if (dict.size() >= kMaxNumAircraft) {
-        CONSOLE_INFO("AIrcraftDictionary::InsertAircraft",
-                     "Failed to add aircraft to dictionary, max number of aircraft is %d.", kMaxNumAircraft);
+    aircraft_ptr = dict.Insert(aircraft.icao_address, aircraft);
+    if (aircraft_ptr == nullptr) {
+        CONSOLE_INFO_DEFERRED("AIrcraftDictionary::InsertAircraft",
+                              "Failed to add aircraft to dictionary, max number of aircraft is %d.", kMaxNumAircraft);
         return false;  // not enough room to add this aircraft
     }
-
-    dict[aircraft.icao_address] = aircraft;  // add the new aircraft to the dictionary
+    GetAircraftMetadata(*aircraft_ptr) = metadata;
+
+    // Inserted aircraft can have any timestamp, so walk back from the newest aircraft to find where it belongs. Usually
+    // this stops right away, since inserted aircraft tend to be fresh.
+    uint16_t index = dict.GetIndex(aircraft_ptr);
+    uint16_t older_index = aircraft_by_age_.GetNewest();
+    while (older_index != StaticLRUList<kMaxNumAircraft>::kInvalidIndex &&
+           static_cast<int32_t>(dict.begin()[older_index].last_message_timestamp_ms -
+                                aircraft.last_message_timestamp_ms) > 0) {
+        older_index = aircraft_by_age_.GetOlder(older_index);
+    }
+    aircraft_by_age_.InsertNewerThan(older_index, index);
     return true;
 }
 
 bool AircraftDictionary::RemoveAircraft(uint32_t icao_address) {
-    auto itr = dict.find(icao_address);
-    if (itr != dict.end()) {
-        dict.erase(itr);
-        return true;
+    Aircraft *aircraft_ptr = dict.Find(icao_address);
+    if (aircraft_ptr == nullptr) {
+        return false;  // Aircraft was not found in the dictionary.
     }
-    return false;  // aircraft was not found in the dictionary
+    EraseAircraft(aircraft_ptr);
+    return true;
 }
 
 bool AircraftDictionary::GetAircraft(uint32_t icao_address, Aircraft &aircraft_out) const {
-    auto itr = dict.find(icao_address);
-    if (itr != dict.end()) {
-        aircraft_out = itr->second;
+    const Aircraft *aircraft = dict.Find(icao_address);
+    if (aircraft != nullptr) {
+        aircraft_out = *aircraft;
         return true;
     }
     return false;  // aircraft not found
 }
 
-bool AircraftDictionary::ContainsAircraft(uint32_t icao_address) const {
-    auto itr = dict.find(icao_address);
-    if (itr != dict.end()) {
+bool AircraftDictionary::GetAircraftMetadata(uint32_t icao_address, AircraftMetadata &metadata_out) const {
+    const Aircraft *aircraft = dict.Find(icao_address);
+    if (aircraft != nullptr) {
+        metadata_out = GetAircraftMetadata(*aircraft);
         return true;
     }
-    return false;
+    return false;  // aircraft not found
 }
 
+bool AircraftDictionary::ContainsAircraft(uint32_t icao_address) const { return dict.Contains(icao_address); }
+
 Aircraft *AircraftDictionary::GetAircraftPtr(uint32_t icao_address) {
-    auto itr = dict.find(icao_address);
-    if (itr != dict.end()) {
-        return &(itr->second);  // return address of existing aircraft
-    } else if (dict.size() < kMaxNumAircraft) {
-        Aircraft new_aircraft = Aircraft(icao_address);
-        dict[icao_address] = new_aircraft;
-        return &(dict[icao_address]);  // insert new aircraft and return its address
+    Aircraft *aircraft = dict.Find(icao_address);
+    if (aircraft != nullptr) {
+        return aircraft;  // return address of existing aircraft
     }
-    return nullptr;  // can't find the aircraft or insert a new one
+    // Insert new aircraft and return its address, or nullptr if the dictionary is full.
+    aircraft = dict.Insert(icao_address, Aircraft(icao_address));
+    if (aircraft != nullptr) {
+        GetAircraftMetadata(*aircraft) = AircraftMetadata();  // Don't inherit metadata from a removed aircraft.
+        aircraft_by_age_.PushOldest(dict.GetIndex(aircraft));  // New aircraft haven't sent a timestamped message yet.
+    }
+    return aircraft;
+}
+
+void AircraftDictionary::RefreshAircraft(Aircraft &aircraft, uint32_t timestamp_ms) {
+    aircraft.last_message_timestamp_ms = timestamp_ms;
+    aircraft_by_age_.MoveToNewest(dict.GetIndex(&aircraft));
+}
+
+Aircraft *AircraftDictionary::EraseAircraft(Aircraft *it) {
+    // Mirror the swap-on-erase done by dict, so that metadata and age ordering stay at the same index as the aircraft.
+    uint16_t index = dict.GetIndex(it);
+    uint16_t last_index = dict.Size() - 1;
+    aircraft_by_age_.Remove(index);
+    aircraft_by_age_.Relocate(last_index, index);
+    metadata_[index] = metadata_[last_index];
+    return dict.Erase(it);
 }
 
 /**
@@ -493,7 +588,7 @@ Aircraft::Category ExtractCategory(const ADSBPacket &packet) {
     }
 }
 
-bool AircraftDictionary::ApplyAircraftIDMessage(Aircraft &aircraft, ADSBPacket packet) {
+bool AircraftDictionary::ApplyAircraftIDMessage(Aircraft &aircraft, AircraftMetadata &metadata, ADSBPacket packet) {
     aircraft.category = ExtractCategory(packet);
     aircraft.category_raw = packet.GetNBitWordFromMessage(8, 0);
     aircraft.transponder_capability = packet.GetCapability();
@@ -506,12 +601,13 @@ bool AircraftDictionary::ApplyAircraftIDMessage(Aircraft &aircraft, ADSBPacket p
     return true;
 }
 
-bool AircraftDictionary::ApplySurfacePositionMessage(Aircraft &aircraft, ADSBPacket packet) {
+bool AircraftDictionary::ApplySurfacePositionMessage(Aircraft &aircraft, AircraftMetadata &metadata,
+                                                     ADSBPacket packet) {
     aircraft.WriteBitFlag(Aircraft::BitFlag::kBitFlagIsAirborne, false);
 
-    if (aircraft.NICBitIsValid(Aircraft::NICBit::kNICBitA) && aircraft.NICBitIsValid(Aircraft::NICBit::kNICBitC)) {
+    if (metadata.NICBitIsValid(Aircraft::NICBit::kNICBitA) && metadata.NICBitIsValid(Aircraft::NICBit::kNICBitC)) {
         // Assign NIC based on NIC supplement bits A and C and received TypeCode.
-        switch ((packet.GetTypeCode() << 3) | (aircraft.nic_bits & 0b101)) {
+        switch ((packet.GetTypeCode() << 3) | (metadata.nic_bits & 0b101)) {
             case (5 << 3) | 0b000:
                 aircraft.navigation_integrity_category = Aircraft::NICRadiusOfContainment::kROCLessThan7p5Meters;
                 break;
@@ -538,16 +634,41 @@ bool AircraftDictionary::ApplySurfacePositionMessage(Aircraft &aircraft, ADSBPac
                 aircraft.navigation_integrity_category = Aircraft::NICRadiusOfContainment::kROCUnknown;
                 break;
             default:
-                CONSOLE_WARNING("AircraftDictionary::ApplySurfacePositionMessage",
-                                "Unable to assign NIC with typecode %d and nic_bits %d.", packet.GetTypeCode(),
-                                aircraft.nic_bits);
+                CONSOLE_WARNING_DEFERRED("AircraftDictionary::ApplySurfacePositionMessage",
+                                         "Unable to assign NIC with typecode %d and nic_bits %d.", packet.GetTypeCode(),
+                                         metadata.nic_bits);
         }
     }
 
-    return false;
+    // ME[6-12] - Movement
+    float ground_speed_kts = SurfaceMovementToGroundSpeedKts(packet.GetNBitWordFromMessage(7, 5));
+    if (ground_speed_kts < 0.0f) {
+        aircraft.velocity_source = Aircraft::VelocitySource::kVelocitySourceNotAvailable;
+    } else {
+        aircraft.velocity_source = Aircraft::VelocitySource::kVelocitySourceGroundSpeed;
+        aircraft.velocity_kts = ground_speed_kts;
+        aircraft.WriteBitFlag(Aircraft::BitFlag::kBitFlagUpdatedHorizontalVelocity, true);
+    }
+
+    // ME[13] - Ground Track Status, ME[14-20] - Ground Track
+    if (packet.GetNBitWordFromMessage(1, 12)) {
+        aircraft.direction_deg = packet.GetNBitWordFromMessage(7, 13) * 360.0f / 128.0f;
+        aircraft.WriteBitFlag(Aircraft::BitFlag::kBitFlagDirectionIsHeading, false);
+        aircraft.WriteBitFlag(Aircraft::BitFlag::kBitFlagUpdatedTrack, true);
+    }
+
+    // ME[22] - CPR Format, ME[23-39] - CPR Latitude, ME[40-56] - CPR Longitude
+    bool odd = packet.GetNBitWordFromMessage(1, 21);
+    if (DecodeCPRPosition(aircraft, metadata, packet.GetNBitWordFromMessage(17, 22),
+                          packet.GetNBitWordFromMessage(17, 39), odd, true)) {
+        aircraft.WriteBitFlag(Aircraft::BitFlag::kBitFlagUpdatedPosition, true);
+    }
+
+    return true;
 }
 
-bool AircraftDictionary::ApplyAirbornePositionMessage(Aircraft &aircraft, ADSBPacket packet) {
+bool AircraftDictionary::ApplyAirbornePositionMessage(Aircraft &aircraft, AircraftMetadata &metadata,
+                                                      ADSBPacket packet) {
     aircraft.WriteBitFlag(Aircraft::BitFlag::kBitFlagIsAirborne, true);
     uint16_t typecode = packet.GetTypeCode();
 
@@ -572,11 +693,11 @@ bool AircraftDictionary::ApplyAirbornePositionMessage(Aircraft &aircraft, ADSBPa
     }
 
     // ME[7] - NIC B Supplement (Formerly Single Antenna Flag)
-    aircraft.WriteNICBit(Aircraft::NICBit::kNICBitB, packet.GetNBitWordFromMessage(1, 7));
+    metadata.WriteNICBit(Aircraft::NICBit::kNICBitB, packet.GetNBitWordFromMessage(1, 7));
 
-    if (aircraft.NICBitIsValid(Aircraft::NICBit::kNICBitA) && aircraft.NICBitIsValid(Aircraft::NICBit::kNICBitB)) {
+    if (metadata.NICBitIsValid(Aircraft::NICBit::kNICBitA) && metadata.NICBitIsValid(Aircraft::NICBit::kNICBitB)) {
         // Assign NIC based on NIC supplement bits A and B and received TypeCode.
-        switch ((typecode << 3) | (aircraft.nic_bits & 0b101)) {
+        switch ((typecode << 3) | (metadata.nic_bits & 0b101)) {
             case (9 << 3) | 0b000:
                 aircraft.navigation_integrity_category = Aircraft::NICRadiusOfContainment::kROCLessThan7p5Meters;
                 break;
@@ -629,9 +750,9 @@ bool AircraftDictionary::ApplyAirbornePositionMessage(Aircraft &aircraft, ADSBPa
                         aircraft.navigation_integrity_category = Aircraft::NICRadiusOfContainment::kROCUnknown;
                         break;
                     default:
-                        CONSOLE_WARNING("AircraftDictionary::ApplyAirbornePositionMessage",
-                                        "Unable to assign NIC with typecode %d and nic_bits %d.", typecode,
-                                        aircraft.nic_bits);
+                        CONSOLE_WARNING_DEFERRED("AircraftDictionary::ApplyAirbornePositionMessage",
+                                                 "Unable to assign NIC with typecode %d and nic_bits %d.", typecode,
+                                                 metadata.nic_bits);
                 }
         }
     }
@@ -642,8 +763,9 @@ bool AircraftDictionary::ApplyAirbornePositionMessage(Aircraft &aircraft, ADSBPa
             uint16_t encoded_altitude_ft_with_q_bit = static_cast<uint16_t>(packet.GetNBitWordFromMessage(12, 8));
             if (encoded_altitude_ft_with_q_bit == 0) {
                 aircraft.altitude_source = Aircraft::AltitudeSource::kAltitudeNotAvailable;
-                CONSOLE_WARNING("AIrcraftDictionary::ApplyAirbornePositionMessage",
-                                "Altitude information not available for aircraft 0x%lx.", aircraft.icao_address);
+                CONSOLE_WARNING_DEFERRED("AIrcraftDictionary::ApplyAirbornePositionMessage",
+                                         "Altitude information not available for aircraft 0x%lx.",
+                                         aircraft.icao_address);
                 decode_successful = false;
             } else {
                 aircraft.altitude_source = Aircraft::AltitudeSource::kAltitudeSourceBaro;
@@ -665,8 +787,8 @@ bool AircraftDictionary::ApplyAirbornePositionMessage(Aircraft &aircraft, ADSBPa
             break;
         }
         default:
-            CONSOLE_WARNING("AircraftDictionary::ApplyAirbornePositionMessage",
-                            "Received packet with unsupported typecode %d.", packet.GetTypeCode());
+            CONSOLE_WARNING_DEFERRED("AircraftDictionary::ApplyAirbornePositionMessage",
+                                     "Received packet with unsupported typecode %d.", packet.GetTypeCode());
             return false;
     }
 
@@ -677,26 +799,48 @@ bool AircraftDictionary::ApplyAirbornePositionMessage(Aircraft &aircraft, ADSBPa
     bool odd = packet.GetNBitWordFromMessage(1, 21);
 
     // ME[32-?]
-    aircraft.SetCPRLatLon(packet.GetNBitWordFromMessage(17, 22), packet.GetNBitWordFromMessage(17, 39), odd);
-    if (aircraft.CanDecodePosition()) {
-        if (!aircraft.DecodePosition()) {
-            CONSOLE_WARNING("ApplyAirbornePositionMessage", "DecodePosition failed for aircraft 0x%lx.\r\n",
-                            aircraft.icao_address);
-            decode_successful = false;
-        } else {
-            aircraft.WriteBitFlag(Aircraft::BitFlag::kBitFlagUpdatedPosition, true);
-        }
+    if (DecodeCPRPosition(aircraft, metadata, packet.GetNBitWordFromMessage(17, 22),
+                          packet.GetNBitWordFromMessage(17, 39), odd, false)) {
+        aircraft.WriteBitFlag(Aircraft::BitFlag::kBitFlagUpdatedPosition, true);
+    } else if (metadata.CanDecodePosition()) {
+        // Had a fresh odd/even pair to decode, but the decode failed and there was no reference to fall back on.
+        CONSOLE_WARNING_DEFERRED("ApplyAirbornePositionMessage", "DecodePosition failed for aircraft 0x%lx.\r\n",
+                                 aircraft.icao_address);
+        decode_successful = false;
     }
 
     return decode_successful;
 }
 
+bool AircraftDictionary::DecodeCPRPosition(Aircraft &aircraft, AircraftMetadata &metadata, uint32_t n_lat_cpr,
+                                           uint32_t n_lon_cpr, bool odd, bool surface) {
+    if (!surface) {
+        // Surface positions use a different zone size, so only airborne packets are paired up for global decoding.
+        if (!metadata.SetCPRLatLon(n_lat_cpr, n_lon_cpr, odd)) {
+            return false;
+        }
+        if (metadata.CanDecodePosition() && metadata.DecodePosition(aircraft)) {
+            return true;
+        }
+    }
+
+    // Aircraft can't have moved far since a recent position, so prefer it as the reference over the receiver position.
+    if (metadata.DecodePositionLocal(aircraft, n_lat_cpr, n_lon_cpr, odd, surface)) {
+        return true;
+    }
+    if (!reference_position_valid_) {
+        return false;  // No reference position available for a local decode.
+    }
+    return metadata.DecodePositionLocal(aircraft, n_lat_cpr, n_lon_cpr, odd, surface, reference_lat_, reference_lon_);
+}
+
 inline float wrapped_atan2f(float y, float x) {
     float val = atan2f(y, x);
     return val < 0.0f ? (val + (2.0f * M_PI)) : val;
 }
 
-bool AircraftDictionary::ApplyAirborneVelocitiesMessage(Aircraft &aircraft, ADSBPacket packet) {
+bool AircraftDictionary::ApplyAirborneVelocitiesMessage(Aircraft &aircraft, AircraftMetadata &metadata,
+                                                        ADSBPacket packet) {
     aircraft.WriteBitFlag(Aircraft::BitFlag::kBitFlagIsAirborne, true);
     bool decode_successful = true;
 
@@ -714,8 +858,8 @@ bool AircraftDictionary::ApplyAirborneVelocitiesMessage(Aircraft &aircraft, ADSB
             int v_ns_kts_plus_1 = static_cast<int>(packet.GetNBitWordFromMessage(10, 25));
             if (v_ew_kts_plus_1 == 0 || v_ns_kts_plus_1 == 0) {
                 aircraft.velocity_source = Aircraft::VelocitySource::kVelocitySourceNotAvailable;
-                CONSOLE_WARNING("AircraftDictionary::ApplyAirborneVelocitiesMessage",
-                                "Ground speed not available for aircraft 0x%lx.", aircraft.icao_address);
+                CONSOLE_WARNING_DEFERRED("AircraftDictionary::ApplyAirborneVelocitiesMessage",
+                                         "Ground speed not available for aircraft 0x%lx.", aircraft.icao_address);
                 decode_successful = false;
             } else {
                 aircraft.velocity_source = Aircraft::VelocitySource::kVelocitySourceGroundSpeed;
@@ -739,8 +883,8 @@ bool AircraftDictionary::ApplyAirborneVelocitiesMessage(Aircraft &aircraft, ADSB
         case ADSBPacket::AirborneVelocitiesSubtype::kAirborneVelocitiesAirspeedSubsonic: {
             int airspeed_kts_plus_1 = static_cast<int>(packet.GetNBitWordFromMessage(10, 25));
             if (airspeed_kts_plus_1 == 0) {
-                CONSOLE_WARNING("AircraftDictionary::ApplyAirborneVelocitiesMessage",
-                                "Airspeed not available for aircraft 0x%lx.", aircraft.icao_address);
+                CONSOLE_WARNING_DEFERRED("AircraftDictionary::ApplyAirborneVelocitiesMessage",
+                                         "Airspeed not available for aircraft 0x%lx.", aircraft.icao_address);
                 decode_successful = false;
             } else {
                 aircraft.velocity_kts = (airspeed_kts_plus_1 - 1) * (is_supersonic ? 4 : 1);
@@ -754,9 +898,9 @@ bool AircraftDictionary::ApplyAirborneVelocitiesMessage(Aircraft &aircraft, ADSB
             break;
         }
         default:
-            CONSOLE_ERROR("AircraftDictionary::ApplyAirborneVelocitiesMessage",
-                          "Encountered invalid airborne velocities message subtype %d (valid values are 1-4).",
-                          subtype);
+            CONSOLE_ERROR_DEFERRED("AircraftDictionary::ApplyAirborneVelocitiesMessage",
+                                   "Encountered invalid airborne velocities message subtype %d (valid values are 1-4).",
+                                   subtype);
             return false;  // Don't attempt vertical rate decode if message type is invalid.
     }
     aircraft.WriteBitFlag(Aircraft::BitFlag::kBitFlagUpdatedTrack, true);
@@ -766,8 +910,8 @@ bool AircraftDictionary::ApplyAirborneVelocitiesMessage(Aircraft &aircraft, ADSB
     int vertical_rate_magnitude_fpm = packet.GetNBitWordFromMessage(9, 37);
     if (vertical_rate_magnitude_fpm == 0) {
         aircraft.vertical_rate_source = Aircraft::VerticalRateSource::kVerticalRateNotAvailable;
-        CONSOLE_WARNING("AircraftDictionary::ApplyAirborneVelocitiesMessage",
-                        "Vertical rate not available for aircraft 0x%lx.", aircraft.icao_address);
+        CONSOLE_WARNING_DEFERRED("AircraftDictionary::ApplyAirborneVelocitiesMessage",
+                                 "Vertical rate not available for aircraft 0x%lx.", aircraft.icao_address);
         decode_successful = false;
     } else {
         aircraft.vertical_rate_source = static_cast<Aircraft::VerticalRateSource>(packet.GetNBitWordFromMessage(1, 35));
@@ -784,9 +928,9 @@ bool AircraftDictionary::ApplyAirborneVelocitiesMessage(Aircraft &aircraft, ADSB
     bool gnss_alt_below_baro_alt = static_cast<bool>(packet.GetNBitWordFromMessage(1, 48));
     uint16_t encoded_gnss_alt_baro_alt_difference_ft = static_cast<uint16_t>(packet.GetNBitWordFromMessage(7, 49));
     if (encoded_gnss_alt_baro_alt_difference_ft == 0) {
-        CONSOLE_WARNING("AircraftDictionary::ApplyAirborneVelocitiesMessage",
-                        "Difference between GNSS and baro altitude not available for aircraft 0x%lx.",
-                        aircraft.icao_address);
+        CONSOLE_WARNING_DEFERRED("AircraftDictionary::ApplyAirborneVelocitiesMessage",
+                                 "Difference between GNSS and baro altitude not available for aircraft 0x%lx.",
+                                 aircraft.icao_address);
         // Don't set decode_successful to false so that we ignore missing GNSS/Baro altitude info.
     } else {
         int gnss_alt_baro_alt_difference_ft =
@@ -809,11 +953,18 @@ bool AircraftDictionary::ApplyAirborneVelocitiesMessage(Aircraft &aircraft, ADSB
     return decode_successful;
 }
 
-bool AircraftDictionary::ApplyAircraftStatusMessage(Aircraft &aircraft, ADSBPacket packet) { return false; }
+bool AircraftDictionary::ApplyAircraftStatusMessage(Aircraft &aircraft, AircraftMetadata &metadata,
+                                                    ADSBPacket packet) {
+    return false;
+}
 
-bool AircraftDictionary::ApplyTargetStateAndStatusInfoMessage(Aircraft &aircraft, ADSBPacket packet) { return false; }
+bool AircraftDictionary::ApplyTargetStateAndStatusInfoMessage(Aircraft &aircraft, AircraftMetadata &metadata,
+                                                              ADSBPacket packet) {
+    return false;
+}
 
-bool AircraftDictionary::ApplyAircraftOperationStatusMessage(Aircraft &aircraft, ADSBPacket packet) {
+bool AircraftDictionary::ApplyAircraftOperationStatusMessage(Aircraft &aircraft, AircraftMetadata &metadata,
+                                                             ADSBPacket packet) {
     // TODO: get nac/navigation_integrity_category, and supplement airborne status from here.
     // https://mode-s.org/decode/content/ads-b/6-operation-status.html
     // More about navigation_integrity_category/nac here: https://mode-s.org/decode/content/ads-b/7-uncertainty.html
@@ -835,17 +986,17 @@ bool AircraftDictionary::ApplyAircraftOperationStatusMessage(Aircraft &aircraft,
     // ME[29] - Single Antenna Flag
     aircraft.WriteBitFlag(Aircraft::BitFlag::kBitFlagSingleAntenna, packet.GetNBitWordFromMessage(1, 29));
     // ME[30-31] - System Design Assurance
-    aircraft.system_design_assurance =
+    metadata.system_design_assurance =
         static_cast<Aircraft::SystemDesignAssurance>(packet.GetNBitWordFromMessage(2, 30));
 
     // ME[40-42] - ADS-B Version Number
-    aircraft.adsb_version = packet.GetNBitWordFromMessage(3, 40);
+    metadata.adsb_version = packet.GetNBitWordFromMessage(3, 40);
 
     // ME[43] - NIC Supplement A
-    aircraft.WriteNICBit(Aircraft::NICBit::kNICBitC, packet.GetNBitWordFromMessage(1, 43));
+    metadata.WriteNICBit(Aircraft::NICBit::kNICBitC, packet.GetNBitWordFromMessage(1, 43));
 
     // ME[44-47] - Navigational Accuracy Category, Position
-    aircraft.navigation_accuracy_category_position =
+    metadata.navigation_accuracy_category_position =
         static_cast<Aircraft::NACEstimatedPositionUncertainty>(packet.GetNBitWordFromMessage(4, 44));
 
     // ME[50-51] - Source Integrity Level (SIL)
@@ -854,7 +1005,7 @@ bool AircraftDictionary::ApplyAircraftOperationStatusMessage(Aircraft &aircraft,
     aircraft.WriteBitFlag(Aircraft::BitFlag::kBitFlagHeadingUsesMagneticNorth, packet.GetNBitWordFromMessage(1, 53));
     // ME[54] - SIL Supplement
     uint8_t sil_supplement = packet.GetNBitWordFromMessage(1, 54);
-    aircraft.source_integrity_level = static_cast<Aircraft::SILProbabilityOfExceedingNICRadiusOfContainmnent>(
+    metadata.source_integrity_level = static_cast<Aircraft::SILProbabilityOfExceedingNICRadiusOfContainmnent>(
         (sil_supplement << 2) | source_integrity_level);
 
     // Conditional fields (meaning depends on subtype).
@@ -871,10 +1022,10 @@ bool AircraftDictionary::ApplyAircraftOperationStatusMessage(Aircraft &aircraft,
             aircraft.WriteBitFlag(Aircraft::BitFlag::kBitFlagHasUATIn, packet.GetNBitWordFromMessage(1, 18));
 
             // ME[48-49] - GVA
-            aircraft.geometric_vertical_accuracy = static_cast<Aircraft::GVA>(packet.GetNBitWordFromMessage(2, 48));
+            metadata.geometric_vertical_accuracy = static_cast<Aircraft::GVA>(packet.GetNBitWordFromMessage(2, 48));
 
             // ME[52] - NIC Baro
-            aircraft.navigation_integrity_category_baro =
+            metadata.navigation_integrity_category_baro =
                 static_cast<Aircraft::NICBarometricAltitudeIntegrity>(packet.GetNBitWordFromMessage(1, 52));
 
             break;
@@ -887,76 +1038,76 @@ bool AircraftDictionary::ApplyAircraftOperationStatusMessage(Aircraft &aircraft,
             // ME[15] - UAT In
             aircraft.WriteBitFlag(Aircraft::BitFlag::kBitFlagHasUATIn, packet.GetNBitWordFromMessage(1, 15));
             // ME[16-18] - NACv
-            aircraft.navigation_accuracy_category_velocity =
+            metadata.navigation_accuracy_category_velocity =
                 static_cast<Aircraft::NACHorizontalVelocityError>(packet.GetNBitWordFromMessage(3, 16));
             // ME[19] - NIC Supplement C
-            aircraft.WriteNICBit(Aircraft::NICBit::kNICBitC, packet.GetNBitWordFromMessage(1, 19));
+            metadata.WriteNICBit(Aircraft::NICBit::kNICBitC, packet.GetNBitWordFromMessage(1, 19));
 
             // ME[20-23] Aircraft/Vehicle Length and Width Code
             switch (packet.GetNBitWordFromMessage(4, 20)) {
                 case 0:
-                    aircraft.length_m = 0;
-                    aircraft.width_m = 0;
+                    metadata.length_m = 0;
+                    metadata.width_m = 0;
                     break;
                 case 1:
-                    aircraft.length_m = 15;
-                    aircraft.width_m = 23;
+                    metadata.length_m = 15;
+                    metadata.width_m = 23;
                     break;
                 case 2:
-                    aircraft.length_m = 25;
-                    aircraft.width_m = 29;  // Rounded up from 28.5.
+                    metadata.length_m = 25;
+                    metadata.width_m = 29;  // Rounded up from 28.5.
                     break;
                 case 3:
-                    aircraft.length_m = 25;
-                    aircraft.width_m = 34;
+                    metadata.length_m = 25;
+                    metadata.width_m = 34;
                     break;
                 case 4:
-                    aircraft.length_m = 35;
-                    aircraft.width_m = 33;
+                    metadata.length_m = 35;
+                    metadata.width_m = 33;
                     break;
                 case 5:
-                    aircraft.length_m = 35;
-                    aircraft.width_m = 38;
+                    metadata.length_m = 35;
+                    metadata.width_m = 38;
                     break;
                 case 6:
-                    aircraft.length_m = 45;
-                    aircraft.width_m = 40;  // Rounded up from 39.5.
+                    metadata.length_m = 45;
+                    metadata.width_m = 40;  // Rounded up from 39.5.
                     break;
                 case 7:
-                    aircraft.length_m = 45;
-                    aircraft.width_m = 45;
+                    metadata.length_m = 45;
+                    metadata.width_m = 45;
                     break;
                 case 8:
-                    aircraft.length_m = 55;
-                    aircraft.width_m = 45;
+                    metadata.length_m = 55;
+                    metadata.width_m = 45;
                     break;
                 case 9:
-                    aircraft.length_m = 55;
-                    aircraft.width_m = 52;
+                    metadata.length_m = 55;
+                    metadata.width_m = 52;
                     break;
                 case 10:
-                    aircraft.length_m = 65;
-                    aircraft.width_m = 60;  // Rounded up from 59.5.
+                    metadata.length_m = 65;
+                    metadata.width_m = 60;  // Rounded up from 59.5.
                     break;
                 case 11:
-                    aircraft.length_m = 65;
-                    aircraft.width_m = 67;
+                    metadata.length_m = 65;
+                    metadata.width_m = 67;
                     break;
                 case 12:
-                    aircraft.length_m = 75;
-                    aircraft.width_m = 73;  // Rounded up from 72.5.
+                    metadata.length_m = 75;
+                    metadata.width_m = 73;  // Rounded up from 72.5.
                     break;
                 case 13:
-                    aircraft.length_m = 75;
-                    aircraft.width_m = 80;
+                    metadata.length_m = 75;
+                    metadata.width_m = 80;
                     break;
                 case 14:
-                    aircraft.length_m = 85;
-                    aircraft.width_m = 80;
+                    metadata.length_m = 85;
+                    metadata.width_m = 80;
                     break;
                 case 15:
-                    aircraft.length_m = 85;
-                    aircraft.width_m = 90;
+                    metadata.length_m = 85;
+                    metadata.width_m = 90;
                     break;
             }
 
@@ -966,25 +1117,25 @@ bool AircraftDictionary::ApplyAircraftOperationStatusMessage(Aircraft &aircraft,
                 case 0b000:  // No data.
                     break;
                 case 0b001:  // 2 meters left of roll axis.
-                    aircraft.gnss_antenna_offset_right_of_roll_axis_m = -2;
+                    metadata.gnss_antenna_offset_right_of_roll_axis_m = -2;
                     break;
                 case 0b010:  // 4 meters left of roll axis.
-                    aircraft.gnss_antenna_offset_right_of_roll_axis_m = -4;
+                    metadata.gnss_antenna_offset_right_of_roll_axis_m = -4;
                     break;
                 case 0b011:  // 6 meters left of roll axis.
-                    aircraft.gnss_antenna_offset_right_of_roll_axis_m = -6;
+                    metadata.gnss_antenna_offset_right_of_roll_axis_m = -6;
                     break;
                 case 0b100:  // Centered on roll axis.
-                    aircraft.gnss_antenna_offset_right_of_roll_axis_m = 0;
+                    metadata.gnss_antenna_offset_right_of_roll_axis_m = 0;
                     break;
                 case 0b101:  // 2 meters right of roll axis.
-                    aircraft.gnss_antenna_offset_right_of_roll_axis_m = 2;
+                    metadata.gnss_antenna_offset_right_of_roll_axis_m = 2;
                     break;
                 case 0b110:  // 4 meters right of roll axis.
-                    aircraft.gnss_antenna_offset_right_of_roll_axis_m = 4;
+                    metadata.gnss_antenna_offset_right_of_roll_axis_m = 4;
                     break;
                 case 0b111:  // 6 meters right of roll axis.
-                    aircraft.gnss_antenna_offset_right_of_roll_axis_m = 6;
+                    metadata.gnss_antenna_offset_right_of_roll_axis_m = 6;
                     break;
             }
 
@@ -994,9 +1145,9 @@ bool AircraftDictionary::ApplyAircraftOperationStatusMessage(Aircraft &aircraft,
             break;
         }
         default:
-            CONSOLE_ERROR("AircraftDictionary::ApplyAircraftOperationStatusMessage",
-                          "Received unsupported Operation Status (TC=31) message subtype %d. Expected 0 or 1.",
-                          subtype);
+            CONSOLE_ERROR_DEFERRED("AircraftDictionary::ApplyAircraftOperationStatusMessage",
+                                   "Received unsupported Operation Status (TC=31) message subtype %d. Expected 0 or 1.",
+                                   subtype);
             return false;
     }
     return true;
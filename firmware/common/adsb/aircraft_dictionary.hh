@@ -3,8 +3,9 @@
 
 #include <cstdio>
 #include <cstring>
-#include <unordered_map>
 
+#include "data_structures.hh"  // For StaticHashMap and StaticLRUList.
+#include "decode_utils.hh"     // For binary angle conversions.
 #include "json_utils.hh"
 #include "transponder_packet.hh"
 
@@ -166,6 +167,74 @@ class Aircraft {
     Aircraft(uint32_t icao_address_in);
     Aircraft();
 
+    /**
+     * Set or clear a bit on the Aircraft.
+     */
+    inline void WriteBitFlag(BitFlag bit, bool value) { value ? flags |= (0b1 << bit) : flags &= ~(0b1 << bit); }
+
+    /**
+     * Checks whether a flag bit is set.
+     * @param[in] bit Position of bit to check.
+     * @retval True if bit has been set, false if bit has been cleared.
+     */
+    inline bool HasBitFlag(BitFlag bit) const { return flags & (0b1 << bit) ? true : false; }
+
+    /**
+     * Resets just the flag bits that show that something updated within the last reporting interval.
+     */
+    inline void ResetUpdatedBitFlags() { flags &= ~(~0b0 << kBitFlagUpdatedBaroAltitude); }
+
+    // Aircraft holds the state vector that gets read by the reporters every reporting interval. Integrity bookkeeping,
+    // CPR decoding state, and other rarely read fields live in AircraftMetadata, which the AircraftDictionary stores in
+    // a separate array so that walking the dictionary only touches the state vectors.
+
+    uint32_t flags = 0b0;
+    uint32_t icao_address = 0;
+
+    uint32_t last_message_timestamp_ms = 0;
+    int16_t last_message_signal_strength_dbm = 0;  // Voltage of RSSI signal during message receipt.
+    int16_t last_message_signal_quality_db = 0;    // Ratio of RSSI to noise floor during message receipt.
+
+    uint16_t transponder_capability = 0;
+    uint16_t squawk = 0;
+    char callsign[kCallSignMaxNumChars + 1] = "?";  // put extra EOS character at end
+    Category category = kCategoryInvalid;
+    uint8_t category_raw = 0;  // Non-enum category in case we want the value without a many to one mapping.
+    NICRadiusOfContainment navigation_integrity_category = kROCUnknown;  // 4 bits. Reported alongside position.
+
+    int32_t baro_altitude_ft = 0;
+    int32_t gnss_altitude_ft = 0;
+    AltitudeSource altitude_source = kAltitudeSourceNotSet;
+
+    // Airborne Position Message
+    float latitude_deg = 0.0f;
+    float longitude_deg = 0.0f;
+
+    // Airborne Velocities Message
+    float direction_deg = 0.0f;
+    float velocity_kts = 0;
+    VelocitySource velocity_source = kVelocitySourceNotSet;
+    VerticalRateSource vertical_rate_source = kVerticalRateSourceNotSet;
+    int vertical_rate_fpm = 0.0f;
+};
+
+/**
+ * Rarely read information about an aircraft: integrity and accuracy categories, dimensions, CPR decoding state, and
+ * metrics counters. Stored alongside the Aircraft state vector with the same ICAO address.
+ */
+class AircraftMetadata {
+   public:
+    static const uint32_t kMetricsIntervalMs = 1000;
+    // Odd and even CPR packets received further apart than this aren't used together for a global position decode,
+    // since the aircraft may have moved too far in between for them to describe the same position.
+    static const uint32_t kCPRMaxPairAgeMs = 10e3;
+    // A decoded position younger than this is used as the reference for locally decoding the aircraft's next position.
+    static const uint32_t kCPRMaxReferenceAgeMs = 10e3;
+    // Positions decoded relative to the receiver are only unambiguous within half a CPR zone of it. Anything further
+    // away is more likely a decode into the wrong zone than a real aircraft, so it's thrown out.
+    static const uint16_t kCPRMaxAirborneReceiverRangeNm = 180;
+    static const uint16_t kCPRMaxSurfaceReceiverRangeNm = 45;
+
     /**
      * Set an aircraft's position in Compact Position Reporting (CPR) format. Takes either an even or odd set of lat/lon
      * coordinates and uses them to set the aircraft's position.
@@ -186,36 +255,58 @@ class Aircraft {
      * @retval True if decode can be attempted, false otherwise.
      */
     bool CanDecodePosition() {
-        return last_odd_packet_.received_timestamp_ms > 0 && last_even_packet_.received_timestamp_ms > 0;
+        return last_odd_packet_.received_timestamp_ms > 0 && last_even_packet_.received_timestamp_ms > 0 &&
+               CPRPairIsFresh();
     }
 
     /**
-     * Decodes the aircraft position using last_odd_packet_ and last_even_packet_.
+     * Decodes the aircraft position using last_odd_packet_ and last_even_packet_ (global decode).
+     * @param[out] aircraft Aircraft state vector to publish the decoded position to.
      * @retval True if position was decoded successfully, false otherwise.
      */
-    bool DecodePosition();
+    bool DecodePosition(Aircraft &aircraft);
 
     /**
-     * Indicate that a frame has been received by incrementing the corresponding frame counter.
-     * @param[in] is_extended_squitter Set to true if the frame received was a Mode S frame.
+     * Decodes the aircraft position from a single CPR packet, using the aircraft's own recent verified position as the
+     * reference (local decode).
+     * @param[out] aircraft Aircraft state vector to publish the decoded position to.
+     * @param[in] n_lat_cpr 17-bit latitude count.
+     * @param[in] n_lon_cpr 17-bit longitude count.
+     * @param[in] odd True if the packet uses the odd CPR grid, false for the even grid.
+     * @param[in] surface True if the packet is a surface position message, false for airborne.
+     * @retval True if position was decoded successfully, false if there was no recent verified position or the decode
+     * failed.
      */
-    inline void IncrementNumFramesReceived(bool is_extended_squitter = false) {
-        is_extended_squitter ? metrics_counter_.valid_extended_squitter_frames++
-                             : metrics_counter_.valid_squitter_frames++;
-    }
+    bool DecodePositionLocal(Aircraft &aircraft, uint32_t n_lat_cpr, uint32_t n_lon_cpr, bool odd, bool surface);
 
     /**
-     * Roll the metrics counter over to the public metrics field.
+     * Decodes the aircraft position from a single CPR packet using the receiver position as the reference (local
+     * decode). The result is range checked against the receiver, and isn't verified until a global decode confirms it.
+     * @param[out] aircraft Aircraft state vector to publish the decoded position to.
+     * @param[in] n_lat_cpr 17-bit latitude count.
+     * @param[in] n_lon_cpr 17-bit longitude count.
+     * @param[in] odd True if the packet uses the odd CPR grid, false for the even grid.
+     * @param[in] surface True if the packet is a surface position message, false for airborne.
+     * @param[in] reference_lat Reference latitude, as a binary angle. Must be within half a CPR zone of the aircraft.
+     * @param[in] reference_lon Reference longitude, as a binary angle.
+     * @retval True if position was decoded successfully, false if the decode failed or was out of range.
      */
-    inline void UpdateMetrics() {
-        metrics = metrics_counter_;
-        metrics_counter_ = Metrics();
-    }
+    bool DecodePositionLocal(Aircraft &aircraft, uint32_t n_lat_cpr, uint32_t n_lon_cpr, bool odd, bool surface,
+                             int32_t reference_lat, int32_t reference_lon);
 
     /**
-     * Set or clear a bit on the Aircraft.
+     * Indicate that a frame has been received by incrementing the corresponding frame counter. Rolls the counters over
+     * first if a new metrics interval has started since the last frame was received.
+     * @param[in] is_extended_squitter Set to true if the frame received was a Mode S frame.
      */
-    inline void WriteBitFlag(BitFlag bit, bool value) { value ? flags |= (0b1 << bit) : flags &= ~(0b1 << bit); }
+    void IncrementNumFramesReceived(bool is_extended_squitter = false);
+
+    /**
+     * Returns the number of frames received from the aircraft during the last complete metrics interval. Metrics are
+     * rolled over lazily based on the current time, so there is no need to visit every aircraft when an interval ends.
+     * @retval Frame counts from the last complete metrics interval.
+     */
+    Aircraft::Metrics GetMetrics() const;
 
     /**
      * Write a value for a NIC supplement bit. Used to piece together a NIC from separate messages, so that the NIC can
@@ -223,7 +314,7 @@ class Aircraft {
      * @param[in] bit NIC supplement bit to write.
      * @param[in] value Value to write to the bit.
      */
-    inline void WriteNICBit(NICBit bit, bool value) {
+    inline void WriteNICBit(Aircraft::NICBit bit, bool value) {
         value ? nic_bits |= (0b1 << bit) : nic_bits &= ~(0b1 << bit);
         // FIXME: Permanently setting NIC bits valid like this can cause invalid navigation integrity values to be read
         // if a stale NIC supplement bit is being used. Hopefully this isn't a big problem if NIC values don't change
@@ -237,103 +328,94 @@ class Aircraft {
      * @param[in] bit NIC supplement bit to check.
      * @retval True if bit has been written to, false otherwise.
      */
-    inline bool NICBitIsValid(NICBit bit) { return nic_bits & (0b1 << bit); }
-
-    /**
-     * Checks whether a flag bit is set.
-     * @param[in] bit Position of bit to check.
-     * @retval True if bit has been set, false if bit has been cleared.
-     */
-    inline bool HasBitFlag(BitFlag bit) const { return flags & (0b1 << bit) ? true : false; }
-
-    /**
-     * Resets just the flag bits that show that something updated within the last reporting interval.
-     */
-    inline void ResetUpdatedBitFlags() { flags &= ~(~0b0 << kBitFlagUpdatedBaroAltitude); }
-
-    uint32_t flags = 0b0;
-
-    uint32_t last_message_timestamp_ms = 0;
-    int16_t last_message_signal_strength_dbm = 0;  // Voltage of RSSI signal during message receipt.
-    int16_t last_message_signal_quality_db = 0;    // Ratio of RSSI to noise floor during message receipt.
-    Metrics metrics;
-
-    uint16_t transponder_capability = 0;
-    uint32_t icao_address = 0;
-    char callsign[kCallSignMaxNumChars + 1] = "?";  // put extra EOS character at end
-    uint16_t squawk = 0;
-    Category category = kCategoryInvalid;
-    uint8_t category_raw = 0;  // Non-enum category in case we want the value without a many to one mapping.
-
-    int32_t baro_altitude_ft = 0;
-    int32_t gnss_altitude_ft = 0;
-    AltitudeSource altitude_source = kAltitudeSourceNotSet;
-
-    // Airborne Position Message
-    float latitude_deg = 0.0f;
-    float longitude_deg = 0.0f;
-
-    // Airborne Velocities Message
-    float direction_deg = 0.0f;
-    float velocity_kts = 0;
-    VelocitySource velocity_source = kVelocitySourceNotSet;
-    int vertical_rate_fpm = 0.0f;
-    VerticalRateSource vertical_rate_source = kVerticalRateSourceNotSet;
+    inline bool NICBitIsValid(Aircraft::NICBit bit) { return nic_bits & (0b1 << bit); }
 
     // Aircraft Operation Status Message
     // Navigation Integrity Category (NIC)
     uint8_t nic_bits_valid = 0b000;  // MSb to LSb: nic_c_valid nic_b_valid nic_a_valid.
     uint8_t nic_bits = 0b000;        // MSb to LSb: nic_c nic_b nic_a.
-    NICRadiusOfContainment navigation_integrity_category = kROCUnknown;  // 4 bits.
-    NICBarometricAltitudeIntegrity navigation_integrity_category_baro =
-        kBAIGillhamInputNotCrossChecked;  // 1 bit. Default to worst case.
+    Aircraft::NICBarometricAltitudeIntegrity navigation_integrity_category_baro =
+        Aircraft::kBAIGillhamInputNotCrossChecked;  // 1 bit. Default to worst case.
     // Navigation Accuracy Category (NAC)
-    NACHorizontalVelocityError navigation_accuracy_category_velocity =
-        kHVEUnknownOrGreaterThanOrEqualTo10MetersPerSecond;  // 3 bits.
-    NACEstimatedPositionUncertainty navigation_accuracy_category_position =
-        kEPUUnknownOrGreaterThanOrEqualTo10NauticalMiles;  // 4 bits.
+    Aircraft::NACHorizontalVelocityError navigation_accuracy_category_velocity =
+        Aircraft::kHVEUnknownOrGreaterThanOrEqualTo10MetersPerSecond;  // 3 bits.
+    Aircraft::NACEstimatedPositionUncertainty navigation_accuracy_category_position =
+        Aircraft::kEPUUnknownOrGreaterThanOrEqualTo10NauticalMiles;  // 4 bits.
     // Geometric Vertical Accuracy (GVA)
-    GVA geometric_vertical_accuracy = kGVAUnknownOrGreaterThan150Meters;  // 2 bits.
-    SILProbabilityOfExceedingNICRadiusOfContainmnent source_integrity_level =
-        kPOERCUnknownOrGreaterThan1em3PerFlightHour;  // 3 bits.
+    Aircraft::GVA geometric_vertical_accuracy = Aircraft::kGVAUnknownOrGreaterThan150Meters;  // 2 bits.
+    Aircraft::SILProbabilityOfExceedingNICRadiusOfContainmnent source_integrity_level =
+        Aircraft::kPOERCUnknownOrGreaterThan1em3PerFlightHour;  // 3 bits.
     // System Design Assurance
-    SystemDesignAssurance system_design_assurance = kSDASupportedFailureUnknownOrNoSafetyEffect;  // 2 bits.
+    Aircraft::SystemDesignAssurance system_design_assurance =
+        Aircraft::kSDASupportedFailureUnknownOrNoSafetyEffect;  // 2 bits.
     // GPS Antenna Offset
     int8_t gnss_antenna_offset_right_of_roll_axis_m =
         INT8_MAX;  // Defaults to INT8_MAX to indicate it hasn't been read yet.
+    int8_t adsb_version = -1;
     // Aircraft dimensions (on the ground).
     uint16_t length_m = 0;
     uint16_t width_m = 0;
 
-    int8_t adsb_version = -1;
-
    private:
     struct CPRPacket {
-        // SetCPRLatLon values.
         uint32_t received_timestamp_ms = 0;  // [ms] time since boot when packet was recorded
         uint32_t n_lat = 0;                  // 17-bit latitude count
         uint32_t n_lon = 0;                  // 17-bit longitude count
-
-        // DecodePosition values.
-        uint32_t calculated_timestamp_ms = 0;  // [ms] time since boot when packet was calculated
-        float lat_cpr = 0.0f;
-        float lon_cpr = 0.0f;
-        uint16_t nl_cpr = 0;  // number of longitude cells in latitude band
-        float lat =
-            0.0f;  // only keep latitude since it's reused in cooperative calculations between odd and even packets
-        // float lon = 0.0f; // longitude
     };
 
+    /**
+     * Returns the aircraft's last decoded position, and whether it is recent enough to be used as the reference for a
+     * local decode of its next position.
+     * @param[out] lat Last decoded latitude, as a binary angle.
+     * @param[out] lon Last decoded longitude, as a binary angle.
+     * @retval True if the position was decoded within the last kCPRMaxReferenceAgeMs, false otherwise.
+     */
+    bool GetRecentPosition(int32_t &lat, int32_t &lon) const;
+
+    /**
+     * Records a decoded position and publishes it to the aircraft state vector.
+     * @param[out] aircraft Aircraft state vector to publish the position to.
+     * @param[in] lat Decoded latitude, as a binary angle.
+     * @param[in] lon Decoded longitude, as a binary angle.
+     * @param[in] verified True if the position came from a global decode, or a local decode relative to a verified
+     * position.
+     */
+    void PublishPosition(Aircraft &aircraft, int32_t lat, int32_t lon, bool verified);
+
+    /**
+     * Checks whether last_odd_packet_ and last_even_packet_ were received close enough together to be decoded as a
+     * pair.
+     * @retval True if the packets are less than kCPRMaxPairAgeMs apart, false otherwise.
+     */
+    bool CPRPairIsFresh() const {
+        uint32_t odd_ms = last_odd_packet_.received_timestamp_ms;
+        uint32_t even_ms = last_even_packet_.received_timestamp_ms;
+        return (odd_ms > even_ms ? odd_ms - even_ms : even_ms - odd_ms) < kCPRMaxPairAgeMs;
+    }
+
     CPRPacket last_odd_packet_;
     CPRPacket last_even_packet_;
-
-    Metrics metrics_counter_;
+    // Last decoded position, kept at full precision to use as the reference for local decoding.
+    uint32_t position_timestamp_ms_ = 0;  // [ms] time since boot when position was last decoded
+    int32_t position_lat_ = 0;            // binary angle
+    int32_t position_lon_ = 0;            // binary angle
+    bool position_verified_ = false;      // position is traceable to a global decode
+
+    uint32_t metrics_interval_ = 0;       // Metrics interval (time since boot / kMetricsIntervalMs) being counted.
+    Aircraft::Metrics metrics_counter_;  // Frames received during metrics_interval_.
+    Aircraft::Metrics metrics_;          // Frames received during the interval before metrics_interval_.
 };
 
+// Capacity of the aircraft dictionary. Can be overridden at build time with a compile definition, e.g. to benchmark
+// a larger dictionary on the host.
+#ifndef ADSBEE_MAX_NUM_AIRCRAFT
+#define ADSBEE_MAX_NUM_AIRCRAFT 100
+#endif
+
 class AircraftDictionary {
    public:
-    static const uint16_t kMaxNumAircraft = 100;
-    static const uint16_t kMaxNumSources = 3;
+    static const uint16_t kMaxNumAircraft = ADSBEE_MAX_NUM_AIRCRAFT;
+    static const uint16_t kMaxNumSources = 4;  // One per demodulator state machine, up to all 4 on a PIO block.
 
     struct AircraftDictionaryConfig_t {
         uint32_t aircraft_prune_interval_ms = 60e3;
@@ -346,13 +428,17 @@ class AircraftDictionary {
         uint32_t valid_squitter_frames = 0;
         uint32_t raw_extended_squitter_frames = 0;
         uint32_t valid_extended_squitter_frames = 0;
+        uint32_t corrected_extended_squitter_frames = 0;  // Subset of valid_extended_squitter_frames.
         uint32_t demods_1090 = 0;
+        uint32_t demod_overlaps_1090 = 0;  // Subset of demods_1090 that began while another demodulator was busy.
 
         uint16_t raw_squitter_frames_by_source[kMaxNumSources] = {0};
         uint16_t valid_squitter_frames_by_source[kMaxNumSources] = {0};
         uint16_t raw_extended_squitter_frames_by_source[kMaxNumSources] = {0};
         uint16_t valid_extended_squitter_frames_by_source[kMaxNumSources] = {0};
+        uint16_t corrected_extended_squitter_frames_by_source[kMaxNumSources] = {0};
         uint16_t demods_1090_by_source[kMaxNumSources] = {0};
+        uint16_t demod_overlaps_1090_by_source[kMaxNumSources] = {0};
 
         /**
          * Formats the metrics dictionary into a JSON packet with the following structure.
@@ -361,12 +447,16 @@ class AircraftDictionary {
          *      "valid_squitter_frames": 7,
          *      "raw_extended_squitter_frames": 30,
          *      "valid_extended_squitter_frames": 16,
+         *      "corrected_extended_squitter_frames": 4,
          *      "demods_1090": 50,
-         *      "raw_squitter_frames_by_source": [3, 3, 4],
-         *      "valid_squitter_frames_by_source": [2, 2, 3],
-         *      "raw_extended_squitter_frames_by_source": [10, 11, 9],
-         *      "valid_squitter_frames_by_source": [4, 4, 8],
-         *      "demods_1090_by_source": [20, 10, 20]
+         *      "demod_overlaps_1090": 6,
+         *      "raw_squitter_frames_by_source": [3, 3, 4, 0],
+         *      "valid_squitter_frames_by_source": [2, 2, 3, 0],
+         *      "raw_extended_squitter_frames_by_source": [10, 11, 9, 0],
+         *      "valid_squitter_frames_by_source": [4, 4, 8, 0],
+         *      "corrected_extended_squitter_frames_by_source": [1, 1, 2, 0],
+         *      "demods_1090_by_source": [20, 10, 20, 0],
+         *      "demod_overlaps_1090_by_source": [0, 4, 2, 0]
          * }
          * @param[in] buf Buffer to write the JSON string to.
          * @param[in] buf_len Length of the buffer, including the null terminator.
@@ -376,9 +466,11 @@ class AircraftDictionary {
             snprintf(buf, message_max_len - strlen(buf),
                      "{ \"raw_squitter_frames\": %lu, \"valid_squitter_frames\": %lu, "
                      "\"raw_extended_squitter_frames\": %lu, "
-                     "\"valid_extended_squitter_frames\": %lu, \"demods_1090\": %lu, ",
+                     "\"valid_extended_squitter_frames\": %lu, \"corrected_extended_squitter_frames\": %lu, "
+                     "\"demods_1090\": %lu, \"demod_overlaps_1090\": %lu, ",
                      raw_squitter_frames, valid_squitter_frames, raw_extended_squitter_frames,
-                     valid_extended_squitter_frames, demods_1090);
+                     valid_extended_squitter_frames, corrected_extended_squitter_frames, demods_1090,
+                     demod_overlaps_1090);
             uint16_t chars_written = strlen(buf);
             chars_written += ArrayToJSON(buf + chars_written, buf_len - chars_written, "raw_squitter_frames_by_source",
                                          raw_squitter_frames_by_source, "%u", true);
@@ -391,8 +483,13 @@ class AircraftDictionary {
             chars_written +=
                 ArrayToJSON(buf + chars_written, buf_len - chars_written, "valid_extended_squitter_frames_by_source",
                             valid_extended_squitter_frames_by_source, "%u", true);
-            chars_written += ArrayToJSON(buf + strlen(buf), buf_len - strlen(buf), "demods_1090_by_source",
-                                         demods_1090_by_source, "%u",
+            chars_written += ArrayToJSON(buf + chars_written, buf_len - chars_written,
+                                         "corrected_extended_squitter_frames_by_source",
+                                         corrected_extended_squitter_frames_by_source, "%u", true);
+            chars_written += ArrayToJSON(buf + chars_written, buf_len - chars_written, "demods_1090_by_source",
+                                         demods_1090_by_source, "%u", true);
+            chars_written += ArrayToJSON(buf + chars_written, buf_len - chars_written, "demod_overlaps_1090_by_source",
+                                         demod_overlaps_1090_by_source, "%u",
                                          false);  // No trailing comma.
             chars_written += snprintf(buf + chars_written, buf_len - chars_written, "}");
             return chars_written;
@@ -415,20 +512,37 @@ class AircraftDictionary {
     void Init();
 
     /**
-     * Prunes stale aircraft from the dictionary.
-     * @param[in] timestamp_us Current timestamp, in microseconds, to use for pruning. Aircraft older than timestamp_us
+     * Prunes stale aircraft from the dictionary and rolls over the dictionary metrics. Aircraft are kept in order of
+     * last_message_timestamp_ms, so only the aircraft being removed get visited.
+     * @param[in] timestamp_ms Current timestamp, in milliseconds, to use for pruning. Aircraft older than timestamp_ms
      * minus the pruning interval will be removed.
      */
-    void Update(uint32_t timestamp_us);
+    void Update(uint32_t timestamp_ms);
+
+    /**
+     * Log attempted demodulations on 1090MHz. Used to record performance statistics. Note that the increment won't be
+     * visible until the next dictionary update occurs. Not safe to call from an ISR while another context may be
+     * updating the dictionary.
+     * @param[in] source Index of the demodulator that made the attempts.
+     * @param[in] num_demods Number of attempted demodulations to log.
+     */
+    void RecordDemod1090(int16_t source = -1, uint32_t num_demods = 1) {
+        metrics_counter_.demods_1090 += num_demods;
+        if (source >= 0 && source < kMaxNumSources) {
+            metrics_counter_.demods_1090_by_source[source] += num_demods;
+        }
+    }
 
     /**
-     * Log an attempted demodulation on 1090MHz. Used to record performance statistics. Note that the increment won't be
-     * visible until the next dictionary update occurs.
+     * Log a demodulation on 1090MHz that began while another demodulator was still busy with a previous packet. Used to
+     * see how much each extra preamble detector gains. Should be logged in addition to RecordDemod1090().
+     * @param[in] source Index of the demodulator that began the overlapping demodulations.
+     * @param[in] num_overlaps Number of overlapping demodulations to log.
      */
-    void RecordDemod1090(int16_t source = -1) {
-        metrics_counter_.demods_1090++;
+    void RecordDemodOverlap1090(int16_t source = -1, uint32_t num_overlaps = 1) {
+        metrics_counter_.demod_overlaps_1090 += num_overlaps;
         if (source >= 0 && source < kMaxNumSources) {
-            metrics_counter_.demods_1090_by_source[source]++;
+            metrics_counter_.demod_overlaps_1090_by_source[source] += num_overlaps;
         }
     }
 
@@ -477,9 +591,10 @@ class AircraftDictionary {
     /**
      * Adds an Aircraft object to the aircraft dictionary, hashed by ICAO address.
      * @param[in] aircraft Aircraft to insert.
+     * @param[in] metadata Metadata to store alongside the aircraft. Defaults to a freshly constructed AircraftMetadata.
      * @retval True if insertaion succeeded, false if failed.
      */
-    bool InsertAircraft(const Aircraft &aircraft);
+    bool InsertAircraft(const Aircraft &aircraft, const AircraftMetadata &metadata = AircraftMetadata());
 
     /**
      * Remove an aircraft from the dictionary, by ICAO address.
@@ -496,6 +611,25 @@ class AircraftDictionary {
      */
     bool GetAircraft(uint32_t icao_address, Aircraft &aircraft_out) const;
 
+    /**
+     * Retrieve the metadata for an aircraft from the dictionary.
+     * @param[in] icao_address Address to use for looking up the aircraft.
+     * @param[out] metadata_out AircraftMetadata reference to put the retrieved metadata into if successful.
+     * @retval True if aircraft was found and its metadata retrieved, false if aircraft was not in the dictionary.
+     */
+    bool GetAircraftMetadata(uint32_t icao_address, AircraftMetadata &metadata_out) const;
+
+    /**
+     * Returns the metadata stored alongside an aircraft in the dictionary. Used by reporters that need more than the
+     * state vector while iterating over dict.
+     * @param[in] aircraft Reference to an Aircraft inside dict (not a copy).
+     * @retval Reference to the metadata for the aircraft.
+     */
+    AircraftMetadata &GetAircraftMetadata(const Aircraft &aircraft) { return metadata_[dict.GetIndex(&aircraft)]; }
+    const AircraftMetadata &GetAircraftMetadata(const Aircraft &aircraft) const {
+        return metadata_[dict.GetIndex(&aircraft)];
+    }
+
     /**
      * Check if an aircraft is contained in the dictionary.
      * @param[in] icao_address Address to use for looking up the aircraft.
@@ -504,13 +638,57 @@ class AircraftDictionary {
     bool ContainsAircraft(uint32_t icao_address) const;
 
     /**
-     * Return a pointer to an aircraft if it's in the aircraft dictionary.
+     * Return a pointer to an aircraft if it's in the aircraft dictionary. Aircraft that aren't in the dictionary yet
+     * are inserted with a last_message_timestamp_ms of 0.
+     * NOTE: Don't change last_message_timestamp_ms through the returned pointer, since the dictionary keeps aircraft
+     * ordered by it for pruning. Use RefreshAircraft() instead.
      * @param[in] icao_address ICAO address of the aircraft to find.
      * @retval Pointer to the aircraft if it exists, or NULL if it wasn't in the dictionary.
      */
     Aircraft *GetAircraftPtr(uint32_t icao_address);
 
-    std::unordered_map<uint32_t, Aircraft> dict;  // index Aircraft objects by their ICAO identifier
+    /**
+     * Marks an aircraft in the dictionary as having just sent a message.
+     * @param[in] aircraft Reference to an Aircraft inside dict (not a copy).
+     * @param[in] timestamp_ms Time since boot of the message. Must not be older than any other message timestamp in
+     * the dictionary.
+     */
+    void RefreshAircraft(Aircraft &aircraft, uint32_t timestamp_ms);
+
+    /**
+     * Sets the position of the receiver, which is used as the reference for locally decoding an aircraft's first
+     * position from a single CPR packet, before an odd/even pair has been received. Also required for decoding surface
+     * positions of aircraft that don't have a recent position yet.
+     * @param[in] latitude_deg Receiver latitude, in degrees.
+     * @param[in] longitude_deg Receiver longitude, in degrees.
+     */
+    inline void SetReferencePosition(float latitude_deg, float longitude_deg) {
+        reference_lat_ = DegreesToBinaryAngle(latitude_deg);
+        reference_lon_ = DegreesToBinaryAngle(longitude_deg);
+        reference_position_valid_ = true;
+    }
+
+    /**
+     * Forgets the receiver position. Aircraft positions will only be decoded from odd/even packet pairs or relative to
+     * the aircraft's own recent position.
+     */
+    inline void ClearReferencePosition() { reference_position_valid_ = false; }
+
+    /**
+     * Returns the receiver position used as the reference for local CPR decoding.
+     * @param[out] latitude_deg Receiver latitude, in degrees.
+     * @param[out] longitude_deg Receiver longitude, in degrees.
+     * @retval True if a receiver position has been set, false otherwise.
+     */
+    inline bool GetReferencePosition(float &latitude_deg, float &longitude_deg) const {
+        latitude_deg = BinaryAngleToDegrees(reference_lat_);
+        longitude_deg = BinaryAngleToDegrees(reference_lon_);
+        return reference_position_valid_;
+    }
+
+    // Index Aircraft state vectors by their ICAO identifier. Statically allocated, so the dictionary never touches the
+    // heap. Iterate over dict to visit every aircraft; use GetAircraftMetadata() to reach the matching metadata.
+    StaticHashMap<Aircraft, kMaxNumAircraft> dict;
 
     Metrics metrics;
 
@@ -522,19 +700,50 @@ class AircraftDictionary {
      * Ingests a <Message Type> ADS-B message. Called by IngestADSBPacket, which makes sure that the packet
      * is valid and has the correct Downlink Format.
      * @param[out] aircraft Reference to the Aircraft to populate with info pulled from packet.
+     * @param[out] metadata Reference to the AircraftMetadata stored alongside the aircraft.
      * @param[in] packet ADSBPacket to ingest.
      * @retval True if message was ingested successfully, false otherwise.
      */
 
-    bool ApplyAircraftIDMessage(Aircraft &aircraft, ADSBPacket packet);
-    bool ApplySurfacePositionMessage(Aircraft &aircraft, ADSBPacket packet);
-    bool ApplyAirbornePositionMessage(Aircraft &aircraft, ADSBPacket packet);
-    bool ApplyAirborneVelocitiesMessage(Aircraft &aircraft, ADSBPacket packet);
-    bool ApplyAircraftStatusMessage(Aircraft &aircraft, ADSBPacket packet);
-    bool ApplyTargetStateAndStatusInfoMessage(Aircraft &aircraft, ADSBPacket packet);
-    bool ApplyAircraftOperationStatusMessage(Aircraft &aircraft, ADSBPacket packet);
+    bool ApplyAircraftIDMessage(Aircraft &aircraft, AircraftMetadata &metadata, ADSBPacket packet);
+    bool ApplySurfacePositionMessage(Aircraft &aircraft, AircraftMetadata &metadata, ADSBPacket packet);
+    bool ApplyAirbornePositionMessage(Aircraft &aircraft, AircraftMetadata &metadata, ADSBPacket packet);
+    bool ApplyAirborneVelocitiesMessage(Aircraft &aircraft, AircraftMetadata &metadata, ADSBPacket packet);
+    bool ApplyAircraftStatusMessage(Aircraft &aircraft, AircraftMetadata &metadata, ADSBPacket packet);
+    bool ApplyTargetStateAndStatusInfoMessage(Aircraft &aircraft, AircraftMetadata &metadata, ADSBPacket packet);
+    bool ApplyAircraftOperationStatusMessage(Aircraft &aircraft, AircraftMetadata &metadata, ADSBPacket packet);
+
+    /**
+     * Decodes an aircraft position from a CPR packet. Airborne packets are globally decoded if a fresh odd/even pair is
+     * available. Otherwise, the packet is locally decoded relative to the aircraft's own recent position, or relative
+     * to the receiver position if the aircraft doesn't have one.
+     * @param[out] aircraft Aircraft state vector to publish the decoded position to.
+     * @param[in] metadata Metadata stored alongside the aircraft, holding its CPR decoding state.
+     * @param[in] n_lat_cpr 17-bit latitude count.
+     * @param[in] n_lon_cpr 17-bit longitude count.
+     * @param[in] odd True if the packet uses the odd CPR grid, false for the even grid.
+     * @param[in] surface True if the packet is a surface position message, false for airborne.
+     * @retval True if the aircraft position was updated, false otherwise.
+     */
+    bool DecodeCPRPosition(Aircraft &aircraft, AircraftMetadata &metadata, uint32_t n_lat_cpr, uint32_t n_lon_cpr,
+                           bool odd, bool surface);
+
+    /**
+     * Removes an aircraft from the dictionary while iterating, keeping metadata_ lined up with dict.
+     * @param[in] it Iterator to the aircraft to remove. Must be between dict.begin() and dict.end().
+     * @retval Iterator to the aircraft that took the place of the removed aircraft.
+     */
+    Aircraft *EraseAircraft(Aircraft *it);
 
     AircraftDictionaryConfig_t config_;
+    // Receiver position used as the reference for local CPR decoding.
+    bool reference_position_valid_ = false;
+    int32_t reference_lat_ = 0;  // binary angle
+    int32_t reference_lon_ = 0;  // binary angle
+    // Cold data for each aircraft, stored at the same index as its state vector in dict.
+    AircraftMetadata metadata_[kMaxNumAircraft];
+    // Indices into dict, ordered from oldest to newest last_message_timestamp_ms.
+    StaticLRUList<kMaxNumAircraft> aircraft_by_age_;
     // Counters in metrics_counter_ are incremented, then metrics_counter_ is swapped into metrics during the dictionary
     // update. This ensures that the public metrics struct always has valid data.
     Metrics metrics_counter_;
@@ -0,0 +1,101 @@
+#include "crc.hh"
+
+uint32_t CalculateModeSCRC24(const uint32_t buffer[], uint16_t num_bits) {
+    uint32_t crc = 0;
+    uint16_t num_full_words = num_bits / 32;
+    uint16_t num_remaining_bytes = (num_bits % 32) / 8;
+    uint16_t num_remaining_bits = num_bits % 8;
+
+    // Full 32-bit words: four table lookups per word, no bit indexing.
+    for (uint16_t i = 0; i < num_full_words; i++) {
+        uint32_t word = buffer[i];
+        crc = (crc << 8) ^ kCRC24Table[((crc >> 16) ^ (word >> 24)) & 0xFF];
+        crc = (crc << 8) ^ kCRC24Table[((crc >> 16) ^ (word >> 16)) & 0xFF];
+        crc = (crc << 8) ^ kCRC24Table[((crc >> 16) ^ (word >> 8)) & 0xFF];
+        crc = (crc << 8) ^ kCRC24Table[((crc >> 16) ^ word) & 0xFF];
+    }
+
+    if (num_remaining_bytes == 0 && num_remaining_bits == 0) {
+        return crc & kCRC24Mask;  // Don't read past the end of the buffer.
+    }
+
+    // Leftover bytes in the last partial word.
+    uint32_t last_word = buffer[num_full_words];
+    for (uint16_t i = 0; i < num_remaining_bytes; i++) {
+        crc = (crc << 8) ^ kCRC24Table[((crc >> 16) ^ (last_word >> 24)) & 0xFF];
+        last_word <<= 8;
+    }
+
+    // Leftover bits that don't make up a full byte. Not hit for standard 56-bit and 112-bit packets.
+    for (uint16_t i = 0; i < num_remaining_bits; i++) {
+        crc ^= (last_word >> 31) << (kCRC24NumBits - 1);
+        crc = (crc & 0x800000) ? (crc << 1) ^ kCRC24Generator : crc << 1;
+        last_word <<= 1;
+    }
+
+    return crc & kCRC24Mask;
+}
+
+/**
+ * Looks up the index of the bit whose syndrome matches the one provided.
+ * @param[in] syndrome Syndrome to look up.
+ * @param[in] bit_index_offset Offset between a bit index in a kCRC24SyndromeTableNumBits frame and the frame being
+ * corrected. Shorter frames line up with the end of the table, since only the distance from the end of the frame
+ * matters to the CRC.
+ * @retval Bit index in the frame being corrected, or -1 if the syndrome is not caused by a single bit error.
+ */
+static int16_t LookupSingleBitSyndrome(uint32_t syndrome, uint16_t bit_index_offset) {
+    uint16_t low = 0;
+    uint16_t high = kCRC24SyndromeTableNumBits;
+    while (low < high) {
+        uint16_t mid = (low + high) / 2;
+        if (kCRC24SyndromeTable[mid].syndrome < syndrome) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if (low >= kCRC24SyndromeTableNumBits || kCRC24SyndromeTable[low].syndrome != syndrome ||
+        kCRC24SyndromeTable[low].bit_index < bit_index_offset) {
+        return -1;
+    }
+    return kCRC24SyndromeTable[low].bit_index - bit_index_offset;
+}
+
+static inline void FlipBitInBuffer(uint32_t buffer[], uint16_t bit_index) {
+    buffer[bit_index / 32] ^= 0b1 << (31 - (bit_index % 32));
+}
+
+uint16_t CorrectModeSCRC24Errors(uint32_t buffer[], uint16_t packet_len_bits, uint32_t syndrome, uint16_t max_num_bits,
+                                 uint16_t first_correctable_bit_index) {
+    if (syndrome == 0 || max_num_bits == 0 || packet_len_bits > kCRC24SyndromeTableNumBits) {
+        return 0;
+    }
+    uint16_t bit_index_offset = kCRC24SyndromeTableNumBits - packet_len_bits;
+
+    // Single bit error.
+    int16_t bit_index = LookupSingleBitSyndrome(syndrome, bit_index_offset);
+    if (bit_index >= first_correctable_bit_index) {
+        FlipBitInBuffer(buffer, bit_index);
+        return 1;
+    } else if (bit_index >= 0) {
+        return 0;  // Error is in a protected field. Don't try to explain it with two errors instead.
+    }
+
+    if (max_num_bits < 2) {
+        return 0;
+    }
+
+    // Two bit error: strip off the syndrome of each candidate bit and check if what remains is a single bit error.
+    for (uint16_t first_bit_index = first_correctable_bit_index; first_bit_index < packet_len_bits;
+         first_bit_index++) {
+        uint32_t remaining_syndrome = syndrome ^ kCRC24SingleBitSyndromes[first_bit_index + bit_index_offset];
+        int16_t second_bit_index = LookupSingleBitSyndrome(remaining_syndrome, bit_index_offset);
+        if (second_bit_index > first_bit_index) {
+            FlipBitInBuffer(buffer, first_bit_index);
+            FlipBitInBuffer(buffer, second_bit_index);
+            return 2;
+        }
+    }
+    return 0;
+}
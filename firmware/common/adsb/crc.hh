@@ -0,0 +1,127 @@
+#ifndef CRC_HH_
+#define CRC_HH_
+
+#include <array>
+#include <cstdint>
+
+// Mode S CRC-24, as used for the parity field of 56-bit (Squitter) and 112-bit (Extended Squitter) frames. The CRC is
+// computed with a zero initial value over the data bits (everything before the 24-bit parity field), MSb first.
+// See The 1090MHz Riddle (Junzi Sun), pg. 91.
+
+static const uint32_t kCRC24Generator = 0xFFF409;  // Generator polynomial 0x1FFF409 with the implied x^24 term removed.
+static const uint16_t kCRC24NumBits = 24;
+static const uint32_t kCRC24Mask = 0xFFFFFF;
+
+/**
+ * Builds the byte-wise CRC-24 lookup table at compile time. Entry i is the CRC remainder of the byte i shifted through
+ * the generator polynomial.
+ * @retval Array of 256 24-bit remainders.
+ */
+constexpr std::array<uint32_t, 256> GenerateCRC24Table() {
+    std::array<uint32_t, 256> table = {};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i << (kCRC24NumBits - 8);
+        for (uint16_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x800000) ? (crc << 1) ^ kCRC24Generator : crc << 1;
+        }
+        table[i] = crc & kCRC24Mask;
+    }
+    return table;
+}
+
+inline constexpr std::array<uint32_t, 256> kCRC24Table = GenerateCRC24Table();
+
+/**
+ * Calculates the Mode S CRC-24 over the first num_bits bits of a big-endian buffer of 32-bit words. Processes the
+ * buffer a byte at a time with kCRC24Table, falling back to a bit-serial loop for any trailing bits that don't fill a
+ * byte. The buffer is not modified, so the parity field does not need to be zeroed out beforehand.
+ * @param[in] buffer Buffer to read from. MSb of the first word is the oldest bit.
+ * @param[in] num_bits Number of bits to run the CRC over. For a transponder packet this is the packet length minus the
+ * 24-bit parity field (32 bits for a Squitter, 88 bits for an Extended Squitter).
+ * @retval 24-bit CRC remainder, right-aligned.
+ */
+uint32_t CalculateModeSCRC24(const uint32_t buffer[], uint16_t num_bits);
+
+// Syndrome-based error correction. The syndrome of a frame is its calculated CRC XORed with its received parity field.
+// Since the CRC is linear, the syndrome of a frame with bit errors is the XOR of the syndromes of each flipped bit, and
+// every 1-bit and 2-bit error pattern in a 112-bit frame maps to a unique syndrome.
+
+static const uint16_t kCRC24SyndromeTableNumBits = 112;  // Sized for Extended Squitter frames.
+static const uint16_t kCRC24MaxNumCorrectableBits = 2;
+
+struct CRC24SyndromeEntry {
+    uint32_t syndrome = 0;
+    uint16_t bit_index = 0;
+};
+
+/**
+ * Calculates the syndrome caused by flipping a single bit in a 112-bit frame.
+ * @param[in] bit_index Index of the flipped bit. MSb of the frame is bit 0.
+ * @retval 24-bit syndrome.
+ */
+constexpr uint32_t CalculateCRC24SingleBitSyndrome(uint16_t bit_index) {
+    const uint16_t kNumDataBits = kCRC24SyndromeTableNumBits - kCRC24NumBits;
+    if (bit_index >= kNumDataBits) {
+        // Error in the parity field shows up directly in the syndrome.
+        return 0b1 << (kCRC24SyndromeTableNumBits - 1 - bit_index);
+    }
+    uint32_t crc = 0;
+    for (uint16_t i = 0; i < kNumDataBits; i++) {
+        bool top_bit = ((crc >> (kCRC24NumBits - 1)) & 0b1) ^ (i == bit_index);
+        crc = (crc << 1) & kCRC24Mask;
+        if (top_bit) crc ^= kCRC24Generator;
+    }
+    return crc;
+}
+
+/**
+ * Builds a table of single bit syndromes for a 112-bit frame, indexed by bit.
+ * @retval Array of syndromes.
+ */
+constexpr std::array<uint32_t, kCRC24SyndromeTableNumBits> GenerateCRC24SingleBitSyndromes() {
+    std::array<uint32_t, kCRC24SyndromeTableNumBits> syndromes = {};
+    for (uint16_t i = 0; i < kCRC24SyndromeTableNumBits; i++) {
+        syndromes[i] = CalculateCRC24SingleBitSyndrome(i);
+    }
+    return syndromes;
+}
+
+inline constexpr std::array<uint32_t, kCRC24SyndromeTableNumBits> kCRC24SingleBitSyndromes =
+    GenerateCRC24SingleBitSyndromes();
+
+/**
+ * Builds a table of single bit syndromes for a 112-bit frame, sorted by syndrome so that it can be binary searched.
+ * @retval Sorted array of syndrome table entries.
+ */
+constexpr std::array<CRC24SyndromeEntry, kCRC24SyndromeTableNumBits> GenerateCRC24SyndromeTable() {
+    std::array<CRC24SyndromeEntry, kCRC24SyndromeTableNumBits> table = {};
+    for (uint16_t i = 0; i < kCRC24SyndromeTableNumBits; i++) {
+        // Insertion sort.
+        CRC24SyndromeEntry entry = {.syndrome = kCRC24SingleBitSyndromes[i], .bit_index = i};
+        uint16_t j = i;
+        for (; j > 0 && table[j - 1].syndrome > entry.syndrome; j--) {
+            table[j] = table[j - 1];
+        }
+        table[j] = entry;
+    }
+    return table;
+}
+
+inline constexpr std::array<CRC24SyndromeEntry, kCRC24SyndromeTableNumBits> kCRC24SyndromeTable =
+    GenerateCRC24SyndromeTable();
+
+/**
+ * Attempts to fix bit errors in a frame that failed its CRC check by matching its syndrome against the syndromes of all
+ * 1-bit and (optionally) 2-bit error patterns. If a match is found, the offending bits are flipped in the buffer.
+ * @param[in,out] buffer Big-endian buffer of 32-bit words containing the frame, including the parity field.
+ * @param[in] packet_len_bits Length of the frame, in bits. Must be no longer than kCRC24SyndromeTableNumBits.
+ * @param[in] syndrome Calculated CRC XORed with the received parity field.
+ * @param[in] max_num_bits Maximum number of bits to flip. Clamped to kCRC24MaxNumCorrectableBits.
+ * @param[in] first_correctable_bit_index Bits before this index will never be flipped. Used to keep fields that
+ * determine how the frame is interpreted, like the downlink format, from being changed.
+ * @retval Number of bits that were corrected, or 0 if the frame could not be corrected.
+ */
+uint16_t CorrectModeSCRC24Errors(uint32_t buffer[], uint16_t packet_len_bits, uint32_t syndrome, uint16_t max_num_bits,
+                                 uint16_t first_correctable_bit_index = 0);
+
+#endif /* CRC_HH_ */
@@ -1,7 +1,6 @@
 #include "decode_utils.hh"
 
-#include <cmath>
-
+#include "macros.hh"
 #include "unit_conversions.hh"
 
 const uint16_t callsign_char_array_len = 64;
@@ -124,23 +123,159 @@ uint16_t IdentityCodeToSquawk(uint16_t identity_code) {
            (d4 << 2) | (d2 << 1) | d1;
 }
 
-uint16_t CalcNLCPRFromLat(float lat) {
-    lat = floorf(lat);
-
-    // Special cases.
-    if (lat == 0) {
-        return 59;  // On the equator.
-    } else if (lat == 87) {
-        return 2;  // Near the north pole.
-    } else if (lat == -87) {
-        return 2;  // Near the south pole.
-    } else if (lat > 87) {
-        return 1;  // In the north pole bin.
-    } else if (lat < -87) {
-        return 1;  // In the south pole bin.
+static constexpr int32_t kCPRMaxLatitude = DegreesToBinaryAngle(90.0);  // Decoded latitudes above this are invalid.
+
+// Highest latitude (as a binary angle) in each NL band, from NL=59 at the equator down to NL=1 at the poles. Calculated
+// with equation 5.3. A latitude of exactly 87 degrees is NL=2.
+static constexpr int32_t kCPRNLTransitionLatitudes[kCPRNLTableLen] = {
+    DegreesToBinaryAngle(10.47047130), DegreesToBinaryAngle(14.82817437), DegreesToBinaryAngle(18.18626357),
+    DegreesToBinaryAngle(21.02939493), DegreesToBinaryAngle(23.54504487), DegreesToBinaryAngle(25.82924707),
+    DegreesToBinaryAngle(27.93898710), DegreesToBinaryAngle(29.91135686), DegreesToBinaryAngle(31.77209708),
+    DegreesToBinaryAngle(33.53993436), DegreesToBinaryAngle(35.22899598), DegreesToBinaryAngle(36.85025108),
+    DegreesToBinaryAngle(38.41241892), DegreesToBinaryAngle(39.92256684), DegreesToBinaryAngle(41.38651832),
+    DegreesToBinaryAngle(42.80914012), DegreesToBinaryAngle(44.19454951), DegreesToBinaryAngle(45.54626723),
+    DegreesToBinaryAngle(46.86733252), DegreesToBinaryAngle(48.16039128), DegreesToBinaryAngle(49.42776439),
+    DegreesToBinaryAngle(50.67150166), DegreesToBinaryAngle(51.89342469), DegreesToBinaryAngle(53.09516153),
+    DegreesToBinaryAngle(54.27817472), DegreesToBinaryAngle(55.44378444), DegreesToBinaryAngle(56.59318756),
+    DegreesToBinaryAngle(57.72747354), DegreesToBinaryAngle(58.84763776), DegreesToBinaryAngle(59.95459277),
+    DegreesToBinaryAngle(61.04917774), DegreesToBinaryAngle(62.13216659), DegreesToBinaryAngle(63.20427479),
+    DegreesToBinaryAngle(64.26616523), DegreesToBinaryAngle(65.31845310), DegreesToBinaryAngle(66.36171008),
+    DegreesToBinaryAngle(67.39646774), DegreesToBinaryAngle(68.42322022), DegreesToBinaryAngle(69.44242631),
+    DegreesToBinaryAngle(70.45451075), DegreesToBinaryAngle(71.45986473), DegreesToBinaryAngle(72.45884545),
+    DegreesToBinaryAngle(73.45177442), DegreesToBinaryAngle(74.43893416), DegreesToBinaryAngle(75.42056257),
+    DegreesToBinaryAngle(76.39684391), DegreesToBinaryAngle(77.36789461), DegreesToBinaryAngle(78.33374083),
+    DegreesToBinaryAngle(79.29428225), DegreesToBinaryAngle(80.24923213), DegreesToBinaryAngle(81.19801349),
+    DegreesToBinaryAngle(82.13956981), DegreesToBinaryAngle(83.07199445), DegreesToBinaryAngle(83.99173563),
+    DegreesToBinaryAngle(84.89166191), DegreesToBinaryAngle(85.75541621), DegreesToBinaryAngle(86.53536998),
+    DegreesToBinaryAngle(87.00000000), DegreesToBinaryAngle(90.00000000)};
+
+uint16_t CalcNLCPRFromBinaryAngle(int32_t lat) {
+    // Bands are symmetric about the equator. Negate as unsigned so that -180 degrees doesn't overflow.
+    uint32_t abs_lat = lat < 0 ? -static_cast<uint32_t>(lat) : static_cast<uint32_t>(lat);
+    // Binary search for the first band whose transition latitude is at or above abs_lat.
+    uint16_t low = 0;
+    uint16_t high = kCPRNLTableLen - 1;
+    while (low < high) {
+        uint16_t mid = (low + high) / 2;
+        if (abs_lat <= static_cast<uint32_t>(kCPRNLTransitionLatitudes[mid])) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return kCPRNLTableLen - low;
+}
+
+/**
+ * Converts a position within a CPR zone into a binary angle.
+ * @param[in] zone_index Index of the zone.
+ * @param[in] n_cpr 17-bit count of the position within the zone.
+ * @param[in] num_zones Number of zones in a full turn (airborne) or quarter turn (surface).
+ * @param[in] surface True if zones tile a quarter turn (90 degrees), false if they tile a full turn.
+ * @retval Binary angle of the position. Wraps around at +/-180 degrees.
+ */
+static inline int32_t CPRZoneToBinaryAngle(int32_t zone_index, uint32_t n_cpr, uint16_t num_zones, bool surface) {
+    // Position in units of 2^-17 zones, scaled up to 2^-32 turns (or 2^-34 turns for a quarter turn) per zone.
+    int64_t position = static_cast<int64_t>(zone_index) * (1 << kCPRNumBits) + n_cpr;
+    int64_t angle = position * (1 << (32 - kCPRNumBits - (surface ? 2 : 0))) / num_zones;
+    return static_cast<int32_t>(static_cast<uint32_t>(angle));
+}
+
+/**
+ * Finds the index of the zone that puts a CPR position closest to a reference position (equations 5.16 and 5.19).
+ * @param[in] reference Reference position, as a binary angle.
+ * @param[in] n_cpr 17-bit count of the position within its zone.
+ * @param[in] num_zones Number of zones in a full turn (airborne) or quarter turn (surface).
+ * @param[in] surface True if zones tile a quarter turn (90 degrees), false if they tile a full turn.
+ * @retval Zone index.
+ */
+static inline int32_t CalcCPRLocalZoneIndex(int32_t reference, uint32_t n_cpr, uint16_t num_zones, bool surface) {
+    // Reference position in units of 2^-32 zones.
+    int64_t reference_zones = static_cast<int64_t>(reference) * num_zones * (surface ? 4 : 1);
+    int64_t zone_index = reference_zones >> 32;  // Arithmetic shift floors negative values.
+    int64_t zone_fraction = reference_zones - zone_index * (1ll << 32);
+    // Move to the neighboring zone if the position is more than half a zone away from the reference.
+    return zone_index + ((zone_fraction - (static_cast<int64_t>(n_cpr) << (32 - kCPRNumBits)) + (1ll << 31)) >> 32);
+}
+
+/**
+ * Modulo that returns a non-negative result for negative dividends.
+ */
+static inline int32_t FloorMod(int32_t a, int32_t n) { return ((a % n) + n) % n; }
+
+bool DecodeCPRGlobal(uint32_t n_lat_even, uint32_t n_lon_even, uint32_t n_lat_odd, uint32_t n_lon_odd, bool odd,
+                     int32_t &lat, int32_t &lon) {
+    if (n_lat_even > kCPRLatLonMaxCount || n_lon_even > kCPRLatLonMaxCount || n_lat_odd > kCPRLatLonMaxCount ||
+        n_lon_odd > kCPRLatLonMaxCount) {
+        return false;  // counts out of bounds, don't parse
+    }
+
+    // Equation 5.6: latitude zone index. Counts are in units of 2^-17 zones, so add half a zone and floor.
+    int32_t lat_zone_index =
+        (59 * static_cast<int32_t>(n_lat_even) - 60 * static_cast<int32_t>(n_lat_odd) + (1 << (kCPRNumBits - 1))) >>
+        kCPRNumBits;
+    // Equations 5.7 and 5.8: latitudes in [270, 360) degrees wrap to [-90, 0) when cast to a signed binary angle.
+    int32_t lat_even = CPRZoneToBinaryAngle(FloorMod(lat_zone_index, 60), n_lat_even, 60, false);
+    int32_t lat_odd = CPRZoneToBinaryAngle(FloorMod(lat_zone_index, 59), n_lat_odd, 59, false);
+    if (lat_even > kCPRMaxLatitude || lat_even < -kCPRMaxLatitude || lat_odd > kCPRMaxLatitude ||
+        lat_odd < -kCPRMaxLatitude) {
+        return false;
     }
 
-    // Equation 5.3
-    return floorf(2.0f * (float)M_PI /
-                  acosf(1 - (1 - cosf((float)M_PI / (2.0f * kCPRNz))) / powf(cosf((float)M_PI / 180.0f * lat), 2)));
-}
\ No newline at end of file
+    // Equation 5.9: both packets must be in the same latitude band.
+    uint16_t nl_cpr = CalcNLCPRFromBinaryAngle(lat_even);
+    if (CalcNLCPRFromBinaryAngle(lat_odd) != nl_cpr) {
+        return false;
+    }
+    lat = odd ? lat_odd : lat_even;
+
+    // Equation 5.10: longitude zone index.
+    int32_t lon_zone_index = (static_cast<int32_t>(n_lon_even) * (nl_cpr - 1) -
+                              static_cast<int32_t>(n_lon_odd) * nl_cpr + (1 << (kCPRNumBits - 1))) >>
+                             kCPRNumBits;
+    // Equations 5.11 to 5.15: longitudes in [180, 360) degrees wrap to [-180, 0) when cast to a signed binary angle.
+    uint16_t num_lon_zones = MAX(nl_cpr - (odd ? 1 : 0), 1);
+    lon = CPRZoneToBinaryAngle(FloorMod(lon_zone_index, num_lon_zones), odd ? n_lon_odd : n_lon_even, num_lon_zones,
+                               false);
+    return true;
+}
+
+bool DecodeCPRLocal(uint32_t n_lat_cpr, uint32_t n_lon_cpr, bool odd, bool surface, int32_t reference_lat,
+                    int32_t reference_lon, int32_t &lat, int32_t &lon) {
+    if (n_lat_cpr > kCPRLatLonMaxCount || n_lon_cpr > kCPRLatLonMaxCount) {
+        return false;  // counts out of bounds, don't parse
+    }
+
+    uint16_t num_lat_zones = 4 * kCPRNz - (odd ? 1 : 0);
+    lat = CPRZoneToBinaryAngle(CalcCPRLocalZoneIndex(reference_lat, n_lat_cpr, num_lat_zones, surface), n_lat_cpr,
+                               num_lat_zones, surface);
+    if (lat > kCPRMaxLatitude || lat < -kCPRMaxLatitude) {
+        return false;
+    }
+
+    uint16_t num_lon_zones = MAX(CalcNLCPRFromBinaryAngle(lat) - (odd ? 1 : 0), 1);
+    lon = CPRZoneToBinaryAngle(CalcCPRLocalZoneIndex(reference_lon, n_lon_cpr, num_lon_zones, surface), n_lon_cpr,
+                               num_lon_zones, surface);
+    return true;
+}
+
+float SurfaceMovementToGroundSpeedKts(uint8_t movement) {
+    if (movement == 0 || movement > 124) {
+        return -1.0f;  // No information available, or reserved value.
+    } else if (movement == 1) {
+        return 0.0f;  // Stopped (< 0.125kts).
+    } else if (movement <= 8) {
+        return 0.125f + (movement - 2) * (0.875f / 6);  // 0.125kts to 1kt in ~0.146kt steps.
+    } else if (movement <= 12) {
+        return 1.0f + (movement - 9) * 0.25f;
+    } else if (movement <= 38) {
+        return 2.0f + (movement - 13) * 0.5f;
+    } else if (movement <= 93) {
+        return 15.0f + (movement - 39) * 1.0f;
+    } else if (movement <= 108) {
+        return 70.0f + (movement - 94) * 2.0f;
+    } else if (movement <= 123) {
+        return 100.0f + (movement - 109) * 5.0f;
+    }
+    return 175.0f;  // 175kts or faster.
+}
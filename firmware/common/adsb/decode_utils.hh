@@ -3,10 +3,10 @@
 
 #include <cstdint>
 
-const uint16_t kCPRNz = 15;                           // number of latitude zones between equator and a pole
-const float kCPRdLatEven = 360.0f / (4 * kCPRNz);     // size of latitude zone for even message
-const float kCPRdLatOdd = 360.0f / (4 * kCPRNz - 1);  // size of latitude zone for odd message
-const uint32_t kCPRLatLonMaxCount = (2 << 16) - 1;    // 2^17
+const uint16_t kCPRNz = 15;                         // number of latitude zones between equator and a pole
+const uint16_t kCPRNumBits = 17;                    // number of bits in a CPR latitude or longitude count
+const uint32_t kCPRLatLonMaxCount = (2 << 16) - 1;  // 2^17 - 1
+const uint16_t kCPRNLTableLen = 59;                 // one entry for each possible NL value (1-59)
 
 enum kAltitudeDecodeError : int32_t {
     kAltitudeDecodeErrorGillhamDecodeError = -9,
@@ -71,25 +71,77 @@ int32_t AltitudeCodeToAltitudeFt(uint16_t altitude_code);
  */
 uint16_t IdentityCodeToSquawk(uint16_t identity_code);
 
+/**
+ * Converts an angle in degrees into a 32-bit binary angle, where 2^32 counts make up a full turn. Binary angles wrap
+ * around at +/-180 degrees for free when stored in an int32_t, and have a resolution of ~8.4e-8 degrees (~1cm).
+ * @param[in] degrees Angle in degrees.
+ * @retval Angle as a binary angle.
+ */
+constexpr int32_t DegreesToBinaryAngle(double degrees) {
+    return static_cast<int32_t>(
+        static_cast<int64_t>(degrees * (4294967296.0 / 360.0) + (degrees < 0.0 ? -0.5 : 0.5)));
+}
+
+/**
+ * Converts a 32-bit binary angle into degrees.
+ * @param[in] angle Binary angle, where 2^32 counts make up a full turn.
+ * @retval Angle in degrees, between -180 and 180.
+ */
+inline float BinaryAngleToDegrees(int32_t angle) { return static_cast<float>(angle) * (360.0f / 4294967296.0f); }
+
+/**
+ * Calculate the number of longitude zones (between 1 and 59) at a given latitude. Looks up the latitude in a table of
+ * NL transition latitudes instead of evaluating the trig functions in equation 5.3.
+ * @param[in] lat Latitude, as a binary angle.
+ * @retval NL (number of longitude zones) in the Compact Position Reporting (CPR) representation at the given latitude.
+ */
+uint16_t CalcNLCPRFromBinaryAngle(int32_t lat);
+
 /**
  * Calculate the number of longituide zones (between 1 and 59) at a given latitude.
  * @param[in] lat Latitude to calculate NL (number of longitude zones) at.
  * @retval NL (number of longitude zones) in the Compact Position Reporting (CPR) representation at the given latitude.
  */
-uint16_t CalcNLCPRFromLat(float lat);
+inline uint16_t CalcNLCPRFromLat(float lat) { return CalcNLCPRFromBinaryAngle(DegreesToBinaryAngle(lat)); }
+
+/**
+ * Decodes an airborne CPR position from an even and an odd packet (global decode). Uses only integer math.
+ * @param[in] n_lat_even 17-bit latitude count from the even packet.
+ * @param[in] n_lon_even 17-bit longitude count from the even packet.
+ * @param[in] n_lat_odd 17-bit latitude count from the odd packet.
+ * @param[in] n_lon_odd 17-bit longitude count from the odd packet.
+ * @param[in] odd True if the position should be decoded for the odd packet (received last), false for the even one.
+ * @param[out] lat Decoded latitude, as a binary angle.
+ * @param[out] lon Decoded longitude, as a binary angle.
+ * @retval True if the position was decoded, false if the counts were out of bounds, the latitude was off the globe, or
+ * the even and odd packets were from different latitude bands.
+ */
+bool DecodeCPRGlobal(uint32_t n_lat_even, uint32_t n_lon_even, uint32_t n_lat_odd, uint32_t n_lon_odd, bool odd,
+                     int32_t &lat, int32_t &lon);
 
 /**
- * Wrap southern hemisphere latitudes resulting from CPR decode. Transforms latitude from [270, 360] to [-90, 90].
- * @param[in] latitude Latitude in degrees.
- * @retval Wrapped latitude.
+ * Decodes a single CPR position (odd or even) relative to a nearby reference position. Unlike global decoding, this
+ * doesn't require an odd/even pair, but the reference must be within half a CPR zone of the true position (~180NM for
+ * airborne positions, ~45NM for surface positions) for the result to be correct. Uses only integer math.
+ * @param[in] n_lat_cpr 17-bit latitude count.
+ * @param[in] n_lon_cpr 17-bit longitude count.
+ * @param[in] odd True if the position was encoded with the odd CPR grid, false for the even grid.
+ * @param[in] surface True if the position came from a surface position message (90 degree zones), false for airborne.
+ * @param[in] reference_lat Latitude of the reference position, as a binary angle.
+ * @param[in] reference_lon Longitude of the reference position, as a binary angle.
+ * @param[out] lat Decoded latitude, as a binary angle.
+ * @param[out] lon Decoded longitude, as a binary angle.
+ * @retval True if the position was decoded, false if the counts were out of bounds or the result was off the globe.
  */
-inline float WrapCPRDecodeLatitude(float latitude) { return latitude >= 270.0f ? latitude - 360.0f : latitude; }
+bool DecodeCPRLocal(uint32_t n_lat_cpr, uint32_t n_lon_cpr, bool odd, bool surface, int32_t reference_lat,
+                    int32_t reference_lon, int32_t &lat, int32_t &lon);
 
 /**
- * Wrap longitude floating point value to conventional values. Transforms longitude from [0, 360] to [-180, 180].
- * @param[in] longitude Longitude in degrees.
- * @retval Wrapped longitude.
+ * Converts the movement field of a surface position message into a ground speed. The field is quantized more finely
+ * at taxiing speeds than at takeoff speeds.
+ * @param[in] movement 7-bit movement field.
+ * @retval Ground speed in knots, or -1.0f if no speed information is available.
  */
-inline float WrapCPRDecodeLongitude(float longitude) { return longitude >= 180.0f ? longitude - 360.0f : longitude; }
+float SurfaceMovementToGroundSpeedKts(uint8_t movement);
 
 #endif /* DECODE_UTILS_HH_ */
\ No newline at end of file
@@ -5,19 +5,19 @@
 #include <cstring>  // for strlen
 
 #include "comms.hh"  // For debug prints.
+#include "crc.hh"
 #include "decode_utils.hh"
+#include "perf_monitor.hh"
 
 #define BYTES_PER_WORD_32 4
 #define BITS_PER_WORD_32  32
 #define BYTES_PER_WORD_24 3
 #define BITS_PER_WORD_24  24
-#define BITS_PER_WORD_25  25
 #define BITS_PER_BYTE     8
 #define NIBBLES_PER_BYTE  2
 #define BITS_PER_NIBBLE   4
 
 #define MASK_MSBIT_WORD24 (0b1 << (BITS_PER_WORD_24 - 1))
-#define MASK_MSBIT_WORD25 (0b1 << BITS_PER_WORD_24)
 #define MASK_WORD24       0xFFFFFF
 
 #define CHAR_TO_HEX(c)    ((c >= 'A') ? (c >= 'a') ? (c - 'a' + 10) : (c - 'A' + 10) : (c - '0'))
@@ -27,18 +27,15 @@ const uint32_t kExtendedSquitterLastWordPopCount = 16;
 const uint32_t kSquitterLastWordIngestionMask = 0xFFFFFF00;
 const uint32_t kSquitterLastWordPopCount = 24;
 
-const uint32_t kCRC24Generator = 0x1FFF409;
-const uint16_t kCRC24GeneratorNumBits = 25;
-
 /** DecodedTransponderPacket **/
 
 RawTransponderPacket::RawTransponderPacket(uint32_t rx_buffer[kMaxPacketLenWords32], uint16_t rx_buffer_len_words32,
                                            int16_t source_in, int32_t sigs_dbm_in, int32_t sigq_db_in,
                                            uint64_t mlat_48mhz_64bit_counts_in)
-    : source(source_in),
+    : mlat_48mhz_64bit_counts(mlat_48mhz_64bit_counts_in),
       sigs_dbm(sigs_dbm_in),
       sigq_db(sigq_db_in),
-      mlat_48mhz_64bit_counts(mlat_48mhz_64bit_counts_in) {
+      source(source_in) {
     // Set the last word indgestion behavior based on packet length.
     uint32_t last_word_ingestion_mask, last_word_popcount;
     if (rx_buffer_len_words32 > 2) {
@@ -65,10 +62,10 @@ RawTransponderPacket::RawTransponderPacket(uint32_t rx_buffer[kMaxPacketLenWords
 
 RawTransponderPacket::RawTransponderPacket(char *rx_string, int16_t source_in, int32_t sigs_dbm_in, int32_t sigq_db_in,
                                            uint64_t mlat_48mhz_64bit_counts_in)
-    : source(source_in),
+    : mlat_48mhz_64bit_counts(mlat_48mhz_64bit_counts_in),
       sigs_dbm(sigs_dbm_in),
       sigq_db(sigq_db_in),
-      mlat_48mhz_64bit_counts(mlat_48mhz_64bit_counts_in) {
+      source(source_in) {
     uint16_t rx_num_bytes = strlen(rx_string) / NIBBLES_PER_BYTE;
     for (uint16_t i = 0; i < rx_num_bytes && i < kMaxPacketLenWords32 * BYTES_PER_WORD_32; i++) {
         uint8_t byte = (CHAR_TO_HEX(rx_string[i * NIBBLES_PER_BYTE]) << BITS_PER_NIBBLE) |
@@ -100,6 +97,18 @@ DecodedTransponderPacket::DecodedTransponderPacket(const RawTransponderPacket &p
     ConstructTransponderPacket();
 }
 
+DecodedTransponderPacket::DecodedTransponderPacket(const RawTransponderPacket &packet_in, bool is_valid,
+                                                   uint32_t icao_address)
+    : raw_(packet_in), is_valid_(is_valid), is_validity_settled_(true) {
+    if (raw_.buffer_len_bits != kExtendedSquitterPacketLenBits && raw_.buffer_len_bits != kSquitterPacketLenBits) {
+        is_valid_ = false;
+        return;
+    }
+    downlink_format_ = raw_.buffer[0] >> 27;
+    // Same addresses as ConstructTransponderPacket(), without the CRC.
+    icao_address_ = (raw_.buffer_len_bits == kSquitterPacketLenBits ? icao_address : raw_.buffer[0]) & 0xFFFFFF;
+}
+
 DecodedTransponderPacket::DownlinkFormat DecodedTransponderPacket::GetDownlinkFormatEnum() {
     switch (downlink_format_) {
         // DF 0-11 = short messages (56 bits)
@@ -161,37 +170,29 @@ uint16_t DecodedTransponderPacket::DumpPacketBuffer(uint8_t to_buffer[kMaxPacket
     return bytes_written;
 }
 
-uint32_t DecodedTransponderPacket::CalculateCRC24(uint16_t packet_len_bits) const {
-    // CRC calculation algorithm from https://mode-s.org/decode/book-the_1090mhz_riddle-junzi_sun.pdf pg. 91.
-    // Must be called on buffer that does not have extra bit ingested at end and has all words left-aligned.
-    uint32_t crc_buffer[kMaxPacketLenWords32];
-    for (uint16_t i = 0; i < kMaxPacketLenWords32; i++) {
-        crc_buffer[i] = raw_.buffer[i];
-    }
-
-    // Overwrite 24-bit parity word with zeros.
-    SetNBitWordInBuffer(BITS_PER_WORD_24, 0x0, packet_len_bits - BITS_PER_WORD_24, crc_buffer);
-
-    // CRC is a conditional convolve operation using the 25-bit generator word.
-    for (uint16_t i = 0; i < packet_len_bits - BITS_PER_WORD_24; i++) {
-        uint32_t word = GetNBitWordFromBuffer(BITS_PER_WORD_25, i, crc_buffer);
-        if (word & MASK_MSBIT_WORD25) {
-            // Most significant bit is a 1. XOR with generator!
-            SetNBitWordInBuffer(BITS_PER_WORD_25, word ^ kCRC24Generator, i, crc_buffer);
-        }
+uint16_t DecodedTransponderPacket::GetMaxNumCorrectedBits(uint16_t downlink_format) {
+    switch (downlink_format) {
+        case kDownlinkFormatExtendedSquitter:
+            return kDF17MaxNumCorrectedBits;
+        case kDownlinkFormatExtendedSquitterNonTransponder:
+            return kDF18MaxNumCorrectedBits;
+        default:
+            return 0;
     }
+}
 
-    return GetNBitWordFromBuffer(BITS_PER_WORD_24, packet_len_bits - BITS_PER_WORD_24, crc_buffer);
+uint32_t DecodedTransponderPacket::CalculateCRC24(uint16_t packet_len_bits) const {
+    // CRC calculation algorithm from https://mode-s.org/decode/book-the_1090mhz_riddle-junzi_sun.pdf pg. 91.
+    // Must be called on buffer that has all words left-aligned. The parity word is skipped, so it doesn't need to be
+    // cleared.
+    return CalculateModeSCRC24(raw_.buffer, packet_len_bits - BITS_PER_WORD_24);
 }
 
 void DecodedTransponderPacket::ConstructTransponderPacket() {
     if (raw_.buffer_len_bits != kExtendedSquitterPacketLenBits && raw_.buffer_len_bits != kSquitterPacketLenBits) {
-        snprintf(debug_string, kDebugStrLen,
-                 "Bit number mismatch while decoding packet. Expected %d or %d but got %d!\r\n",
-                 kExtendedSquitterPacketLenBits, kSquitterPacketLenBits, raw_.buffer_len_bits);
-
         return;  // leave is_valid_ as false
     }
+    PERF_PROBE(PerfMonitor::kStageCRC);
 
     downlink_format_ = raw_.buffer[0] >> 27;
     uint32_t calculated_checksum = CalculateCRC24(raw_.buffer_len_bits);
@@ -212,32 +213,48 @@ void DecodedTransponderPacket::ConstructTransponderPacket() {
         default:  // All other DFs. Note: DF=17-19 for ADS-B.
         {
             // Process a 112-bit message.
-            icao_address_ = raw_.buffer[0] & 0xFFFFFF;
             if (calculated_checksum == parity_value) {
                 is_valid_ = true;  // mark packet as valid if CRC matches the parity bits
             } else {
-                // is_valid_ is set to false by default
-                snprintf(debug_string, kDebugStrLen, "Invalid checksum, expected %06lx but calculated %06lx.\r\n",
-                         parity_value, calculated_checksum);
+                // Attempt to fix bit errors, leaving the downlink format untouched.
+                raw_.num_corrected_bits =
+                    CorrectModeSCRC24Errors(raw_.buffer, raw_.buffer_len_bits, calculated_checksum ^ parity_value,
+                                            GetMaxNumCorrectedBits(downlink_format_), kDFNUmBits);
+                is_valid_ = raw_.num_corrected_bits > 0;  // Buffer is left untouched if correction fails.
             }
+            icao_address_ = raw_.buffer[0] & 0xFFFFFF;  // Read after correction in case the address had a bit error.
         }
     }
 }
 
-/** ADSBPacket **/
-
-/**
- * Helper function used by constructors.
- */
-void ADSBPacket::ConstructADSBPacket() {
-    capability_ = static_cast<ADSBPacket::Capability>((raw_.buffer[0] >> 24) & 0b111);
-    typecode_ = static_cast<ADSBPacket::TypeCode>(raw_.buffer[1] >> 27);
-    parity_interrogator_id = raw_.buffer[1] & 0xFFFFFF;
+uint16_t DecodedTransponderPacket::PrintDebugString(char str_buf[kDebugStrLen]) const {
+    int num_chars = 0;
+    if (raw_.buffer_len_bits != kExtendedSquitterPacketLenBits && raw_.buffer_len_bits != kSquitterPacketLenBits) {
+        num_chars = snprintf(str_buf, kDebugStrLen,
+                             "Bit number mismatch while decoding packet. Expected %d or %d but got %d!\r\n",
+                             kExtendedSquitterPacketLenBits, kSquitterPacketLenBits, raw_.buffer_len_bits);
+    } else if (raw_.buffer_len_bits == kSquitterPacketLenBits) {
+        num_chars = snprintf(str_buf, kDebugStrLen, "Squitter packet with ICAO %06lx is %s.\r\n", icao_address_,
+                             is_valid_ ? "validated" : "not validated against the aircraft dictionary");
+    } else if (!is_valid_) {
+        num_chars = snprintf(str_buf, kDebugStrLen, "Invalid checksum, expected %06lx but calculated %06lx.\r\n",
+                             Get24BitWordFromBuffer(raw_.buffer_len_bits - BITS_PER_WORD_24, raw_.buffer),
+                             CalculateCRC24(raw_.buffer_len_bits));
+    } else {
+        num_chars = snprintf(str_buf, kDebugStrLen, "Valid packet, %d bits corrected.\r\n", raw_.num_corrected_bits);
+    }
+    if (num_chars < 0) {
+        str_buf[0] = '\0';
+        return 0;
+    }
+    return num_chars < kDebugStrLen ? num_chars : kDebugStrLen - 1;
 }
 
+/** ADSBPacket **/
+
 ADSBPacket::TypeCode ADSBPacket::GetTypeCodeEnum() const {
     // Table 3.3 from The 1090Mhz Riddle (Junzi Sun), pg. 37.
-    switch (static_cast<uint16_t>(typecode_)) {
+    switch (static_cast<uint16_t>(GetTypeCode())) {
         case 1:
         case 2:
         case 3:
@@ -291,94 +308,64 @@ ADSBPacket::TypeCode ADSBPacket::GetTypeCodeEnum() const {
     }
 }
 
-ModeCPacket::ModeCPacket(const DecodedTransponderPacket &decoded_packet) : DecodedTransponderPacket(decoded_packet) {
-    uint8_t flight_status = GetNBitWordFromBuffer(3, 5, raw_.buffer);  // FS = Bits 5-7.
-    switch (flight_status) {
-        case 0b000:  // No alert, no SPI, aircraft is airborne.
-            has_alert_ = false;
-            has_ident_ = false;
-            is_airborne_ = true;
-            break;
-        case 0b001:  // No alert, no SPI, aircraft is on ground.
-            has_alert_ = false;
-            has_ident_ = false;
-            is_airborne_ = false;
-            break;
-        case 0b010:  // Alert, no SPI, aircraft is airborne.
-            has_alert_ = true;
-            has_ident_ = false;
-            is_airborne_ = true;
-            break;
-        case 0b011:  // Alert, no SPI, aircraft is on ground.
-            has_alert_ = true;
-            has_ident_ = false;
-            is_airborne_ = false;
-            break;
-        case 0b100:  // Alert, SPI, aircraft is airborne or on ground.
-            has_alert_ = true;
-            has_ident_ = true;
-            // Default is_airborne_ to false when not known.
-            break;
-        case 0b101:
-            // No alert, SPI, aircaft is airborne or on ground.
-            has_ident_ = true;
-            has_alert_ = false;
-            // Default is_airborne_ to false when not known.
-            break;
-        case 0b110:  // Reserved.
-            break;
-        case 0b111:  // Not assigned.
-            break;
-    }
+/** ModeCPacket and ModeAPacket **/
 
-    downlink_request_ = static_cast<DownlinkRequest>(GetNBitWordFromBuffer(5, 8, raw_.buffer));
-    utility_message_ = GetNBitWordFromBuffer(4, 13, raw_.buffer);
-    utility_message_type_ = static_cast<UtilityMessageType>(GetNBitWordFromBuffer(2, 17, raw_.buffer));
-    altitude_ft_ = AltitudeCodeToAltitudeFt(GetNBitWordFromBuffer(13, 19, raw_.buffer));
-};
-
-ModeAPacket::ModeAPacket(const DecodedTransponderPacket &decoded_packet) : DecodedTransponderPacket(decoded_packet) {
-    uint8_t flight_status = GetNBitWordFromBuffer(3, 5, raw_.buffer);  // FS = Bits 5-7.
-    switch (flight_status) {
-        case 0b000:  // No alert, no SPI, aircraft is airborne.
-            has_alert_ = false;
-            has_ident_ = false;
-            is_airborne_ = true;
-            break;
-        case 0b001:  // No alert, no SPI, aircraft is on ground.
-            has_alert_ = false;
-            has_ident_ = false;
-            is_airborne_ = false;
-            break;
-        case 0b010:  // Alert, no SPI, aircraft is airborne.
-            has_alert_ = true;
-            has_ident_ = false;
-            is_airborne_ = true;
-            break;
-        case 0b011:  // Alert, no SPI, aircraft is on ground.
-            has_alert_ = true;
-            has_ident_ = false;
-            is_airborne_ = false;
-            break;
-        case 0b100:  // Alert, SPI, aircraft is airborne or on ground.
-            has_alert_ = true;
-            has_ident_ = true;
-            // Default is_airborne_ to false when not known.
-            break;
-        case 0b101:
-            // No alert, SPI, aircaft is airborne or on ground.
-            has_ident_ = true;
-            has_alert_ = false;
-            // Default is_airborne_ to false when not known.
-            break;
-        case 0b110:  // Reserved.
-            break;
-        case 0b111:  // Not assigned.
-            break;
-    }
+// DF4 (Mode C) and DF5 (Mode A) replies share the same layout for everything except the last 13 bits.
+static const uint16_t kFlightStatusFirstBitIndex = 5;     // FS = Bits 6-8.
+static const uint16_t kDownlinkRequestFirstBitIndex = 8;  // DR = Bits 9-13.
+static const uint16_t kUtilityMessageFirstBitIndex = 13;  // UM = Bits 14-19.
+static const uint16_t kUtilityMessageTypeFirstBitIndex = 17;
+static const uint16_t kReplyCodeFirstBitIndex = 19;  // AC or ID = Bits 20-32.
+
+static inline uint8_t GetFlightStatus(const RawTransponderPacket &raw) {
+    return GetNBitWordFromBuffer(3, kFlightStatusFirstBitIndex, raw.buffer);
+}
 
-    downlink_request_ = static_cast<DownlinkRequest>(GetNBitWordFromBuffer(5, 8, raw_.buffer));
-    utility_message_ = GetNBitWordFromBuffer(4, 13, raw_.buffer);
-    utility_message_type_ = static_cast<UtilityMessageType>(GetNBitWordFromBuffer(2, 17, raw_.buffer));
-    squawk_ = IdentityCodeToSquawk(GetNBitWordFromBuffer(13, 19, raw_.buffer));
-};
\ No newline at end of file
+// Flight status 0b000 and 0b010 are airborne. Flight status 0b100 and 0b101 could be either, default to not airborne.
+static inline bool FlightStatusIsAirborne(uint8_t flight_status) {
+    return flight_status == 0b000 || flight_status == 0b010;
+}
+
+static inline bool FlightStatusHasAlert(uint8_t flight_status) {
+    return flight_status == 0b010 || flight_status == 0b011 || flight_status == 0b100;
+}
+
+static inline bool FlightStatusHasIdent(uint8_t flight_status) {
+    return flight_status == 0b100 || flight_status == 0b101;
+}
+
+bool ModeCPacket::IsAirborne() const { return FlightStatusIsAirborne(GetFlightStatus(packet_->GetRaw())); }
+bool ModeCPacket::HasAlert() const { return FlightStatusHasAlert(GetFlightStatus(packet_->GetRaw())); }
+bool ModeCPacket::HasIdent() const { return FlightStatusHasIdent(GetFlightStatus(packet_->GetRaw())); }
+ModeCPacket::DownlinkRequest ModeCPacket::GetDownlinkRequest() const {
+    return static_cast<DownlinkRequest>(
+        GetNBitWordFromBuffer(5, kDownlinkRequestFirstBitIndex, packet_->GetRaw().buffer));
+}
+uint8_t ModeCPacket::GetUtilityMessage() const {
+    return GetNBitWordFromBuffer(4, kUtilityMessageFirstBitIndex, packet_->GetRaw().buffer);
+}
+ModeCPacket::UtilityMessageType ModeCPacket::GetUtilityMessageType() const {
+    return static_cast<UtilityMessageType>(
+        GetNBitWordFromBuffer(2, kUtilityMessageTypeFirstBitIndex, packet_->GetRaw().buffer));
+}
+int32_t ModeCPacket::GetAltitudeFt() const {
+    return AltitudeCodeToAltitudeFt(GetNBitWordFromBuffer(13, kReplyCodeFirstBitIndex, packet_->GetRaw().buffer));
+}
+
+bool ModeAPacket::IsAirborne() const { return FlightStatusIsAirborne(GetFlightStatus(packet_->GetRaw())); }
+bool ModeAPacket::HasAlert() const { return FlightStatusHasAlert(GetFlightStatus(packet_->GetRaw())); }
+bool ModeAPacket::HasIdent() const { return FlightStatusHasIdent(GetFlightStatus(packet_->GetRaw())); }
+ModeAPacket::DownlinkRequest ModeAPacket::GetDownlinkRequest() const {
+    return static_cast<DownlinkRequest>(
+        GetNBitWordFromBuffer(5, kDownlinkRequestFirstBitIndex, packet_->GetRaw().buffer));
+}
+uint8_t ModeAPacket::GetUtilityMessage() const {
+    return GetNBitWordFromBuffer(4, kUtilityMessageFirstBitIndex, packet_->GetRaw().buffer);
+}
+ModeAPacket::UtilityMessageType ModeAPacket::GetUtilityMessageType() const {
+    return static_cast<UtilityMessageType>(
+        GetNBitWordFromBuffer(2, kUtilityMessageTypeFirstBitIndex, packet_->GetRaw().buffer));
+}
+uint16_t ModeAPacket::GetSquawk() const {
+    return IdentityCodeToSquawk(GetNBitWordFromBuffer(13, kReplyCodeFirstBitIndex, packet_->GetRaw().buffer));
+}
@@ -2,6 +2,7 @@
 #define _ADSB_PACKET_HH_
 
 #include <cstdint>
+#include <type_traits>
 
 #include "buffer_utils.hh"
 #include "unit_conversions.hh"
@@ -26,12 +27,14 @@ class RawTransponderPacket {
         }
     }
 
+    // Fields are ordered largest to smallest to avoid padding.
     uint32_t buffer[kMaxPacketLenWords32];
-    uint16_t buffer_len_bits = 0;
-    int16_t source = -1;                   // Source of the ADS-B packet (PIO state machine number).
+    uint64_t mlat_48mhz_64bit_counts = 0;  // High resolution MLAT counter.
     int32_t sigs_dbm = INT32_MIN;          // Signal strength, in dBm.
     int32_t sigq_db = INT32_MIN;           // Signal quality (dB above noise floor), in dB.
-    uint64_t mlat_48mhz_64bit_counts = 0;  // High resolution MLAT counter.
+    uint16_t buffer_len_bits = 0;
+    int16_t source = -1;              // Source of the ADS-B packet (PIO state machine number).
+    uint16_t num_corrected_bits = 0;  // Number of bits flipped by CRC error correction. 0 if received clean.
 };
 
 class DecodedTransponderPacket {
@@ -39,12 +42,17 @@ class DecodedTransponderPacket {
     static const uint16_t kMaxPacketLenWords32 = RawTransponderPacket::kMaxPacketLenWords32;
     static const uint16_t kDFNUmBits = 5;     // [1-5] Downlink Format bitlength.
     static const uint16_t kMaxDFStrLen = 50;  // Max length of TypeCode string.
-    static const uint16_t kDebugStrLen = 200;
+    static const uint16_t kDebugStrLen = 200;  // Max length of string written by PrintDebugString.
     static const uint16_t kSquitterPacketLenBits = 56;
     static const uint16_t kSquitterPacketNumWords32 = 2;  // 56 bits = 1.75 words, round up to 2.
     static const uint16_t kExtendedSquitterPacketLenBits = 112;
     static const uint16_t kExtendedSquitterPacketNumWords32 = 4;  // 112 bits = 3.5 words, round up to 4.
 
+    // Maximum number of bit errors to correct in frames that fail CRC, by downlink format. Only DF17 and DF18 have a
+    // parity field that isn't overlaid with an address, so all other downlink formats are left uncorrected.
+    static const uint16_t kDF17MaxNumCorrectedBits = 2;
+    static const uint16_t kDF18MaxNumCorrectedBits = 1;
+
     // Bits 1-5: Downlink Format (DF)
     enum DownlinkFormat {
         kDownlinkFormatInvalid = -1,
@@ -94,10 +102,22 @@ class DecodedTransponderPacket {
      */
     DecodedTransponderPacket(const RawTransponderPacket &packet_in);
 
+    /**
+     * DecodedTransponderPacket constructor from a RawTransponderPacket that was already decoded somewhere else, e.g.
+     * by the RP2040 before forwarding it to the ESP32. Skips the CRC check, error correction, and address recovery,
+     * and takes the validity as settled (see IsValiditySettled()).
+     * @param[in] packet_in RawTransponderPacket as it was after decoding, with any bit errors corrected.
+     * @param[in] is_valid Whether the packet passed its CRC check, or for 56-bit packets, whether its address was
+     * found in the aircraft dictionary.
+     * @param[in] icao_address ICAO address recovered from the parity field of a 56-bit packet. Ignored for 112-bit
+     * packets, which carry their address in the clear.
+     */
+    DecodedTransponderPacket(const RawTransponderPacket &packet_in, bool is_valid, uint32_t icao_address = 0);
+
     /**
      * Default constructor.
      */
-    DecodedTransponderPacket() : raw_((char *)"") { debug_string[0] = '\0'; };
+    DecodedTransponderPacket() {};
 
     bool IsValid() const { return is_valid_; };
 
@@ -108,6 +128,26 @@ class DecodedTransponderPacket {
      */
     void ForceValid() { is_valid_ = true; }
 
+    /**
+     * Returns whether the validity of the packet was settled by whoever decoded it, in which case 56-bit packets don't
+     * need to be checked against the aircraft dictionary again.
+     */
+    bool IsValiditySettled() const { return is_validity_settled_; }
+
+    /**
+     * Returns the number of bits that were flipped to make the packet pass its CRC check. Corrected packets are marked
+     * as valid, but some consumers (e.g. feeds) may want to exclude them.
+     * @retval Number of corrected bits, or 0 if the packet was received without bit errors.
+     */
+    uint16_t GetNumCorrectedBits() const { return raw_.num_corrected_bits; }
+
+    /**
+     * Returns the maximum number of bit errors that will be corrected for a given downlink format.
+     * @param[in] downlink_format Downlink format of the packet.
+     * @retval Maximum number of bits that may be flipped during error correction.
+     */
+    static uint16_t GetMaxNumCorrectedBits(uint16_t downlink_format);
+
     int GetBufferLenBits() const { return raw_.buffer_len_bits; }
     int GetRSSIdBm() const { return raw_.sigs_dbm; }
     uint64_t GetMLAT12MHzCounter() const { return (raw_.mlat_48mhz_64bit_counts >> 2) & 0xFFFFFFFFFFFF; }
@@ -116,7 +156,7 @@ class DecodedTransponderPacket {
     DownlinkFormat GetDownlinkFormatEnum();
     uint32_t GetICAOAddress() const { return icao_address_; }
     uint16_t GetPacketBufferLenBits() const { return raw_.buffer_len_bits; }
-    RawTransponderPacket GetRaw() const { return raw_; }
+    const RawTransponderPacket &GetRaw() const { return raw_; }
 
     /**
      * Dumps the internal packet buffer to a destination and returns the number of bytes written.
@@ -138,22 +178,31 @@ class DecodedTransponderPacket {
      */
     uint32_t CalculateCRC24(uint16_t packet_len_bits = kExtendedSquitterPacketLenBits) const;
 
-    char debug_string[kDebugStrLen] = "";
+    /**
+     * Writes a human readable explanation of why the packet is invalid. Diagnostics are generated on demand instead of
+     * during construction, since most invalid packets are never inspected.
+     * @param[out] str_buf Buffer to write the string to. Must be at least kDebugStrLen chars long.
+     * @retval Number of characters written, not including the null terminator.
+     */
+    uint16_t PrintDebugString(char str_buf[kDebugStrLen]) const;
 
    protected:
-    bool is_valid_ = false;
     RawTransponderPacket raw_;
 
     uint32_t icao_address_ = 0;
     uint16_t downlink_format_ = static_cast<uint16_t>(kDownlinkFormatInvalid);
-
-    uint32_t parity_interrogator_id = 0;
+    bool is_valid_ = false;
+    bool is_validity_settled_ = false;
 
    private:
     void ConstructTransponderPacket();
 };
 
-class ADSBPacket : public DecodedTransponderPacket {
+// DecodedTransponderPackets are passed around by value through queues, so keep them small and memcpy-able.
+static_assert(std::is_trivially_copyable<DecodedTransponderPacket>::value);
+static_assert(sizeof(DecodedTransponderPacket) <= 48);
+
+class ADSBPacket {
    public:
     static const uint16_t kMaxTCStrLen = 50;
 
@@ -164,16 +213,15 @@ class ADSBPacket : public DecodedTransponderPacket {
     static const uint16_t kTCNumBits = 5;     // [33-37] Type code bitlength. Not always included.
     static const uint16_t kPINumBits = 24;    // Parity / Interrogator ID bitlength.
 
-    static const uint16_t kMEFirstBitIndex = kDFNUmBits + kCANumBits + kICAONumBits;
+    static const uint16_t kMEFirstBitIndex = DecodedTransponderPacket::kDFNUmBits + kCANumBits + kICAONumBits;
 
     /**
      * Constructor. Can only create an ADSBPacket from an existing DecodedTransponderPacket, which is is referenced as
      * the parent of the ADSBPacket. Think of this as a way to use the ADSBPacket as a "window" into the contents of the
      * parent DecodedTransponderPacket. The ADSBPacket cannot exist without the parent DecodedTransponderPacket!
      */
-    ADSBPacket(const DecodedTransponderPacket &decoded_packet) : DecodedTransponderPacket(decoded_packet) {
-        ConstructADSBPacket();
-    };
+    ADSBPacket(const DecodedTransponderPacket &decoded_packet) : packet_(&decoded_packet) {};
+    ADSBPacket(const DecodedTransponderPacket &&decoded_packet) = delete;  // Don't allow views of temporaries.
 
     // Bits 6-8 [3]: Capability (CA)
     enum Capability : uint8_t {
@@ -214,24 +262,28 @@ class ADSBPacket : public DecodedTransponderPacket {
     // Operation Status (TC = 31)
     enum OperationStatusSubtype : uint8_t { kOperationStatusSubtypeAirborne = 0, kOperationStatusSubtypeSurface = 1 };
 
-    inline Capability GetCapability() const { return capability_; };
-    inline TypeCode GetTypeCode() const { return typecode_; };
+    // Pass-throughs to the parent packet.
+    bool IsValid() const { return packet_->IsValid(); }
+    uint16_t GetDownlinkFormat() const { return packet_->GetDownlinkFormat(); }
+    uint32_t GetICAOAddress() const { return packet_->GetICAOAddress(); }
+    const DecodedTransponderPacket &GetDecodedPacket() const { return *packet_; }
+
+    inline Capability GetCapability() const {
+        return static_cast<Capability>((packet_->GetRaw().buffer[0] >> 24) & 0b111);
+    };
+    inline TypeCode GetTypeCode() const { return static_cast<TypeCode>(packet_->GetRaw().buffer[1] >> 27); };
     TypeCode GetTypeCodeEnum() const;
 
     // Exposed for testing only.
     inline uint32_t GetNBitWordFromMessage(uint16_t n, uint16_t first_bit_index) const {
-        return GetNBitWordFromBuffer(n, kMEFirstBitIndex + first_bit_index, raw_.buffer);
+        return GetNBitWordFromBuffer(n, kMEFirstBitIndex + first_bit_index, packet_->GetRaw().buffer);
     };
 
    private:
-    Capability capability_ = kCALevel1Transponder;  // Default to most basic capability.
-
-    TypeCode typecode_ = kTypeCodeInvalid;
-
-    void ConstructADSBPacket();
+    const DecodedTransponderPacket *packet_;
 };
 
-class ModeCPacket : public DecodedTransponderPacket {
+class ModeCPacket {
    public:
     enum DownlinkRequest : uint8_t {
         kDownlinkRequestNone = 0b00000,
@@ -247,28 +299,32 @@ class ModeCPacket : public DecodedTransponderPacket {
         kUtilityMessageCommDInterrogatorIdentifierCode = 0b11
     };
 
-    ModeCPacket(const DecodedTransponderPacket &decoded_packet);
-
-    bool IsAirborne() const { return is_airborne_; }
-    bool HasAlert() const { return has_alert_; }
-    bool HasIdent() const { return has_ident_; }
-    DownlinkRequest GetDownlinkRequest() const { return downlink_request_; }
-    uint8_t GetUtilityMessage() const { return utility_message_; }
-    int32_t GetAltitudeFt() const { return altitude_ft_; }
+    /**
+     * Constructor. Non-owning view into a DF4 DecodedTransponderPacket, which must outlive the ModeCPacket. Fields are
+     * decoded from the parent's buffer when they are requested.
+     */
+    ModeCPacket(const DecodedTransponderPacket &decoded_packet) : packet_(&decoded_packet) {};
+    ModeCPacket(const DecodedTransponderPacket &&decoded_packet) = delete;  // Don't allow views of temporaries.
+
+    // Pass-throughs to the parent packet.
+    bool IsValid() const { return packet_->IsValid(); }
+    uint16_t GetDownlinkFormat() const { return packet_->GetDownlinkFormat(); }
+    uint32_t GetICAOAddress() const { return packet_->GetICAOAddress(); }
+    const DecodedTransponderPacket &GetDecodedPacket() const { return *packet_; }
+
+    bool IsAirborne() const;
+    bool HasAlert() const;
+    bool HasIdent() const;
+    DownlinkRequest GetDownlinkRequest() const;
+    uint8_t GetUtilityMessage() const;
+    UtilityMessageType GetUtilityMessageType() const;
+    int32_t GetAltitudeFt() const;
 
    private:
-    bool is_airborne_ = false;
-    bool has_alert_ = false;
-    bool has_ident_ = false;
-
-    DownlinkRequest downlink_request_ = kDownlinkRequestNone;
-    uint8_t utility_message_ = 0b0;
-    UtilityMessageType utility_message_type_ = kUtilityMessageNoInformation;
-
-    int32_t altitude_ft_ = -1;
+    const DecodedTransponderPacket *packet_;
 };
 
-class ModeAPacket : public DecodedTransponderPacket {
+class ModeAPacket {
    public:
     enum DownlinkRequest : uint8_t {
         kDownlinkRequestNone = 0b00000,
@@ -284,25 +340,29 @@ class ModeAPacket : public DecodedTransponderPacket {
         kUtilityMessageCommDInterrogatorIdentifierCode = 0b11
     };
 
-    ModeAPacket(const DecodedTransponderPacket &decoded_packet);
-
-    bool IsAirborne() const { return is_airborne_; }
-    bool HasAlert() const { return has_alert_; }
-    bool HasIdent() const { return has_ident_; }
-    DownlinkRequest GetDownlinkRequest() const { return downlink_request_; }
-    uint8_t GetUtilityMessage() const { return utility_message_; }
-    uint16_t GetSquawk() const { return squawk_; }
+    /**
+     * Constructor. Non-owning view into a DF5 DecodedTransponderPacket, which must outlive the ModeAPacket. Fields are
+     * decoded from the parent's buffer when they are requested.
+     */
+    ModeAPacket(const DecodedTransponderPacket &decoded_packet) : packet_(&decoded_packet) {};
+    ModeAPacket(const DecodedTransponderPacket &&decoded_packet) = delete;  // Don't allow views of temporaries.
+
+    // Pass-throughs to the parent packet.
+    bool IsValid() const { return packet_->IsValid(); }
+    uint16_t GetDownlinkFormat() const { return packet_->GetDownlinkFormat(); }
+    uint32_t GetICAOAddress() const { return packet_->GetICAOAddress(); }
+    const DecodedTransponderPacket &GetDecodedPacket() const { return *packet_; }
+
+    bool IsAirborne() const;
+    bool HasAlert() const;
+    bool HasIdent() const;
+    DownlinkRequest GetDownlinkRequest() const;
+    uint8_t GetUtilityMessage() const;
+    UtilityMessageType GetUtilityMessageType() const;
+    uint16_t GetSquawk() const;
 
    private:
-    bool is_airborne_ = false;
-    bool has_alert_ = false;
-    bool has_ident_ = false;
-
-    DownlinkRequest downlink_request_ = kDownlinkRequestNone;
-    uint8_t utility_message_ = 0b0;
-    UtilityMessageType utility_message_type_ = kUtilityMessageNoInformation;
-
-    uint16_t squawk_ = 0xFFFF;
+    const DecodedTransponderPacket *packet_;
 };
 
 #endif /* _ADSB_PACKET_HH_ */
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include "trigger_level_controller.hh"
+
+#include <cmath>  // For sqrtf.
+
+#include "macros.hh"
+#include "unit_conversions.hh"  // For kUsPerMs.
+
+void TriggerLevelController::Start(int tl_mv, int noise_floor_mv, int tl_min_mv, int tl_max_mv) {
+    tl_min_mv_ = MAX(tl_min_mv, config_.tl_min_mv);
+    tl_max_mv_ = MIN(tl_max_mv, config_.tl_max_mv);
+    tl_mv_ = tl_mv;
+    margin_mv_ = tl_mv - noise_floor_mv;
+    step_mv_ = config_.initial_step_mv;
+    last_step_direction_ = 0;
+    last_noise_occupancy_ = 0.0f;
+    ResetBandit();
+    enabled_ = true;
+}
+
+int TriggerLevelController::Update(const AircraftDictionary::Metrics &metrics, int noise_floor_mv,
+                                   uint32_t interval_ms) {
+    if (!enabled_ || interval_ms == 0) {
+        return tl_mv_;
+    }
+
+    uint32_t num_valid_frames = 0;
+    uint32_t num_demods = 0;
+    uint32_t max_source_noise_demods = 0;
+    for (uint16_t i = 0; i < AircraftDictionary::kMaxNumSources; i++) {
+        uint16_t source_valid_frames =
+            metrics.valid_squitter_frames_by_source[i] + metrics.valid_extended_squitter_frames_by_source[i];
+        uint16_t source_demods = metrics.demods_1090_by_source[i];
+        num_valid_frames += source_valid_frames;
+        num_demods += source_demods;
+        if (source_demods >= source_valid_frames) {
+            max_source_noise_demods =
+                MAX(max_source_noise_demods, static_cast<uint32_t>(source_demods - source_valid_frames));
+        }
+    }
+    last_noise_occupancy_ =
+        static_cast<float>(max_source_noise_demods) * config_.demod_duration_us / (interval_ms * kUsPerMs);
+
+    if (num_settle_intervals_remaining_ > 0) {
+        // Interval straddled a trigger level change.
+        num_settle_intervals_remaining_--;
+    } else if (last_noise_occupancy_ > config_.max_noise_occupancy) {
+        // Demodulators are busy with noise.
+        StepMargin(1, noise_floor_mv);
+    } else if (num_demods < config_.min_num_demods || last_noise_occupancy_ < config_.min_noise_occupancy) {
+        // Room to go lower before noise gets in the way.
+        StepMargin(-1, noise_floor_mv);
+    } else if (arm_ == kArmHigh) {
+        arm_valid_frames_[kArmHigh] += num_valid_frames;
+        arm_ = kArmLow;
+        num_settle_intervals_remaining_ = config_.num_settle_intervals;
+    } else {
+        arm_valid_frames_[kArmLow] += num_valid_frames;
+        num_bandit_rounds_++;
+        // Valid frame counts are roughly Poisson, so the variance of the difference is the sum of the counts.
+        float diff = static_cast<float>(arm_valid_frames_[kArmHigh]) - static_cast<float>(arm_valid_frames_[kArmLow]);
+        float min_diff =
+            config_.min_valid_frames_diff_sigmas * sqrtf(arm_valid_frames_[kArmHigh] + arm_valid_frames_[kArmLow]);
+        if (diff > min_diff) {
+            StepMargin(1, noise_floor_mv);
+        } else if (diff < -min_diff) {
+            StepMargin(-1, noise_floor_mv);
+        } else if (num_bandit_rounds_ >= config_.max_num_bandit_rounds) {
+            // Near the optimum: refine with a smaller step.
+            step_mv_ = MAX(step_mv_ / 2, config_.min_step_mv);
+            last_step_direction_ = 0;
+            ResetBandit();
+        } else {
+            // Keep accumulating.
+            arm_ = kArmHigh;
+            num_settle_intervals_remaining_ = config_.num_settle_intervals;
+        }
+    }
+
+    tl_mv_ = GetTLMilliVolts(noise_floor_mv);
+    return tl_mv_;
+}
+
+void TriggerLevelController::ResetBandit() {
+    arm_ = kArmHigh;
+    arm_valid_frames_[kArmHigh] = 0;
+    arm_valid_frames_[kArmLow] = 0;
+    num_bandit_rounds_ = 0;
+    num_settle_intervals_remaining_ = config_.num_settle_intervals;
+}
+
+void TriggerLevelController::StepMargin(int direction, int noise_floor_mv) {
+    if (direction == last_step_direction_) {
+        step_mv_ = MIN(step_mv_ * 2, config_.max_step_mv);
+        last_step_direction_ = direction;
+    } else if (last_step_direction_ != 0) {
+        // Overshot. Don't grow the step again on the next step, or the margin can cycle around the optimum.
+        step_mv_ = MAX(step_mv_ / 2, config_.min_step_mv);
+        last_step_direction_ = 0;
+    } else {
+        last_step_direction_ = direction;
+    }
+    // Don't let the margin wind up past the trigger level limits.
+    margin_mv_ = MIN(MAX(margin_mv_ + direction * step_mv_, tl_min_mv_ - noise_floor_mv), tl_max_mv_ - noise_floor_mv);
+    ResetBandit();
+}
+
+int TriggerLevelController::GetTLMilliVolts(int noise_floor_mv) const {
+    int tl_mv = noise_floor_mv + margin_mv_ + (arm_ == kArmHigh ? config_.dither_mv : -config_.dither_mv);
+    return MIN(MAX(tl_mv, tl_min_mv_), tl_max_mv_);
+}
@@ -0,0 +1,135 @@
+#ifndef TRIGGER_LEVEL_CONTROLLER_HH_
+#define TRIGGER_LEVEL_CONTROLLER_HH_
+
+#include "aircraft_dictionary.hh"  // For AircraftDictionary::Metrics.
+#include "stdint.h"
+
+/**
+ * Closed-loop controller for the trigger level (TL) of the data slicer. Runs continuously once enabled, with one
+ * update per aircraft dictionary metrics interval.
+ *
+ * The trigger level is tracked as a margin above the noise floor, so it follows the noise floor right away as it
+ * drifts through the day. The margin is steered by how busy the demodulator state machines are with demods that don't
+ * decode into valid frames. For each state machine, demods minus valid frames times the length of a demod is the
+ * fraction of time it spent on noise, during which it couldn't receive anything else. The margin is raised when the
+ * busiest state machine spends more than max_noise_occupancy on noise, and lowered to look for weaker signals when it
+ * spends less than min_noise_occupancy.
+ *
+ * Between the two, the margin is fine tuned with a two-armed bandit. The trigger level is dithered above and below the
+ * margin on alternating metrics intervals, and the margin steps towards whichever side decoded significantly more
+ * valid frames. The step size grows while the margin keeps moving in the same direction and shrinks when it reverses
+ * or when the bandit can't tell the arms apart.
+ */
+class TriggerLevelController {
+   public:
+    struct TriggerLevelControllerConfig {
+        int tl_min_mv = 0;
+        int tl_max_mv = 3300;
+        int dither_mv = 20;  // Trigger level offset above and below the margin for each arm of the bandit.
+        int initial_step_mv = 50;
+        int min_step_mv = 10;
+        int max_step_mv = 400;
+        // Longest demod, for an extended squitter with its preamble.
+        uint16_t demod_duration_us = 120;
+        // Band for the fraction of time the busiest state machine spends on demods that don't decode.
+        float min_noise_occupancy = 0.02f;
+        float max_noise_occupancy = 0.05f;
+        // Below this many demods across all state machines in an interval, the trigger level is assumed to be above
+        // most signals and the margin is lowered.
+        uint16_t min_num_demods = 10;
+        // Difference in valid frames between the arms, in standard deviations of the count, needed to move the margin.
+        float min_valid_frames_diff_sigmas = 2.0f;
+        // Rounds of the bandit to accumulate before giving up on telling the arms apart.
+        uint16_t max_num_bandit_rounds = 4;
+        // Metrics intervals to skip after the trigger level changes. Metrics intervals aren't aligned with trigger
+        // level updates, so the first interval after a change has counts from both the old and new trigger level.
+        uint16_t num_settle_intervals = 1;
+    };
+
+    TriggerLevelController(TriggerLevelControllerConfig config_in) : config_(config_in) {}
+
+    /**
+     * Starts controlling the trigger level.
+     * @param[in] tl_mv Current trigger level, in milliVolts.
+     * @param[in] noise_floor_mv Current noise floor, in milliVolts.
+     * @param[in] tl_min_mv Lowest trigger level the controller may use, in milliVolts.
+     * @param[in] tl_max_mv Highest trigger level the controller may use, in milliVolts.
+     */
+    void Start(int tl_mv, int noise_floor_mv, int tl_min_mv, int tl_max_mv);
+
+    /**
+     * Stops controlling the trigger level. Update() returns the last trigger level until Start() is called again.
+     */
+    void Stop() { enabled_ = false; }
+
+    /**
+     * Returns whether the controller is running.
+     */
+    bool IsEnabled() const { return enabled_; }
+
+    /**
+     * Feeds the metrics from a complete metrics interval into the controller.
+     * @param[in] metrics Aircraft dictionary metrics from the last complete interval, received at the trigger level
+     * from the previous call to Update().
+     * @param[in] noise_floor_mv Current noise floor, in milliVolts.
+     * @param[in] interval_ms Length of the metrics interval, in milliseconds.
+     * @retval Trigger level to use for the next interval, in milliVolts.
+     */
+    int Update(const AircraftDictionary::Metrics &metrics, int noise_floor_mv, uint32_t interval_ms);
+
+    /**
+     * Returns the margin between the trigger level and the noise floor that the controller has settled on, without
+     * dither.
+     * @retval Margin in milliVolts.
+     */
+    int GetMarginMilliVolts() const { return margin_mv_; }
+
+    /**
+     * Returns the current step size for the margin.
+     * @retval Step size in milliVolts.
+     */
+    int GetStepMilliVolts() const { return step_mv_; }
+
+    /**
+     * Returns the fraction of time that the busiest state machine spent on demods that didn't decode during the last
+     * interval.
+     */
+    float GetLastNoiseOccupancy() const { return last_noise_occupancy_; }
+
+   private:
+    enum Arm : uint16_t { kArmHigh = 0, kArmLow, kNumArms };
+
+    /**
+     * Clears the bandit and starts measuring from the high arm.
+     */
+    void ResetBandit();
+
+    /**
+     * Steps the margin and resets the bandit.
+     * @param[in] direction 1 to raise the margin, -1 to lower it.
+     * @param[in] noise_floor_mv Current noise floor, in milliVolts.
+     */
+    void StepMargin(int direction, int noise_floor_mv);
+
+    /**
+     * Returns the trigger level for the current arm, clamped to the allowed range.
+     */
+    int GetTLMilliVolts(int noise_floor_mv) const;
+
+    TriggerLevelControllerConfig config_;
+
+    bool enabled_ = false;
+    int tl_min_mv_ = 0;
+    int tl_max_mv_ = 0;
+    int tl_mv_ = 0;
+    int margin_mv_ = 0;
+    int step_mv_ = 0;
+    int last_step_direction_ = 0;
+    Arm arm_ = kArmHigh;
+    uint32_t arm_valid_frames_[kNumArms] = {0};
+    uint16_t num_bandit_rounds_ = 0;
+    uint16_t num_settle_intervals_remaining_ = 0;
+    float last_noise_occupancy_ = 0.0f;
+};
+
+#endif /* TRIGGER_LEVEL_CONTROLLER_HH_ */
@@ -7,6 +7,9 @@
 
 const uint8_t kBeastEscapeChar = 0x1a;
 const uint16_t kBeastMLATTimestampNumBytes = 6;
+// Validated Beast outputs (e.g. feeds) drop packets that needed more bit corrections than this to pass CRC, since
+// aggregators do their own error correction and are stricter about false positives than we are.
+const uint16_t kBeastMaxNumCorrectedBits = 1;
 
 // Beast Frame Structure
 // <preceded by 0x1a escape character>
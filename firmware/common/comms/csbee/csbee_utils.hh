@@ -14,28 +14,32 @@ const uint16_t kEOLNumChars = 2;
  * kCSBeeMessageStrMaxLen.
  * @param[out] message_buf Character array to write into.
  * @param[in] aircraft Aircraft object to dump the contents of.
+ * @param[in] metadata AircraftMetadata stored alongside the aircraft, used for the SYSINFO field.
  * @retval Number of characters written to the string buffer, or a negative value if something went wrong.
  */
-inline int16_t WriteCSBeeAircraftMessageStr(char message_buf[], const Aircraft &aircraft) {
+inline int16_t WriteCSBeeAircraftMessageStr(char message_buf[], const Aircraft &aircraft,
+                                            const AircraftMetadata &metadata) {
     // #A:ICAO,FLAGS,CALL,SQ,LAT,LON,ALT_BARO,TRACK,VELH,VELV,SIGS,SIGQ,FPS,NICNAC,ALT_GEO,ECAT,CRC\r\n
 
     // Build up SYSINFO bitfield.
     // Convert aircraft length and width to maximum dimension.
-    uint32_t sysinfo = MAX(aircraft.length_m, aircraft.width_m) << 22;  // MDIM bitfield.
+    uint32_t sysinfo = MAX(metadata.length_m, metadata.width_m) << 22;  // MDIM bitfield.
     // Convert GNSS antenna offset value to CSBee formatted bitfield.
-    if (aircraft.gnss_antenna_offset_right_of_roll_axis_m != INT8_MAX) {
-        sysinfo |= (((aircraft.gnss_antenna_offset_right_of_roll_axis_m > 0) & 0b1) << 21);         // GAOR bitfield.
-        sysinfo |= (((ABS(aircraft.gnss_antenna_offset_right_of_roll_axis_m) >> 1) & 0b11) << 19);  // GAOD bitfield.
+    if (metadata.gnss_antenna_offset_right_of_roll_axis_m != INT8_MAX) {
+        sysinfo |= (((metadata.gnss_antenna_offset_right_of_roll_axis_m > 0) & 0b1) << 21);         // GAOR bitfield.
+        sysinfo |= (((ABS(metadata.gnss_antenna_offset_right_of_roll_axis_m) >> 1) & 0b11) << 19);  // GAOD bitfield.
         sysinfo |= (0b1 << 18);                                                                     // GAOK bitfield.
     }
-    sysinfo |= ((aircraft.system_design_assurance & 0b11) << 16);                 // SDA bitfield.
-    sysinfo |= ((aircraft.source_integrity_level & 0b11) << 14);                  // SIL bitfield.
-    sysinfo |= ((aircraft.geometric_vertical_accuracy & 0b11) << 12);             // GVA bitfield
-    sysinfo |= ((aircraft.navigation_accuracy_category_position & 0b1111) << 8);  // NAC_p bitfield.
-    sysinfo |= ((aircraft.navigation_accuracy_category_velocity & 0b111) << 5);   // NAC_v bitfield.
-    sysinfo |= ((aircraft.navigation_integrity_category_baro & 0b1) << 4);        // NIC_baro bitfield.
+    sysinfo |= ((metadata.system_design_assurance & 0b11) << 16);                 // SDA bitfield.
+    sysinfo |= ((metadata.source_integrity_level & 0b11) << 14);                  // SIL bitfield.
+    sysinfo |= ((metadata.geometric_vertical_accuracy & 0b11) << 12);             // GVA bitfield
+    sysinfo |= ((metadata.navigation_accuracy_category_position & 0b1111) << 8);  // NAC_p bitfield.
+    sysinfo |= ((metadata.navigation_accuracy_category_velocity & 0b111) << 5);   // NAC_v bitfield.
+    sysinfo |= ((metadata.navigation_integrity_category_baro & 0b1) << 4);        // NIC_baro bitfield.
     sysinfo |= ((aircraft.navigation_integrity_category & 0b1111));               // NIC bitfield.
 
+    Aircraft::Metrics metrics = metadata.GetMetrics();
+
     int16_t num_chars =  // Print everything except CRC into string buffer.
         snprintf(message_buf, kCSBeeMessageStrMaxLen - kCRCMaxNumChars - 1,
                  "#A:%06X,"                                      // ICAO, e.g. 3C65AC
@@ -69,8 +73,8 @@ inline int16_t WriteCSBeeAircraftMessageStr(char message_buf[], const Aircraft &
                  aircraft.vertical_rate_fpm,                     // VELV
                  aircraft.last_message_signal_strength_dbm,      // SIGS
                  aircraft.last_message_signal_quality_db,        // SIGQ
-                 aircraft.metrics.valid_squitter_frames,           // SFPS
-                 aircraft.metrics.valid_extended_squitter_frames,  // ESFPS
+                 metrics.valid_squitter_frames,                  // SFPS
+                 metrics.valid_extended_squitter_frames,         // ESFPS
                  sysinfo                                         // SYSINFO
         );
     if (num_chars < 0) return num_chars;  // Check if snprintf call got busted.
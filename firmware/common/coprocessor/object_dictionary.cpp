@@ -1,6 +1,7 @@
 #include "object_dictionary.hh"
 
 #include "comms.hh"
+#include "raw_packet_batch.hh"
 
 const uint8_t ObjectDictionary::kFirmwareVersionMajor = 0;
 const uint8_t ObjectDictionary::kFirmwareVersionMinor = 6;
@@ -48,12 +49,26 @@ bool ObjectDictionary::SetBytes(Address addr, uint8_t *buf, uint16_t buf_len, ui
             break;
         }
         case kAddrRawTransponderPacketArray: {
-            uint8_t num_packets = buf[0];
-            RawTransponderPacket tpacket;
-            for (uint16_t i = 0; i < num_packets && i * sizeof(RawTransponderPacket) + sizeof(uint8_t) < buf_len; i++) {
-                memcpy(&tpacket, buf + sizeof(uint8_t) + i * sizeof(RawTransponderPacket),
-                       sizeof(RawTransponderPacket));
-                adsbee_server.HandleRawTransponderPacket(tpacket);
+            // Decode packets straight from the SPI buffer into the packet queue, without copying the batch.
+            RawPacketBatch::Reader reader = RawPacketBatch::Reader(buf, buf_len);
+            if (!reader.IsValid()) {
+                CONSOLE_ERROR("ObjectDictionary::SetBytes",
+                              "Received raw packet batch with a bad header or unsupported format version.");
+                return false;
+            }
+            uint16_t num_packets_queued = 0;
+            DecodedTransponderPacket *tpacket;
+            while ((tpacket = adsbee_server.transponder_packet_queue.GetPushSlot()) != nullptr &&
+                   reader.Next(*tpacket)) {
+                adsbee_server.transponder_packet_queue.CommitPush();
+                num_packets_queued++;
+            }
+            if (num_packets_queued < reader.GetNumPackets()) {
+                // Only the consumer may clear the queue, so drop the rest of the batch instead. Still ack the write,
+                // since a retry would queue the first part of the batch twice.
+                CONSOLE_ERROR("ObjectDictionary::SetBytes",
+                              "Dropped %d of %d packets in raw packet batch. Queue full or batch truncated?",
+                              reader.GetNumPackets() - num_packets_queued, reader.GetNumPackets());
             }
             break;
         }
@@ -63,6 +78,19 @@ bool ObjectDictionary::SetBytes(Address addr, uint8_t *buf, uint16_t buf_len, ui
             xQueueSend(adsbee_server.rp2040_aircraft_dictionary_metrics_queue, &rp2040_metrics, 0);
             break;
         }
+        case kAddrPerfStats:
+            // Stats are too big for a single SPI write, so forward them once the last chunk arrives.
+            if (offset + buf_len > sizeof(PerfMonitor::Stats)) {
+                CONSOLE_ERROR("ObjectDictionary::SetBytes",
+                              "Perf stats write of %d Bytes at offset %d overruns the %zu Byte stats struct.", buf_len,
+                              offset, sizeof(PerfMonitor::Stats));
+                return false;
+            }
+            memcpy((uint8_t *)&rp2040_perf_stats_ + offset, buf, buf_len);
+            if (offset + buf_len == sizeof(PerfMonitor::Stats)) {
+                xQueueSend(adsbee_server.rp2040_perf_stats_queue, &rp2040_perf_stats_, 0);
+            }
+            break;
 #endif
         case kAddrSettingsData:
             // Warning: printing here will cause a timeout and tests will fail.
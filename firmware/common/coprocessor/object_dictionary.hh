@@ -1,6 +1,7 @@
 #ifndef OBJECT_DICTIONARY_HH_
 #define OBJECT_DICTIONARY_HH_
 
+#include "perf_monitor.hh"
 #include "settings.hh"
 #include "stdint.h"
 #ifdef ON_ESP32
@@ -33,6 +34,7 @@ class ObjectDictionary {
         kAddrDeviceInfo = 0x09,                 // ESP32 MAC addresses.
         kAddrConsole = 0xA,                     // Pipe for console characters.
         kAddrNetworkInfo = 0xB,                 // Network information for ESP32.
+        kAddrPerfStats = 0xC,                   // For forwarding PerfMonitor stats from RP2040 to ESP32.
         kNumAddrs
     };
 
@@ -102,6 +104,9 @@ class ObjectDictionary {
 
    private:
     uint32_t scratch_ = 0x0;  // Scratch register used for testing.
+#ifdef ON_ESP32
+    PerfMonitor::Stats rp2040_perf_stats_;  // Reassembled from multiple SPI writes.
+#endif
 };
 
 extern ObjectDictionary object_dictionary;
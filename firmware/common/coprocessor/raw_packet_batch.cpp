@@ -0,0 +1,206 @@
+#include "raw_packet_batch.hh"
+
+#include <cstring>  // For memcpy.
+
+#include "macros.hh"
+
+static const uint8_t kFlagsLongFrame = 0b1 << 7;
+static const uint8_t kFlagsDecoded = 0b1 << 6;
+static const uint8_t kFlagsValid = 0b1 << 5;
+static const uint16_t kFlagsNumCorrectedBitsShift = 3;
+static const uint8_t kFlagsNumCorrectedBitsMask = 0b11;
+static const uint8_t kFlagsSourceMask = 0x7;
+
+static const uint16_t kNumPacketsOffsetBytes = sizeof(uint8_t);
+static const uint16_t kBaseMLATOffsetBytes = kNumPacketsOffsetBytes + sizeof(uint16_t);
+
+static const uint16_t kShortPayloadLenBytes = DecodedTransponderPacket::kSquitterPacketLenBits / 8;
+
+static_assert(RawPacketBatch::kSourceUnknown == kFlagsSourceMask);
+static_assert(kShortPayloadLenBytes + RawPacketBatch::kICAOAddressLenBytes <= RawPacketBatch::kPayloadMaxLenBytes);
+
+/**
+ * Squeezes a signal level into a signed Byte. INT32_MIN (no measurement) maps to RawPacketBatch::kSignalUnknown.
+ */
+static inline int8_t SignalToInt8(int32_t signal) {
+    if (signal == INT32_MIN) {
+        return RawPacketBatch::kSignalUnknown;
+    }
+    return static_cast<int8_t>(MAX(MIN(signal, INT8_MAX), INT8_MIN + 1));
+}
+
+static inline int32_t Int8ToSignal(int8_t signal) {
+    return signal == RawPacketBatch::kSignalUnknown ? INT32_MIN : signal;
+}
+
+/**
+ * Writes a signed value as a zigzag LEB128 varint.
+ * @retval Number of Bytes written.
+ */
+static inline uint16_t WriteVarint(uint8_t *buf, int64_t value) {
+    uint64_t zigzag = (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    uint16_t len_bytes = 0;
+    while (zigzag >= 0x80) {
+        buf[len_bytes++] = static_cast<uint8_t>(zigzag) | 0x80;
+        zigzag >>= 7;
+    }
+    buf[len_bytes++] = static_cast<uint8_t>(zigzag);
+    return len_bytes;
+}
+
+/**
+ * Reads a zigzag LEB128 varint.
+ * @retval Number of Bytes read, or 0 if the varint ran off the end of the buffer.
+ */
+static inline uint16_t ReadVarint(const uint8_t *buf, uint16_t buf_len_bytes, int64_t &value) {
+    uint64_t zigzag = 0;
+    for (uint16_t i = 0; i < buf_len_bytes && i < RawPacketBatch::kMLATDeltaMaxLenBytes; i++) {
+        zigzag |= static_cast<uint64_t>(buf[i] & 0x7F) << (7 * i);
+        if ((buf[i] & 0x80) == 0) {
+            value = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 0b1);
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+/** RawPacketBatch::Writer **/
+
+RawPacketBatch::Writer::Writer(uint8_t *buf, uint16_t buf_len_bytes) : buf_(buf), buf_len_bytes_(buf_len_bytes) {
+    Clear();
+}
+
+bool RawPacketBatch::Writer::Append(const RawTransponderPacket &packet) { return Append(packet, false, false, 0); }
+
+bool RawPacketBatch::Writer::Append(const DecodedTransponderPacket &packet) {
+    return Append(packet.GetRaw(), true, packet.IsValid(), packet.GetICAOAddress());
+}
+
+bool RawPacketBatch::Writer::Append(const RawTransponderPacket &packet, bool decoded, bool is_valid,
+                                    uint32_t icao_address) {
+    if (num_packets_ == UINT16_MAX || buf_len_bytes_ - len_bytes_ < kRecordMaxLenBytes) {
+        return false;
+    }
+    if (num_packets_ == 0) {
+        // MLAT deltas are relative to the first packet.
+        last_mlat_48mhz_64bit_counts_ = packet.mlat_48mhz_64bit_counts;
+        memcpy(buf_ + kBaseMLATOffsetBytes, &last_mlat_48mhz_64bit_counts_, sizeof(uint64_t));
+    }
+
+    bool long_frame = packet.buffer_len_bits == DecodedTransponderPacket::kExtendedSquitterPacketLenBits;
+    uint8_t *record = buf_ + len_bytes_;
+    record[0] = (long_frame ? kFlagsLongFrame : 0) | (decoded ? kFlagsDecoded : 0) | (is_valid ? kFlagsValid : 0) |
+                (MIN(packet.num_corrected_bits, kFlagsNumCorrectedBitsMask) << kFlagsNumCorrectedBitsShift) |
+                (packet.source < 0 ? kSourceUnknown : MIN(packet.source, kFlagsSourceMask - 1));
+    uint16_t record_len_bytes = sizeof(uint8_t);
+    record_len_bytes += WriteVarint(
+        record + record_len_bytes,
+        static_cast<int64_t>(packet.mlat_48mhz_64bit_counts - last_mlat_48mhz_64bit_counts_));
+    last_mlat_48mhz_64bit_counts_ = packet.mlat_48mhz_64bit_counts;
+    record[record_len_bytes++] = SignalToInt8(packet.sigs_dbm);
+    record[record_len_bytes++] = SignalToInt8(packet.sigq_db);
+    // Words in the packet buffer are filled MSB first.
+    uint16_t payload_len_bytes = long_frame ? kPayloadMaxLenBytes : kShortPayloadLenBytes;
+    for (uint16_t i = 0; i < payload_len_bytes; i++) {
+        record[record_len_bytes++] = packet.buffer[i / sizeof(uint32_t)] >> (24 - 8 * (i % sizeof(uint32_t)));
+    }
+    if (decoded && is_valid && !long_frame) {
+        // Only the sender's aircraft dictionary can tell which address is hidden in the parity field.
+        for (uint16_t i = 0; i < kICAOAddressLenBytes; i++) {
+            record[record_len_bytes++] = icao_address >> (8 * i);
+        }
+    }
+
+    len_bytes_ += record_len_bytes;
+    num_packets_++;
+    memcpy(buf_ + kNumPacketsOffsetBytes, &num_packets_, sizeof(uint16_t));
+    return true;
+}
+
+void RawPacketBatch::Writer::Clear() {
+    len_bytes_ = kHeaderLenBytes;
+    num_packets_ = 0;
+    last_mlat_48mhz_64bit_counts_ = 0;
+    buf_[0] = kFormatVersion;
+    memcpy(buf_ + kNumPacketsOffsetBytes, &num_packets_, sizeof(uint16_t));
+    memcpy(buf_ + kBaseMLATOffsetBytes, &last_mlat_48mhz_64bit_counts_, sizeof(uint64_t));
+}
+
+/** RawPacketBatch::Reader **/
+
+RawPacketBatch::Reader::Reader(const uint8_t *buf, uint16_t buf_len_bytes) : buf_(buf), buf_len_bytes_(buf_len_bytes) {
+    if (buf_len_bytes_ < kHeaderLenBytes || buf_[0] != kFormatVersion) {
+        return;
+    }
+    memcpy(&num_packets_, buf_ + kNumPacketsOffsetBytes, sizeof(uint16_t));
+    memcpy(&last_mlat_48mhz_64bit_counts_, buf_ + kBaseMLATOffsetBytes, sizeof(uint64_t));
+    offset_bytes_ = kHeaderLenBytes;
+    valid_ = true;
+}
+
+bool RawPacketBatch::Reader::Next(RawTransponderPacket &packet) {
+    bool decoded, is_valid;
+    uint32_t icao_address;
+    return Next(packet, decoded, is_valid, icao_address);
+}
+
+bool RawPacketBatch::Reader::Next(DecodedTransponderPacket &packet) {
+    RawTransponderPacket raw_packet;
+    bool decoded, is_valid;
+    uint32_t icao_address;
+    if (!Next(raw_packet, decoded, is_valid, icao_address)) {
+        return false;
+    }
+    packet = decoded ? DecodedTransponderPacket(raw_packet, is_valid, icao_address)
+                     : DecodedTransponderPacket(raw_packet);
+    return true;
+}
+
+bool RawPacketBatch::Reader::Next(RawTransponderPacket &packet, bool &decoded, bool &is_valid,
+                                  uint32_t &icao_address) {
+    if (!valid_ || num_packets_read_ >= num_packets_ || offset_bytes_ >= buf_len_bytes_) {
+        return false;
+    }
+    const uint8_t *record = buf_ + offset_bytes_;
+    uint16_t bytes_remaining = buf_len_bytes_ - offset_bytes_;
+    uint8_t flags = record[0];
+    int64_t mlat_delta = 0;
+    uint16_t varint_len_bytes = ReadVarint(record + sizeof(uint8_t), bytes_remaining - sizeof(uint8_t), mlat_delta);
+    uint16_t payload_len_bytes = (flags & kFlagsLongFrame) ? kPayloadMaxLenBytes : kShortPayloadLenBytes;
+    decoded = flags & kFlagsDecoded;
+    is_valid = flags & kFlagsValid;
+    bool has_icao_address = decoded && is_valid && !(flags & kFlagsLongFrame);
+    uint16_t record_len_bytes = sizeof(uint8_t) + varint_len_bytes + 2 * sizeof(int8_t) + payload_len_bytes +
+                                (has_icao_address ? kICAOAddressLenBytes : 0);
+    if (varint_len_bytes == 0 || record_len_bytes > bytes_remaining) {
+        valid_ = false;  // Truncated record, don't try to read past it.
+        return false;
+    }
+
+    last_mlat_48mhz_64bit_counts_ += static_cast<uint64_t>(mlat_delta);
+    packet.mlat_48mhz_64bit_counts = last_mlat_48mhz_64bit_counts_;
+    packet.num_corrected_bits = (flags >> kFlagsNumCorrectedBitsShift) & kFlagsNumCorrectedBitsMask;
+    packet.source = (flags & kFlagsSourceMask) == kSourceUnknown ? -1 : (flags & kFlagsSourceMask);
+    const uint8_t *field = record + sizeof(uint8_t) + varint_len_bytes;
+    packet.sigs_dbm = Int8ToSignal(static_cast<int8_t>(field[0]));
+    packet.sigq_db = Int8ToSignal(static_cast<int8_t>(field[1]));
+    field += 2 * sizeof(int8_t);
+    packet.buffer_len_bits = payload_len_bytes * 8;
+    for (uint16_t i = 0; i < RawTransponderPacket::kMaxPacketLenWords32; i++) {
+        packet.buffer[i] = 0;
+    }
+    for (uint16_t i = 0; i < payload_len_bytes; i++) {
+        packet.buffer[i / sizeof(uint32_t)] |= static_cast<uint32_t>(field[i]) << (24 - 8 * (i % sizeof(uint32_t)));
+    }
+    field += payload_len_bytes;
+    icao_address = 0;
+    if (has_icao_address) {
+        for (uint16_t i = 0; i < kICAOAddressLenBytes; i++) {
+            icao_address |= static_cast<uint32_t>(field[i]) << (8 * i);
+        }
+    }
+
+    offset_bytes_ += record_len_bytes;
+    num_packets_read_++;
+    return true;
+}
@@ -0,0 +1,147 @@
+#ifndef RAW_PACKET_BATCH_HH_
+#define RAW_PACKET_BATCH_HH_
+
+#include "stdint.h"
+#include "transponder_packet.hh"
+
+/**
+ * Packed, versioned encoding for batches of RawTransponderPackets sent from the RP2040 to the ESP32 over SPI. Each
+ * packet is a variable length record instead of a whole RawTransponderPacket struct, which roughly doubles the number
+ * of packets that fit in a single SPI transfer.
+ *
+ * Batch: version (uint8_t) | num_packets (uint16_t) | base MLAT counts (uint64_t) | record 1 | record 2 | ...
+ * Record: flags (uint8_t) | MLAT delta (varint) | sigs_dbm (int8_t) | sigq_db (int8_t) | payload (7 or 14 Bytes)
+ *         | ICAO address (3 Bytes, only for decoded and valid 56-bit frames)
+ *
+ * Flags hold the payload length (bit 7 set for 112-bit frames), whether the sender already decoded the frame (bit 6),
+ * whether it found the frame valid (bit 5), the number of corrected bits (bits 3-4) and the source (bits 0-2, 0x7 for
+ * no source). The MLAT delta is the difference from the previous packet's MLAT counts (the base for the first packet),
+ * zigzag and LEB128 encoded so that small deltas of either sign take few Bytes. Multi-Byte fields are little endian,
+ * like the rest of the SPI protocol. The payload is the frame in transmission order, after error correction.
+ *
+ * Frames that were already decoded carry the sender's verdict with them, so the receiver doesn't need to redo the CRC,
+ * error correction, or address recovery. This matters most for 56-bit frames, which can only be validated against
+ * the sender's aircraft dictionary: the ICAO address recovered from their parity field is sent along with them.
+ */
+class RawPacketBatch {
+   public:
+    static const uint8_t kFormatVersion = 2;
+    static const uint16_t kHeaderLenBytes = sizeof(uint8_t) + sizeof(uint16_t) + sizeof(uint64_t);
+    static const uint16_t kMLATDeltaMaxLenBytes = 10;  // LEB128 of a 64-bit value.
+    static const uint16_t kPayloadMaxLenBytes =
+        DecodedTransponderPacket::kExtendedSquitterPacketLenBits / 8;  // 14 Bytes.
+    static const uint16_t kICAOAddressLenBytes = 3;
+    // 112-bit frames never carry an ICAO address, and it fits in the room that 56-bit frames leave.
+    static const uint16_t kRecordMaxLenBytes =
+        sizeof(uint8_t) + kMLATDeltaMaxLenBytes + 2 * sizeof(int8_t) + kPayloadMaxLenBytes;
+
+    static const int8_t kSignalUnknown = INT8_MIN;  // Stands in for INT32_MIN in sigs_dbm and sigq_db.
+    static const uint8_t kSourceUnknown = 0x7;
+
+    /**
+     * Builds a batch in a buffer owned by the caller.
+     */
+    class Writer {
+       public:
+        /**
+         * Constructor. Writes an empty batch into the buffer.
+         * @param[in] buf Buffer to build the batch in. Must be at least kHeaderLenBytes long.
+         * @param[in] buf_len_bytes Length of the buffer.
+         */
+        Writer(uint8_t *buf, uint16_t buf_len_bytes);
+
+        /**
+         * Appends a packet to the batch. Only 56-bit and 112-bit frames are supported, anything that isn't 112 bits
+         * is sent as a 56-bit frame.
+         * @param[in] packet Packet to append.
+         * @retval True if the packet was appended, false if it didn't fit.
+         */
+        bool Append(const RawTransponderPacket &packet);
+
+        /**
+         * Appends a packet along with the results of decoding it, so that the receiver doesn't have to decode it
+         * again. Call after the packet has been ingested into the aircraft dictionary, since that's what validates
+         * 56-bit frames.
+         * @param[in] packet Decoded packet to append.
+         * @retval True if the packet was appended, false if it didn't fit.
+         */
+        bool Append(const DecodedTransponderPacket &packet);
+
+        /**
+         * Empties the batch so that the buffer can be reused.
+         */
+        void Clear();
+
+        uint16_t GetNumPackets() const { return num_packets_; }
+        uint16_t GetLenBytes() const { return len_bytes_; }
+
+       private:
+        /**
+         * Shared by both versions of Append().
+         * @param[in] decoded Whether is_valid and icao_address hold the results of decoding the packet.
+         */
+        bool Append(const RawTransponderPacket &packet, bool decoded, bool is_valid, uint32_t icao_address);
+
+        uint8_t *buf_;
+        uint16_t buf_len_bytes_;
+        uint16_t len_bytes_ = 0;
+        uint16_t num_packets_ = 0;
+        uint64_t last_mlat_48mhz_64bit_counts_ = 0;
+    };
+
+    /**
+     * Decodes packets straight out of a received batch, without copying the batch.
+     */
+    class Reader {
+       public:
+        /**
+         * Constructor. Checks the header of the batch.
+         * @param[in] buf Buffer with the batch in it. Must stay around while the reader is used.
+         * @param[in] buf_len_bytes Length of the batch.
+         */
+        Reader(const uint8_t *buf, uint16_t buf_len_bytes);
+
+        /**
+         * Returns whether the batch had a valid header with a supported version.
+         */
+        bool IsValid() const { return valid_; }
+
+        /**
+         * Returns the number of packets in the batch, according to its header.
+         */
+        uint16_t GetNumPackets() const { return num_packets_; }
+
+        /**
+         * Decodes the next packet in the batch.
+         * @param[out] packet Packet to decode into, e.g. a slot in a queue.
+         * @retval True if a packet was decoded, false if there are no more packets or the record was truncated.
+         */
+        bool Next(RawTransponderPacket &packet);
+
+        /**
+         * Decodes the next packet in the batch into a DecodedTransponderPacket. Packets that the sender already decoded
+         * keep the sender's verdict, anything else is decoded from scratch.
+         * @param[out] packet Packet to decode into, e.g. a slot in a queue.
+         * @retval True if a packet was decoded, false if there are no more packets or the record was truncated.
+         */
+        bool Next(DecodedTransponderPacket &packet);
+
+       private:
+        /**
+         * Shared by both versions of Next().
+         * @param[out] decoded Set if the sender decoded the packet, in which case is_valid and icao_address are set
+         * too.
+         */
+        bool Next(RawTransponderPacket &packet, bool &decoded, bool &is_valid, uint32_t &icao_address);
+
+        const uint8_t *buf_;
+        uint16_t buf_len_bytes_;
+        uint16_t offset_bytes_ = 0;
+        uint16_t num_packets_ = 0;
+        uint16_t num_packets_read_ = 0;
+        uint64_t last_mlat_48mhz_64bit_counts_ = 0;
+        bool valid_ = false;
+    };
+};
+
+#endif /* RAW_PACKET_BATCH_HH_ */
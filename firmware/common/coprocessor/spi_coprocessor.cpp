@@ -6,6 +6,20 @@
 #include "hal.hh"
 
 static const uint32_t kESP32EnableBootupDelayMs = 500;
+
+// Source for the TX DMA channel when there's nothing to send, so that 0's are clocked out while reading.
+static const uint8_t kSPIDMAZero = 0x0;
+
+// DMA sniffer calculation that matches CalculateCRC16(): CRC-16-CCITT with data bits in normal order.
+static const uint16_t kDMASniffCalcCRC16 = 0x2;
+
+SPICoprocessor *spi_coprocessor_isr_access = nullptr;
+
+/** Begin pass-through functions for public access **/
+void on_spi_coprocessor_dma_complete() { spi_coprocessor_isr_access->OnDMAComplete(); }
+
+void on_spi_coprocessor_handshake_rise() { spi_coprocessor_isr_access->OnHandshakeRise(); }
+/** End pass-through functions for public access **/
 #elif ON_ESP32
 #include "adsbee_server.hh"
 
@@ -51,6 +65,24 @@ bool SPICoprocessor::Init() {
                    SPI_CPHA_0,  // Phase (CPHA).
                    SPI_MSB_FIRST);
 
+    // DMA channels for SPI transfers. Only the RX channel raises an interrupt, since it finishes last.
+    spi_coprocessor_isr_access = this;
+    if (spi_tx_dma_channel_ < 0) {
+        spi_tx_dma_channel_ = dma_claim_unused_channel(true);
+        spi_rx_dma_channel_ = dma_claim_unused_channel(true);
+    }
+    irq_add_shared_handler(DMA_IRQ_1, on_spi_coprocessor_dma_complete, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_1, true);
+    dma_channel_set_irq1_enabled(spi_rx_dma_channel_, true);
+
+    // Use a raw handler for the HANDSHAKE pin, since the GPIO callback belongs to the demodulators. The raw handler
+    // acknowledges the interrupt, so the GPIO callback never sees it.
+    gpio_add_raw_irq_handler(config_.spi_handshake_pin, on_spi_coprocessor_handshake_rise);
+    gpio_set_irq_enabled(config_.spi_handshake_pin, GPIO_IRQ_EDGE_RISE, true);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+
+    SetSPIState(kSPIStateIdle);
+
     // Wait for a bit for the ESP32 to boot up.
     uint32_t boot_delay_finished_timestamp_ms = get_time_since_boot_ms() + kESP32EnableBootupDelayMs;
     while (get_time_since_boot_ms() < boot_delay_finished_timestamp_ms) {
@@ -103,6 +135,22 @@ bool SPICoprocessor::Init() {
 
 bool SPICoprocessor::DeInit() {
 #ifdef ON_PICO
+    // Stop transfers and interrupts, and fail anything that was still queued.
+    gpio_set_irq_enabled(config_.spi_handshake_pin, GPIO_IRQ_EDGE_RISE, false);
+    gpio_remove_raw_irq_handler(config_.spi_handshake_pin, on_spi_coprocessor_handshake_rise);
+    if (spi_rx_dma_channel_ >= 0) {
+        dma_channel_set_irq1_enabled(spi_rx_dma_channel_, false);
+        irq_remove_handler(DMA_IRQ_1, on_spi_coprocessor_dma_complete);
+        dma_channel_abort(spi_tx_dma_channel_);
+        dma_channel_abort(spi_rx_dma_channel_);
+    }
+    SetSPIState(kSPIStateIdle);
+    window_num_sent_ = 0;
+    while (transaction_queue_.Length() > 0) {
+        CompleteTransaction(false);
+    }
+    dropping_blocks_ = false;
+
     // ESP32 enable pin.
     gpio_put(config_.esp32_enable_pin, 0);
     gpio_deinit(config_.esp32_enable_pin);
@@ -123,82 +171,17 @@ bool SPICoprocessor::DeInit() {
 bool SPICoprocessor::Update(bool blocking) {
     bool ret = false;
 #ifdef ON_PICO
-    // Do a blocking check of the HANDSHAKE pin to make sure that the ESP32 can have its say.
-    if (!GetSPIHandshakePinLevel(blocking)) {
-        return true;  // Nothing to do.
+    if (!is_enabled_) {
+        return false;
     }
-
-    // Incoming unsolicited transmission from ESP32.
-    uint8_t rx_buf[kSPITransactionMaxLenBytes];
-    SPIReadBlocking(rx_buf, 1, false);  // Peek the command first, keep chip select asserted.
-    SCCommand cmd = static_cast<SCCommand>(rx_buf[0]);
-    switch (cmd) {
-        case kCmdWriteToMaster:
-        case kCmdWriteToMasterRequireAck: {
-            // Figure out how long the write packet is, then read in the rest of it.
-            SPIReadBlocking(rx_buf + sizeof(SCCommand), SCWritePacket::kDataOffsetBytes - sizeof(SCCommand),
-                            false);  // Read addr, offset, and len.
-            uint16_t len;
-            memcpy(&len, rx_buf + SCWritePacket::kDataOffsetBytes - sizeof(uint16_t), sizeof(uint16_t));
-            // Read the rest of the write packet and complete the transaction. Guard to not run off end if invalid
-            // len is received.
-            SPIReadBlocking(rx_buf + SCWritePacket::kDataOffsetBytes,
-                            MIN(len, SCWritePacket::kDataMaxLenBytes) + SCPacket::kCRCLenBytes, true);
-            SCWritePacket write_packet =
-                SCWritePacket(rx_buf, SCWritePacket::kDataOffsetBytes + len + SCPacket::kCRCLenBytes);
-            if (!write_packet.IsValid()) {
-                CONSOLE_ERROR("SPICoprocessor::Update", "Received unsolicited write to master with bad checksum.");
-                return false;
-            }
-            ret =
-                object_dictionary.SetBytes(write_packet.addr, write_packet.data, write_packet.len, write_packet.offset);
-            bool ack = true;
-            if (!ret) {
-                CONSOLE_ERROR(
-                    "SPICoprocessor::Update",
-                    "Failed to write data for write to slave at address 0x%x with offset %d and length %d Bytes.",
-                    write_packet.addr, write_packet.offset, write_packet.len);
-                ack = false;
-            }
-            if (write_packet.cmd == kCmdWriteToMasterRequireAck) {
-                SPISendAck(ack);
-            }
-            break;
-        }
-        case kCmdReadFromMaster: {
-            // NOTE: If an Object lager than SCResponsePacket::kDataMaxLenBytes - SCReadRequestPacket::kBufLenBytes,
-            // the slave must request multiple reads with offsets to read the full object.
-            SPIReadBlocking(rx_buf + sizeof(SCCommand), SCReadRequestPacket::kBufLenBytes - sizeof(SCCommand), false);
-            SCReadRequestPacket read_request_packet = SCReadRequestPacket(rx_buf, SCReadRequestPacket::kBufLenBytes);
-            if (!read_request_packet.IsValid()) {
-                EndSPITransaction();
-                CONSOLE_ERROR("SPICoprocessor::Update", "Received unsolicited read from master with bad checksum.");
-                return false;
-            }
-            SCResponsePacket response_packet;
-            response_packet.cmd = kCmdDataBlock;
-            ret = object_dictionary.GetBytes(read_request_packet.addr, response_packet.data, read_request_packet.len,
-                                             read_request_packet.offset);
-            if (!ret) {
-                CONSOLE_ERROR("SPICoprocessor::Update",
-                              "Failed to retrieve data for read from master at address 0x%x with length %d Bytes.",
-                              read_request_packet.addr, read_request_packet.len);
-            }
-            response_packet.data_len_bytes = read_request_packet.len;
-            response_packet.PopulateCRC();
-            SPIWriteBlocking(response_packet.GetBuf(), response_packet.GetBufLenBytes());
-            break;
+    ret = true;
+    do {
+        if (!UpdateSPIState()) {
+            ret = false;
         }
-        default:
-            EndSPITransaction();
-            CONSOLE_ERROR("SPICoprocessor::Update", "Received unsolicited packet from ESP32 with unsupported cmd=%d.",
-                          cmd);
-            return false;
-    }
+    } while (blocking && (spi_state_ != kSPIStateIdle || transaction_queue_.Length() > 0));
+    return ret;
 #elif ON_ESP32
-    uint8_t rx_buf[kSPITransactionMaxLenBytes];
-    memset(rx_buf, 0, kSPITransactionMaxLenBytes);
-
     if (xSemaphoreTake(spi_mutex_, kSPIMutexTimeoutTicks) != pdTRUE) {
         CONSOLE_ERROR("SPICoprocessor::SPIWriteReadBlocking",
                       "Failed to acquire coprocessor SPI mutex after waiting %d ms.", kSPITransactionTimeoutMs);
@@ -206,7 +189,8 @@ bool SPICoprocessor::Update(bool blocking) {
     }
 
     use_handshake_pin_ = false;  // Don't solicit a transfer.
-    int16_t bytes_read = SPIReadBlocking(rx_buf);
+    // Packets are parsed in place in the DMA buffer, which is safe while the SPI mutex is held.
+    int16_t bytes_read = SPIReadBlocking(spi_rx_buf_);
     if (bytes_read < 0) {
         if (bytes_read != kErrorTimeout) {
             CONSOLE_ERROR("SPICoprocessor::Update", "SPI read received non-timeout error code 0x%x.", bytes_read);
@@ -215,33 +199,46 @@ bool SPICoprocessor::Update(bool blocking) {
         return SPISlaveLoopReturnHelper(true);  // Timeout errors are OK and expected.
     }
 
-    uint8_t cmd = rx_buf[0];
+    uint8_t cmd = spi_rx_buf_[0];
     switch (cmd) {
         case kCmdWriteToSlave:
-        case kCmdWriteToSlaveRequireAck: {
-            SCWritePacket write_packet = SCWritePacket(rx_buf, bytes_read);
+        case kCmdWriteToSlaveRequireAck:
+        case kCmdStreamWriteToSlave:
+        case kCmdStreamWriteToSlaveRequireAck: {
+            SCWritePacket write_packet = SCWritePacket(spi_rx_buf_, bytes_read);
             if (!write_packet.IsValid()) {
+                // No ack for a bad block of a window, the RP2040 sends the window again once it times out.
                 CONSOLE_ERROR("SPICoprocessor::Update",
                               "Received unsolicited write to slave with bad checksum, packet length %d Bytes.",
                               bytes_read);
                 return SPISlaveLoopReturnHelper(false);
             }
-            ret =
-                object_dictionary.SetBytes(write_packet.addr, write_packet.data, write_packet.len, write_packet.offset);
+            SCWriteHeader header = write_packet.GetHeader();
+            bool is_stream = cmd == kCmdStreamWriteToSlave || cmd == kCmdStreamWriteToSlaveRequireAck;
+            ret = true;
+            // Blocks of a window that arrive out of order are dropped, the ack tells the RP2040 where to resume.
+            if (!is_stream || stream_receiver_.IsNextBlock(header.addr, header.offset)) {
+                ret = object_dictionary.SetBytes(header.addr, write_packet.GetData(), header.len, header.offset);
+                if (ret && is_stream) {
+                    stream_receiver_.Advance(header.len);
+                }
+            }
             bool ack = true;
             if (!ret) {
                 CONSOLE_ERROR("SPICoprocessor::Update",
                               "Failed to write data for %d Byte write to slave at address 0x%x with offset %d Bytes.",
-                              write_packet.len, write_packet.addr, write_packet.offset);
+                              header.len, header.addr, header.offset);
                 ack = false;
             }
             if (cmd == kCmdWriteToSlaveRequireAck) {
                 SPISendAck(ack);
+            } else if (cmd == kCmdStreamWriteToSlaveRequireAck) {
+                SPISendStreamAck();
             }
             break;
         }
         case kCmdReadFromSlave: {
-            SCReadRequestPacket read_request_packet = SCReadRequestPacket(rx_buf, bytes_read);
+            SCReadRequestPacket read_request_packet = SCReadRequestPacket(spi_rx_buf_, bytes_read);
             if (!read_request_packet.IsValid()) {
                 CONSOLE_ERROR("SPICoprocessor::Update",
                               "Received unsolicited read from slave with bad checksum, packet length %d Bytes.",
@@ -249,16 +246,18 @@ bool SPICoprocessor::Update(bool blocking) {
                 return SPISlaveLoopReturnHelper(false);
             }
 
-            SCResponsePacket response_packet;
-            response_packet.cmd = kCmdDataBlock;
-            ret = object_dictionary.GetBytes(read_request_packet.addr, response_packet.data, read_request_packet.len,
-                                             read_request_packet.offset);
+            SCReadRequestHeader read_request = read_request_packet.GetHeader();
+            // Build the response right in the DMA buffer so that SPIWriteBlocking() doesn't need to copy it.
+            SCResponsePacket response_packet = SCResponsePacket(spi_tx_buf_, kSPITransactionMaxLenBytes);
+            response_packet.SetHeader({.cmd = kCmdDataBlock});
+            ret = object_dictionary.GetBytes(read_request.addr, response_packet.GetData(), read_request.len,
+                                             read_request.offset);
             if (!ret) {
                 CONSOLE_ERROR("SPICoprocessor::Update",
-                              "Failed to retrieve data for %d Byte read from slave at address 0x%x",
-                              read_request_packet.len, read_request_packet.addr);
+                              "Failed to retrieve data for %d Byte read from slave at address 0x%x", read_request.len,
+                              read_request.addr);
             }
-            response_packet.data_len_bytes = read_request_packet.len;  // Assume the correct number of bytes were read.
+            response_packet.SetDataLenBytes(read_request.len);  // Assume the correct number of bytes were read.
             response_packet.PopulateCRC();
             use_handshake_pin_ = true;  // Solicit a read from the RP2040.
             SPIWriteBlocking(response_packet.GetBuf(), response_packet.GetBufLenBytes());
@@ -278,82 +277,626 @@ bool SPICoprocessor::Update(bool blocking) {
 
 /** Begin Private Functions **/
 
+#ifdef ON_PICO
+bool SPICoprocessor::UpdateSPIState() {
+    uint64_t timestamp_us = get_time_since_boot_us();
+    switch (spi_state_) {
+        case kSPIStateIdle: {
+            if (GetSPIHandshakePinLevel()) {
+                // Incoming unsolicited transmission from ESP32.
+                BeginSPITransaction();
+                return BeginUnsolicitedTransfer();
+            }
+            if (transaction_queue_.Length() <= window_num_sent_) {
+                return true;  // Nothing to do.
+            }
+            if (dropping_blocks_) {
+                // An earlier block of this multi-transfer write or read failed.
+                CompleteTransaction(false);
+                return false;
+            }
+            // Wait for the next transmit interval so that we don't overwhelm the slave with messages. Chip select goes
+            // LO a bit early to stop the ESP32 from initiating a transaction with the HANDSHAKE pin.
+            if (timestamp_us - spi_last_transmit_timestamp_us_ <
+                kSPIMinTransmitIntervalUs - kSPIUpdateCSPreAssertIntervalUs) {
+                return true;
+            }
+            BeginSPITransaction();
+            SetSPIState(kSPIStatePreAssert);
+            return true;
+        }
+        case kSPIStatePreAssert: {
+            if (GetSPIHandshakePinLevel()) {
+                // ESP32 asserted the HANDSHAKE pin before chip select went LO. Let it go first, the queued transaction
+                // is sent afterwards.
+                return BeginUnsolicitedTransfer();
+            }
+            if (timestamp_us - spi_state_timestamp_us_ < kSPIUpdateCSPreAssertIntervalUs) {
+                return true;
+            }
+            SPITransaction *transaction = GetSendingTransaction();
+            StartSPIDMA(transaction->tx_buf, nullptr, transaction->tx_len_bytes);
+            SetSPIState(kSPIStateSending);
+            return true;
+        }
+        case kSPIStateSending: {
+            int dma_status = CheckSPIDMA();
+            if (dma_status > 0) {
+                return true;  // Still sending.
+            }
+            if (dma_status == kErrorTimeout) {
+                RetryTransaction("Timed out while sending transaction.");
+                return false;
+            }
+            SCCommand cmd = GetSendingTransaction()->GetCmd();
+            if (cmd == kCmdStreamWriteToSlave) {
+                // Keep the block around until the ack at the end of its window, and move on to the next one.
+                window_num_sent_++;
+                SetSPIState(kSPIStateIdle);
+            } else if (cmd == kCmdWriteToSlaveRequireAck || cmd == kCmdStreamWriteToSlaveRequireAck ||
+                       cmd == kCmdReadFromSlave) {
+                SetSPIState(kSPIStateAwaitingReply);
+            } else {
+                CompleteTransaction(true);
+            }
+            return true;
+        }
+        case kSPIStateAwaitingReply: {
+            if (!GetSPIHandshakePinLevel()) {
+                if (timestamp_us - spi_state_timestamp_us_ >= kSPIHandshakeTimeoutMs * kUsPerMs) {
+                    RetryTransaction("Timed out while waiting for handshake after sending transaction.");
+                    return false;
+                }
+                return true;
+            }
+            SPITransaction *transaction = GetSendingTransaction();
+            uint16_t reply_len_bytes = SCResponsePacket::kAckLenBytes;
+            if (transaction->GetCmd() == kCmdReadFromSlave) {
+                reply_len_bytes = SCResponsePacket::GetBufLenForPayloadLenBytes(transaction->read_len_bytes);
+            } else if (transaction->GetCmd() == kCmdStreamWriteToSlaveRequireAck) {
+                reply_len_bytes = SCResponsePacket::kStreamAckLenBytes;
+            }
+            BeginSPITransaction();
+            StartSPIDMA(nullptr, rx_buf_, reply_len_bytes);
+            SetSPIState(kSPIStateReceivingReply);
+            return true;
+        }
+        case kSPIStateReceivingReply: {
+            int dma_status = CheckSPIDMA();
+            if (dma_status > 0) {
+                return true;  // Still receiving.
+            }
+            char error_message[kErrorMessageMaxLen + 1] = "Timed out while receiving reply.";
+            error_message[kErrorMessageMaxLen] = '\0';
+            if (dma_status == kErrorTimeout) {
+                RetryTransaction(error_message);
+                return false;
+            }
+            if (GetSendingTransaction()->GetCmd() == kCmdStreamWriteToSlaveRequireAck) {
+                // Acked blocks of the window are completed by HandleStreamAck(), the rest are sent again.
+                if (!HandleStreamAck(error_message)) {
+                    RetryTransaction(error_message);
+                    return false;
+                }
+                return true;
+            }
+            if (!HandleReply(*transaction_queue_.GetPopSlot(), error_message)) {
+                RetryTransaction(error_message);
+                return false;
+            }
+            CompleteTransaction(true);
+            return true;
+        }
+        case kSPIStateReceivingWrite: {
+            int dma_status = CheckSPIDMA();
+            if (dma_status > 0) {
+                return true;  // Still receiving.
+            }
+            if (dma_status == kErrorTimeout) {
+                CONSOLE_ERROR("SPICoprocessor::Update", "Timed out while receiving unsolicited write from ESP32.");
+                SetSPIState(kSPIStateIdle);
+                return false;
+            }
+            return HandleUnsolicitedWrite();
+        }
+        case kSPIStateAckPending:
+            // Give the ESP32 the usual transmit interval to get ready for the ack.
+            if (timestamp_us - spi_last_transmit_timestamp_us_ < kSPIMinTransmitIntervalUs) {
+                return true;
+            }
+            BeginSPITransaction();
+            StartSPIDMA(response_buf_, nullptr, response_len_bytes_);
+            SetSPIState(kSPIStateSendingResponse);
+            return true;
+        case kSPIStateSendingResponse: {
+            int dma_status = CheckSPIDMA();
+            if (dma_status > 0) {
+                return true;  // Still sending.
+            }
+            SetSPIState(kSPIStateIdle);
+            if (dma_status == kErrorTimeout) {
+                CONSOLE_ERROR("SPICoprocessor::Update", "Timed out while sending response to ESP32.");
+                return false;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void SPICoprocessor::StartSPIDMA(const uint8_t *tx_buf, uint8_t *rx_buf, uint16_t len_bytes, uint16_t rx_crc_seed) {
+    spi_dma_complete_ = false;
+
+    dma_channel_config tx_config = dma_channel_get_default_config(spi_tx_dma_channel_);
+    channel_config_set_transfer_data_size(&tx_config, DMA_SIZE_8);
+    channel_config_set_dreq(&tx_config, spi_get_dreq(config_.spi_handle, true));
+    channel_config_set_read_increment(&tx_config, tx_buf != nullptr);
+    channel_config_set_write_increment(&tx_config, false);
+    dma_channel_configure(spi_tx_dma_channel_, &tx_config, &spi_get_hw(config_.spi_handle)->dr,
+                          tx_buf != nullptr ? tx_buf : &kSPIDMAZero, len_bytes, false);
+
+    dma_channel_config rx_config = dma_channel_get_default_config(spi_rx_dma_channel_);
+    channel_config_set_transfer_data_size(&rx_config, DMA_SIZE_8);
+    channel_config_set_dreq(&rx_config, spi_get_dreq(config_.spi_handle, false));
+    channel_config_set_read_increment(&rx_config, false);
+    channel_config_set_write_increment(&rx_config, rx_buf != nullptr);
+    channel_config_set_sniff_enable(&rx_config, rx_buf != nullptr);
+    dma_channel_configure(spi_rx_dma_channel_, &rx_config, rx_buf != nullptr ? rx_buf : &spi_dma_sink_,
+                          &spi_get_hw(config_.spi_handle)->dr, len_bytes, false);
+    if (rx_buf != nullptr) {
+        // Run the CRC while the packet comes in, so it's ready as soon as the transfer completes.
+        dma_sniffer_enable(spi_rx_dma_channel_, kDMASniffCalcCRC16, false);
+        dma_hw->sniff_data = rx_crc_seed;
+    }
+
+    // Start both channels together so that no received Bytes are dropped.
+    dma_start_channel_mask((1u << spi_tx_dma_channel_) | (1u << spi_rx_dma_channel_));
+}
+
+bool SPICoprocessor::ReceivedCRCIsValid(const uint8_t *buf, uint16_t len_bytes) {
+    uint32_t sniff_ctrl = dma_hw->sniff_ctrl;
+    uint32_t sniff_channel = (sniff_ctrl & DMA_SNIFF_CTRL_DMACH_BITS) >> DMA_SNIFF_CTRL_DMACH_LSB;
+    uint32_t sniff_calc = (sniff_ctrl & DMA_SNIFF_CTRL_CALC_BITS) >> DMA_SNIFF_CTRL_CALC_LSB;
+    if ((sniff_ctrl & DMA_SNIFF_CTRL_EN_BITS) && sniff_channel == static_cast<uint32_t>(spi_rx_dma_channel_) &&
+        sniff_calc == kDMASniffCalcCRC16) {
+        // The packet ends with its own CRC, so the CRC over the whole packet is 0 if it's intact.
+        return (dma_hw->sniff_data & 0xFFFF) == 0;
+    }
+    return CalculateCRC16(buf, len_bytes) == 0;
+}
+
+int SPICoprocessor::CheckSPIDMA() {
+    if (spi_dma_complete_) {
+        return kOk;
+    }
+    if (get_time_since_boot_us() - spi_state_timestamp_us_ < kSPITransactionTimeoutMs * kUsPerMs) {
+        return 1;
+    }
+    // Aborting can raise a spurious completion interrupt (RP2040-E13), so mask it while the channels wind down.
+    dma_channel_set_irq1_enabled(spi_rx_dma_channel_, false);
+    dma_channel_abort(spi_tx_dma_channel_);
+    dma_channel_abort(spi_rx_dma_channel_);
+    dma_channel_acknowledge_irq1(spi_rx_dma_channel_);
+    dma_channel_set_irq1_enabled(spi_rx_dma_channel_, true);
+    EndSPITransaction();
+    return kErrorTimeout;
+}
+
+void SPICoprocessor::OnDMAComplete() {
+    if (!dma_channel_get_irq1_status(spi_rx_dma_channel_)) {
+        return;  // Shared interrupt was raised by another DMA channel.
+    }
+    dma_channel_acknowledge_irq1(spi_rx_dma_channel_);
+    // The RX channel finishes once the last Byte has been clocked in, so the transaction is over.
+    EndSPITransaction();
+    spi_dma_complete_ = true;
+    if (config_.event_callback != nullptr) {
+        config_.event_callback();
+    }
+}
+
+void SPICoprocessor::OnHandshakeRise() {
+    if (!(gpio_get_irq_event_mask(config_.spi_handshake_pin) & GPIO_IRQ_EDGE_RISE)) {
+        return;
+    }
+    gpio_acknowledge_irq(config_.spi_handshake_pin, GPIO_IRQ_EDGE_RISE);
+    if (config_.event_callback != nullptr) {
+        config_.event_callback();
+    }
+}
+
+bool SPICoprocessor::BeginUnsolicitedTransfer() {
+    // Peek the command and header with short blocking reads, since they say how much is left to transfer. The rest of
+    // the transfer goes over DMA.
+    spi_read_blocking(config_.spi_handle, 0x0, rx_buf_, sizeof(SCCommand));
+    SCCommand cmd = static_cast<SCCommand>(rx_buf_[0]);
+    switch (cmd) {
+        case kCmdWriteToMaster:
+        case kCmdWriteToMasterRequireAck:
+        case kCmdStreamWriteToMaster:
+        case kCmdStreamWriteToMasterRequireAck: {
+            // Read addr, offset, and len.
+            spi_read_blocking(config_.spi_handle, 0x0, rx_buf_ + sizeof(SCCommand),
+                              SCWritePacket::kDataOffsetBytes - sizeof(SCCommand));
+            // Receive the rest of the write packet. The data length is clamped so that an invalid len can't run off
+            // the end of the buffer. The header was read without DMA, so its CRC seeds the sniffer.
+            SCWritePacket write_packet = SCWritePacket(rx_buf_, sizeof(rx_buf_));
+            StartSPIDMA(nullptr, write_packet.GetData(), write_packet.GetDataLenBytes() + SCWritePacket::kCRCLenBytes,
+                        UpdateCRC16(kCRC16Init, rx_buf_, SCWritePacket::kDataOffsetBytes));
+            SetSPIState(kSPIStateReceivingWrite);
+            return true;
+        }
+        case kCmdReadFromMaster: {
+            // NOTE: If an Object lager than SCResponsePacket::kDataMaxLenBytes - SCReadRequestPacket::kBufLenBytes,
+            // the slave must request multiple reads with offsets to read the full object.
+            spi_read_blocking(config_.spi_handle, 0x0, rx_buf_ + sizeof(SCCommand),
+                              SCReadRequestPacket::kBufLenBytes - sizeof(SCCommand));
+            SCReadRequestPacket read_request_packet = SCReadRequestPacket(rx_buf_, SCReadRequestPacket::kBufLenBytes);
+            SCReadRequestHeader read_request = read_request_packet.GetHeader();
+            if (!read_request_packet.IsValid() || read_request.len > SCResponsePacket::kDataMaxLenBytes) {
+                EndSPITransaction();
+                SetSPIState(kSPIStateIdle);
+                CONSOLE_ERROR("SPICoprocessor::Update",
+                              "Received unsolicited read from master with bad checksum or length %d Bytes.",
+                              read_request.len);
+                return false;
+            }
+            SCResponsePacket response_packet = SCResponsePacket(response_buf_, sizeof(response_buf_));
+            response_packet.SetHeader({.cmd = kCmdDataBlock});
+            bool ret = object_dictionary.GetBytes(read_request.addr, response_packet.GetData(), read_request.len,
+                                                  read_request.offset);
+            if (!ret) {
+                CONSOLE_ERROR("SPICoprocessor::Update",
+                              "Failed to retrieve data for read from master at address 0x%x with length %d Bytes.",
+                              read_request.addr, read_request.len);
+            }
+            response_packet.SetDataLenBytes(read_request.len);
+            response_packet.PopulateCRC();
+            // The response goes out in the same transaction as the request.
+            StartSPIDMA(response_buf_, nullptr, response_packet.GetBufLenBytes());
+            SetSPIState(kSPIStateSendingResponse);
+            return ret;
+        }
+        default:
+            EndSPITransaction();
+            SetSPIState(kSPIStateIdle);
+            CONSOLE_ERROR("SPICoprocessor::Update", "Received unsolicited packet from ESP32 with unsupported cmd=%d.",
+                          cmd);
+            return false;
+    }
+}
+
+bool SPICoprocessor::HandleUnsolicitedWrite() {
+    SCWritePacket write_packet = SCWritePacket(rx_buf_, sizeof(rx_buf_));
+    SCWriteHeader header = write_packet.GetHeader();
+    uint16_t len = write_packet.GetDataLenBytes();  // Only this much was received.
+    if (!ReceivedCRCIsValid(rx_buf_, write_packet.GetBufLenBytes())) {
+        CONSOLE_ERROR("SPICoprocessor::Update", "Received unsolicited write to master with bad checksum.");
+        SetSPIState(kSPIStateIdle);
+        return false;
+    }
+    bool is_stream = header.cmd == kCmdStreamWriteToMaster || header.cmd == kCmdStreamWriteToMasterRequireAck;
+    bool ret = true;
+    // Blocks of a window that arrive out of order are dropped, the ack tells the ESP32 where to resume.
+    if (!is_stream || stream_receiver_.IsNextBlock(header.addr, header.offset)) {
+        ret = object_dictionary.SetBytes(header.addr, write_packet.GetData(), len, header.offset);
+        if (ret && is_stream) {
+            stream_receiver_.Advance(len);
+        }
+    }
+    if (!ret) {
+        CONSOLE_ERROR("SPICoprocessor::Update",
+                      "Failed to write data for write to slave at address 0x%x with offset %d and length %d Bytes.",
+                      header.addr, header.offset, len);
+    }
+    if (header.cmd == kCmdWriteToMasterRequireAck) {
+        SCResponsePacket ack_packet = SCResponsePacket(response_buf_, SCResponsePacket::kAckLenBytes);
+        ack_packet.SetHeader({.cmd = kCmdAck});
+        ack_packet.GetData()[0] = ret;
+        ack_packet.PopulateCRC();
+        response_len_bytes_ = SCResponsePacket::kAckLenBytes;
+    } else if (header.cmd == kCmdStreamWriteToMasterRequireAck) {
+        stream_receiver_.PopulateAck(response_buf_);
+        response_len_bytes_ = SCResponsePacket::kStreamAckLenBytes;
+    } else {
+        SetSPIState(kSPIStateIdle);
+        return ret;
+    }
+    SetSPIState(kSPIStateAckPending);
+    return ret;
+}
+
+bool SPICoprocessor::HandleReply(SPITransaction &transaction, char *error_message) {
+    // The reply is checked in place in rx_buf_.
+    bool is_read = transaction.GetCmd() == kCmdReadFromSlave;
+    SCResponsePacket reply = SCResponsePacket(
+        rx_buf_, is_read ? SCResponsePacket::GetBufLenForPayloadLenBytes(transaction.read_len_bytes)
+                         : SCResponsePacket::kAckLenBytes);
+    SCCommand cmd = reply.GetHeader().cmd;
+    if (!ReceivedCRCIsValid(rx_buf_, reply.GetBufLenBytes())) {
+        snprintf(error_message, kErrorMessageMaxLen, "Received reply of length %d Bytes with an invalid CRC.",
+                 reply.GetBufLenBytes());
+        return false;
+    }
+    if (!is_read) {
+        if (cmd != kCmdAck) {
+            snprintf(error_message, kErrorMessageMaxLen,
+                     "Received a message that was not an ack (cmd=0x%x, expected 0x%x).", cmd, kCmdAck);
+            return false;
+        }
+        if (!reply.GetData()[0]) {
+            snprintf(error_message, kErrorMessageMaxLen, "Received NACK after writing to coprocessor.");
+            return false;
+        }
+        return true;
+    }
+    if (cmd != kCmdDataBlock) {
+        snprintf(error_message, kErrorMessageMaxLen, "Received invalid response with cmd=0x%x to requested read.",
+                 cmd);
+        return false;
+    }
+    memcpy(transaction.read_buf, reply.GetData(), reply.GetDataLenBytes());
+    return true;
+}
+
+bool SPICoprocessor::HandleStreamAck(char *error_message) {
+    SCResponsePacket reply = SCResponsePacket(rx_buf_, SCResponsePacket::kStreamAckLenBytes);
+    if (!ReceivedCRCIsValid(rx_buf_, reply.GetBufLenBytes())) {
+        snprintf(error_message, kErrorMessageMaxLen, "Received stream ack with an invalid CRC.");
+        return false;
+    }
+    if (reply.GetHeader().cmd != kCmdStreamAck) {
+        snprintf(error_message, kErrorMessageMaxLen,
+                 "Received a message that was not a stream ack (cmd=0x%x, expected 0x%x).", reply.GetHeader().cmd,
+                 kCmdStreamAck);
+        return false;
+    }
+    SCStreamAck ack;
+    memcpy(&ack, reply.GetData(), sizeof(SCStreamAck));
+    // Complete every block of the window that made it. The first one that didn't is now at the front of the queue.
+    uint16_t num_unacked = window_num_sent_ + 1;
+    window_num_sent_ = 0;
+    while (num_unacked > 0) {
+        SCWriteHeader header =
+            SCWritePacket(transaction_queue_.GetPopSlot()->tx_buf, SCWritePacket::kBufMinLenBytes).GetHeader();
+        if (header.addr != ack.addr || static_cast<uint32_t>(header.offset) + header.len > ack.next_offset) {
+            break;
+        }
+        CompleteTransaction(true);
+        num_unacked--;
+    }
+    if (num_unacked > 0) {
+        snprintf(error_message, kErrorMessageMaxLen,
+                 "Window was only acked up to offset %d Bytes of object at address 0x%x, %d blocks left to send.",
+                 ack.next_offset, ack.addr, num_unacked);
+        return false;
+    }
+    return true;
+}
+
+void SPICoprocessor::RetryTransaction(const char *error_message) {
+    window_num_sent_ = 0;  // Go back to the first block that wasn't acked.
+    SPITransaction *transaction = transaction_queue_.GetPopSlot();
+    transaction->num_attempts++;
+    CONSOLE_WARNING("SPICoprocessor::Update", "%s", error_message);
+    if (transaction->num_attempts < kSPITransactionMaxNumRetries) {
+        SetSPIState(kSPIStateIdle);  // Sent again from the front of the queue.
+        return;
+    }
+    CONSOLE_ERROR("SPICoprocessor::Update", "Transaction with cmd=0x%x failed after %d tries: %s",
+                  transaction->GetCmd(), transaction->num_attempts, error_message);
+    CompleteTransaction(false);
+}
+
+void SPICoprocessor::CompleteTransaction(bool success) {
+    SPITransaction *transaction = transaction_queue_.GetPopSlot();
+    if (!success && !transaction->is_last_block) {
+        dropping_blocks_ = true;  // Don't send the rest of a write or read that can't succeed.
+    }
+    success = success && !dropping_blocks_;
+    SPITransactionCallback callback = nullptr;
+    void *callback_context = nullptr;
+    if (transaction->is_last_block) {
+        callback = transaction->callback;
+        callback_context = transaction->callback_context;
+        dropping_blocks_ = false;
+    }
+    // Free the slot before calling back, so that the callback can queue another transaction.
+    transaction_queue_.CommitPop();
+    SetSPIState(kSPIStateIdle);
+    if (callback != nullptr) {
+        callback(success, callback_context);
+    }
+}
+
+bool SPICoprocessor::WaitForTransactionQueueSpace(uint16_t num_transactions, bool can_time_out) {
+    uint32_t wait_begin_timestamp_ms = get_time_since_boot_ms();
+    while (kSPITransactionQueueDepth - transaction_queue_.Length() < num_transactions) {
+        if (can_time_out && get_time_since_boot_ms() - wait_begin_timestamp_ms >= kSPITransactionQueueTimeoutMs) {
+            return false;
+        }
+        Update();
+    }
+    return true;
+}
+
+bool SPICoprocessor::QueueWrite(ObjectDictionary::Address addr, const uint8_t *object_buf, uint16_t len_bytes,
+                                bool require_ack, SPITransactionCallback callback, void *callback_context) {
+    if (!is_enabled_) {
+        return false;
+    }
+    if (queueing_blocks_) {
+        CONSOLE_ERROR("SPICoprocessor::QueueWrite",
+                      "Can't queue write of object at address 0x%x while another object's blocks are being queued.",
+                      addr);
+        return false;
+    }
+    uint16_t num_blocks =
+        MAX((len_bytes + SCWritePacket::kQueuedDataMaxLenBytes - 1) / SCWritePacket::kQueuedDataMaxLenBytes, 1);
+    for (uint16_t block = 0; block < num_blocks; block++) {
+        // Only the first block can time out. Once part of an object is queued, the rest has to follow so that the
+        // object ends with its last block, and queued blocks always go through or run out of retries.
+        queueing_blocks_ = block > 0;
+        bool queue_has_space = WaitForTransactionQueueSpace(1, block == 0);
+        queueing_blocks_ = false;
+        if (!queue_has_space) {
+            CONSOLE_ERROR("SPICoprocessor::QueueWrite",
+                          "Timed out after %d ms while waiting to queue %d Byte write of object at address 0x%x.",
+                          kSPITransactionQueueTimeoutMs, len_bytes, addr);
+            return false;
+        }
+        uint16_t offset = block * SCWritePacket::kQueuedDataMaxLenBytes;
+        uint16_t len = MIN(SCWritePacket::kQueuedDataMaxLenBytes, len_bytes - offset);
+        SCCommand cmd = require_ack ? kCmdWriteToSlaveRequireAck : kCmdWriteToSlave;
+        if (require_ack && num_blocks > 1) {
+            // Multi-transfer writes are sent in windows, and only the last block of each window is acked. The first
+            // block is a window of its own, see kSPIWriteWindowNumBlocks.
+            bool window_end = block % kSPIWriteWindowNumBlocks == 0 || block == num_blocks - 1;
+            cmd = window_end ? kCmdStreamWriteToSlaveRequireAck : kCmdStreamWriteToSlave;
+        }
+        SPITransaction *transaction = transaction_queue_.GetPushSlot();
+        // Build the write packet in place in the transaction.
+        SCWritePacket write_packet = SCWritePacket(transaction->tx_buf, sizeof(transaction->tx_buf));
+        write_packet.SetHeader({.cmd = cmd, .addr = addr, .offset = offset, .len = len});
+        memcpy(write_packet.GetData(), object_buf + offset, len);
+        write_packet.PopulateCRC();
+        transaction->tx_len_bytes = write_packet.GetBufLenBytes();
+        transaction->read_buf = nullptr;
+        transaction->read_len_bytes = 0;
+        transaction->is_last_block = block == num_blocks - 1;
+        transaction->num_attempts = 0;
+        transaction->callback = transaction->is_last_block ? callback : nullptr;
+        transaction->callback_context = callback_context;
+        transaction_queue_.CommitPush();
+    }
+    return true;
+}
+
+bool SPICoprocessor::QueueRead(ObjectDictionary::Address addr, uint8_t *object_buf, uint16_t len_bytes,
+                               SPITransactionCallback callback, void *callback_context) {
+    if (!is_enabled_) {
+        return false;
+    }
+    if (queueing_blocks_) {
+        CONSOLE_ERROR("SPICoprocessor::QueueRead",
+                      "Can't queue read of object at address 0x%x while another object's blocks are being queued.",
+                      addr);
+        return false;
+    }
+    // On the master, reading from the slave is two transactions: The read request is sent, then we wait on the
+    // handshake line to read the reply. The whole response packet is available for the reply.
+    uint16_t num_blocks =
+        MAX((len_bytes + SCResponsePacket::kDataMaxLenBytes - 1) / SCResponsePacket::kDataMaxLenBytes, 1);
+    for (uint16_t block = 0; block < num_blocks; block++) {
+        // Same as in QueueWrite(), only the first block can time out.
+        queueing_blocks_ = block > 0;
+        bool queue_has_space = WaitForTransactionQueueSpace(1, block == 0);
+        queueing_blocks_ = false;
+        if (!queue_has_space) {
+            CONSOLE_ERROR("SPICoprocessor::QueueRead",
+                          "Timed out after %d ms while waiting to queue %d Byte read of object at address 0x%x.",
+                          kSPITransactionQueueTimeoutMs, len_bytes, addr);
+            return false;
+        }
+        uint16_t offset = block * SCResponsePacket::kDataMaxLenBytes;
+        uint16_t len = MIN(SCResponsePacket::kDataMaxLenBytes, len_bytes - offset);
+        SPITransaction *transaction = transaction_queue_.GetPushSlot();
+        SCReadRequestPacket read_request_packet = SCReadRequestPacket(transaction->tx_buf, sizeof(transaction->tx_buf));
+        read_request_packet.SetHeader({.cmd = kCmdReadFromSlave, .addr = addr, .offset = offset, .len = len});
+        read_request_packet.PopulateCRC();
+        transaction->tx_len_bytes = SCReadRequestPacket::kBufLenBytes;
+        transaction->read_buf = object_buf + offset;
+        transaction->read_len_bytes = len;
+        transaction->is_last_block = block == num_blocks - 1;
+        transaction->num_attempts = 0;
+        transaction->callback = transaction->is_last_block ? callback : nullptr;
+        transaction->callback_context = callback_context;
+        transaction_queue_.CommitPush();
+    }
+    return true;
+}
+#else
 bool SPICoprocessor::SPISendAck(bool success) {
-    SCResponsePacket response_packet;
-    response_packet.cmd = kCmdAck;
-    response_packet.data[0] = success;
-    response_packet.data_len_bytes = 1;
-    response_packet.PopulateCRC();
+    uint8_t ack_buf[SCResponsePacket::kAckLenBytes];
+    SCResponsePacket ack_packet = SCResponsePacket(ack_buf, sizeof(ack_buf));
+    ack_packet.SetHeader({.cmd = kCmdAck});
+    ack_packet.GetData()[0] = success;
+    ack_packet.PopulateCRC();
 #ifdef ON_ESP32
     use_handshake_pin_ = true;  // Solicit a transfer to send the ack.
 #endif
-    return SPIWriteBlocking(response_packet.GetBuf(), SCResponsePacket::kAckLenBytes) > 0;
+    return SPIWriteBlocking(ack_buf, SCResponsePacket::kAckLenBytes) > 0;
 }
 
 bool SPICoprocessor::SPIWaitForAck() {
-    SCResponsePacket response_packet;
-#ifdef ON_PICO
-    if (!SPIWaitForHandshake()) {
-        CONSOLE_ERROR("SPICoprocessor::SPIWaitForAck", "Timed out while waiting for ack: never received handshake.");
-        return false;
-    }
-#elif ON_ESP32
+    uint8_t ack_buf[SCResponsePacket::kAckLenBytes] = {0};
+#ifdef ON_ESP32
     use_handshake_pin_ = false;  // Don't solicit an ack when waiting for one.
 #endif
-    int bytes_read = SPIReadBlocking(response_packet.GetBuf(), SCResponsePacket::kAckLenBytes);
-    response_packet.data_len_bytes = SCResponsePacket::kAckLenBytes;
-    if (response_packet.cmd != kCmdAck) {
-        CONSOLE_ERROR("SPICoprocessor::SPIWaitForAck",
-                      "Received a message that was not an ack (cmd=0x%x, expected 0x%x).", response_packet.cmd,
-                      kCmdAck);
-        return false;
-    }
+    int bytes_read = SPIReadBlocking(ack_buf, SCResponsePacket::kAckLenBytes);
     if (bytes_read < 0) {
         CONSOLE_ERROR("SPICoprocessor::SPIWaitForAck", "SPI read failed with code 0x%x.", bytes_read);
         return false;
     }
-    if (!response_packet.IsValid()) {
+    SCResponsePacket ack_packet = SCResponsePacket(ack_buf, sizeof(ack_buf));
+    if (ack_packet.GetHeader().cmd != kCmdAck) {
+        CONSOLE_ERROR("SPICoprocessor::SPIWaitForAck",
+                      "Received a message that was not an ack (cmd=0x%x, expected 0x%x).", ack_packet.GetHeader().cmd,
+                      kCmdAck);
+        return false;
+    }
+    if (!ack_packet.IsValid()) {
         CONSOLE_ERROR("SPICoprocessor::SPIWaitForAck", "Received a response packet with an invalid CRC.");
         return false;
     }
-    return response_packet.data[0];  // Return ACK / NACK value.
+    return ack_packet.GetData()[0];  // Return ACK / NACK value.
 }
 
-int SPICoprocessor::SPIWriteReadBlocking(uint8_t *tx_buf, uint8_t *rx_buf, uint16_t len_bytes, bool end_transaction) {
-    int bytes_written = 0;
-#ifdef ON_PICO
+bool SPICoprocessor::SPISendStreamAck() {
+    uint8_t ack_buf[SCResponsePacket::kStreamAckLenBytes];
+    stream_receiver_.PopulateAck(ack_buf);
+#ifdef ON_ESP32
+    use_handshake_pin_ = true;  // Solicit a transfer to send the ack.
+#endif
+    return SPIWriteBlocking(ack_buf, SCResponsePacket::kStreamAckLenBytes) > 0;
+}
 
-    // Wait for the next transmit interval (blocking) so that we don't overwhelm the slave with messages.
-    while (get_time_since_boot_us() - spi_last_transmit_timestamp_us_ < kSPIMinTransmitIntervalUs) {
-        if (get_time_since_boot_us() - spi_last_transmit_timestamp_us_ > kSPIPostTransmitLockoutUs &&
-            gpio_get(config_.spi_handshake_pin)) {
-            // Slave is requesting another write, and we're convinced it's properly processed the previous transaction.
-            break;
-        }
+bool SPICoprocessor::SPIWaitForStreamAck(ObjectDictionary::Address addr, uint16_t &next_offset) {
+    uint8_t ack_buf[SCResponsePacket::kStreamAckLenBytes] = {0};
+#ifdef ON_ESP32
+    use_handshake_pin_ = false;  // Don't solicit an ack when waiting for one.
+#endif
+    int bytes_read = SPIReadBlocking(ack_buf, SCResponsePacket::kStreamAckLenBytes);
+    if (bytes_read < 0) {
+        CONSOLE_ERROR("SPICoprocessor::SPIWaitForStreamAck", "SPI read failed with code 0x%x.", bytes_read);
+        return false;
     }
-
-    BeginSPITransaction();
-    // Pico SDK doesn't have nice nullptr behavior for tx_buf and rx_buf, so we have to do this.
-    if (tx_buf == nullptr) {
-        // Transmit 0's when reading.
-        bytes_written = spi_read_blocking(config_.spi_handle, 0x0, rx_buf, len_bytes);
-    } else if (rx_buf == nullptr) {
-        bytes_written = spi_write_blocking(config_.spi_handle, tx_buf, len_bytes);
-    } else {
-        bytes_written = spi_write_read_blocking(config_.spi_handle, tx_buf, rx_buf, len_bytes);
+    SCResponsePacket ack_packet = SCResponsePacket(ack_buf, sizeof(ack_buf));
+    if (ack_packet.GetHeader().cmd != kCmdStreamAck) {
+        CONSOLE_ERROR("SPICoprocessor::SPIWaitForStreamAck",
+                      "Received a message that was not a stream ack (cmd=0x%x, expected 0x%x).",
+                      ack_packet.GetHeader().cmd, kCmdStreamAck);
+        return false;
     }
-
-    if (end_transaction) {
-        EndSPITransaction();
-        // Only the last transfer chunk of the transaction is used to record the last transmission timestamp. This stops
-        // transactions from getting too long as earlier chunks reset the lockout timer for later chungs, e.g. if we
-        // only read one byte we don't want to wait for the timeout before conducting the rest of the transaction.
+    if (!ack_packet.IsValid()) {
+        CONSOLE_ERROR("SPICoprocessor::SPIWaitForStreamAck", "Received a response packet with an invalid CRC.");
+        return false;
     }
-    if (bytes_written < 0) {
-        CONSOLE_ERROR("SPICoprocessor::SPIWriteReadBlocking", "SPI write read call returned error code 0x%x.",
-                      bytes_written);
+    SCStreamAck ack;
+    memcpy(&ack, ack_packet.GetData(), sizeof(SCStreamAck));
+    if (ack.addr != addr) {
+        CONSOLE_ERROR("SPICoprocessor::SPIWaitForStreamAck",
+                      "Received stream ack for object at address 0x%x while writing object at address 0x%x.",
+                      ack.addr, addr);
+        return false;
     }
-#elif ON_ESP32
+    next_offset = ack.next_offset;
+    return true;
+}
+
+int SPICoprocessor::SPIWriteReadBlocking(uint8_t *tx_buf, uint8_t *rx_buf, uint16_t len_bytes, bool end_transaction) {
+    int bytes_written = 0;
+#ifdef ON_ESP32
     spi_slave_transaction_t t;
     memset(&t, 0, sizeof(t));
 
@@ -361,7 +904,8 @@ int SPICoprocessor::SPIWriteReadBlocking(uint8_t *tx_buf, uint8_t *rx_buf, uint1
     t.tx_buffer = tx_buf == nullptr ? nullptr : spi_tx_buf_;
     t.rx_buffer = rx_buf == nullptr ? nullptr : spi_rx_buf_;
 
-    if (tx_buf != nullptr) {
+    // Packets that were built in the DMA buffers don't need to be copied.
+    if (tx_buf != nullptr && tx_buf != spi_tx_buf_) {
         memcpy(spi_tx_buf_, tx_buf, len_bytes);
     }
 
@@ -380,9 +924,10 @@ int SPICoprocessor::SPIWriteReadBlocking(uint8_t *tx_buf, uint8_t *rx_buf, uint1
         return kErrorGeneric;
     }
     bytes_written = CeilBitsToBytes(t.trans_len);
-    if (rx_buf != nullptr) {
+    if (rx_buf != nullptr && rx_buf != spi_rx_buf_) {
         memcpy(rx_buf, spi_rx_buf_, len_bytes);
     }
 #endif
     return bytes_written;
 }
+#endif
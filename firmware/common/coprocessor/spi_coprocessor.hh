@@ -3,17 +3,20 @@
 
 #include "aircraft_dictionary.hh"
 #include "comms.hh"
+#include "data_structures.hh"  // For SPSCQueue.
 #include "hal.hh"
 #include "macros.hh"
 #include "object_dictionary.hh"
+#include "perf_monitor.hh"
 #include "settings.hh"
 #include "transponder_packet.hh"
 
 #ifdef ON_PICO
+#include "hardware/dma.h"
 #include "hardware/gpio.h"
+#include "hardware/irq.h"
 #include "hardware/spi.h"
 #elif ON_ESP32
-#include "data_structures.hh"
 #include "driver/gpio.h"
 #include "driver/spi_slave.h"
 #include "esp_heap_caps.h"
@@ -28,9 +31,17 @@ class SPICoprocessor {
     static const uint16_t kSPITransactionMaxLenBytes =
         4096;  // Default max is 4096 Bytes on ESP32 (with DMA) and 4096 Bytes on RP2040.
     static_assert(kSPITransactionMaxLenBytes % 4 == 0);  // Make sure it's word-aligned.
+    // Largest packet sent from the RP2040's transaction queue. Writes from the RP2040 are split into blocks that fit,
+    // so that each queue slot only needs this much room instead of kSPITransactionMaxLenBytes.
+    static const uint16_t kSPIQueuedPacketMaxLenBytes = 1024;
+    static_assert(kSPIQueuedPacketMaxLenBytes % 4 == 0);  // Make sure it's word-aligned.
     static const uint16_t kSPITransactionQueueLenTransactions = 3;
     static const uint16_t kSPITransactionMaxNumRetries =
         3;  // Max num retries per block in a multi-transfer transaction.
+    // Number of blocks of a windowed write that are sent back to back before waiting for a cumulative ack. The first
+    // block of a windowed write is always acked on its own, so that a cumulative ack can't be left over from the last
+    // write to the same object.
+    static const uint16_t kSPIWriteWindowNumBlocks = 4;
 
 #ifdef ON_PICO
     // Make sure that we don't talk to the slave before it has a chance to get ready for the next message.
@@ -47,8 +58,16 @@ class SPICoprocessor {
     // NOTE: Max transmission time is ~10ms with a 4kB packet at 40MHz.
     // How long to wait once a transaction is started before timing out.
     static const uint16_t kSPITransactionTimeoutMs = 20;
-    // How long a blocking wait for a handshake can last.
+    // How long to wait for the handshake that announces an ack or read response.
     static const uint16_t kSPIHandshakeTimeoutMs = 20;
+    // Transactions queued by Write() and ReadAsync() and sent in the background by Update(). Must be a power of two
+    // (SPSCQueue). Writes and reads with more blocks than this wait for room in the queue block by block.
+    static const uint16_t kSPITransactionQueueDepth = 4;
+    // Blocks of a window stay in the queue until they are acked, so that they can be sent again.
+    static_assert(kSPIWriteWindowNumBlocks <= kSPITransactionQueueDepth);
+    // How long Write() and ReadAsync() keep running Update() to make room in a full transaction queue before giving up
+    // on queueing the first block of an object.
+    static const uint16_t kSPITransactionQueueTimeoutMs = 100;
 #elif ON_ESP32
     static const uint32_t kNetworkLEDBlinkDurationMs = 10;
     static const uint32_t kNetworkLEDBlinkDurationTicks = kNetworkLEDBlinkDurationMs / portTICK_PERIOD_MS;
@@ -72,6 +91,9 @@ class SPICoprocessor {
         uint16_t spi_miso_pin = 12;
         uint16_t spi_cs_pin = 9;
         uint16_t spi_handshake_pin = 13;
+        // Called from interrupts when Update() has work to do: the HANDSHAKE line went high, or a DMA transfer
+        // finished. Optional, e.g. to release the task that calls Update().
+        void (*event_callback)() = nullptr;
         // gpio_slew_rate spi_gpio_slew_rate = GPIO_SLEW_RATE_SLOW;
         // gpio_drive_strength spi_gpio_drive_strength = GPIO_DRIVE_STRENGTH_2MA;
 #elif ON_ESP32
@@ -98,35 +120,105 @@ class SPICoprocessor {
         kCmdWriteToMasterRequireAck = 0x05,  // Expects a response to continue to the next block.
         kCmdReadFromMaster = 0x06,
         kCmdDataBlock = 0x07,
-        kCmdAck = 0x08
+        kCmdAck = 0x08,
+        // Windowed writes. Blocks of a multi-transfer write are sent back to back, and only the last block of each
+        // window asks for a kCmdStreamAck. The offset of each block doubles as its sequence number. The first block
+        // is a window of its own, since it starts the stream on the receiving end.
+        kCmdStreamWriteToSlave = 0x09,             // No response expected.
+        kCmdStreamWriteToSlaveRequireAck = 0x0A,   // Last block of a window, expects a kCmdStreamAck.
+        kCmdStreamWriteToMaster = 0x0B,            // No response expected.
+        kCmdStreamWriteToMasterRequireAck = 0x0C,  // Last block of a window, expects a kCmdStreamAck.
+        kCmdStreamAck = 0x0D
     };
+    /** Begin packet headers on the wire. **/
+    struct __attribute__((__packed__)) SCWriteHeader {
+        SCCommand cmd;
+        ObjectDictionary::Address addr;
+        uint16_t offset;
+        uint16_t len;  // Length from start of data to beginning of CRC.
+    };
+
+    struct __attribute__((__packed__)) SCReadRequestHeader {
+        SCCommand cmd;
+        ObjectDictionary::Address addr;
+        uint16_t offset;
+        uint16_t len;  // Length of the data requested.
+    };
+
+    struct __attribute__((__packed__)) SCResponseHeader {
+        SCCommand cmd;
+    };
+
+    // Payload of a kCmdStreamAck response.
+    struct __attribute__((__packed__)) SCStreamAck {
+        ObjectDictionary::Address addr;
+        // Every Byte of the object before this offset has been written. Anything short of the end of the window asks
+        // for the window to be sent again from this offset.
+        uint16_t next_offset;
+    };
+    /** End packet headers on the wire. **/
+
     /**
-     * Abstract base struct for SPI Coprocessor packets.
+     * Base class for SPI Coprocessor packets. A packet on the wire is a HeaderType, followed by the data, followed by a
+     * CRC16. Packets are views over a buffer that belongs to someone else (usually the buffer that the SPI peripheral
+     * reads from or writes into), so building or parsing a packet doesn't clear or copy the buffer. PacketType
+     * provides GetDataLenBytes(), which is resolved at compile time instead of through a vtable.
      */
-    struct __attribute__((__packed__)) SCPacket {
-        static const uint16_t kPacketMaxLenBytes = kSPITransactionMaxLenBytes;
-        static const uint16_t kCRCLenBytes = sizeof(uint16_t);
+    template <typename PacketType, typename HeaderType>
+    class SCPacket {
+       public:
+        static constexpr uint16_t kPacketMaxLenBytes = kSPITransactionMaxLenBytes;
+        static constexpr uint16_t kCRCLenBytes = sizeof(uint16_t);
+        static constexpr uint16_t kDataOffsetBytes = sizeof(HeaderType);
+        static constexpr uint16_t kBufMinLenBytes = kDataOffsetBytes + kCRCLenBytes;
 
-        // Pure virtual functions.
-        virtual inline uint16_t GetBufLenBytes() = 0;
-        // GetBuf needs to return the beginning of the elements of the child class, not "this", since "this" points to
-        // the beginning of the child class struct, which first contains a pointer to this virtual base class.
-        virtual inline uint8_t *GetBuf() = 0;
-        virtual inline uint8_t *GetCRCPtr() = 0;
+        /**
+         * Constructor.
+         * @param[in] buf Buffer with a packet in it, or to build a packet in.
+         * @param[in] buf_len_bytes Length of the buffer. Packets that would run off the end of it are not valid.
+         */
+        SCPacket(uint8_t *buf, uint16_t buf_len_bytes) : buf_(buf), buf_len_bytes_(buf_len_bytes) {}
+
+        // The header is copied in and out, since the buffer may not be aligned for its fields.
+        inline HeaderType GetHeader() const {
+            HeaderType header;
+            memcpy(&header, buf_, sizeof(HeaderType));
+            return header;
+        }
+        inline void SetHeader(const HeaderType &header) { memcpy(buf_, &header, sizeof(HeaderType)); }
 
-        // Virtual functions.
-        virtual inline bool IsValid() { return CalculateCRC16(GetBuf(), GetBufLenBytes() - kCRCLenBytes) == GetCRC(); }
-        virtual inline void PopulateCRC() { SetCRC(CalculateCRC16(GetBuf(), GetBufLenBytes() - kCRCLenBytes)); }
-        virtual inline uint16_t GetCRC() {
+        inline uint8_t *GetBuf() const { return buf_; }
+        inline uint8_t *GetData() const { return buf_ + kDataOffsetBytes; }
+        inline uint16_t GetBufLenBytes() const {
+            return kDataOffsetBytes + static_cast<const PacketType *>(this)->GetDataLenBytes() + kCRCLenBytes;
+        }
+
+        /**
+         * Checks that the packet fits in its buffer and that its CRC matches. Since the CRC is stored MSB first, the
+         * CRC over the whole packet including its CRC is 0 for a valid packet.
+         * @retval True if the packet is valid, false otherwise.
+         */
+        inline bool IsValid() const {
+            return buf_len_bytes_ >= kBufMinLenBytes && GetBufLenBytes() <= buf_len_bytes_ &&
+                   CalculateCRC16(buf_, GetBufLenBytes()) == 0;
+        }
+        inline void PopulateCRC() { SetCRC(CalculateCRC16(buf_, GetBufLenBytes() - kCRCLenBytes)); }
+        inline uint16_t GetCRC() const {
             uint16_t crc_out = 0x0;
             // Extract CRC safely regardless of memory alignment.
             memcpy(&crc_out, GetCRCPtr(), sizeof(uint16_t));
             return crc_out;
         }
-        virtual inline void SetCRC(uint16_t crc_in) {
+        inline void SetCRC(uint16_t crc_in) {
             // Set CRC safely regardless of memory alignment.
             memcpy(GetCRCPtr(), &crc_in, sizeof(uint16_t));
         }
+
+       protected:
+        inline uint8_t *GetCRCPtr() const { return buf_ + GetBufLenBytes() - kCRCLenBytes; }
+
+        uint8_t *buf_;
+        uint16_t buf_len_bytes_;
     };
 
     /**
@@ -134,47 +226,15 @@ class SPICoprocessor {
      *
      * Used to write to slave (from master), or write to master (from slave). Does not receive a reply.
      */
-    struct __attribute__((__packed__)) SCWritePacket : public SCPacket {
-        static const uint16_t kDataOffsetBytes =
-            sizeof(SCCommand) + sizeof(ObjectDictionary::Address) + sizeof(uint16_t) + sizeof(uint16_t);
+    class SCWritePacket : public SCPacket<SCWritePacket, SCWriteHeader> {
+       public:
         static const uint16_t kDataMaxLenBytes = kPacketMaxLenBytes - kDataOffsetBytes - kCRCLenBytes;
-        static const uint16_t kBufMinLenBytes = kDataOffsetBytes + kCRCLenBytes;
-
-        /** Begin packet contents on the wire. **/
-        SCCommand cmd = kCmdInvalid;
-        ObjectDictionary::Address addr = ObjectDictionary::kAddrInvalid;
-        uint16_t offset = 0;
-        uint16_t len = 0;                               // Length from start of data to beginning of CRC.
-        uint8_t data[kDataMaxLenBytes + kCRCLenBytes];  // CRC is secretly appended at the end of data so that the
-                                                        // struct can be used as a buffer to send with.
-        /** End packet contents on the wire. **/
-
-        /**
-         * Default constructor.
-         */
-        SCWritePacket() { memset(data, 0x0, kDataMaxLenBytes); }
+        // Largest payload of a single block of a write queued on the RP2040, see kSPIQueuedPacketMaxLenBytes.
+        static const uint16_t kQueuedDataMaxLenBytes = kSPIQueuedPacketMaxLenBytes - kDataOffsetBytes - kCRCLenBytes;
 
-        /**
-         * Constructor from buffer. Used for creating an SCCommand packet from a SPI transaction.
-         * @param[in] buf_in Pointer to buffer with SCCommand packet in it.
-         * @param[in] buf_in_len_bytes Length of the buffer to ingest.
-         */
-        SCWritePacket(uint8_t *buf_in, uint16_t buf_in_len_bytes) {
-            if (buf_in_len_bytes < kBufMinLenBytes) {
-                CONSOLE_ERROR("SPICoprocessor::SCWritePacket",
-                              "Attempted to create a packet from a buffer that was too small. Received %d bytes, but"
-                              "needed at least %d!",
-                              buf_in_len_bytes, kBufMinLenBytes);
-                return;
-            }
-            memcpy(GetBuf(), buf_in, buf_in_len_bytes);
-            // Override the len field that we read in since it's important for calculating CRC.
-            len = buf_in_len_bytes - kDataOffsetBytes - kCRCLenBytes;
-        }
+        using SCPacket::SCPacket;
 
-        inline uint16_t GetBufLenBytes() override { return kDataOffsetBytes + len + kCRCLenBytes; }
-        inline uint8_t *GetBuf() override { return (uint8_t *)(&cmd); }
-        inline uint8_t *GetCRCPtr() override { return data + MIN(len, kDataMaxLenBytes); }
+        inline uint16_t GetDataLenBytes() const { return MIN(GetHeader().len, kDataMaxLenBytes); }
     };
 
     /**
@@ -183,43 +243,13 @@ class SPICoprocessor {
      * Used to request a read from slave (by master) or request a read from master (by slave). Receives a
      * SCResponsePacket in response.
      */
-    struct __attribute__((__packed__)) SCReadRequestPacket : public SCPacket {
-        static const uint16_t kBufLenBytes =
-            sizeof(SCCommand) + sizeof(ObjectDictionary::Address) + 2 * sizeof(uint16_t) + kCRCLenBytes;
-        /** Begin packet contents on the wire. **/
-        SCCommand cmd = kCmdInvalid;
-        ObjectDictionary::Address addr = ObjectDictionary::kAddrInvalid;
-        uint16_t offset = 0;
-        uint16_t len = 0;
-        uint16_t crc;
-        /** End packet contents on the wire. **/
-
-        /**
-         * Default constructor.
-         */
-        SCReadRequestPacket() {}
+    class SCReadRequestPacket : public SCPacket<SCReadRequestPacket, SCReadRequestHeader> {
+       public:
+        static const uint16_t kBufLenBytes = kBufMinLenBytes;  // No data, the header is the whole request.
 
-        /**
-         * Constructor from buffer. Used for creating an SCReadRequest packet from a SPI transaction.
-         * @param[in] buf_in Pointer to buffer with SCReadRequest packet in it.
-         * @param[in] buf_in_len_bytes Length of the buffer to ingest.
-         */
-        SCReadRequestPacket(uint8_t *buf_in, uint16_t buf_in_len_bytes) {
-            if (buf_in_len_bytes < kBufLenBytes) {
-                CONSOLE_ERROR(
-                    "SPICoprocessor::SCReadRequestPacket",
-                    "Attempted to create a packet from a buffer that was too small. Received %d Bytes, but needed %d!",
-                    buf_in_len_bytes, kBufLenBytes);
-                return;
-            }
-            memcpy(GetBuf(), buf_in, buf_in_len_bytes);
-        }
+        using SCPacket::SCPacket;
 
-        inline uint16_t GetCRC() override { return crc; }
-        inline void SetCRC(uint16_t crc_in) override { crc = crc_in; }
-        inline uint16_t GetBufLenBytes() override { return kBufLenBytes; }
-        inline uint8_t *GetBuf() override { return (uint8_t *)(&cmd); }
-        inline uint8_t *GetCRCPtr() override { return (uint8_t *)&crc; }
+        inline uint16_t GetDataLenBytes() const { return 0; }
     };
 
     /**
@@ -228,10 +258,9 @@ class SPICoprocessor {
      * Response to a Read Request Packet, containing the requested data, or response to a Write Request Packet Requiring
      * Ack, containing an ack.
      */
-    struct __attribute__((__packed__)) SCResponsePacket : public SCPacket {
-        static const uint16_t kDataMaxLenBytes = kPacketMaxLenBytes - sizeof(SCCommand) - kCRCLenBytes;
-        static const uint16_t kDataOffsetBytes = sizeof(SCCommand);
-        static const uint16_t kBufMinLenBytes = sizeof(SCCommand) + kCRCLenBytes;  // No payload Bytes.
+    class SCResponsePacket : public SCPacket<SCResponsePacket, SCResponseHeader> {
+       public:
+        static const uint16_t kDataMaxLenBytes = kPacketMaxLenBytes - kDataOffsetBytes - kCRCLenBytes;
 
         // ACK packet is special format of SCResponse packet with a single byte data payload.
         // ACK format: CMD | ACK | CRC
@@ -239,6 +268,8 @@ class SPICoprocessor {
         // ACK = true if success, false if fail
         // CRC = CRC16
         static const uint16_t kAckLenBytes = sizeof(SCCommand) + 1 + kCRCLenBytes;
+        // Stream ACK format: CMD | SCStreamAck | CRC
+        static const uint16_t kStreamAckLenBytes = sizeof(SCCommand) + sizeof(SCStreamAck) + kCRCLenBytes;
 
         /**
          * Convenience function that tells you how long a response packet would be with a payload of X bytes.
@@ -249,40 +280,82 @@ class SPICoprocessor {
             return kDataOffsetBytes + payload_len_bytes + kCRCLenBytes;
         }
 
-        /** Begin packet contents on the wire. **/
-        SCCommand cmd = kCmdInvalid;
-        uint8_t data[kDataMaxLenBytes + kCRCLenBytes];
-        /** End packet contents on the wire. **/
+        /**
+         * Constructor. The data length isn't sent on the wire, so a response fills its whole buffer until
+         * SetDataLenBytes() is called.
+         * @param[in] buf Buffer with a response in it, or to build a response in.
+         * @param[in] buf_len_bytes Length of the buffer.
+         */
+        SCResponsePacket(uint8_t *buf, uint16_t buf_len_bytes)
+            : SCPacket(buf, buf_len_bytes),
+              data_len_bytes_(buf_len_bytes > kBufMinLenBytes ? MIN(buf_len_bytes - kBufMinLenBytes, kDataMaxLenBytes)
+                                                              : 0) {}
+
+        inline uint16_t GetDataLenBytes() const { return data_len_bytes_; }
+        inline void SetDataLenBytes(uint16_t data_len_bytes) {
+            data_len_bytes_ = MIN(data_len_bytes, kDataMaxLenBytes);
+        }
 
-        uint16_t data_len_bytes = 0;  // Length from start of data to beginning of CRC.
+       private:
+        uint16_t data_len_bytes_;  // Length from start of data to beginning of CRC.
+    };
 
+    /**
+     * Receiving end of windowed writes. Blocks are only written to the object dictionary in order, so the offset of the
+     * next block that's expected is also a cumulative ack for the whole stream. Anything that shows up out of order
+     * (because the block before it was lost) is dropped, and gets sent again once the ack goes back to the sender.
+     */
+    class SCStreamReceiver {
+       public:
         /**
-         * Default constructor.
+         * Checks whether a block is the next one in the stream. A block at offset 0 starts a new stream.
+         * @param[in] addr Address of the object that the block belongs to.
+         * @param[in] offset Offset of the block in the object.
+         * @retval True if the block should be written, false if it should be dropped.
          */
-        SCResponsePacket() { memset(data, 0x0, kDataMaxLenBytes); }
+        bool IsNextBlock(ObjectDictionary::Address addr, uint16_t offset) {
+            if (offset == 0) {
+                addr_ = addr;
+                next_offset_ = 0;
+            }
+            return addr == addr_ && offset == next_offset_;
+        }
 
         /**
-         * Constructor from buffer. Used for creating an SCReadResponse packet from a SPI transaction.
-         * @param[in] buf_in Pointer to buffer with SCReadResponse packet in it.
-         * @param[in] buf_in_len_bytes Length of the buffer to ingest.
+         * Moves the stream past a block that was written.
+         * @param[in] len_bytes Length of the block.
          */
-        SCResponsePacket(uint8_t *buf_in, uint16_t buf_in_len_bytes) {
-            if (buf_in_len_bytes < kBufMinLenBytes) {
-                CONSOLE_ERROR("SPICoprocessor::SCResponsePacket",
-                              "Attempted to create a packet from a buffer that was too small. Received %d Bytes, but "
-                              "needed at least %d!",
-                              buf_in_len_bytes, kBufMinLenBytes);
-                return;
-            }
-            memcpy(GetBuf(), buf_in, buf_in_len_bytes);
-            data_len_bytes = buf_in_len_bytes - kDataOffsetBytes - kCRCLenBytes;
+        void Advance(uint16_t len_bytes) { next_offset_ += len_bytes; }
+
+        /**
+         * Builds a kCmdStreamAck for the stream so far.
+         * @param[out] buf Buffer to build the ack in. Must be at least SCResponsePacket::kStreamAckLenBytes long.
+         */
+        void PopulateAck(uint8_t *buf) const {
+            SCResponsePacket ack_packet = SCResponsePacket(buf, SCResponsePacket::kStreamAckLenBytes);
+            ack_packet.SetHeader({.cmd = kCmdStreamAck});
+            SCStreamAck ack = {.addr = addr_, .next_offset = next_offset_};
+            memcpy(ack_packet.GetData(), &ack, sizeof(SCStreamAck));
+            ack_packet.PopulateCRC();
         }
 
-        inline uint16_t GetBufLenBytes() override { return kDataOffsetBytes + data_len_bytes + kCRCLenBytes; }
-        inline uint8_t *GetBuf() override { return (uint8_t *)(&cmd); }
-        inline uint8_t *GetCRCPtr() override { return data + data_len_bytes; }
+        uint16_t GetNextOffset() const { return next_offset_; }
+
+       private:
+        ObjectDictionary::Address addr_ = ObjectDictionary::Address::kAddrInvalid;
+        uint16_t next_offset_ = 0;
     };
 
+#ifdef ON_PICO
+    /**
+     * Called by Update() when a queued transaction finishes, after any retries.
+     * @param[in] success True if the transaction went through (and was acked, or got a valid response), false
+     * otherwise.
+     * @param[in] context Pointer that was passed in along with the callback.
+     */
+    typedef void (*SPITransactionCallback)(bool success, void *context);
+#endif
+
     /**
      * Constructor
      */
@@ -315,37 +388,58 @@ class SPICoprocessor {
     bool IsEnabled() { return is_enabled_; }
 #endif
     /**
-     *
-     * @param[in] blocking On RP2040, blocks until kSPIMinTransactionIntervalUs after the previous transaction to check
-     * to see if the ESP32 has anything to say. Set to true if using this as a way to flush the ESP32 of messages before
-     * writing to it. On ESP32, has no effect.
+     * On RP2040, runs the transaction engine: services transfers requested by the ESP32 with the HANDSHAKE line, and
+     * sends queued transactions. Transfers run on DMA, so this returns right away and needs to be called again to make
+     * progress. On ESP32, waits for and handles a transaction from the RP2040.
+     * @param[in] blocking On RP2040, keep running until the transaction queue is empty and the bus is idle. On ESP32,
+     * has no effect.
      */
     bool Update(bool blocking = false);
 
     /**
      * Top level function that translates a write to an object (with associated address) into SPI transaction(s).
      * Included in the header file since the template function implementation needs to be visible to any file that
-     * utilizes it.
+     * utilizes it. On RP2040, the object is copied into the transaction queue. Writes that require an ack run Update()
+     * until every block has been acked, so the return value says whether the write went through. Writes without an ack
+     * happen in the background, and the return value only says whether the write was queued. Use WriteAsync() to queue
+     * a write that requires an ack without waiting for it. Don't call from a transaction callback.
      */
     template <typename T>
     bool Write(ObjectDictionary::Address addr, T &object, bool require_ack = false, uint16_t len_bytes = 0) {
+        PERF_PROBE(PerfMonitor::kStageSPICoprocessorWrite);
         if (len_bytes == 0) {
             len_bytes = sizeof(object);
         }
+#ifdef ON_PICO
+        if (!require_ack) {
+            return QueueWrite(addr, (uint8_t *)&object, len_bytes, false, nullptr, nullptr);
+        }
+        int8_t result = -1;  // -1 while the write is in progress, then 0 or 1.
+        if (!QueueWrite(
+                addr, (uint8_t *)&object, len_bytes, true,
+                [](bool success, void *context) { *static_cast<int8_t *>(context) = success; }, &result)) {
+            return false;
+        }
+        while (result < 0) {
+            Update();
+        }
+        return result;
+#else
 #ifdef ON_ESP32
         if (xSemaphoreTake(spi_next_transaction_mutex_, kSPIMutexTimeoutTicks) != pdTRUE) {
             CONSOLE_ERROR("SPICoprocessor::Write", "Failed to take SPI context mutex after waiting for %d ms.",
                           kSPIMutexTimeoutMs);
             return false;
         }
-#elif ON_PICO
-
 #else
         return false;  // Not supported on other platforms.
 #endif
         if (len_bytes < SCWritePacket::kDataMaxLenBytes) {
             // Single write. Write the full object at once, no offset, require ack if necessary.
             return SPIIndependentLoopReturnHelper(PartialWrite(addr, (uint8_t *)&object, len_bytes, 0, require_ack));
+        } else if (require_ack) {
+            // Multi write, sent in windows that are acked all at once instead of block by block.
+            return SPIIndependentLoopReturnHelper(StreamWrite(addr, (uint8_t *)&object, len_bytes));
         } else {
             // Multi write.
             int16_t bytes_remaining = len_bytes;
@@ -367,26 +461,38 @@ class SPICoprocessor {
             return SPIIndependentLoopReturnHelper(true);
         }
         return SPIIndependentLoopReturnHelper(false);
+#endif
     }
 
     /**
      * Top level function that translates a read from an object (with associated address) into SPI transaction(s).
      * Included in the header file since the template function implementation needs to be visible to any file that
-     * utilizes it.
+     * utilizes it. On RP2040, runs Update() until the read is done, since the object has to be filled in before
+     * returning. Use ReadAsync() to read without waiting. Don't call from a transaction callback.
      */
     template <typename T>
     bool Read(ObjectDictionary::Address addr, T &object, uint16_t len_bytes = 0) {
         if (len_bytes == 0) {
             len_bytes = sizeof(object);
         }
+#ifdef ON_PICO
+        int8_t result = -1;  // -1 while the read is in progress, then 0 or 1.
+        if (!QueueRead(
+                addr, (uint8_t *)&object, len_bytes,
+                [](bool success, void *context) { *static_cast<int8_t *>(context) = success; }, &result)) {
+            return false;
+        }
+        while (result < 0) {
+            Update();
+        }
+        return result;
+#else
 #ifdef ON_ESP32
         if (xSemaphoreTake(spi_next_transaction_mutex_, kSPIMutexTimeoutTicks) != pdTRUE) {
             CONSOLE_ERROR("SPICoprocessor::PartialRead", "Failed to take SPI context mutex after waiting for %d ms.",
                           kSPIMutexTimeoutMs);
             return false;
         }
-#elif ON_PICO
-
 #else
         return false;  // Not supported on other platforms.
 #endif
@@ -396,10 +502,7 @@ class SPICoprocessor {
 
         } else {
             // Multi-read.
-#ifdef ON_PICO
-            // Write and read are separate transactions.
-            uint16_t max_chunk_size_bytes = SCResponsePacket::kDataMaxLenBytes;
-#elif ON_ESP32
+#ifdef ON_ESP32
             // Write and read are a single transaction.
             uint16_t max_chunk_size_bytes = SCResponsePacket::kDataMaxLenBytes - SCReadRequestPacket::kBufLenBytes;
 #else
@@ -424,45 +527,54 @@ class SPICoprocessor {
             return SPIIndependentLoopReturnHelper(true);
         }
         return SPIIndependentLoopReturnHelper(false);
+#endif
     }
 
 #ifdef ON_PICO
+    /**
+     * Queues a write to an object on the ESP32 and returns right away. The object is copied into the transaction
+     * queue, so it doesn't need to outlive the call.
+     * @param[in] addr Address of the object.
+     * @param[in] object Object to write.
+     * @param[in] require_ack Whether the ESP32 needs to ack the write. Multi-transfer writes are acked once per
+     * window of kSPIWriteWindowNumBlocks blocks.
+     * @param[in] len_bytes Number of Bytes to write. Optional, defaults to sizeof(object).
+     * @param[in] callback Called from Update() once the write is done. Optional.
+     * @param[in] callback_context Passed to the callback.
+     * @retval True if the write was queued, false otherwise.
+     */
+    template <typename T>
+    bool WriteAsync(ObjectDictionary::Address addr, T &object, bool require_ack = false, uint16_t len_bytes = 0,
+                    SPITransactionCallback callback = nullptr, void *callback_context = nullptr) {
+        PERF_PROBE(PerfMonitor::kStageSPICoprocessorWrite);
+        return QueueWrite(addr, (uint8_t *)&object, len_bytes == 0 ? sizeof(object) : len_bytes, require_ack, callback,
+                          callback_context);
+    }
+
+    /**
+     * Queues a read from an object on the ESP32 and returns right away. The object is filled in by Update() before the
+     * callback is called, so it needs to stay around until then.
+     * @param[in] addr Address of the object.
+     * @param[out] object Object to read into.
+     * @param[in] callback Called from Update() once the read is done.
+     * @param[in] callback_context Passed to the callback.
+     * @param[in] len_bytes Number of Bytes to read. Optional, defaults to sizeof(object).
+     * @retval True if the read was queued, false otherwise.
+     */
+    template <typename T>
+    bool ReadAsync(ObjectDictionary::Address addr, T &object, SPITransactionCallback callback, void *callback_context,
+                   uint16_t len_bytes = 0) {
+        return QueueRead(addr, (uint8_t *)&object, len_bytes == 0 ? sizeof(object) : len_bytes, callback,
+                         callback_context);
+    }
+
     /**
      * Checks the level of the HANDSHAKE pin used to initiate communication from the ESP32 to RP2040.
-     * NOTE: There is some hysteresis! The ESP32 can request a transfer as soon as kSPIPostTransmitLockoutUs is up, but
-     * this function won't unblock and confidently state that the HANDSHAKE pin is not asserted unless
-     * kSPIMinTransmitIntervalUs has elapsed.
-     * @param[in] blocking If true, wait until the pin is readable before reading it (e.g. it's been long enough since
-     * the end of the last transaction that the ESP32 has been able to assert or de-assert the HANDSHAKE pin as
-     * necessary). If false, return false if kSPIPostTransmitLockoutUs has not elapsed, otherwise return the HANDSHAKE
-     * pin state.
-     */
-    bool GetSPIHandshakePinLevel(bool blocking = false) {
-        if (blocking) {
-            // Blocking wait before pre-assert interval.
-            while (get_time_since_boot_us() - spi_last_transmit_timestamp_us_ <
-                   kSPIMinTransmitIntervalUs - kSPIUpdateCSPreAssertIntervalUs) {
-                // Check for Handshake pin going high after post transmit lockout period.
-                if (get_time_since_boot_us() - spi_last_transmit_timestamp_us_ > kSPIPostTransmitLockoutUs &&
-                    gpio_get(config_.spi_handshake_pin)) {
-                    // Allowed to exit blocking early if ESP32 asserts the HANDSHAKE pin.
-                    volatile bool early_exit = true;  // Just for debugging, allows breakpoint here.
-                    return true;
-                }
-            }
-            // Put CS pin LO during pre-assert interval to stop ESP32 from initiating a transaction with HANDSHAKE pin.
-            BeginSPITransaction();
-            // Enforce CS pre-assert interval with blocking wait.
-            uint32_t pre_assert_interval_start = get_time_since_boot_us();
-            while (get_time_since_boot_us() - pre_assert_interval_start < kSPIUpdateCSPreAssertIntervalUs) {
-                // Assert the CS line before the ESP32 has a chance to handshake.
-                if (gpio_get(config_.spi_handshake_pin)) {
-                    // Allowed to exit blocking early if ESP32 asserts the HANDSHAKE pin.
-                    return true;
-                }
-            }
-            return false;
-        } else if (get_time_since_boot_us() - spi_last_transmit_timestamp_us_ < kSPIPostTransmitLockoutUs) {
+     * @retval False if kSPIPostTransmitLockoutUs has not elapsed since the last transaction (the ESP32 may not have
+     * lowered the HANDSHAKE pin yet), otherwise the HANDSHAKE pin state.
+     */
+    bool GetSPIHandshakePinLevel() {
+        if (get_time_since_boot_us() - spi_last_transmit_timestamp_us_ < kSPIPostTransmitLockoutUs) {
             // Don't actually read the handshake pin if it might overlap with an existing transaction, since we could
             // try reading the slave when nothing is here (slave hasn't yet had time to de-assert handshake pin).
             return false;
@@ -471,21 +583,20 @@ class SPICoprocessor {
     }
 
     /**
-     * Blocks on waiting for the handshake pin to go high, until a timeout is reached.
-     * @retval True if handshake line went high before timeout, false otherwise.
+     * Returns the number of transactions waiting to be sent, including the one in progress.
      */
-    bool SPIWaitForHandshake() {
-        uint32_t wait_begin_timestamp_ms = get_time_since_boot_ms();
-        while (true) {
-            if (gpio_get(config_.spi_handshake_pin)) {
-                break;
-            }
-            if (get_time_since_boot_ms() - wait_begin_timestamp_ms >= kSPIHandshakeTimeoutMs) {
-                return false;
-            }
-        }
-        return true;
-    }
+    uint16_t GetNumQueuedTransactions() const { return transaction_queue_.Length(); }
+
+    /**
+     * ISR for the SPI RX DMA channel finishing a transfer. Public so that it can be reached from the interrupt
+     * handler.
+     */
+    void OnDMAComplete();
+
+    /**
+     * ISR for a rising edge on the HANDSHAKE pin. Public so that it can be reached from the interrupt handler.
+     */
+    void OnHandshakeRise();
 #elif ON_ESP32
     /**
      * Helper function used by callbacks to set the handshake pin high or low on the ESP32.
@@ -530,6 +641,33 @@ class SPICoprocessor {
     enum ReturnCode : int { kOk = 0, kErrorGeneric = -1, kErrorTimeout = -2 };
 
 #ifdef ON_PICO
+    /**
+     * Transaction queued for the ESP32, with the packet ready to send. Retries re-send the same packet.
+     */
+    struct SPITransaction {
+        uint8_t tx_buf[kSPIQueuedPacketMaxLenBytes];
+        uint16_t tx_len_bytes = 0;
+        uint8_t *read_buf = nullptr;  // Reads only. Object that the response is copied into.
+        uint16_t read_len_bytes = 0;  // Reads only. Payload length of the response.
+        bool is_last_block = true;    // False for all but the last block of a multi-transfer write or read.
+        uint16_t num_attempts = 0;
+        SPITransactionCallback callback = nullptr;  // Only called for the last block.
+        void *callback_context = nullptr;
+
+        SCCommand GetCmd() const { return static_cast<SCCommand>(tx_buf[0]); }
+    };
+
+    enum SPIState : uint8_t {
+        kSPIStateIdle = 0,
+        kSPIStatePreAssert,        // CS held low before sending, so that the ESP32 can't start a handshake.
+        kSPIStateSending,          // Sending the transaction at the front of the queue.
+        kSPIStateAwaitingReply,    // Waiting for the HANDSHAKE line to announce an ack or read response.
+        kSPIStateReceivingReply,   // Receiving an ack or read response.
+        kSPIStateReceivingWrite,   // Receiving the rest of a write that the ESP32 started.
+        kSPIStateAckPending,       // Waiting for the transmit interval to send an ack for a write from the ESP32.
+        kSPIStateSendingResponse,  // Sending a response to a read from the ESP32, or an ack.
+    };
+
     void BeginSPITransaction() { gpio_put(config_.spi_cs_pin, 0); }
 
     void EndSPITransaction() {
@@ -537,6 +675,117 @@ class SPICoprocessor {
         spi_last_transmit_timestamp_us_ = get_time_since_boot_us();
     }
 
+    void SetSPIState(SPIState state) {
+        spi_state_ = state;
+        spi_state_timestamp_us_ = get_time_since_boot_us();
+    }
+
+    /**
+     * Advances the transaction engine by one step. Never waits on the bus.
+     * @retval False if something went wrong during the step, true otherwise.
+     */
+    bool UpdateSPIState();
+
+    /**
+     * Starts a full duplex DMA transfer on the SPI peripheral. The DMA complete interrupt de-asserts chip select once
+     * the last Byte has been clocked in. Chip select must already be asserted. When receiving into rx_buf, the DMA
+     * sniffer runs the CRC16 over the received Bytes as they arrive, see ReceivedCRCIsValid().
+     * @param[in] tx_buf Buffer to send, or nullptr to send 0's.
+     * @param[in] rx_buf Buffer to receive into, or nullptr to throw away received Bytes.
+     * @param[in] len_bytes Number of Bytes to transfer.
+     * @param[in] rx_crc_seed Running CRC of any Bytes of the packet that were received before this transfer.
+     */
+    void StartSPIDMA(const uint8_t *tx_buf, uint8_t *rx_buf, uint16_t len_bytes, uint16_t rx_crc_seed = kCRC16Init);
+
+    /**
+     * Checks the CRC of a packet that finished arriving through StartSPIDMA(). Uses the CRC that the DMA sniffer
+     * calculated during the transfer, and only runs the CRC in software if something else borrowed the sniffer (e.g.
+     * FirmwareUpdateManager::CalculateCRC32()).
+     * @param[in] buf Start of the packet.
+     * @param[in] len_bytes Length of the packet, including the CRC at the end.
+     * @retval True if the CRC of the packet is valid, false otherwise.
+     */
+    bool ReceivedCRCIsValid(const uint8_t *buf, uint16_t len_bytes);
+
+    /**
+     * Checks whether the DMA transfer started by StartSPIDMA() is done, and aborts it if it has taken longer than
+     * kSPITransactionTimeoutMs.
+     * @retval kOk if the transfer finished, kErrorTimeout if it was aborted, or 1 if it's still running.
+     */
+    int CheckSPIDMA();
+
+    /**
+     * Handles the start of a transfer that the ESP32 requested with the HANDSHAKE line. Chip select must already be
+     * asserted. Reads the command and header, then hands the rest of the transfer to DMA.
+     * @retval True if the transfer was started, false if it was malformed.
+     */
+    bool BeginUnsolicitedTransfer();
+
+    /**
+     * Handles a write from the ESP32 once the whole packet has been received into rx_buf_.
+     * @retval True if the write was applied to the object dictionary, false otherwise.
+     */
+    bool HandleUnsolicitedWrite();
+
+    /**
+     * Handles the ack or read response to a transaction once it has been received into rx_buf_.
+     * @param[in] transaction Transaction at the front of the queue.
+     * @param[out] error_message Filled in if the reply was bad.
+     * @retval True if the reply was valid (and was an ack, for writes), false otherwise.
+     */
+    bool HandleReply(SPITransaction &transaction, char *error_message);
+
+    /**
+     * Handles the cumulative ack at the end of a window once it has been received into rx_buf_. Blocks of the window
+     * that were acked are completed and popped from the queue.
+     * @param[out] error_message Filled in if the ack was bad or asked for part of the window to be sent again.
+     * @retval True if the whole window was acked, false otherwise.
+     */
+    bool HandleStreamAck(char *error_message);
+
+    /**
+     * Returns the transaction that is being sent: the front of the queue, or a later block of a window whose earlier
+     * blocks are still waiting for their ack.
+     */
+    SPITransaction *GetSendingTransaction() { return transaction_queue_.GetPopSlot(window_num_sent_); }
+
+    /**
+     * Re-sends the transaction at the front of the queue, or gives up on it once it runs out of retries. Any blocks of
+     * a window that were sent after it are sent again too.
+     * @param[in] error_message Reason that the last attempt failed.
+     */
+    void RetryTransaction(const char *error_message);
+
+    /**
+     * Pops the transaction at the front of the queue and calls its callback if it was the last block.
+     * @param[in] success Whether the transaction went through.
+     */
+    void CompleteTransaction(bool success);
+
+    /**
+     * Waits for room in the transaction queue, running Update() in the meantime.
+     * @param[in] num_transactions Number of free slots needed.
+     * @param[in] can_time_out Give up after kSPITransactionQueueTimeoutMs. Without a timeout, this waits for as long as
+     * the queued transactions take to go through or run out of retries.
+     * @retval True if there was room, false if the wait timed out.
+     */
+    bool WaitForTransactionQueueSpace(uint16_t num_transactions, bool can_time_out = true);
+
+    /**
+     * Splits a write into blocks of up to SCWritePacket::kQueuedDataMaxLenBytes and queues them, waiting for room in
+     * the queue block by block.
+     * @retval True if all blocks were queued, false otherwise.
+     */
+    bool QueueWrite(ObjectDictionary::Address addr, const uint8_t *object_buf, uint16_t len_bytes, bool require_ack,
+                    SPITransactionCallback callback, void *callback_context);
+
+    /**
+     * Splits a read into blocks and queues their read requests, waiting for room in the queue block by block.
+     * @retval True if all read requests were queued, false otherwise.
+     */
+    bool QueueRead(ObjectDictionary::Address addr, uint8_t *object_buf, uint16_t len_bytes,
+                   SPITransactionCallback callback, void *callback_context);
+
 #elif ON_ESP32
     SemaphoreHandle_t spi_mutex_;  // Low level mutex used to guard the SPI peripheral (don't let multiple
                                    // threads queue packets at the same time).
@@ -580,42 +829,33 @@ class SPICoprocessor {
         return ret;
     }
 
+#ifndef ON_PICO
+    // Blocking transfers, used on the ESP32. The RP2040 queues transactions instead.
     bool PartialWrite(ObjectDictionary::Address addr, uint8_t *object_buf, uint16_t len, uint16_t offset = 0,
                       bool require_ack = false) {
-        SCWritePacket write_packet;
-#ifdef ON_PICO
-        write_packet.cmd = require_ack ? kCmdWriteToSlaveRequireAck : kCmdWriteToSlave;
-#elif ON_ESP32
-        write_packet.cmd = require_ack ? kCmdWriteToMasterRequireAck : kCmdWriteToMaster;
-#else
-        return false;  // Not supported on other platforms.
-#endif
-        write_packet.addr = addr;
-        memcpy(write_packet.data, object_buf + offset, len);
-        write_packet.len = len;
-        write_packet.offset = offset;
-        write_packet.PopulateCRC();
-
 #ifdef ON_ESP32
         if (xSemaphoreTake(spi_mutex_, kSPIMutexTimeoutTicks) != pdTRUE) {
             CONSOLE_ERROR("SPICoprocessor::PartialWrite",
                           "Failed to acquire coprocessor SPI mutex after waiting %d ms.", kSPIMutexTimeoutMs);
             return false;
         }
-#endif
+        // Build the packet right in the DMA buffer so that SPIWriteBlocking() doesn't need to copy it. Holding the SPI
+        // mutex keeps other tasks out of the buffer.
+        SCWritePacket write_packet = SCWritePacket(spi_tx_buf_, kSPITransactionMaxLenBytes);
+        write_packet.SetHeader({.cmd = require_ack ? kCmdWriteToMasterRequireAck : kCmdWriteToMaster,
+                                .addr = addr,
+                                .offset = offset,
+                                .len = len});
+        memcpy(write_packet.GetData(), object_buf + offset, len);
+        write_packet.PopulateCRC();
+
         int num_attempts = 0;
         char error_message[kErrorMessageMaxLen + 1] = "No error.";
         error_message[kErrorMessageMaxLen] = '\0';
         bool ret = true;
         while (num_attempts < kSPITransactionMaxNumRetries) {
-#ifdef ON_PICO
-            // Call Update with blocking to flush ESP32 of messages before write (block to make sure it has a chance to
-            // talk if it needs to).
-            Update(true);  // Check to see if handshake line is raised before blasting a packet into the ESP32.
-#elif ON_ESP32
             // Handshake pin gets set LO by SPIWaitForAck(), so we need to re-assert it here for retries to bring it HI.
             use_handshake_pin_ = true;  // Set handshake pin to solicit a transaction with the RP2040.
-#endif
             int bytes_written = SPIWriteBlocking(write_packet.GetBuf(), write_packet.GetBufLenBytes());
 
             if (bytes_written < 0) {
@@ -637,84 +877,42 @@ class SPICoprocessor {
             ret = false;
             continue;
         }
-#ifdef ON_ESP32
         xSemaphoreGive(spi_mutex_);  // Allow other tasks to access the SPI peripheral.
-#endif
         if (!ret) {
             CONSOLE_ERROR("SPICoprocessor::PartialWrite", "Failed after %d tries: %s", num_attempts, error_message);
         }
         return ret;
-    }
-
-    bool PartialRead(ObjectDictionary::Address addr, uint8_t *object_buf, uint16_t len, uint16_t offset = 0) {
-        SCReadRequestPacket read_request_packet;
-#ifdef ON_PICO
-        read_request_packet.cmd = kCmdReadFromSlave;
-#elif ON_ESP32
-        read_request_packet.cmd = kCmdReadFromMaster;
 #else
         return false;  // Not supported on other platforms.
 #endif
-        read_request_packet.addr = addr;
-        read_request_packet.offset = offset;
-        read_request_packet.len = len;
-        read_request_packet.PopulateCRC();
-
-        uint8_t rx_buf[kSPITransactionMaxLenBytes];
-
-        uint16_t read_request_bytes = read_request_packet.GetBufLenBytes();
+    }
 
+    bool PartialRead(ObjectDictionary::Address addr, uint8_t *object_buf, uint16_t len, uint16_t offset = 0) {
 #ifdef ON_ESP32
         if (xSemaphoreTake(spi_mutex_, kSPIMutexTimeoutTicks) != pdTRUE) {
             CONSOLE_ERROR("SPICoprocessor::PartialRead", "Failed to acquire coprocessor SPI mutex after waiting %d ms.",
                           kSPIMutexTimeoutMs);
             return false;
         }
-#endif
+        // The read request is built and the response is parsed right in the DMA buffers. Holding the SPI mutex keeps
+        // other tasks out of them.
+        SCReadRequestPacket read_request_packet = SCReadRequestPacket(spi_tx_buf_, SCReadRequestPacket::kBufLenBytes);
+        read_request_packet.SetHeader({.cmd = kCmdReadFromMaster, .addr = addr, .offset = offset, .len = len});
+        read_request_packet.PopulateCRC();
+        uint16_t read_request_bytes = read_request_packet.GetBufLenBytes();
 
         int num_attempts = 0;
         char error_message[kErrorMessageMaxLen + 1] = "No error.";
         error_message[kErrorMessageMaxLen] = '\0';
         bool ret = true;
         while (num_attempts < kSPITransactionMaxNumRetries) {
-#ifdef ON_PICO
-            // On the master, reading from the slave is two transactions: The read request is sent, then we wait on the
-            // handshake line to read the reply.
-            SCResponsePacket response_packet;  // Declare this up here so the goto's don't cross it.
-            // Call Update with blocking to flush ESP32 of messages before write (block to make sure it has a chance to
-            // talk
-            // if it needs to).
-            Update(true);  // Check to see if handshake line is raised before blasting a packet into the ESP32.
-            int bytes_written = SPIWriteBlocking(read_request_packet.GetBuf(), read_request_bytes);
-            int bytes_read = 0;
-            if (bytes_written < 0) {
-                snprintf(error_message, kErrorMessageMaxLen, "Error code %d while writing read request over SPI.",
-                         bytes_written);
-                goto PARTIAL_READ_FAILED;
-            }
-            if (!SPIWaitForHandshake()) {
-                snprintf(error_message, kErrorMessageMaxLen,
-                         "Timed out while waiting for handshake after sending read request.");
-                goto PARTIAL_READ_FAILED;
-            }
-
-            response_packet.data_len_bytes =
-                len;  // We need to set this manually since we are using the default constructor.
-            bytes_read = SPIReadBlocking(response_packet.GetBuf(), SCResponsePacket::GetBufLenForPayloadLenBytes(len));
-            if (bytes_read < 0) {
-                snprintf(error_message, kErrorMessageMaxLen, "Error code %d while reading read response over SPI.",
-                         bytes_read);
-                goto PARTIAL_READ_FAILED;
-            }
-#elif ON_ESP32
             // On the slave, reading from the master is a single transaction. We preload the beginning of the message
             // with the read request, and the master populates the remainder of the message with the reply.
             use_handshake_pin_ = true;  // Set handshake pin to solicit a transaction with the RP2040.
             // Need to request the max transaction size. If we request something smaller, like read_request_bytes (which
             // doesn't include the response bytes), the SPI transmit function won't write the additional reply into our
             // buffer.
-            int bytes_exchanged =
-                SPIWriteReadBlocking(read_request_packet.GetBuf(), rx_buf, SCPacket::kPacketMaxLenBytes);
+            int bytes_exchanged = SPIWriteReadBlocking(spi_tx_buf_, spi_rx_buf_, kSPITransactionMaxLenBytes);
 
             if (bytes_exchanged < 0) {
                 snprintf(error_message, kErrorMessageMaxLen, "Error code %d during read from master SPI transaction.",
@@ -723,8 +921,6 @@ class SPICoprocessor {
                 CONSOLE_WARNING("SPICoprocessor::PartialRead", "%s", error_message);
                 num_attempts++;
                 ret = false;
-                // Mutex can be given back immediately because we don't ever wait for an ACK.
-                xSemaphoreGive(spi_mutex_);  // Allow other tasks to access the SPI peripheral.
                 continue;
             }
             if (bytes_exchanged <= read_request_bytes) {
@@ -736,42 +932,33 @@ class SPICoprocessor {
                 CONSOLE_WARNING("SPICoprocessor::PartialRead", "%s", error_message);
                 num_attempts++;
                 ret = false;
-                // Mutex can be given back immediately because we don't ever wait for an ACK.
-                xSemaphoreGive(spi_mutex_);  // Allow other tasks to access the SPI peripheral.
                 continue;
             }
             SCResponsePacket response_packet =
-                SCResponsePacket(rx_buf + read_request_bytes, bytes_exchanged - read_request_bytes);
-#else
-            SCResponsePacket response_packet;  // Dummy to stop compile errors.
-            // Total BS used to suppress a compile warning during host unit tests.
-            rx_buf[read_request_bytes] = '\0';
-            printf("%s", rx_buf);
-#endif
+                SCResponsePacket(spi_rx_buf_ + read_request_bytes, bytes_exchanged - read_request_bytes);
             if (!response_packet.IsValid()) {
                 snprintf(error_message, kErrorMessageMaxLen,
                          "Received response packet of length %d Bytes with an invalid CRC.",
                          response_packet.GetBufLenBytes());
                 goto PARTIAL_READ_FAILED;
             }
-            if (response_packet.cmd != SCCommand::kCmdDataBlock) {
+            if (response_packet.GetHeader().cmd != SCCommand::kCmdDataBlock) {
                 snprintf(error_message, kErrorMessageMaxLen,
                          "Received invalid response with cmd=0x%x to requested read at address 0x%x of length %d with "
                          "offset %d Bytes.",
-                         response_packet.cmd, read_request_packet.addr, read_request_packet.len,
-                         read_request_packet.offset);
+                         response_packet.GetHeader().cmd, addr, len, offset);
                 goto PARTIAL_READ_FAILED;
             }
-            if (response_packet.data_len_bytes != len) {
+            if (response_packet.GetDataLenBytes() != len) {
                 snprintf(error_message, kErrorMessageMaxLen,
                          "Received incorrect number of Bytes while reading object at address 0x%x with offset %d "
                          "Bytes. Requested %d Bytes but received %d.",
-                         addr, offset, read_request_packet.len, response_packet.data_len_bytes);
+                         addr, offset, len, response_packet.GetDataLenBytes());
                 goto PARTIAL_READ_FAILED;
             }
             // Completed successfully!
             ret = true;
-            memcpy(object_buf + offset, response_packet.data, response_packet.data_len_bytes);
+            memcpy(object_buf + offset, response_packet.GetData(), response_packet.GetDataLenBytes());
             break;
         PARTIAL_READ_FAILED:
             CONSOLE_WARNING("SPICoprocessor::PartialRead", "%s", error_message);
@@ -779,13 +966,100 @@ class SPICoprocessor {
             ret = false;
             continue;
         }
-#ifdef ON_ESP32
         xSemaphoreGive(spi_mutex_);  // Allow other tasks to access the SPI peripheral.
-#endif
         if (!ret) {
             CONSOLE_ERROR("SPICoprocessor::PartialRead", "Failed after %d tries: %s", num_attempts, error_message);
         }
         return ret;
+#else
+        return false;  // Not supported on other platforms.
+#endif
+    }
+
+    /**
+     * Writes an object to the RP2040 in windows of kSPIWriteWindowNumBlocks blocks. Blocks within a window are sent
+     * back to back, and the last one asks for a kCmdStreamAck. If the ack comes back short of the end of the window,
+     * the window is sent again from the acked offset.
+     * @param[in] addr Address of the object.
+     * @param[in] object_buf Object to write.
+     * @param[in] len_bytes Number of Bytes to write.
+     * @retval True if the whole object was acked, false otherwise.
+     */
+    bool StreamWrite(ObjectDictionary::Address addr, uint8_t *object_buf, uint16_t len_bytes) {
+#ifdef ON_ESP32
+        if (xSemaphoreTake(spi_mutex_, kSPIMutexTimeoutTicks) != pdTRUE) {
+            CONSOLE_ERROR("SPICoprocessor::StreamWrite", "Failed to acquire coprocessor SPI mutex after waiting %d ms.",
+                          kSPIMutexTimeoutMs);
+            return false;
+        }
+        uint16_t acked_offset = 0;  // Everything before this has been written on the RP2040.
+        int num_attempts = 0;
+        char error_message[kErrorMessageMaxLen + 1] = "No error.";
+        error_message[kErrorMessageMaxLen] = '\0';
+        while (acked_offset < len_bytes && num_attempts < kSPITransactionMaxNumRetries) {
+            bool window_ok = true;
+            uint16_t offset = acked_offset;
+            for (uint16_t block = 0; block < kSPIWriteWindowNumBlocks && offset < len_bytes; block++) {
+                uint16_t len = MIN(SCWritePacket::kDataMaxLenBytes, len_bytes - offset);
+                // The first block of the object is acked on its own, see kSPIWriteWindowNumBlocks.
+                bool window_end =
+                    acked_offset == 0 || block == kSPIWriteWindowNumBlocks - 1 || offset + len >= len_bytes;
+                // Build each block right in the DMA buffer, like PartialWrite().
+                SCWritePacket write_packet = SCWritePacket(spi_tx_buf_, kSPITransactionMaxLenBytes);
+                write_packet.SetHeader({.cmd = window_end ? kCmdStreamWriteToMasterRequireAck : kCmdStreamWriteToMaster,
+                                        .addr = addr,
+                                        .offset = offset,
+                                        .len = len});
+                memcpy(write_packet.GetData(), object_buf + offset, len);
+                write_packet.PopulateCRC();
+                use_handshake_pin_ = true;  // Set handshake pin to solicit a transaction with the RP2040.
+                int bytes_written = SPIWriteBlocking(write_packet.GetBuf(), write_packet.GetBufLenBytes());
+                if (bytes_written < 0) {
+                    snprintf(error_message, kErrorMessageMaxLen,
+                             "Error code %d while writing block at offset %d Bytes over SPI.", bytes_written, offset);
+                    window_ok = false;
+                    break;
+                }
+                offset += len;
+                if (window_end) {
+                    // The RP2040 answers with an ack right away, so nothing else can be sent until it has been read.
+                    // Otherwise the ack collides with the next block, which is lost even though the write went out.
+                    break;
+                }
+            }
+            uint16_t next_offset = acked_offset;
+            if (window_ok && !SPIWaitForStreamAck(addr, next_offset)) {
+                snprintf(error_message, kErrorMessageMaxLen,
+                         "Timed out or received bad ack after writing window at offset %d Bytes.", acked_offset);
+                window_ok = false;
+            } else if (window_ok && next_offset < offset) {
+                snprintf(error_message, kErrorMessageMaxLen,
+                         "Window from offset %d to %d Bytes was only acked up to offset %d Bytes.", acked_offset,
+                         offset, next_offset);
+                window_ok = false;
+            }
+            if (!window_ok) {
+                CONSOLE_WARNING("SPICoprocessor::StreamWrite", "%s", error_message);
+            }
+            if (next_offset > acked_offset) {
+                // Send the next window (or the rest of this one) from wherever the RP2040 got to. Retries only count
+                // when no progress was made.
+                acked_offset = next_offset;
+                num_attempts = 0;
+            } else {
+                num_attempts++;
+            }
+        }
+        if (acked_offset < len_bytes) {
+            CONSOLE_ERROR("SPICoprocessor::StreamWrite",
+                          "%d Byte write of object at address 0x%x failed at offset %d Bytes after %d tries: %s",
+                          len_bytes, addr, acked_offset, num_attempts, error_message);
+        }
+        xSemaphoreGive(spi_mutex_);  // Allow other tasks to access the SPI peripheral.
+        return acked_offset >= len_bytes;
+#else
+        return false;  // Not supported on other platforms.
+#endif
     }
 
     /**
@@ -801,9 +1075,25 @@ class SPICoprocessor {
      */
     bool SPIWaitForAck();
 
+    /**
+     * Sends a kCmdStreamAck with the progress of the windowed write that is coming in.
+     * @retval True if the ack was transmitted successfully, false if something went wrong.
+     */
+    bool SPISendStreamAck();
+
+    /**
+     * Blocks until a kCmdStreamAck is received or a timeout is reached.
+     * @param[in] addr Address of the object being written.
+     * @param[out] next_offset Offset that the receiver wants the write to continue from. Left alone if no valid ack
+     * for the object was received.
+     * @retval True if a valid ack was received, false otherwise.
+     */
+    bool SPIWaitForStreamAck(ObjectDictionary::Address addr, uint16_t &next_offset);
+
     /**
      * Low level HAL for SPI Write Read call. Transmits the contents of tx_buf and receives into rx_buf.
-     * Both buffers MUST be at least kSPITransactionMaxLenBytes Bytes long.
+     * Both buffers MUST be at least kSPITransactionMaxLenBytes Bytes long. On the ESP32, packets that are built or
+     * parsed in place in the DMA buffers (spi_tx_buf_ and spi_rx_buf_) are not copied.
      * @param[in] tx_buf Buffer with data to transmit.
      * @param[in] rx_buf Buffer to fill with data that is received.
      * @param[in] len_bytes Number of bytes to transmit. Only has an effect when this function is being called on the
@@ -824,12 +1114,36 @@ class SPICoprocessor {
                                bool end_transaction = true) {
         return SPIWriteReadBlocking(nullptr, rx_buf, len_bytes, end_transaction);
     }
+#endif
 
     SPICoprocessorConfig config_;
 
 #ifdef ON_PICO
-    uint64_t spi_last_transmit_timestamp_us_ = 0;
+    volatile uint64_t spi_last_transmit_timestamp_us_ = 0;  // Written by EndSPITransaction(), which runs in an ISR.
     bool is_enabled_ = false;
+
+    SPSCQueue<SPITransaction, kSPITransactionQueueDepth> transaction_queue_;
+    // Number of blocks at the front of the queue that belong to the current window and were sent without waiting for
+    // an ack. They stay in the queue until the ack at the end of the window comes back.
+    uint16_t window_num_sent_ = 0;
+    // Set when a block of a multi-transfer write or read fails, so that the rest of its blocks are dropped.
+    bool dropping_blocks_ = false;
+    // Set while QueueWrite() or QueueRead() waits to queue the rest of an object's blocks. Transaction callbacks that
+    // run in the meantime can't queue anything, since their blocks would end up in the middle of the object.
+    bool queueing_blocks_ = false;
+    SPIState spi_state_ = kSPIStateIdle;
+    uint64_t spi_state_timestamp_us_ = 0;
+
+    int spi_tx_dma_channel_ = -1;
+    int spi_rx_dma_channel_ = -1;
+    volatile bool spi_dma_complete_ = false;
+    uint8_t spi_dma_sink_ = 0;  // Received Bytes go here when there is no rx_buf.
+
+    // Packets received from the ESP32.
+    alignas(4) uint8_t rx_buf_[kSPITransactionMaxLenBytes];
+    // Acks and read responses sent to the ESP32.
+    alignas(4) uint8_t response_buf_[kSPITransactionMaxLenBytes];
+    uint16_t response_len_bytes_ = 0;  // Length of the ack waiting in response_buf_.
 #elif ON_ESP32
     // SPI peripheral needs to operate on special buffers that are 32-bit word aligned and in DMA accessible memory.
     uint8_t *spi_rx_buf_ = nullptr;
@@ -841,6 +1155,7 @@ class SPICoprocessor {
     bool use_handshake_pin_ =
         false;  // Allow handshake pin toggle to be skipped if waiting for a mesage and not writing to master.
 #endif
+    SCStreamReceiver stream_receiver_;  // Windowed writes coming in from the other side.
 };
 
 #ifdef ON_PICO
@@ -6,6 +6,9 @@
 #include "hardware/dma.h"  // for CRC32 calculation
 #include "hardware/flash.h"
 #include "hardware/sync.h"
+#if LIB_PICO_MULTICORE
+#include "pico/multicore.h"
+#endif
 #elif ON_ESP32
 #include "stdint.h"
 #endif
@@ -389,7 +392,15 @@ class FirmwareUpdateManager {
      * Disable interrupts and store them for use in a restore command. Call this for TEMPORARILY disabling interrupts,
      * like during flash operations.
      */
-    static inline void DisableInterrupts(void) { stored_interrupts_ = save_and_disable_interrupts(); }
+    static inline void DisableInterrupts(void) {
+#if LIB_PICO_MULTICORE
+        // Park core 1 in RAM, since it can't execute from XIP flash while flash is being erased or programmed.
+        if (multicore_lockout_victim_is_initialized(1)) {
+            multicore_lockout_start_blocking();
+        }
+#endif
+        stored_interrupts_ = save_and_disable_interrupts();
+    }
 
     /**
      * Permanently disable interrupts, for use before jumping to a new application.
@@ -433,7 +444,14 @@ class FirmwareUpdateManager {
     /**
      * Restore interrupts from stored values. Call this after erasing flash or performing a boot jump.
      */
-    static inline void RestoreInterrupts(void) { restore_interrupts(stored_interrupts_); }
+    static inline void RestoreInterrupts(void) {
+        restore_interrupts(stored_interrupts_);
+#if LIB_PICO_MULTICORE
+        if (multicore_lockout_victim_is_initialized(1)) {
+            multicore_lockout_end_blocking();
+        }
+#endif
+    }
 
     /**
      * Modifies the header status word of a flash partition header by re-writing the full header. Note that not all
@@ -18,6 +18,12 @@ void SettingsManager::Print() {
 #endif
     CONSOLE_PRINTF("\tBias Tee: %s\r\n", settings.bias_tee_enabled ? "ENABLED" : "DISABLED");
     CONSOLE_PRINTF("\tWatchdog Timeout: %lu seconds\r\n", settings.watchdog_timeout_sec);
+    if (settings.receiver_position_valid) {
+        CONSOLE_PRINTF("\tReceiver Position: %.5f, %.5f\r\n", settings.receiver_latitude_deg,
+                       settings.receiver_longitude_deg);
+    } else {
+        CONSOLE_PRINTF("\tReceiver Position: NOT SET\r\n");
+    }
     CONSOLE_PRINTF("\tLog Level: %s\r\n", kConsoleLogLevelStrs[settings.log_level]);
     CONSOLE_PRINTF("\tReporting Protocols:\r\n");
     for (uint16_t i = 0; i < SerialInterface::kGNSSUART; i++) {
@@ -11,7 +11,7 @@
 #include "pico/rand.h"
 #endif
 
-static const uint32_t kSettingsVersion = 0x6;  // Change this when settings format changes!
+static const uint32_t kSettingsVersion = 0x7;  // Change this when settings format changes!
 static const uint32_t kDeviceInfoVersion = 0x2;
 
 class SettingsManager {
@@ -68,6 +68,10 @@ class SettingsManager {
         int tl_mv = kDefaultTLMV;
         bool bias_tee_enabled = false;
         uint32_t watchdog_timeout_sec = kDefaultWatchdogTimeoutSec;
+        // Receiver position, used as the reference for decoding an aircraft's first position from a single CPR packet.
+        bool receiver_position_valid = false;
+        float receiver_latitude_deg = 0.0f;
+        float receiver_longitude_deg = 0.0f;
 
         // CommunicationsManager settings
         LogLevel log_level = LogLevel::kWarnings;
@@ -2,6 +2,10 @@
 
 #include "stdio.h"
 
+#ifdef ON_ESP32
+#include "esp_rom_crc.h"
+#endif
+
 #define BITMASK_32_ALL   0xFFFFFFFF
 #define WORD_32_NUM_BITS 32
 
@@ -93,13 +97,21 @@ void PrintBinary32(uint32_t value) {
  */
 uint16_t swap16(uint16_t value) { return (value << 8) | (value >> 8); }
 
-uint16_t CalculateCRC16(const uint8_t *data_p, int32_t length) {
-    uint8_t x;
-    uint16_t crc = 0xFFFF;
+uint16_t UpdateCRC16(uint16_t crc, const uint8_t *data_p, int32_t length) {
+    if (length <= 0) {
+        return crc;
+    }
+#ifdef ON_ESP32
+    // The ROM routine inverts the CRC on the way in and on the way out.
+    return static_cast<uint16_t>(~esp_rom_crc16_be(static_cast<uint16_t>(~crc), data_p, length));
+#else
     while (length--) {
-        x = crc >> 8 ^ *data_p++;
-        x ^= x >> 4;
-        crc = (crc << 8) ^ ((uint16_t)(x << 12)) ^ ((uint16_t)(x << 5)) ^ ((uint16_t)x);
+        crc = (crc << 8) ^ kCRC16Table[(crc >> 8) ^ *data_p++];
     }
-    return swap16(crc);
+    return crc;
+#endif
+}
+
+uint16_t CalculateCRC16(const uint8_t *data_p, int32_t length) {
+    return swap16(UpdateCRC16(kCRC16Init, data_p, length));
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #ifndef _BUFFER_UTILS_HH_
 #define _BUFFER_UTILS_HH_
 
+#include <array>
 #include <cstdint>
 
 void PrintBinary32(uint32_t);  // for debugging
@@ -9,10 +10,44 @@ uint32_t Get24BitWordFromBuffer(uint32_t first_bit_index, const uint32_t buffer[
 uint32_t GetNBitWordFromBuffer(uint16_t n, uint32_t first_bit_index, const uint32_t buffer[]);
 void SetNBitWordInBuffer(uint16_t n, uint32_t word, uint32_t first_bit_index, uint32_t buffer[]);
 
-// CRC16 is used for inter-processor communication and reporting, not for ADS-B message decode.
+// CRC16 is used for inter-processor communication and reporting, not for ADS-B message decode. It is the CRC-16/CCITT
+// variant (polynomial 0x1021, initial value 0xFFFF, MSb first, no output inversion), which is what the RP2040 DMA
+// sniffer and the ESP32 ROM CRC routines calculate.
+
+static const uint16_t kCRC16Polynomial = 0x1021;
+static const uint16_t kCRC16Init = 0xFFFF;
+
+/**
+ * Builds the byte-wise CRC16 lookup table at compile time. Entry i is the CRC remainder of the byte i shifted through
+ * the polynomial.
+ * @retval Array of 256 16-bit remainders.
+ */
+constexpr std::array<uint16_t, 256> GenerateCRC16Table() {
+    std::array<uint16_t, 256> table = {};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint16_t crc = i << 8;
+        for (uint16_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ kCRC16Polynomial : crc << 1;
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+inline constexpr std::array<uint16_t, 256> kCRC16Table = GenerateCRC16Table();
+
+/**
+ * Runs a 16-bit CRC over more data. Uses the ROM CRC routines on the ESP32 and kCRC16Table everywhere else.
+ * @param[in] crc CRC of the data so far, or kCRC16Init to start a new CRC.
+ * @param[in] data_p Pointer to the buffer to continue the CRC over.
+ * @param[in] length Number of bytes to continue the CRC over.
+ * @retval Running CRC. This is the value held by the CRC hardware, CalculateCRC16() swaps its bytes.
+ */
+uint16_t UpdateCRC16(uint16_t crc, const uint8_t *data_p, int32_t length);
 
 /**
- * Calculates the 16-bit CRC of a buffer.
+ * Calculates the 16-bit CRC of a buffer. Since the CRC is stored MSB first in the buffer, the CRC of a buffer that ends
+ * with its own valid CRC is 0.
  * @param[in] data_p Pointer to the buffer to calculate a CRC for.
  * @param[in] length Number fo bytes to calculate the CRC over.
  * @retval 16-bit CRC.
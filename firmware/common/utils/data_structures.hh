@@ -4,6 +4,7 @@
 #include <stdint.h>
 
 #include <algorithm>  // For std::copy.
+#include <atomic>     // For std::atomic_thread_fence.
 
 template <class T>
 class PFBQueue {
@@ -51,13 +52,14 @@ class PFBQueue {
         if (next_tail == head_) {
             if (config_.overwrite_when_full) {
                 // Overwriting allowed; nudge the head to overwrite the first enqueued element.
-                head_++;
+                head_ = IncrementIndex(head_);
             } else {
                 // Overwriting not allowed; this push will result in an error.
                 return false;
             }
         }
         config_.buffer[tail_] = element;
+        std::atomic_thread_fence(std::memory_order_release);  // Publish the element before the new tail.
         tail_ = next_tail;
         return true;
     }
@@ -71,7 +73,9 @@ class PFBQueue {
         if (head_ == tail_) {
             return false;
         }
+        std::atomic_thread_fence(std::memory_order_acquire);  // Don't read the element before seeing the tail.
         element = config_.buffer[head_];
+        std::atomic_thread_fence(std::memory_order_release);  // Finish reading the element before freeing its slot.
         head_ = IncrementIndex(head_);
         return true;
     }
@@ -131,8 +135,469 @@ class PFBQueue {
     PFBQueueConfig config_;
     bool buffer_was_dynamically_allocated_ = false;
     uint16_t buffer_length_;
-    uint16_t head_ = 0;
-    uint16_t tail_ = 0;
+    // Head is only written by the consumer and tail is only written by the producer (unless overwrite_when_full is
+    // set). Prefer SPSCQueue for queues that are shared between an ISR, cores or tasks.
+    volatile uint16_t head_ = 0;
+    volatile uint16_t tail_ = 0;
+};
+
+/**
+ * Lock-free single producer single consumer ring buffer with a fixed, power-of-two capacity. Safe to share between an
+ * ISR and the main loop, between cores, or between FreeRTOS tasks, as long as only one context pushes and only one
+ * context pops. The producer publishes elements with a release store of the tail, and the consumer frees slots with a
+ * release store of the head. Head and tail are free-running counters that get masked into the buffer, so all
+ * kMaxNumElements slots are usable and Length() is a single subtraction.
+ */
+template <class T, uint16_t kMaxNumElements>
+class SPSCQueue {
+   public:
+    static_assert(kMaxNumElements > 0 && (kMaxNumElements & (kMaxNumElements - 1)) == 0,
+                  "SPSCQueue capacity must be a power of two.");
+    static_assert(kMaxNumElements <= 0x8000, "SPSCQueue capacity must fit in the range of a uint16_t index.");
+
+    /**
+     * Pushes an element onto the back of the queue. Producer only.
+     * @param[in] element Object to copy onto the back of the queue.
+     * @retval True if succeeded, false if the queue is full.
+     */
+    bool Push(const T &element) {
+        uint16_t tail = tail_.load(std::memory_order_relaxed);
+        if (static_cast<uint16_t>(tail - head_.load(std::memory_order_acquire)) == kMaxNumElements) {
+            return false;
+        }
+        buffer_[tail & kIndexMask] = element;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Returns the slot that the next CommitPush() will publish, so that the producer (or a DMA channel set up by the
+     * producer) can build the element in place. The slot stays invisible to the consumer until CommitPush() is called.
+     * Producer only.
+     * @retval Pointer to the next free slot, or nullptr if the queue is full.
+     */
+    T *GetPushSlot() {
+        uint16_t tail = tail_.load(std::memory_order_relaxed);
+        if (static_cast<uint16_t>(tail - head_.load(std::memory_order_acquire)) == kMaxNumElements) {
+            return nullptr;
+        }
+        return &buffer_[tail & kIndexMask];
+    }
+
+    /**
+     * Publishes the element built in the slot returned by GetPushSlot(). Must only be called after a successful
+     * GetPushSlot(). Producer only.
+     */
+    void CommitPush() { tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    /**
+     * Pushes as many elements as will fit onto the back of the queue. Elements are copied in at most two contiguous
+     * spans, and are published to the consumer all at once. Producer only.
+     * @param[in] elements Array of elements to push.
+     * @param[in] num_elements Number of elements in the array.
+     * @retval Number of elements that were pushed.
+     */
+    uint16_t PushN(const T *elements, uint16_t num_elements) {
+        uint16_t tail = tail_.load(std::memory_order_relaxed);
+        uint16_t num_free = kMaxNumElements - static_cast<uint16_t>(tail - head_.load(std::memory_order_acquire));
+        num_elements = std::min(num_elements, num_free);
+        uint16_t start = tail & kIndexMask;
+        uint16_t first_span_len = std::min(num_elements, static_cast<uint16_t>(kMaxNumElements - start));
+        std::copy(elements, elements + first_span_len, buffer_ + start);
+        std::copy(elements + first_span_len, elements + num_elements, buffer_);
+        tail_.store(tail + num_elements, std::memory_order_release);
+        return num_elements;
+    }
+
+    /**
+     * Pops an element from the front of the queue. Consumer only.
+     * @param[out] element Reference to an object that will be overwritten by the contents of the popped element.
+     * @retval True if successful, false if the queue is empty.
+     */
+    bool Pop(T &element) {
+        uint16_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        element = buffer_[head & kIndexMask];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Returns an element in the queue without copying it out, so that the consumer (or a DMA channel set up by the
+     * consumer) can work on it in place. The element stays in the queue until CommitPop() is called. Consumer only.
+     * @param[in] index Position in the queue. Defaults to 0 (the front of the queue).
+     * @retval Pointer to the element, or nullptr if the queue is empty or index is out of bounds.
+     */
+    T *GetPopSlot(uint16_t index = 0) {
+        uint16_t head = head_.load(std::memory_order_relaxed);
+        if (index >= static_cast<uint16_t>(tail_.load(std::memory_order_acquire) - head)) {
+            return nullptr;
+        }
+        return &buffer_[(head + index) & kIndexMask];
+    }
+
+    /**
+     * Removes the element at the front of the queue, handing its slot back to the producer. Must only be called after
+     * a successful GetPopSlot(). Consumer only.
+     */
+    void CommitPop() { head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    /**
+     * Pops up to num_elements elements from the front of the queue, copying them out in at most two contiguous spans.
+     * Consumer only.
+     * @param[out] elements Array to copy popped elements into. Must have room for num_elements elements.
+     * @param[in] num_elements Maximum number of elements to pop.
+     * @retval Number of elements that were popped.
+     */
+    uint16_t PopN(T *elements, uint16_t num_elements) {
+        uint16_t head = head_.load(std::memory_order_relaxed);
+        num_elements = std::min(num_elements, static_cast<uint16_t>(tail_.load(std::memory_order_acquire) - head));
+        uint16_t start = head & kIndexMask;
+        uint16_t first_span_len = std::min(num_elements, static_cast<uint16_t>(kMaxNumElements - start));
+        std::copy(buffer_ + start, buffer_ + start + first_span_len, elements);
+        std::copy(buffer_, buffer_ + (num_elements - first_span_len), elements + first_span_len);
+        head_.store(head + num_elements, std::memory_order_release);
+        return num_elements;
+    }
+
+    /**
+     * Returns the contents of an element in the queue without removing it. Consumer only.
+     * @param[out] element Reference to an object that will be overwritten by the contents of the peeked element.
+     * @param[in] index Position in the queue to peek. Defaults to 0 (the front of the queue).
+     * @retval True if successful, false if the queue is empty or index is out of bounds.
+     */
+    bool Peek(T &element, uint16_t index = 0) {
+        uint16_t head = head_.load(std::memory_order_relaxed);
+        if (index >= static_cast<uint16_t>(tail_.load(std::memory_order_acquire) - head)) {
+            return false;
+        }
+        element = buffer_[(head + index) & kIndexMask];
+        return true;
+    }
+
+    /**
+     * Returns the number of elements currently in the queue. May be called from either side, but the value is only a
+     * lower bound for the consumer and an upper bound for the producer.
+     * @retval Number of elements in the queue.
+     */
+    uint16_t Length() const {
+        return static_cast<uint16_t>(tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire));
+    }
+
+    /**
+     * Return the maximum number of elements that can be stored in the queue.
+     * @retval Number of elements that can be stored in the queue.
+     */
+    static constexpr uint16_t MaxNumElements() { return kMaxNumElements; }
+
+    /**
+     * Empty out the queue by moving the head up to the tail. Consumer only.
+     */
+    void Clear() { head_.store(tail_.load(std::memory_order_acquire), std::memory_order_release); }
+
+   private:
+    static constexpr uint16_t kIndexMask = kMaxNumElements - 1;
+
+    T buffer_[kMaxNumElements];
+    std::atomic<uint16_t> head_ = 0;  // Only written by the consumer.
+    std::atomic<uint16_t> tail_ = 0;  // Only written by the producer.
+};
+
+/**
+ * Fixed capacity hash map with uint32_t keys (e.g. ICAO addresses) that never allocates memory. Values are stored
+ * contiguously in insertion order (with swap-on-erase), so iterating over them is a walk over a flat array. Lookups go
+ * through an open-addressing index with linear probing and backward shift deletion, which keeps insert, lookup, and
+ * erase O(1) without tombstones.
+ */
+template <class T, uint16_t kMaxNumElements>
+class StaticHashMap {
+   public:
+    /**
+     * Returns the number of bits needed to address the smallest power of two number of index slots that is at least
+     * twice the capacity, so that the index load factor stays at or below 50%.
+     */
+    static constexpr uint16_t CalculateNumIndexSlotBits() {
+        uint16_t num_bits = 1;
+        while ((1u << num_bits) < 2u * kMaxNumElements) {
+            num_bits++;
+        }
+        return num_bits;
+    }
+
+    static constexpr uint16_t kNumIndexSlotBits = CalculateNumIndexSlotBits();
+    static constexpr uint16_t kNumIndexSlots = 1u << kNumIndexSlotBits;
+    static constexpr uint16_t kIndexSlotMask = kNumIndexSlots - 1;
+    static constexpr uint16_t kEmptyIndexSlot = UINT16_MAX;
+    static_assert(kMaxNumElements > 0 && kNumIndexSlotBits < 16);
+
+    StaticHashMap() { Clear(); }
+
+    /**
+     * Removes all elements from the map.
+     */
+    void Clear() {
+        for (uint16_t i = 0; i < kNumIndexSlots; i++) {
+            index_[i] = kEmptyIndexSlot;
+        }
+        num_elements_ = 0;
+    }
+
+    /**
+     * Looks up an element by key.
+     * @param[in] key Key to look up.
+     * @retval Pointer to the element, or nullptr if the key is not in the map.
+     */
+    T *Find(uint32_t key) {
+        uint16_t slot = FindIndexSlot(key);
+        return slot == kEmptyIndexSlot ? nullptr : &values_[index_[slot]];
+    }
+    const T *Find(uint32_t key) const {
+        uint16_t slot = FindIndexSlot(key);
+        return slot == kEmptyIndexSlot ? nullptr : &values_[index_[slot]];
+    }
+
+    bool Contains(uint32_t key) const { return FindIndexSlot(key) != kEmptyIndexSlot; }
+
+    /**
+     * Inserts an element, or overwrites the existing element with the same key.
+     * @param[in] key Key to insert.
+     * @param[in] value Value to copy into the map.
+     * @retval Pointer to the element in the map, or nullptr if the key was new and the map is full.
+     */
+    T *Insert(uint32_t key, const T &value) {
+        uint16_t slot = Hash(key);
+        for (; index_[slot] != kEmptyIndexSlot; slot = (slot + 1) & kIndexSlotMask) {
+            if (keys_[index_[slot]] == key) {
+                values_[index_[slot]] = value;
+                return &values_[index_[slot]];
+            }
+        }
+        if (num_elements_ >= kMaxNumElements) {
+            return nullptr;
+        }
+        // Slot is the first empty slot in the probe sequence.
+        index_[slot] = num_elements_;
+        keys_[num_elements_] = key;
+        values_[num_elements_] = value;
+        return &values_[num_elements_++];
+    }
+
+    /**
+     * Removes an element by key.
+     * @param[in] key Key of the element to remove.
+     * @retval True if the element was removed, false if the key was not in the map.
+     */
+    bool Erase(uint32_t key) {
+        uint16_t slot = FindIndexSlot(key);
+        if (slot == kEmptyIndexSlot) {
+            return false;
+        }
+        EraseAt(slot);
+        return true;
+    }
+
+    /**
+     * Removes the element pointed to by an iterator. The last element is moved into its place, so the returned
+     * iterator points at an element that has not been visited yet. Use as it = map.Erase(it) while iterating.
+     * @param[in] it Iterator to the element to remove. Must be between begin() and end().
+     * @retval Iterator to the element that took the place of the removed element.
+     */
+    T *Erase(T *it) {
+        EraseAt(FindIndexSlot(keys_[it - values_]));
+        return it;
+    }
+
+    /**
+     * Returns the key of an element in the map.
+     * @param[in] it Iterator to the element. Must be between begin() and end().
+     * @retval Key of the element.
+     */
+    uint32_t GetKey(const T *it) const { return keys_[it - values_]; }
+
+    /**
+     * Returns the position of an element in the dense value array. Useful for keeping parallel arrays of data that
+     * follow the same layout: Insert() appends at Size() - 1, and Erase() moves the last element into the erased
+     * element's position.
+     * @param[in] it Iterator to the element. Must be between begin() and end().
+     * @retval Index of the element, between 0 and Size() - 1.
+     */
+    uint16_t GetIndex(const T *it) const { return it - values_; }
+
+    uint16_t Size() const { return num_elements_; }
+    uint16_t MaxSize() const { return kMaxNumElements; }
+
+    // Iteration over values, with no guaranteed order.
+    T *begin() { return values_; }
+    T *end() { return values_ + num_elements_; }
+    const T *begin() const { return values_; }
+    const T *end() const { return values_ + num_elements_; }
+
+   private:
+    /**
+     * Fibonacci hash. Scatters sequential ICAO addresses (common within an airline's fleet) across the index.
+     */
+    static inline uint16_t Hash(uint32_t key) { return (key * 2654435769u) >> (32 - kNumIndexSlotBits); }
+
+    /**
+     * Returns the index slot that refers to a key, or kEmptyIndexSlot if the key is not in the map.
+     */
+    uint16_t FindIndexSlot(uint32_t key) const {
+        for (uint16_t slot = Hash(key); index_[slot] != kEmptyIndexSlot; slot = (slot + 1) & kIndexSlotMask) {
+            if (keys_[index_[slot]] == key) {
+                return slot;
+            }
+        }
+        return kEmptyIndexSlot;
+    }
+
+    /**
+     * Removes the element referred to by an index slot, then moves the last element into the freed value position.
+     */
+    void EraseAt(uint16_t slot) {
+        uint16_t value_index = index_[slot];
+
+        // Backward shift deletion: pull later entries in the probe sequence into the hole if that doesn't move them
+        // ahead of their home slot.
+        uint16_t hole = slot;
+        for (uint16_t next = (hole + 1) & kIndexSlotMask; index_[next] != kEmptyIndexSlot;
+             next = (next + 1) & kIndexSlotMask) {
+            uint16_t home = Hash(keys_[index_[next]]);
+            if (((next - home) & kIndexSlotMask) >= ((next - hole) & kIndexSlotMask)) {
+                index_[hole] = index_[next];
+                hole = next;
+            }
+        }
+        index_[hole] = kEmptyIndexSlot;
+
+        // Keep values contiguous by moving the last value into the gap.
+        uint16_t last_value_index = --num_elements_;
+        if (value_index != last_value_index) {
+            index_[FindIndexSlot(keys_[last_value_index])] = value_index;
+            keys_[value_index] = keys_[last_value_index];
+            values_[value_index] = values_[last_value_index];
+        }
+    }
+
+    uint16_t index_[kNumIndexSlots];  // Open addressing index into keys_ and values_.
+    uint32_t keys_[kMaxNumElements];  // Dense array of keys, in the same order as values_.
+    T values_[kMaxNumElements];       // Dense array of values.
+    uint16_t num_elements_ = 0;
+};
+
+/**
+ * Fixed capacity doubly linked list of element indices, ordered from least to most recently used. Meant to sit
+ * alongside the dense value array of a StaticHashMap (indexed with StaticHashMap::GetIndex()) so that the oldest
+ * elements can be found without scanning the whole map. Links are stored in flat arrays, so the list never allocates.
+ */
+template <uint16_t kMaxNumElements>
+class StaticLRUList {
+   public:
+    static constexpr uint16_t kInvalidIndex = UINT16_MAX;
+    static_assert(kMaxNumElements < kInvalidIndex);
+
+    StaticLRUList() { Clear(); }
+
+    /**
+     * Removes all indices from the list.
+     */
+    void Clear() {
+        oldest_ = kInvalidIndex;
+        newest_ = kInvalidIndex;
+    }
+
+    /**
+     * Returns the least recently used index, or kInvalidIndex if the list is empty.
+     */
+    uint16_t GetOldest() const { return oldest_; }
+
+    /**
+     * Returns the most recently used index, or kInvalidIndex if the list is empty.
+     */
+    uint16_t GetNewest() const { return newest_; }
+
+    /**
+     * Returns the index that was used just before the one provided, or kInvalidIndex if index is the oldest.
+     */
+    uint16_t GetOlder(uint16_t index) const { return older_[index]; }
+
+    /**
+     * Returns the index that was used just after the one provided, or kInvalidIndex if index is the newest.
+     */
+    uint16_t GetNewer(uint16_t index) const { return newer_[index]; }
+
+    /**
+     * Adds an index that is not in the list as the most recently used.
+     * @param[in] index Index to add.
+     */
+    void PushNewest(uint16_t index) { InsertNewerThan(newest_, index); }
+
+    /**
+     * Adds an index that is not in the list as the least recently used.
+     * @param[in] index Index to add.
+     */
+    void PushOldest(uint16_t index) { InsertNewerThan(kInvalidIndex, index); }
+
+    /**
+     * Adds an index that is not in the list directly after another index.
+     * @param[in] older_index Index that is already in the list, or kInvalidIndex to add index as the oldest.
+     * @param[in] index Index to add.
+     */
+    void InsertNewerThan(uint16_t older_index, uint16_t index) {
+        uint16_t newer_index = older_index == kInvalidIndex ? oldest_ : newer_[older_index];
+        older_[index] = older_index;
+        newer_[index] = newer_index;
+        older_index == kInvalidIndex ? oldest_ = index : newer_[older_index] = index;
+        newer_index == kInvalidIndex ? newest_ = index : older_[newer_index] = index;
+    }
+
+    /**
+     * Marks an index that is already in the list as the most recently used.
+     * @param[in] index Index to move.
+     */
+    void MoveToNewest(uint16_t index) {
+        if (index == newest_) {
+            return;
+        }
+        Remove(index);
+        PushNewest(index);
+    }
+
+    /**
+     * Removes an index from the list.
+     * @param[in] index Index to remove. Must be in the list.
+     */
+    void Remove(uint16_t index) {
+        uint16_t older_index = older_[index];
+        uint16_t newer_index = newer_[index];
+        older_index == kInvalidIndex ? oldest_ = newer_index : newer_[older_index] = newer_index;
+        newer_index == kInvalidIndex ? newest_ = older_index : older_[newer_index] = older_index;
+    }
+
+    /**
+     * Changes the index of an entry while keeping its position in the list. Used to follow an element that gets
+     * moved in its container, e.g. by the swap-on-erase in StaticHashMap.
+     * @param[in] from Index of the entry in the list.
+     * @param[in] to New index for the entry. Must not be in the list.
+     */
+    void Relocate(uint16_t from, uint16_t to) {
+        if (from == to) {
+            return;
+        }
+        uint16_t older_index = older_[from];
+        uint16_t newer_index = newer_[from];
+        older_[to] = older_index;
+        newer_[to] = newer_index;
+        older_index == kInvalidIndex ? oldest_ = to : newer_[older_index] = to;
+        newer_index == kInvalidIndex ? newest_ = to : older_[newer_index] = to;
+    }
+
+   private:
+    uint16_t older_[kMaxNumElements];
+    uint16_t newer_[kMaxNumElements];
+    uint16_t oldest_ = kInvalidIndex;
+    uint16_t newest_ = kInvalidIndex;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include "deferred_log.hh"
+
+#include <cstdio>
+
+#include "macros.hh"
+
+DeferredLog deferred_log;
+
+bool DeferredLog::Pop(Entry &entry) {
+    for (uint16_t i = 0; i < kNumProducers; i++) {
+        uint16_t producer = next_pop_producer_;
+        next_pop_producer_ = (next_pop_producer_ + 1) % kNumProducers;
+        if (queues_[producer].Pop(entry)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t DeferredLog::GetNumDroppedEntries() const {
+    uint32_t num_dropped_entries = 0;
+    for (uint16_t i = 0; i < kNumProducers; i++) {
+        num_dropped_entries += num_dropped_entries_[i];
+    }
+    return num_dropped_entries;
+}
+
+uint16_t DeferredLog::Format(const Entry &entry, char *buf, uint16_t buf_len) {
+    if (buf_len == 0) {
+        return 0;
+    }
+    uint16_t chars_written = 0;
+    uint16_t arg_index = 0;
+    const char *c = entry.format;
+    while (c != nullptr && *c != '\0' && chars_written < buf_len - 1) {
+        if (*c != '%') {
+            buf[chars_written++] = *c++;
+            continue;
+        }
+
+        // Copy out the conversion spec: %, flags, width, precision, length modifier, then the conversion itself.
+        char spec[kConversionSpecMaxLen];
+        uint16_t spec_len = 0;
+        spec[spec_len++] = *c++;
+        while (*c != '\0' && strchr("-+ #0123456789.hlzjt", *c) != nullptr && spec_len < kConversionSpecMaxLen - 2) {
+            spec[spec_len++] = *c++;
+        }
+        if (*c == '\0') {
+            break;  // Format string ended partway through a conversion spec.
+        }
+        char conversion = *c++;
+        spec[spec_len++] = conversion;
+        spec[spec_len] = '\0';
+
+        int res;
+        if (conversion == '%') {
+            res = snprintf(buf + chars_written, buf_len - chars_written, "%%");
+        } else if (arg_index >= entry.num_args || conversion == 's' || conversion == 'n') {
+            res = snprintf(buf + chars_written, buf_len - chars_written, "<?>");
+            arg_index++;
+        } else {
+            res = FormatArg(buf + chars_written, buf_len - chars_written, spec, entry, arg_index++);
+        }
+        if (res < 0) {
+            break;
+        }
+        chars_written = MIN(chars_written + res, buf_len - 1);  // snprintf returns the length it wanted.
+    }
+    buf[chars_written] = '\0';
+    return chars_written;
+}
+
+int DeferredLog::FormatArg(char *buf, uint16_t buf_len, const char *spec, const Entry &entry, uint16_t arg_index) {
+    uint64_t value = entry.args[arg_index];
+    bool is_float_arg = entry.float_arg_mask & (1 << arg_index);
+    uint16_t spec_len = strlen(spec);
+    char conversion = spec[spec_len - 1];
+    // Integer length modifier sits right before the conversion. Only "l" and "ll" change the argument width on our
+    // platforms; "h", "hh", "z", "j", and "t" are either promoted to int or the same width as long.
+    uint16_t num_l = 0;
+    for (int16_t i = spec_len - 2; i >= 0 && spec[i] == 'l'; i--) {
+        num_l++;
+    }
+
+    switch (conversion) {
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A': {
+            double float_value;
+            if (is_float_arg) {
+                memcpy(&float_value, &value, sizeof(float_value));
+            } else {
+                float_value = static_cast<double>(static_cast<int64_t>(value));
+            }
+            return snprintf(buf, buf_len, spec, float_value);
+        }
+        case 'p':
+            return snprintf(buf, buf_len, spec, reinterpret_cast<void *>(static_cast<uintptr_t>(value)));
+        default:
+            break;
+    }
+
+    // Integer conversions.
+    if (is_float_arg) {
+        double float_value;
+        memcpy(&float_value, &value, sizeof(float_value));
+        value = static_cast<uint64_t>(static_cast<int64_t>(float_value));
+    }
+    bool is_signed = conversion == 'd' || conversion == 'i' || conversion == 'c';
+    if (num_l >= 2) {
+        return is_signed ? snprintf(buf, buf_len, spec, static_cast<long long>(value))
+                         : snprintf(buf, buf_len, spec, static_cast<unsigned long long>(value));
+    } else if (num_l == 1) {
+        return is_signed ? snprintf(buf, buf_len, spec, static_cast<long>(value))
+                         : snprintf(buf, buf_len, spec, static_cast<unsigned long>(value));
+    }
+    return is_signed ? snprintf(buf, buf_len, spec, static_cast<int>(value))
+                     : snprintf(buf, buf_len, spec, static_cast<unsigned int>(value));
+}
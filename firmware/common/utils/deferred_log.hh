@@ -0,0 +1,182 @@
+#ifndef DEFERRED_LOG_HH_
+#define DEFERRED_LOG_HH_
+
+#include <cstring>
+#include <type_traits>
+
+#include "data_structures.hh"  // For SPSCQueue.
+#include "stdint.h"
+#ifdef ON_PICO
+#include "hardware/sync.h"
+#include "pico/platform.h"  // For get_core_num().
+#endif
+
+/**
+ * Lock-free ring of log messages that get formatted later. Log() only stores the format string pointer and the raw
+ * argument values, so logging from a hot path costs a copy instead of a printf. Entries are formatted with Format()
+ * from a low priority context, e.g. the main loop.
+ *
+ * Each RP2040 core pushes to its own SPSCQueue, with interrupts masked for the duration of the push so that ISRs can
+ * log too. Other platforms have a single producer.
+ *
+ * Format strings must outlive the entry (string literals are fine). String arguments can't be deferred, since the
+ * buffer they point to may be gone by the time the entry is formatted, and are rejected at compile time.
+ */
+class DeferredLog {
+   public:
+    static const uint16_t kMaxNumArgs = 8;
+    static const uint16_t kQueueDepth = 32;  // Per producer, must be a power of two (SPSCQueue).
+#ifdef ON_PICO
+    static const uint16_t kNumProducers = 2;  // One per core.
+#else
+    static const uint16_t kNumProducers = 1;
+#endif
+
+   private:
+    template <typename T>
+    static constexpr bool IsString() {
+        using Decayed = std::decay_t<T>;
+        return std::is_pointer_v<Decayed> && std::is_same_v<std::remove_cv_t<std::remove_pointer_t<Decayed>>, char>;
+    }
+
+    // Fails to compile if a message with these argument types can't be deferred.
+    template <typename... Args>
+    struct ArgCheck {
+        static_assert(sizeof...(Args) <= kMaxNumArgs, "Too many arguments for a deferred log message.");
+        static_assert((!IsString<Args>() && ...),
+                      "String arguments can't be deferred, since they may not exist by the time they're printed.");
+    };
+
+   public:
+    struct Entry {
+        const char *format = nullptr;
+        uint8_t level = 0;
+        uint8_t num_args = 0;
+        uint8_t float_arg_mask = 0;  // Bit i is set if args[i] holds the bits of a double.
+        // Integers are sign extended to 64 bits, pointers are zero extended.
+        uint64_t args[kMaxNumArgs] = {0};
+    };
+
+    /**
+     * Stores a log message to be formatted later.
+     * @param[in] level Log level of the message, for filtering when it gets printed.
+     * @param[in] format printf style format string. Must have static storage duration.
+     * @param[in] args Arguments for the format string. Numbers and non-string pointers only.
+     * @retval True if the message was stored, false if the ring was full and the message was dropped.
+     */
+    template <typename... Args>
+    bool Log(uint8_t level, const char *format, Args... args) {
+        static_assert(sizeof(ArgCheck<Args...>) > 0);  // Instantiates the argument checks.
+        Entry entry;
+        entry.format = format;
+        entry.level = level;
+        entry.num_args = sizeof...(Args);
+        uint16_t arg_index = 0;
+        (StoreArg(entry, arg_index++, args), ...);
+        (void)arg_index;  // Unused when there are no arguments.
+        return Push(entry);
+    }
+
+    /**
+     * Checks the arguments of a deferred log message at compile time, the same way Log() does. Only declared, for use
+     * in an unevaluated context by CONSOLE_*_DEFERRED, so that arguments are checked on targets that print deferred
+     * messages right away too.
+     * @param[in] args Arguments for the format string.
+     * @retval Type that fails to compile if the arguments can't be deferred.
+     */
+    template <typename... Args>
+    static ArgCheck<Args...> CheckArgs(Args... args);
+
+    /**
+     * Pops the next entry to format. Producers are drained round robin, so entries from different producers may be
+     * popped out of order.
+     * @param[out] entry Entry that was popped.
+     * @retval True if an entry was popped, false if all queues were empty.
+     */
+    bool Pop(Entry &entry);
+
+    /**
+     * Returns the total number of messages dropped because the ring was full.
+     */
+    uint32_t GetNumDroppedEntries() const;
+
+    /**
+     * Formats an entry into a buffer. Supports the integer, floating point, character, and pointer conversions of
+     * printf along with their flags, width, precision, and length modifiers. Conversions without a matching argument
+     * and string conversions print as "<?>".
+     * @param[in] entry Entry to format.
+     * @param[out] buf Buffer to write the null terminated message to.
+     * @param[in] buf_len Length of buf, including the null terminator. Longer messages are truncated.
+     * @retval Number of characters written, not including the null terminator.
+     */
+    static uint16_t Format(const Entry &entry, char *buf, uint16_t buf_len);
+
+   private:
+    static const uint16_t kConversionSpecMaxLen = 16;  // Includes null terminator.
+
+    template <typename T>
+    static inline void StoreArg(Entry &entry, uint16_t arg_index, T arg) {
+        if constexpr (std::is_floating_point_v<T>) {
+            double value = arg;
+            memcpy(&entry.args[arg_index], &value, sizeof(value));
+            entry.float_arg_mask |= 1 << arg_index;
+        } else if constexpr (std::is_pointer_v<T>) {
+            entry.args[arg_index] = reinterpret_cast<uintptr_t>(arg);
+        } else if constexpr (std::is_signed_v<T>) {
+            entry.args[arg_index] = static_cast<uint64_t>(static_cast<int64_t>(arg));
+        } else {
+            entry.args[arg_index] = static_cast<uint64_t>(arg);
+        }
+    }
+
+    /**
+     * Formats a single argument with a conversion spec copied out of a format string.
+     * @param[out] buf Buffer to write to.
+     * @param[in] buf_len Length of buf, including the null terminator.
+     * @param[in] spec Null terminated conversion spec, e.g. "%08lx".
+     * @param[in] entry Entry holding the argument.
+     * @param[in] arg_index Index of the argument in the entry.
+     * @retval Return value of snprintf.
+     */
+    static int FormatArg(char *buf, uint16_t buf_len, const char *spec, const Entry &entry, uint16_t arg_index);
+
+    inline bool Push(const Entry &entry) {
+#ifdef ON_PICO
+        uint16_t producer = get_core_num();
+        uint32_t interrupts = save_and_disable_interrupts();
+#else
+        uint16_t producer = 0;
+#endif
+        bool pushed = queues_[producer].Push(entry);
+        if (!pushed) {
+            num_dropped_entries_[producer]++;
+        }
+#ifdef ON_PICO
+        restore_interrupts(interrupts);
+#endif
+        return pushed;
+    }
+
+    SPSCQueue<Entry, kQueueDepth> queues_[kNumProducers];
+    uint32_t num_dropped_entries_[kNumProducers] = {0};
+    uint16_t next_pop_producer_ = 0;
+};
+
+extern DeferredLog deferred_log;
+
+// CONSOLE_*_DEFERRED are shared by all targets, so that their arguments are checked the same way whether a target
+// defers messages or prints them right away. Each target's comms.hh supplies the sinks,
+// CONSOLE_INFO_DEFERRED_SINK(tag, format, ...) and its WARNING and ERROR counterparts.
+#define CONSOLE_DEFERRED(sink, tag, format, ...)                        \
+    do {                                                                \
+        static_assert(sizeof(DeferredLog::CheckArgs(__VA_ARGS__)) > 0); \
+        sink(tag, format __VA_OPT__(, ) __VA_ARGS__);                   \
+    } while (0)
+#define CONSOLE_INFO_DEFERRED(tag, format, ...) \
+    CONSOLE_DEFERRED(CONSOLE_INFO_DEFERRED_SINK, tag, format __VA_OPT__(, ) __VA_ARGS__)
+#define CONSOLE_WARNING_DEFERRED(tag, format, ...) \
+    CONSOLE_DEFERRED(CONSOLE_WARNING_DEFERRED_SINK, tag, format __VA_OPT__(, ) __VA_ARGS__)
+#define CONSOLE_ERROR_DEFERRED(tag, format, ...) \
+    CONSOLE_DEFERRED(CONSOLE_ERROR_DEFERRED_SINK, tag, format __VA_OPT__(, ) __VA_ARGS__)
+
+#endif /* DEFERRED_LOG_HH_ */
@@ -12,6 +12,7 @@
 #else
 #include "hal_god_powers.hh"
 extern uint64_t time_since_boot_us;
+extern uint32_t time_since_boot_us_per_read;
 #endif
 
 inline uint64_t get_time_since_boot_us() {
@@ -20,6 +21,9 @@ inline uint64_t get_time_since_boot_us() {
 #elif ON_ESP32
     return esp_timer_get_time();
 #else
+    if (time_since_boot_us_per_read > 0) {
+        time_since_boot_us += time_since_boot_us_per_read;
+    }
     return time_since_boot_us;
 #endif
 }
@@ -29,7 +33,7 @@ inline uint32_t get_time_since_boot_ms() {
 #elif ON_ESP32
     return xTaskGetTickCount() * portTICK_PERIOD_MS;
 #else
-    return time_since_boot_us / 1e3;
+    return get_time_since_boot_us() / 1e3;
 #endif
 }
 
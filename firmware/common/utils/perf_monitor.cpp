@@ -0,0 +1,68 @@
+#include "perf_monitor.hh"
+
+#include "json_utils.hh"
+#include "macros.hh"
+#include "string.h"
+
+PerfMonitor perf_monitor;
+
+const char PerfMonitor::kStageStrs[PerfMonitor::Stage::kNumStages][PerfMonitor::kStageStrMaxLen + 1] = {
+    "DEMOD_ISR", "QUEUE_POP", "CRC", "INGEST", "REPORTING", "SPI_WRITE", "USB_CONSOLE", "MAIN_LOOP", "DECODE_LOOP"};
+const char PerfMonitor::kQueueStrs[PerfMonitor::Queue::kNumQueues][PerfMonitor::kQueueStrMaxLen + 1] = {
+    "DEMOD_PACKETS", "REPORTING_PACKETS"};
+
+uint16_t PerfMonitor::Stats::ToJSON(char *buf, uint16_t buf_len) const {
+    uint16_t chars_written = snprintf(buf, buf_len, "{ \"cycles_per_us\": %lu, \"stages\": { ", cycles_per_us);
+    for (uint16_t i = 0; i < kNumStages && chars_written < buf_len; i++) {
+        const StageStats &stage = stages[i];
+        chars_written += snprintf(buf + chars_written, buf_len - chars_written,
+                                  "\"%s\": { \"num\": %lu, \"min\": %lu, \"mean\": %lu, \"max\": %lu, ", kStageStrs[i],
+                                  stage.num_samples, stage.num_samples > 0 ? stage.min_cycles : 0,
+                                  stage.GetMeanCycles(), stage.max_cycles);
+        if (chars_written >= buf_len) {
+            break;
+        }
+        chars_written += ArrayToJSON(buf + chars_written, buf_len - chars_written, "histogram", stage.histogram, "%lu");
+        if (chars_written >= buf_len) {
+            break;
+        }
+        chars_written +=
+            snprintf(buf + chars_written, buf_len - chars_written, "}%s", i < kNumStages - 1 ? ", " : " ");
+    }
+    if (chars_written < buf_len) {
+        chars_written += snprintf(buf + chars_written, buf_len - chars_written, "}, \"queues\": { ");
+    }
+    for (uint16_t i = 0; i < kNumQueues && chars_written < buf_len; i++) {
+        chars_written += snprintf(buf + chars_written, buf_len - chars_written,
+                                  "\"%s\": { \"high_water_mark\": %u, \"drops\": %lu }%s", kQueueStrs[i],
+                                  queues[i].high_water_mark, queues[i].num_drops, i < kNumQueues - 1 ? ", " : " ");
+    }
+    if (chars_written < buf_len) {
+        chars_written += snprintf(buf + chars_written, buf_len - chars_written, "} }");
+    }
+    return MIN(chars_written, buf_len - 1);  // snprintf returns the length it wanted, not what it wrote.
+}
+
+uint16_t PerfMonitor::GetHistogramBin(uint32_t cycles) {
+    uint16_t bin = 0;
+    for (uint32_t bin_end_cycles = 1u << kHistogramBin1MinCyclesLog2;
+         cycles >= bin_end_cycles && bin < kNumHistogramBins - 1; bin_end_cycles <<= 1) {
+        bin++;
+    }
+    return bin;
+}
+
+void PerfMonitor::RecordStage(Stage stage, uint32_t cycles) {
+    StageStats &stage_stats = stats_.stages[stage];
+    stage_stats.num_samples++;
+    stage_stats.min_cycles = MIN(stage_stats.min_cycles, cycles);
+    stage_stats.max_cycles = MAX(stage_stats.max_cycles, cycles);
+    stage_stats.sum_cycles += cycles;
+    stage_stats.histogram[GetHistogramBin(cycles)]++;
+}
+
+void PerfMonitor::Reset() {
+    uint32_t cycles_per_us = stats_.cycles_per_us;
+    stats_ = Stats();
+    stats_.cycles_per_us = cycles_per_us;
+}
@@ -0,0 +1,232 @@
+#ifndef PERF_MONITOR_HH_
+#define PERF_MONITOR_HH_
+
+#include "hal.hh"
+#include "stdint.h"
+#include "stdio.h"
+#ifdef ON_PICO
+#include "hardware/clocks.h"
+#include "hardware/structs/systick.h"
+#elif ON_ESP32
+#include "esp_cpu.h"
+#endif
+
+// Probes are compiled in by default. Build with ADSBEE_PERF_PROBES_ENABLED=0 to compile PERF_PROBE() and the queue
+// recording macros down to nothing.
+#ifndef ADSBEE_PERF_PROBES_ENABLED
+#define ADSBEE_PERF_PROBES_ENABLED 1
+#endif
+
+/**
+ * Collects cycle count statistics for named stages of the receive pipeline, along with high water marks and drop
+ * counters for the queues between them. Each stage and each queue is expected to be recorded from a single context
+ * (one core, or one ISR), so recording doesn't need any locks. Readers may see a partially updated stage, which is
+ * fine for statistics.
+ */
+class PerfMonitor {
+   public:
+    static const uint16_t kNumHistogramBins = 16;
+    // Bin 0 holds durations shorter than 2^kHistogramBin1MinCyclesLog2 cycles, and each subsequent bin spans a factor
+    // of two. The last bin has no upper bound.
+    static const uint16_t kHistogramBin1MinCyclesLog2 = 6;
+    static const uint16_t kStatsJSONMaxLen = 3000;  // Includes null terminator.
+    static const uint16_t kStageStrMaxLen = 20;
+    static const uint16_t kQueueStrMaxLen = 20;
+
+    enum Stage : uint16_t {
+        kStageDemodISR = 0,         // ADSBee::OnDemodComplete().
+        kStageQueuePop,             // Popping a packet from a demodulator packet queue.
+        kStageCRC,                  // CRC check and bit error correction while decoding a packet.
+        kStageIngest,               // Aircraft dictionary ingest, including time spent waiting on its mutex.
+        kStageReporting,            // CommsManager::UpdateReporting(), including the raw packet SPI write.
+        kStageSPICoprocessorWrite,  // SPICoprocessor::Write() to the coprocessor, including retries.
+        kStageUSBConsole,           // Servicing the USB console and AT commands.
+        kStageMainLoop,             // One iteration of the main loop.
+        kStageDecodeLoop,           // One iteration of the decode loop (core 1 when multicore decode is enabled).
+        kNumStages
+    };
+    static const char kStageStrs[kNumStages][kStageStrMaxLen + 1];
+
+    enum Queue : uint16_t {
+        kQueueDemodPackets = 0,            // Demodulator packet queues, combined.
+        kQueueTransponderPacketReporting,  // CommsManager::transponder_packet_reporting_queue.
+        kNumQueues
+    };
+    static const char kQueueStrs[kNumQueues][kQueueStrMaxLen + 1];
+
+    struct StageStats {
+        uint32_t num_samples = 0;
+        uint32_t min_cycles = UINT32_MAX;
+        uint32_t max_cycles = 0;
+        uint64_t sum_cycles = 0;
+        uint32_t histogram[kNumHistogramBins] = {0};
+
+        inline uint32_t GetMeanCycles() const { return num_samples > 0 ? sum_cycles / num_samples : 0; }
+    };
+
+    struct QueueStats {
+        uint16_t high_water_mark = 0;
+        uint32_t num_drops = 0;
+    };
+
+    /**
+     * Everything the PerfMonitor records. Plain data, so it can be copied over the coprocessor SPI link.
+     */
+    struct Stats {
+        uint32_t cycles_per_us = 1;  // For converting cycle counts to time.
+        StageStats stages[kNumStages];
+        QueueStats queues[kNumQueues];
+
+        /**
+         * Formats the stats into a JSON string with the following structure. Durations are in cycles.
+         * {
+         *   "cycles_per_us": 125,
+         *   "stages": {
+         *     "DEMOD_ISR": { "num": 10, "min": 800, "mean": 900, "max": 1200, "histogram": [0, 0, 0, 0, 8, 2, ...] },
+         *     ...
+         *   },
+         *   "queues": {
+         *     "DEMOD_PACKETS": { "high_water_mark": 3, "drops": 0 },
+         *     ...
+         *   }
+         * }
+         * @param[in] buf Buffer to write the JSON string to.
+         * @param[in] buf_len Length of the buffer, including the null terminator.
+         * @retval Number of characters written, not including the null terminator.
+         */
+        uint16_t ToJSON(char *buf, uint16_t buf_len) const;
+    };
+
+    /**
+     * Returns the index of the histogram bin that a duration falls into.
+     * @param[in] cycles Duration, in cycles.
+     * @retval Histogram bin index.
+     */
+    static uint16_t GetHistogramBin(uint32_t cycles);
+
+    /**
+     * Returns the smallest duration that lands in a given histogram bin.
+     * @param[in] bin Histogram bin index.
+     * @retval Lower bound of the bin, in cycles.
+     */
+    static inline uint32_t GetHistogramBinMinCycles(uint16_t bin) {
+        return bin == 0 ? 0 : 1u << (kHistogramBin1MinCyclesLog2 + bin - 1);
+    }
+
+    /**
+     * Reads the cycle counter of the calling core. On the RP2040 this is the core's 24-bit SysTick counter, which
+     * counts down. Use GetCyclesSince() to turn a reading into a duration.
+     * @retval Raw cycle counter value.
+     */
+    static inline uint32_t ReadCycleCounter() {
+#ifdef ON_PICO
+        return systick_hw->cvr;
+#elif ON_ESP32
+        return esp_cpu_get_cycle_count();
+#else
+        return static_cast<uint32_t>(get_time_since_boot_us());  // One "cycle" per microsecond on host.
+#endif
+    }
+
+    /**
+     * Returns the number of cycles elapsed since a pair of readings taken with ReadCycleCounter() and
+     * get_time_since_boot_us(). The microsecond timestamp covers intervals that are too long for the cycle counter.
+     * @param[in] start_cycles Cycle counter value at the start of the interval.
+     * @param[in] start_us Microsecond timestamp at the start of the interval.
+     * @retval Cycles elapsed, saturated at UINT32_MAX.
+     */
+    static inline uint32_t GetCyclesSince(uint32_t start_cycles, uint32_t start_us) {
+#ifdef ON_PICO
+        // SysTick wraps every 2^24 cycles (134ms at 125MHz). Fall back to the microsecond timer well before then.
+        static const uint32_t kSysTickMaxIntervalUs = 100000;
+        uint32_t elapsed_cycles = (start_cycles - systick_hw->cvr) & 0xFFFFFF;
+        uint32_t elapsed_us = static_cast<uint32_t>(get_time_since_boot_us()) - start_us;
+        if (elapsed_us > kSysTickMaxIntervalUs) {
+            uint64_t elapsed_cycles_from_us = static_cast<uint64_t>(elapsed_us) * (clock_get_hz(clk_sys) / 1000000);
+            return elapsed_cycles_from_us > UINT32_MAX ? UINT32_MAX : elapsed_cycles_from_us;
+        }
+        return elapsed_cycles;
+#else
+        (void)start_us;
+        return ReadCycleCounter() - start_cycles;
+#endif
+    }
+
+    /**
+     * Sets the conversion factor between cycles and microseconds reported alongside the stats.
+     * @param[in] cycles_per_us Cycles per microsecond of the counter used by ReadCycleCounter().
+     */
+    void SetCyclesPerUs(uint32_t cycles_per_us) { stats_.cycles_per_us = cycles_per_us; }
+
+    /**
+     * Adds a duration sample to a stage.
+     * @param[in] stage Stage that was timed.
+     * @param[in] cycles Duration of the stage, in cycles.
+     */
+    void RecordStage(Stage stage, uint32_t cycles);
+
+    /**
+     * Updates the high water mark of a queue.
+     * @param[in] queue Queue that was just pushed to.
+     * @param[in] length Length of the queue after the push.
+     */
+    inline void RecordQueueLength(Queue queue, uint16_t length) {
+        if (length > stats_.queues[queue].high_water_mark) {
+            stats_.queues[queue].high_water_mark = length;
+        }
+    }
+
+    /**
+     * Counts an element that was dropped because a queue was full.
+     * @param[in] queue Queue that overflowed.
+     */
+    inline void RecordQueueDrop(Queue queue) { stats_.queues[queue].num_drops++; }
+
+    /**
+     * Returns a copy of all recorded stats.
+     */
+    Stats GetStats() const { return stats_; }
+
+    /**
+     * Clears all recorded stats. Keeps the cycles per microsecond conversion factor.
+     */
+    void Reset();
+
+   private:
+    Stats stats_;
+};
+
+extern PerfMonitor perf_monitor;
+
+/**
+ * Times the scope it's declared in and records it to a PerfMonitor stage when it goes out of scope. Use the
+ * PERF_PROBE() macro instead of declaring these directly, so that probes can be compiled out.
+ */
+class PerfProbe {
+   public:
+    PerfProbe(PerfMonitor::Stage stage)
+        : stage_(stage),
+          start_us_(static_cast<uint32_t>(get_time_since_boot_us())),
+          start_cycles_(PerfMonitor::ReadCycleCounter()) {}
+    ~PerfProbe() { perf_monitor.RecordStage(stage_, PerfMonitor::GetCyclesSince(start_cycles_, start_us_)); }
+
+   private:
+    PerfMonitor::Stage stage_;
+    uint32_t start_us_;
+    uint32_t start_cycles_;
+};
+
+#if ADSBEE_PERF_PROBES_ENABLED
+#define PERF_PROBE_CONCAT_INNER(a, b) a##b
+#define PERF_PROBE_CONCAT(a, b)       PERF_PROBE_CONCAT_INNER(a, b)
+// Times the rest of the enclosing scope.
+#define PERF_PROBE(stage)                       PerfProbe PERF_PROBE_CONCAT(perf_probe_, __LINE__)(stage)
+#define PERF_RECORD_QUEUE_LENGTH(queue, length) perf_monitor.RecordQueueLength(queue, length)
+#define PERF_RECORD_QUEUE_DROP(queue)           perf_monitor.RecordQueueDrop(queue)
+#else
+#define PERF_PROBE(stage)
+#define PERF_RECORD_QUEUE_LENGTH(queue, length)
+#define PERF_RECORD_QUEUE_DROP(queue)
+#endif
+
+#endif /* PERF_MONITOR_HH_ */
@@ -0,0 +1,111 @@
+#include "task_scheduler.hh"
+
+#include "comms.hh"
+#include "hal.hh"
+#include "string.h"
+
+int16_t TaskScheduler::AddTask(const Task &task) {
+    if (num_tasks_ >= kMaxNumTasks || task.function == nullptr) {
+        CONSOLE_ERROR("TaskScheduler::AddTask", "Unable to add task %s.", task.name);
+        return -1;
+    }
+    uint16_t task_id = num_tasks_;
+    tasks_[task_id] = task;
+    tasks_[task_id].name[kTaskNameMaxLen] = '\0';
+    stats_[task_id] = TaskStats();
+    next_release_timestamps_us_[task_id] = get_time_since_boot_us();
+    released_[task_id] = false;
+    num_tasks_++;
+    return task_id;
+}
+
+void TaskScheduler::Release(uint16_t task_id, uint32_t release_timestamp_us) {
+    if (task_id >= num_tasks_ || released_[task_id]) {
+        return;
+    }
+    release_timestamps_us_[task_id] = release_timestamp_us;
+    released_[task_id] = true;
+}
+
+bool TaskScheduler::Update() {
+    uint32_t timestamp_us = get_time_since_boot_us();
+
+    // Find the highest priority task that is ready.
+    int16_t task_id = -1;
+    uint32_t release_timestamp_us = 0;
+    for (uint16_t i = 0; i < num_tasks_; i++) {
+        uint32_t task_release_timestamp_us;
+        if (released_[i]) {
+            // Deadline task, or periodic task released early.
+            task_release_timestamp_us = release_timestamps_us_[i];
+        } else if (tasks_[i].period_us > 0 && !TimestampIsAfter(next_release_timestamps_us_[i], timestamp_us)) {
+            task_release_timestamp_us = next_release_timestamps_us_[i];
+        } else {
+            continue;  // Not due yet.
+        }
+        if (task_id < 0 || tasks_[i].priority < tasks_[task_id].priority) {
+            task_id = i;
+            release_timestamp_us = task_release_timestamp_us;
+        }
+    }
+    if (task_id < 0) {
+        return false;  // Nothing to do.
+    }
+
+    Task &task = tasks_[task_id];
+    TaskStats &stats = stats_[task_id];
+    if (task.period_us > 0 && !TimestampIsAfter(next_release_timestamps_us_[task_id], timestamp_us)) {
+        next_release_timestamps_us_[task_id] += task.period_us;
+        if (!TimestampIsAfter(next_release_timestamps_us_[task_id], timestamp_us)) {
+            // Fell more than a period behind. Skip the missed releases instead of running back to back to catch up.
+            next_release_timestamps_us_[task_id] = timestamp_us + task.period_us;
+        }
+    }
+    // Clear before running, so that a release that happens while the task is running isn't lost.
+    released_[task_id] = false;
+
+    // A deadline task may have been released by an ISR after timestamp_us was taken.
+    uint32_t latency_us =
+        TimestampIsAfter(release_timestamp_us, timestamp_us) ? 0 : timestamp_us - release_timestamp_us;
+    task.function();
+    uint32_t runtime_us = static_cast<uint32_t>(get_time_since_boot_us()) - timestamp_us;
+
+    stats.num_runs++;
+    uint32_t deadline_us = task.deadline_us > 0 ? task.deadline_us : task.period_us;
+    if (deadline_us > 0 && latency_us > deadline_us) {
+        stats.num_deadline_misses++;
+        if (latency_us > stats.max_latency_us) {
+            // Only report new worst cases, to avoid flooding the console when a task keeps missing its deadline.
+            CONSOLE_WARNING("TaskScheduler::Update", "Task %s missed its %lu us deadline by %lu us.", task.name,
+                            deadline_us, latency_us - deadline_us);
+        }
+    }
+    if (task.budget_us > 0 && runtime_us > task.budget_us) {
+        stats.num_budget_overruns++;
+        if (runtime_us > stats.max_runtime_us) {
+            CONSOLE_WARNING("TaskScheduler::Update", "Task %s ran for %lu us, over its %lu us budget.", task.name,
+                            runtime_us, task.budget_us);
+        }
+    }
+    if (latency_us > stats.max_latency_us) {
+        stats.max_latency_us = latency_us;
+    }
+    if (runtime_us > stats.max_runtime_us) {
+        stats.max_runtime_us = runtime_us;
+    }
+    return true;
+}
+
+uint32_t TaskScheduler::GetNumDeadlineMisses() const {
+    uint32_t num_deadline_misses = 0;
+    for (uint16_t i = 0; i < num_tasks_; i++) {
+        num_deadline_misses += stats_[i].num_deadline_misses;
+    }
+    return num_deadline_misses;
+}
+
+void TaskScheduler::ResetStats() {
+    for (uint16_t i = 0; i < num_tasks_; i++) {
+        stats_[i] = TaskStats();
+    }
+}
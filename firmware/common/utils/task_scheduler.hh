@@ -0,0 +1,106 @@
+#ifndef TASK_SCHEDULER_HH_
+#define TASK_SCHEDULER_HH_
+
+#include "stdint.h"
+
+/**
+ * Cooperative, deadline-aware scheduler for a superloop. Each call to Update() runs the highest priority task that is
+ * ready, so a high priority task never waits for more than one lower priority task to finish. Tasks are either
+ * periodic, or deadline tasks that become ready when they are released with Release(). Periodic tasks can also be
+ * released early, e.g. from an ISR that has work for them.
+ *
+ * For each task, the scheduler tracks the latency from release to start and the runtime, and counts deadline misses
+ * (latency > deadline) and budget overruns (runtime > budget). The worst case latency of a task is bounded by its
+ * period plus the longest runtime of any other task, which is what budgets are for.
+ */
+class TaskScheduler {
+   public:
+    static const uint16_t kMaxNumTasks = 12;
+    static const uint16_t kTaskNameMaxLen = 16;
+
+    typedef void (*TaskFunction)();
+
+    struct Task {
+        char name[kTaskNameMaxLen + 1] = "";
+        TaskFunction function = nullptr;
+        uint16_t priority = 0;     // Lower value runs first. Ties go to the task that was added first.
+        uint32_t period_us = 0;    // Time between releases. 0 = deadline task, only released with Release().
+        uint32_t deadline_us = 0;  // Maximum time from release to start. 0 = use the period.
+        uint32_t budget_us = 0;    // Maximum expected runtime. 0 = unlimited.
+    };
+
+    struct TaskStats {
+        uint32_t num_runs = 0;
+        uint32_t num_deadline_misses = 0;
+        uint32_t num_budget_overruns = 0;
+        uint32_t max_latency_us = 0;  // Longest time from release to start.
+        uint32_t max_runtime_us = 0;
+    };
+
+    /**
+     * Adds a task to the scheduler. Periodic tasks are released for the first time right away.
+     * @param[in] task Task to add. The name is copied.
+     * @retval Task ID to use with Release() and GetTaskStats(), or -1 if there is no room for the task.
+     */
+    int16_t AddTask(const Task &task);
+
+    /**
+     * Releases a task, making it ready to run. Releasing a task that is already ready keeps the earlier release
+     * timestamp, so latency is measured from the first release. Periodic tasks that are released early keep their
+     * period. Safe to call from an ISR on the same core.
+     * @param[in] task_id ID returned by AddTask().
+     * @param[in] release_timestamp_us Time at which the task became ready, e.g. when an ISR queued some work.
+     */
+    void Release(uint16_t task_id, uint32_t release_timestamp_us);
+
+    /**
+     * Runs the highest priority task that is ready, if there is one.
+     * @retval True if a task was run, false if no tasks were ready.
+     */
+    bool Update();
+
+    /**
+     * Returns the number of tasks that have been added.
+     */
+    uint16_t GetNumTasks() const { return num_tasks_; }
+
+    /**
+     * Returns a task that was added with AddTask().
+     * @param[in] task_id ID returned by AddTask().
+     */
+    const Task &GetTask(uint16_t task_id) const { return tasks_[task_id]; }
+
+    /**
+     * Returns the statistics for a task.
+     * @param[in] task_id ID returned by AddTask().
+     */
+    TaskStats GetTaskStats(uint16_t task_id) const { return stats_[task_id]; }
+
+    /**
+     * Returns the total number of deadline misses across all tasks.
+     */
+    uint32_t GetNumDeadlineMisses() const;
+
+    /**
+     * Clears the statistics for all tasks.
+     */
+    void ResetStats();
+
+   private:
+    /**
+     * Returns true if a is later than b, accounting for the microsecond timestamp wrapping around.
+     */
+    static inline bool TimestampIsAfter(uint32_t a, uint32_t b) { return static_cast<int32_t>(a - b) > 0; }
+
+    Task tasks_[kMaxNumTasks];
+    TaskStats stats_[kMaxNumTasks];
+    uint32_t next_release_timestamps_us_[kMaxNumTasks] = {0};  // Periodic tasks only.
+    // Written from Release(), which may run in an ISR.
+    volatile bool released_[kMaxNumTasks] = {false};
+    volatile uint32_t release_timestamps_us_[kMaxNumTasks] = {0};
+    uint16_t num_tasks_ = 0;
+};
+
+extern TaskScheduler task_scheduler;  // Defined in main.cc.
+
+#endif /* TASK_SCHEDULER_HH_ */
@@ -14,6 +14,7 @@ static const uint16_t kGDL90Port = 4000;
 
 static const uint16_t kNetworkConsoleWelcomeMessageMaxLen = 1000;
 static const uint16_t kNetworkMetricsMessageMaxLen = 1000;
+static const uint16_t kPerfMessageWrapperMaxLen = 30;  // Room for wrapping PerfMonitor stats JSON in a labeled object.
 static const uint16_t kNumTransponderPacketSources = 3;
 
 /* obsolete */
@@ -119,9 +120,12 @@ bool ADSBeeServer::Update() {
         // ESP32 can't see number of attempted demodulations, so steal that from RP2040 metrics dictionary.
         AircraftDictionary::Metrics combined_metrics = aircraft_dictionary.metrics;
         combined_metrics.demods_1090 = adsbee_server.rp2040_aircraft_dictionary_metrics.demods_1090;
+        combined_metrics.demod_overlaps_1090 = adsbee_server.rp2040_aircraft_dictionary_metrics.demod_overlaps_1090;
         for (uint16_t i = 0; i < AircraftDictionary::kMaxNumSources; i++) {
             combined_metrics.demods_1090_by_source[i] +=
                 adsbee_server.rp2040_aircraft_dictionary_metrics.demods_1090_by_source[i];
+            combined_metrics.demod_overlaps_1090_by_source[i] =
+                adsbee_server.rp2040_aircraft_dictionary_metrics.demod_overlaps_1090_by_source[i];
         }
         // Broadcast dictionary metrics over the metrics Websocket.
         char metrics_message[AircraftDictionary::Metrics::kMetricsJSONMaxLen];
@@ -141,11 +145,12 @@ bool ADSBeeServer::Update() {
         network_metrics.BroadcastMessage(metrics_message, strlen(metrics_message));
     }
 
-    // Ingest new packets into the dictionary.
-    RawTransponderPacket raw_packet;
-    while (raw_transponder_packet_queue.Pop(raw_packet)) {
-        DecodedTransponderPacket decoded_packet = DecodedTransponderPacket(raw_packet);
+    // Ingest new packets into the dictionary. The RP2040 already checked them, so there's no CRC to redo here, and
+    // 56-bit packets that the RP2040 validated against its own dictionary are taken as valid.
+    DecodedTransponderPacket decoded_packet;
+    while (transponder_packet_queue.Pop(decoded_packet)) {
 #ifdef VERBOSE_DEBUG
+        const RawTransponderPacket &raw_packet = decoded_packet.GetRaw();
         if (raw_packet.buffer_len_bits == DecodedTransponderPacket::kExtendedSquitterPacketLenBits) {
             CONSOLE_INFO("ADSBeeServer::Update", "New message: 0x%08lx|%08lx|%08lx|%04lx RSSI=%ddBm MLAT=%llu",
                          raw_packet.buffer[0], raw_packet.buffer[1], raw_packet.buffer[2],
@@ -205,15 +210,25 @@ bool ADSBeeServer::Update() {
     // Check to see whether the RP2040 sent over new metrics.
     xQueueReceive(rp2040_aircraft_dictionary_metrics_queue, &rp2040_aircraft_dictionary_metrics, 0);
 
+    // Forward RP2040 perf stats over the metrics Websocket as they arrive. They're too long to share a message with the
+    // dictionary metrics.
+    if (xQueueReceive(rp2040_perf_stats_queue, &rp2040_perf_stats, 0) == pdTRUE) {
+        static char perf_message[PerfMonitor::kStatsJSONMaxLen + kPerfMessageWrapperMaxLen];
+        snprintf(perf_message, sizeof(perf_message), "{ \"rp2040_perf_stats\": ");
+        rp2040_perf_stats.ToJSON(perf_message + strlen(perf_message), sizeof(perf_message) - strlen(perf_message));
+        snprintf(perf_message + strlen(perf_message), sizeof(perf_message) - strlen(perf_message), "}");
+        network_metrics.BroadcastMessage(perf_message, strlen(perf_message));
+    }
+
     return ret;
 }
 
 bool ADSBeeServer::HandleRawTransponderPacket(RawTransponderPacket &raw_packet) {
     bool ret = true;
-    if (!raw_transponder_packet_queue.Push(raw_packet)) {
+    if (!transponder_packet_queue.Push(DecodedTransponderPacket(raw_packet))) {
+        // Only the consumer (Update()) may clear the queue, so drop the packet instead.
         CONSOLE_ERROR("ADSBeeServer::HandleRawTransponderPacket",
                       "Push to transponder packet queue failed. May have overflowed?");
-        raw_transponder_packet_queue.Clear();
         ret = false;
     }
     return ret;
@@ -248,8 +263,7 @@ bool ADSBeeServer::ReportGDL90() {
 
     // Traffic Reports
     uint16_t aircraft_index = 0;  // Just used for error reporting.
-    for (auto &itr : aircraft_dictionary.dict) {
-        const Aircraft &aircraft = itr.second;
+    for (const Aircraft &aircraft : aircraft_dictionary.dict) {
         printf("\t%s: %.5f %.5f %ld\r\n", aircraft.callsign, aircraft.latitude_deg, aircraft.longitude_deg,
                aircraft.baro_altitude_ft);
         message.len = gdl90.WriteGDL90TargetReportMessage(message.data, aircraft, false);
@@ -4,12 +4,13 @@
 #include "aircraft_dictionary.hh"
 #include "data_structures.hh"
 #include "esp_http_server.h"
+#include "perf_monitor.hh"
 #include "transponder_packet.hh"
 #include "websocket_server.hh"
 
 class ADSBeeServer {
    public:
-    static const uint16_t kMaxNumTransponderPackets = 100;  // Depth of queue for incoming packets from RP2040.
+    static const uint16_t kMaxNumTransponderPackets = 128;  // Depth of queue for incoming packets from RP2040.
     static const uint32_t kAircraftDictionaryUpdateIntervalMs = 1000;
     static const uint32_t kGDL90ReportingIntervalMs = 1000;
 
@@ -47,6 +48,7 @@ class ADSBeeServer {
         network_console_rx_queue = xQueueCreate(kNetworkConsoleQueueLen, sizeof(NetworkConsoleMessage));
         network_console_tx_queue = xQueueCreate(kNetworkConsoleQueueLen, sizeof(NetworkConsoleMessage));
         rp2040_aircraft_dictionary_metrics_queue = xQueueCreate(1, sizeof(AircraftDictionary::Metrics));
+        rp2040_perf_stats_queue = xQueueCreate(1, sizeof(PerfMonitor::Stats));
     };
 
     /**
@@ -56,13 +58,15 @@ class ADSBeeServer {
         vQueueDelete(network_console_rx_queue);
         vQueueDelete(network_console_tx_queue);
         vQueueDelete(rp2040_aircraft_dictionary_metrics_queue);
+        vQueueDelete(rp2040_perf_stats_queue);
     }
 
     bool Init();
     bool Update();
 
     /**
-     * Ingest a RawTransponderPacket written in over Coprocessor SPI.
+     * Ingest a RawTransponderPacket written in over Coprocessor SPI. Single raw packets don't come with the RP2040's
+     * decode results, so the packet gets decoded from scratch.
      * @param[in] raw_packet RawTransponderPacket to ingest.
      * @retval True if packet was handled successfully, false otherwise.
      */
@@ -78,8 +82,9 @@ class ADSBeeServer {
      */
     void TCPServerTask(void* pvParameters);
 
-    PFBQueue<RawTransponderPacket> raw_transponder_packet_queue = PFBQueue<RawTransponderPacket>(
-        {.buf_len_num_elements = kMaxNumTransponderPackets, .buffer = raw_transponder_packet_queue_buffer_});
+    // Filled by SPIReceiveTask(), drained by Update(). Packets are decoded on the way in, mostly by taking the RP2040's
+    // word for it.
+    SPSCQueue<DecodedTransponderPacket, kMaxNumTransponderPackets> transponder_packet_queue;
 
     AircraftDictionary aircraft_dictionary;
 
@@ -92,6 +97,9 @@ class ADSBeeServer {
     QueueHandle_t rp2040_aircraft_dictionary_metrics_queue = nullptr;
     AircraftDictionary::Metrics rp2040_aircraft_dictionary_metrics;
 
+    QueueHandle_t rp2040_perf_stats_queue = nullptr;
+    PerfMonitor::Stats rp2040_perf_stats;
+
    private:
     struct WSClientInfo {
         bool in_use = false;
@@ -108,8 +116,6 @@ class ADSBeeServer {
 
     bool spi_receive_task_should_exit_ = false;
 
-    // Queue for raw packets from RP2040.
-    RawTransponderPacket raw_transponder_packet_queue_buffer_[kMaxNumTransponderPackets];
     uint32_t last_aircraft_dictionary_update_timestamp_ms_ = 0;
 
     uint32_t last_gdl90_report_timestamp_ms_ = 0;
@@ -2,6 +2,7 @@
 #define COMMS_HH_
 
 #include "data_structures.hh"
+#include "deferred_log.hh"  // For CONSOLE_*_DEFERRED.
 #include "driver/gpio.h"
 #include "esp_eth.h"
 #include "esp_log.h"
@@ -327,5 +328,9 @@ extern CommsManager comms_manager;
 #define CONSOLE_WARNING(tag, ...) ESP_LOGW(tag, __VA_ARGS__)
 #define CONSOLE_INFO(tag, ...)    ESP_LOGI(tag, __VA_ARGS__)
 #define CONSOLE_PRINTF(...)       printf(__VA_ARGS__);
+// ESP_LOG is already filtered at compile time by CONFIG_LOG_MAXIMUM_LEVEL, and nothing needs to defer printing.
+#define CONSOLE_ERROR_DEFERRED_SINK   CONSOLE_ERROR
+#define CONSOLE_WARNING_DEFERRED_SINK CONSOLE_WARNING
+#define CONSOLE_INFO_DEFERRED_SINK    CONSOLE_INFO
 
 #endif /* COMMS_HH_ */
\ No newline at end of file
@@ -312,8 +312,8 @@ void CommsManager::WiFiStationTask(void* pvParameters) {
             // NOTE: Construct packets that are specific to a feed in case statements here!
             switch (settings_manager.settings.feed_protocols[i]) {
                 case SettingsManager::ReportingProtocol::kBeast:
-                    if (!decoded_packet.IsValid()) {
-                        // Packet is invalid, don't send.
+                    if (!decoded_packet.IsValid() || decoded_packet.GetNumCorrectedBits() > kBeastMaxNumCorrectedBits) {
+                        // Packet is invalid or was only made valid by aggressive error correction, don't send.
                         break;
                     }
                     [[fallthrough]];  // Intentional cascade into BEAST_RAW, since reporting code is shared.
@@ -1,5 +1,6 @@
 #include "settings.hh"
 
+#include "adsbee_server.hh"
 #include "comms.hh"
 
 bool SettingsManager::Apply() {
@@ -55,6 +56,14 @@ bool SettingsManager::Apply() {
     strncpy(comms_manager.wifi_sta_password, settings.wifi_sta_password,
             SettingsManager::Settings::kWiFiPasswordMaxLen + 1);
 
+    // Apply the receiver position used for local CPR decoding.
+    if (settings.receiver_position_valid) {
+        adsbee_server.aircraft_dictionary.SetReferencePosition(settings.receiver_latitude_deg,
+                                                               settings.receiver_longitude_deg);
+    } else {
+        adsbee_server.aircraft_dictionary.ClearReferencePosition();
+    }
+
     // Restart network interfaces if necessary.
     if (ethernet_restart_required) {
         if (!comms_manager.EthernetDeInit()) {
@@ -1,5 +1,6 @@
 #include "adsbee.hh"
 
+#include <hardware/structs/scb.h>
 #include <hardware/structs/systick.h>
 #include <stdio.h>  // for printing
 
@@ -9,13 +10,13 @@
 #include "hardware/gpio.h"
 #include "hardware/pio.h"
 #include "hardware/pwm.h"
-#include "pico/rand.h"
 #include "pico/stdlib.h"
 #include "pico/time.h"
-// #include "hardware/dma.h"
+#include "hardware/dma.h"
 #include "capture.pio.h"
 #include "hal.hh"
 #include "hardware/irq.h"
+#include "perf_monitor.hh"
 #include "pico/binary_info.h"
 #include "spi_coprocessor.hh"
 
@@ -27,8 +28,6 @@
 constexpr float kPreambleDetectorFreq = 48e6;    // Running at 48MHz (24 clock cycles per half bit).
 constexpr float kMessageDemodulatorFreq = 48e6;  // Run at 48 MHz to demodulate bits at 1Mbps.
 
-constexpr float kInt16MaxRecip = 1.0f / INT16_MAX;
-
 ADSBee *isr_access = nullptr;
 
 /** Begin pass-through functions for public access **/
@@ -55,13 +54,18 @@ ADSBee::ADSBee(ADSBeeConfig config_in) {
     config_ = config_in;
 
     for (uint16_t sm_index = 0; sm_index < kNumDemodStateMachines; sm_index++) {
-        preamble_detector_sm_[sm_index] = pio_claim_unused_sm(config_.preamble_detector_pio, true);
+        // Preamble detectors hand off to each other with relative IRQs, so they must sit on state machines 0 to N-1.
+        pio_sm_claim(config_.preamble_detector_pio, sm_index);
+        preamble_detector_sm_[sm_index] = sm_index;
         message_demodulator_sm_[sm_index] = pio_claim_unused_sm(config_.message_demodulator_pio, true);
+        demod_dma_packets_[sm_index] = &demod_overflow_packets_[sm_index];  // Re-pointed by ArmDemodDMA() in Init().
     }
-    irq_wrapper_sm_ = pio_claim_unused_sm(config_.preamble_detector_pio, true);
 
     preamble_detector_offset_ = pio_add_program(config_.preamble_detector_pio, &preamble_detector_program);
-    irq_wrapper_offset_ = pio_add_program(config_.preamble_detector_pio, &irq_wrapper_program);
+    if (kHasIRQWrapper) {
+        irq_wrapper_sm_ = pio_claim_unused_sm(config_.preamble_detector_pio, true);
+        irq_wrapper_offset_ = pio_add_program(config_.preamble_detector_pio, &irq_wrapper_program);
+    }
     message_demodulator_offset_ = pio_add_program(config_.message_demodulator_pio, &message_demodulator_program);
 
     // Put IRQ parameters into the global scope for the on_demod_complete ISR.
@@ -73,6 +77,8 @@ ADSBee::ADSBee(ADSBeeConfig config_in) {
 }
 
 bool ADSBee::Init() {
+    mutex_init(&aircraft_dictionary_mutex_);
+
     gpio_init(config_.status_led_pin);
     gpio_set_dir(config_.status_led_pin, GPIO_OUT);
     gpio_put(config_.status_led_pin, 0);
@@ -84,10 +90,13 @@ bool ADSBee::Init() {
     SetTLMilliVolts(SettingsManager::Settings::kDefaultTLMV);
     pwm_set_enabled(tl_pwm_slice_, true);
 
-    // Initialize the trigger level bias ADC input.
+    // Initialize the trigger level bias and RSSI ADC inputs, and start sampling them into the ADC ring buffer.
     adc_init();
     adc_gpio_init(config_.tl_adc_pin);
     adc_gpio_init(config_.rssi_adc_pin);
+    adc_rssi_sample_parity_ = config_.rssi_adc_input > config_.tl_adc_input ? 1 : 0;
+    adc_dma_channel_ = dma_claim_unused_channel(true);
+    StartADCDMA();
 
     // Initialize I2C for talking to the EEPROM and rx gain digipot.
     if (config_.onboard_i2c_requires_init) {
@@ -112,15 +121,39 @@ bool ADSBee::Init() {
     // Let the games begin!
     systick_hw->csr |= 0b1;  // Enable the counter.
 
+    // Free-run a PWM slice at clk_sys alongside SysTick. Demodulators capture its value by DMA for MLAT timestamps.
+    pwm_config mlat_capture_pwm_config = pwm_get_default_config();  // Divider 1, wraps at 0xFFFF.
+    pwm_init(config_.mlat_capture_pwm_slice, &mlat_capture_pwm_config, true);
+    uint32_t interrupts = save_and_disable_interrupts();
+    mlat_capture_pwm_offset_counts_ =
+        static_cast<uint16_t>(GetMLAT48MHzCounts(16) - pwm_get_counter(config_.mlat_capture_pwm_slice));
+    restore_interrupts(interrupts);
+    // Bits arrive at 1Mbps, so the first word is pushed 32us into the demod interval.
+    mlat_first_word_offset_counts_ = clock_get_hz(clk_sys) / 1000000 * kBytesPerWord * kBitsPerByte;
+
+    // Perf probes count SysTick cycles, which run at clk_sys.
+    perf_monitor.SetCyclesPerUs(clock_get_hz(clk_sys) / 1000000);
+
     /** PREAMBLE DETECTOR PIO **/
     // Calculate the PIO clock divider.
     float preamble_detector_div = (float)clock_get_hz(clk_sys) / kPreambleDetectorFreq;
-    irq_wrapper_program_init(config_.preamble_detector_pio, kNumDemodStateMachines, irq_wrapper_offset_,
-                             preamble_detector_div);
+    if (kHasIRQWrapper) {
+        irq_wrapper_program_init(config_.preamble_detector_pio, irq_wrapper_sm_, irq_wrapper_offset_,
+                                 preamble_detector_div);
+        // Point the IRQ wrapper at the IRQ set by the last well formed preamble detector: wait 1 irq (4+N).
+        config_.preamble_detector_pio->instr_mem[irq_wrapper_offset_] =
+            pio_encode_wait_irq(true, false, 4 + kNumWellFormedPreambleDetectors);
+    }
+    if (!kHasHighPowerPreambleDetector) {
+        // Well formed preamble detectors keep the high power detector running by setting its follow IRQ. Without a
+        // high power detector that IRQ belongs to a well formed detector, so replace the irq set with a nop.
+        config_.preamble_detector_pio->instr_mem[preamble_detector_offset_ +
+                                                 preamble_detector_offset_waiting_for_first_edge] = pio_encode_nop();
+    }
     for (uint16_t sm_index = 0; sm_index < kNumDemodStateMachines; sm_index++) {
         // Only make the state machine wait to start if it's part of the round-robin group of well formed preamble
         // detectors.
-        bool make_sm_wait = sm_index > 0 && sm_index < kHighPowerDemodStateMachineIndex;
+        bool make_sm_wait = sm_index > 0 && sm_index < kNumWellFormedPreambleDetectors;
         // Initialize the program using the .pio file helper function
         preamble_detector_program_init(config_.preamble_detector_pio,                     // Use PIO block 0.
                                        preamble_detector_sm_[sm_index],                   // State machines 0-2
@@ -131,6 +164,7 @@ bool ADSBee::Init() {
                                        make_sm_wait  // Whether state machine should wait for an IRQ to begin.
         );
 
+        demod_pins_mask_ |= 0b1 << config_.demod_pins[sm_index];
         // Handle GPIO interrupts (for marking beginning of demod interval).
         gpio_set_irq_enabled_with_callback(config_.demod_pins[sm_index], GPIO_IRQ_EDGE_RISE /* | GPIO_IRQ_EDGE_FALL */,
                                            true, on_demod_pin_change);
@@ -169,22 +203,75 @@ bool ADSBee::Init() {
         // pio_sm_exec(config_.preamble_detector_pio, preamble_detector_sm_[sm_index], pio_encode_push(false, true));
     }
 
-    // Enable the DEMOD interrupt on PIO1_IRQ_0.
-    pio_set_irq0_source_enabled(config_.preamble_detector_pio, pis_interrupt0, true);  // PIO0 state machine 0
-    pio_set_irq0_source_enabled(config_.preamble_detector_pio, pis_interrupt1, true);  // PIO0 state machine 1
-    pio_set_irq0_source_enabled(config_.preamble_detector_pio, pis_interrupt2, true);  // PIO0 state machine 2
+    // Enable the DEMOD interrupt on PIO0_IRQ_0. Each preamble detector sets the IRQ flag matching its state machine.
+    for (uint16_t sm_index = 0; sm_index < kNumDemodStateMachines; sm_index++) {
+        pio_set_irq0_source_enabled(config_.preamble_detector_pio,
+                                    static_cast<pio_interrupt_source>(pis_interrupt0 + sm_index), true);
+    }
 
     // Handle PIO0 IRQ0.
     irq_set_exclusive_handler(config_.preamble_detector_demod_complete_irq, on_demod_complete);
     irq_set_enabled(config_.preamble_detector_demod_complete_irq, true);
 
     /** MESSAGE DEMODULATOR PIO **/
+    // Point the alternate entry point of the demodulator program at the DEMOD pin used by demodulators that can't have
+    // DEMOD directly after pulses: wait 1 pin (demod_pin - pulses_pin).
+    int16_t alternate_entry_demod_pin_offset = -1;
+    for (uint16_t sm_index = 0; sm_index < kNumDemodStateMachines; sm_index++) {
+        if (!DemodUsesAlternateEntry(sm_index)) {
+            continue;
+        }
+        int16_t demod_pin_offset = (config_.demod_pins[sm_index] - config_.pulses_pins[sm_index] + 32) % 32;
+        if (alternate_entry_demod_pin_offset >= 0 && demod_pin_offset != alternate_entry_demod_pin_offset) {
+            CONSOLE_ERROR("ADSBee::Init",
+                          "Demodulator %d has DEMOD pin offset %d, but another demodulator already uses offset %d.",
+                          sm_index, demod_pin_offset, alternate_entry_demod_pin_offset);
+            return false;
+        }
+        alternate_entry_demod_pin_offset = demod_pin_offset;
+    }
+    if (alternate_entry_demod_pin_offset >= 0) {
+        // Keep the side-set bits of the original instruction, only swap out the pin index.
+        config_.message_demodulator_pio
+            ->instr_mem[message_demodulator_offset_ + message_demodulator_offset_high_power_initial_entry] =
+            (message_demodulator_program.instructions[message_demodulator_offset_high_power_initial_entry] & ~0x1Fu) |
+            alternate_entry_demod_pin_offset;
+    }
+
     float message_demodulator_div = (float)clock_get_hz(clk_sys) / kMessageDemodulatorFreq;
     for (uint16_t sm_index = 0; sm_index < kNumDemodStateMachines; sm_index++) {
         message_demodulator_program_init(config_.message_demodulator_pio, message_demodulator_sm_[sm_index],
                                          message_demodulator_offset_, config_.pulses_pins[sm_index],
                                          config_.demod_pins[sm_index], config_.recovered_clk_pins[sm_index],
                                          message_demodulator_div);
+
+        // Stream each demodulator's RX FIFO into its packet queue with DMA, so the ISR doesn't have to pull words.
+        demod_dma_channels_[sm_index] = dma_claim_unused_channel(true);
+        dma_channel_config demod_dma_config = dma_channel_get_default_config(demod_dma_channels_[sm_index]);
+        channel_config_set_transfer_data_size(&demod_dma_config, DMA_SIZE_32);
+        channel_config_set_read_increment(&demod_dma_config, false);
+        channel_config_set_write_increment(&demod_dma_config, true);
+        channel_config_set_dreq(&demod_dma_config, pio_get_dreq(config_.message_demodulator_pio,
+                                                                message_demodulator_sm_[sm_index], false));
+        dma_channel_configure(demod_dma_channels_[sm_index], &demod_dma_config,
+                              nullptr,  // Write address is set by ArmDemodDMA().
+                              &config_.message_demodulator_pio->rxf[message_demodulator_sm_[sm_index]],
+                              RawTransponderPacket::kMaxPacketLenWords32,
+                              false);  // Don't start yet.
+        ArmDemodDMA(sm_index);
+
+        // Capture the MLAT counter when the first word of each packet is pushed.
+        mlat_dma_channels_[sm_index] = dma_claim_unused_channel(true);
+        dma_channel_config mlat_dma_config = dma_channel_get_default_config(mlat_dma_channels_[sm_index]);
+        channel_config_set_transfer_data_size(&mlat_dma_config, DMA_SIZE_32);
+        channel_config_set_read_increment(&mlat_dma_config, false);
+        channel_config_set_write_increment(&mlat_dma_config, false);
+        channel_config_set_dreq(&mlat_dma_config, pio_get_dreq(config_.message_demodulator_pio,
+                                                               message_demodulator_sm_[sm_index], false));
+        dma_channel_configure(mlat_dma_channels_[sm_index], &mlat_dma_config, &mlat_capture_pwm_counts_[sm_index],
+                              &pwm_hw->slice[config_.mlat_capture_pwm_slice].ctr,
+                              1,      // Only the first word.
+                              true);  // Start now, waits for DREQ.
     }
 
     // Set GPIO interrupts to be higher priority than the DEMOD interrupt to allow RSSI measurement.
@@ -197,7 +284,9 @@ bool ADSBee::Init() {
     last_aircraft_dictionary_update_timestamp_ms_ = get_time_since_boot_ms();
 
     // Enable the state machines.
-    pio_sm_set_enabled(config_.preamble_detector_pio, irq_wrapper_sm_, true);
+    if (kHasIRQWrapper) {
+        pio_sm_set_enabled(config_.preamble_detector_pio, irq_wrapper_sm_, true);
+    }
     // Need to enable the demodulator SMs first, since if the preamble detector trips the IRQ but the demodulator isn't
     // enabled, we end up in a deadlock (I think, this maybe should be verified again).
     for (uint16_t sm_index = 0; sm_index < kNumDemodStateMachines; sm_index++) {
@@ -208,11 +297,14 @@ bool ADSBee::Init() {
     // NOTE: These need to be enable to allow the high power preamble detector to run, since they reset the IRQ that the
     // high power preamble detector relies on. This is a vestige of the fact that the high power preamble detector uses
     // the same PIO code that does round-robin for the well formed preamble detectors.
-    for (uint16_t sm_index = 0; sm_index < kHighPowerDemodStateMachineIndex; sm_index++) {
+    for (uint16_t sm_index = 0; sm_index < kNumWellFormedPreambleDetectors; sm_index++) {
         pio_sm_set_enabled(config_.preamble_detector_pio, preamble_detector_sm_[sm_index], true);
     }
-    // Enable high power preamble detector.
-    pio_sm_set_enabled(config_.preamble_detector_pio, preamble_detector_sm_[kHighPowerDemodStateMachineIndex], true);
+    if (kHasHighPowerPreambleDetector) {
+        // Enable high power preamble detector.
+        pio_sm_set_enabled(config_.preamble_detector_pio, preamble_detector_sm_[kHighPowerDemodStateMachineIndex],
+                           true);
+    }
 
     // Throw a fit if the watchdog caused a reboot.
     if (watchdog_caused_reboot()) {
@@ -234,118 +326,152 @@ bool ADSBee::Update() {
         gpio_put(config_.status_led_pin, 0);
     }
 
-    // Prune aircraft dictionary. Need to do this up front so that we don't end up with a negative timestamp delta
-    // caused by packets being ingested more recently than the timestamp we take at the beginning of this function.
-    if (timestamp_ms - last_aircraft_dictionary_update_timestamp_ms_ > config_.aircraft_dictionary_update_interval_ms) {
-        aircraft_dictionary.Update(timestamp_ms);
+    if (timestamp_ms - last_aircraft_dictionary_metrics_timestamp_ms_ >
+        config_.aircraft_dictionary_update_interval_ms) {
+        AircraftDictionary::Metrics metrics = GetAircraftDictionaryMetrics();
         if (esp32.IsEnabled()) {
-            // Send fresh aircraft dictionary stats to ESPS32.
-            esp32.Write(ObjectDictionary::kAddrAircraftDictionaryMetrics, aircraft_dictionary.metrics,
-                        true);  // require ACK.
-        }
-        // Add the fresh metrics values to the pile used for TL learning.
-        // If learning, add the number of valid packets received to the pile used for trigger level learning.
-        if (tl_learning_temperature_mv_ > 0) {
-            tl_learning_num_valid_packets_ += (aircraft_dictionary.metrics.valid_squitter_frames +
-                                               aircraft_dictionary.metrics.valid_extended_squitter_frames);
-        }
-        last_aircraft_dictionary_update_timestamp_ms_ = timestamp_ms;
-    }
-
-    // Ingest new packets into the dictionary.
-    RawTransponderPacket raw_packet;
-    while (transponder_packet_queue.Pop(raw_packet)) {
-        if (raw_packet.buffer_len_bits == DecodedTransponderPacket::kExtendedSquitterPacketLenBits) {
-            CONSOLE_INFO("ADSBee::Update", "New message: 0x%08x|%08x|%08x|%04x SRC=%d SIGS=%ddBm SIGQ=%ddB MLAT=%u",
-                         raw_packet.buffer[0], raw_packet.buffer[1], raw_packet.buffer[2],
-                         (raw_packet.buffer[3]) >> (4 * kBitsPerNibble), raw_packet.source, raw_packet.sigs_dbm,
-                         raw_packet.sigq_db, raw_packet.mlat_48mhz_64bit_counts);
-        } else {
-            CONSOLE_INFO("ADSBee::Update", "New message: 0x%08x|%06x SRC=%d SIGS=%ddBm SIGQ=%ddB MLAT=%u",
-                         raw_packet.buffer[0], (raw_packet.buffer[1]) >> (2 * kBitsPerNibble), raw_packet.source,
-                         raw_packet.sigs_dbm, raw_packet.sigq_db, raw_packet.mlat_48mhz_64bit_counts);
-        }
-
-        DecodedTransponderPacket decoded_packet = DecodedTransponderPacket(raw_packet);
-        CONSOLE_INFO("ADSBee::Update", "\tdf=%d icao_address=0x%06x", decoded_packet.GetDownlinkFormat(),
-                     decoded_packet.GetICAOAddress());
-
-        if (aircraft_dictionary.IngestDecodedTransponderPacket(decoded_packet)) {
-            // Packet was used to update the dictionary or was silently ignored (but presumed to be valid).
-            FlashStatusLED();
-            // NOTE: Pushing to the reporting queue here means that we only will report validated packets!
-            // comms_manager.transponder_packet_reporting_queue.Push(decoded_packet);
-            CONSOLE_INFO("ADSBee::Update", "\taircraft_dictionary: %d aircraft", aircraft_dictionary.GetNumAircraft());
+            // Send fresh aircraft dictionary stats to ESPS32. Queued without waiting for the acks, since nothing is
+            // done if they fail.
+            esp32.WriteAsync(ObjectDictionary::kAddrAircraftDictionaryMetrics, metrics, true);  // require ACK.
+#if ADSBEE_PERF_PROBES_ENABLED
+            PerfMonitor::Stats perf_stats = perf_monitor.GetStats();
+            esp32.WriteAsync(ObjectDictionary::kAddrPerfStats, perf_stats, true);  // require ACK.
+#endif
         }
-        comms_manager.transponder_packet_reporting_queue.Push(decoded_packet);
-    }
-
-    // Update trigger level learning if it's active.
-    if (tl_learning_temperature_mv_ > 0 &&
-        timestamp_ms - tl_learning_cycle_start_timestamp_ms_ > kTLLearningIntervalMs) {
-        // Trigger level learning is active and due for an update.
-        // Is this neighbor (current value for tl_mv) worth traversing to?
-        float valid_packet_ratio = (tl_learning_num_valid_packets_ - tl_learning_prev_num_valid_packets_) /
-                                   MAX(tl_learning_prev_num_valid_packets_, 1);  // Avoid divide by zero.
-        float random_weight =
-            static_cast<int16_t>(get_rand_32()) * kInt16MaxRecip * 0.25;  // Random value from [-0.25,0.25].
-        if (valid_packet_ratio + random_weight > 0.0f) {
-            // Transition to neighbor TL value.
-            tl_learning_prev_tl_mv_ = tl_mv_;
-            tl_learning_prev_num_valid_packets_ = tl_learning_num_valid_packets_;
+        if (tl_controller_.IsEnabled()) {
+            SetTLMilliVolts(
+                tl_controller_.Update(metrics, noise_floor_mv_, config_.aircraft_dictionary_update_interval_ms));
         }
-        // Else keep existing TL value in tl_learning_prev_tl_mv_.
-
-        // DO STUFF HERE
-        // Find a new neighbor by stepping trigger level with random value from [-1.0, 1.0] * temperature.
-        uint16_t new_tl_mv = tl_mv_ + static_cast<int16_t>(get_rand_32()) * tl_learning_temperature_mv_ / INT16_MAX;
-        if (new_tl_mv > tl_learning_max_mv_) {
-            tl_mv_ = tl_learning_max_mv_;
-        } else if (new_tl_mv < tl_learning_min_mv_) {
-            tl_mv_ = tl_learning_min_mv_;
-        } else {
-            tl_mv_ = new_tl_mv;
-        }
-
-        // Update learning temperature. Decrement by the annealing temperature step or set to 0
-        // if learning is complete.
-        if (tl_learning_temperature_mv_ > tl_learning_temperature_step_mv_) {
-            // Not done learning: step the trigger level learning temperature.
-            tl_learning_temperature_mv_ -= tl_learning_temperature_step_mv_;
-        } else {
-            // Done learning: take the current best trigger level and yeet outta here.
-            tl_learning_temperature_mv_ = 0;   // Set learning temperature to 0 to finish learnign trigger level.
-            tl_mv_ = tl_learning_prev_tl_mv_;  // Set trigger level to the best value we've seen so far.
-        }
-
-        // Store timestamp as start of trigger learning cycle so we know when to come back.
-        tl_learning_cycle_start_timestamp_ms_ = timestamp_ms;
-        tl_learning_num_valid_packets_ = 0;  // Start the counter over.
+        last_aircraft_dictionary_metrics_timestamp_ms_ = timestamp_ms;
     }
 
     // Update PWM output duty cycle.
     pwm_set_chan_level(tl_pwm_slice_, tl_pwm_chan_, tl_pwm_count_);
 
-    // Occasionally sample the signal strength to approximate the noise floor.
+    // Keep the ADC ring buffer going. The DMA transfer count only runs out every couple of hours.
+    if (!dma_channel_is_busy(adc_dma_channel_)) {
+        StartADCDMA();
+    }
+
+    // Occasionally sample the signal strength to approximate the noise floor. Only use RSSI samples from outside of
+    // demod intervals, so that packets don't drag the noise floor up.
     timestamp_ms = get_time_since_boot_ms();
-    if (timestamp_ms - noise_floor_last_sample_timestamp_ms_ > kNoiseFloorADCSampleIntervalMs) {
+    if (timestamp_ms - noise_floor_last_sample_timestamp_ms_ > kNoiseFloorADCSampleIntervalMs &&
+        (gpio_get_all() & demod_pins_mask_) == 0 &&
+        time_us_32() - last_demod_activity_timestamp_us_ > kNoiseFloorQuietTimeUs) {
         noise_floor_mv_ = ((noise_floor_mv_ * kNoiseFloorExpoFilterPercent) +
-                           ReadSignalStrengthMilliVolts() * (100 - kNoiseFloorExpoFilterPercent)) /
+                           ADCCountsToMilliVolts(GetMeanRSSIADCCounts(kNoiseFloorNumRSSISamples)) *
+                               (100 - kNoiseFloorExpoFilterPercent)) /
                           100;
         noise_floor_last_sample_timestamp_ms_ = timestamp_ms;
     }
     return true;
 }
 
+bool ADSBee::UpdateDecode() {
+    PERF_PROBE(PerfMonitor::kStageDecodeLoop);
+    uint32_t timestamp_ms = get_time_since_boot_ms();
+
+    // Prune aircraft dictionary. Need to do this up front so that we don't end up with a negative timestamp delta
+    // caused by packets being ingested more recently than the timestamp we take at the beginning of this function.
+    if (timestamp_ms - last_aircraft_dictionary_update_timestamp_ms_ > config_.aircraft_dictionary_update_interval_ms) {
+        mutex_enter_blocking(&aircraft_dictionary_mutex_);
+        // Fold in demods counted by the ISRs right before the metrics roll over.
+        for (uint16_t sm_index = 0; sm_index < kNumDemodStateMachines; sm_index++) {
+            uint32_t demods = isr_demods_1090_[sm_index].load(std::memory_order_relaxed);
+            uint32_t overlaps = isr_demod_overlaps_1090_[sm_index].load(std::memory_order_relaxed);
+            aircraft_dictionary.RecordDemod1090(sm_index, demods - folded_demods_1090_[sm_index]);
+            aircraft_dictionary.RecordDemodOverlap1090(sm_index, overlaps - folded_demod_overlaps_1090_[sm_index]);
+            folded_demods_1090_[sm_index] = demods;
+            folded_demod_overlaps_1090_[sm_index] = overlaps;
+        }
+        aircraft_dictionary.Update(timestamp_ms);
+        mutex_exit(&aircraft_dictionary_mutex_);
+        last_aircraft_dictionary_update_timestamp_ms_ = timestamp_ms;
+    }
+
+    // Ingest new packets into the dictionary. Don't print from here: console output is forwarded to the ESP32 over
+    // SPI, which belongs to core 0. Packets get logged when they are popped from the reporting queue instead.
+    RawTransponderPacket raw_packet;
+    for (uint16_t sm_index = 0; sm_index < kNumDemodStateMachines; sm_index++) {
+        // This is the only consumer, so a non-empty queue can always be popped. Checking first keeps empty pops out of
+        // the queue pop stats.
+        while (demod_packet_queues_[sm_index].Length() > 0) {
+            {
+                PERF_PROBE(PerfMonitor::kStageQueuePop);
+                demod_packet_queues_[sm_index].Pop(raw_packet);
+            }
+            // Decode outside of the mutex to keep the critical section short.
+            DecodedTransponderPacket decoded_packet = DecodedTransponderPacket(raw_packet);
+
+            bool ingested;
+            {
+                PERF_PROBE(PerfMonitor::kStageIngest);
+                mutex_enter_blocking(&aircraft_dictionary_mutex_);
+                ingested = aircraft_dictionary.IngestDecodedTransponderPacket(decoded_packet);
+                mutex_exit(&aircraft_dictionary_mutex_);
+            }
+            if (ingested) {
+                // Packet was used to update the dictionary or was silently ignored (but presumed to be valid).
+                FlashStatusLED();
+            }
+            if (comms_manager.transponder_packet_reporting_queue.Push(decoded_packet)) {
+                PERF_RECORD_QUEUE_LENGTH(PerfMonitor::kQueueTransponderPacketReporting,
+                                         comms_manager.transponder_packet_reporting_queue.Length());
+            } else {
+                PERF_RECORD_QUEUE_DROP(PerfMonitor::kQueueTransponderPacketReporting);
+            }
+        }
+    }
+    return true;
+}
+
+void ADSBee::ArmDemodDMA(uint16_t sm_index) {
+    RawTransponderPacket *packet = demod_packet_queues_[sm_index].GetPushSlot();
+    if (packet == nullptr) {
+        packet = &demod_overflow_packets_[sm_index];  // Queue is full, this packet will be dropped.
+    }
+    demod_dma_packets_[sm_index] = packet;
+    dma_channel_set_write_addr(demod_dma_channels_[sm_index], packet->buffer, false);
+    dma_channel_set_trans_count(demod_dma_channels_[sm_index], RawTransponderPacket::kMaxPacketLenWords32, true);
+}
+
+void ADSBee::ClearReferencePosition() {
+    mutex_enter_blocking(&aircraft_dictionary_mutex_);
+    aircraft_dictionary.ClearReferencePosition();
+    mutex_exit(&aircraft_dictionary_mutex_);
+}
+
 void ADSBee::FlashStatusLED(uint32_t led_on_ms) {
     SetStatusLED(true);
     led_on_timestamp_ms_ = get_time_since_boot_ms();
 }
 
 uint64_t ADSBee::GetMLAT48MHzCounts(uint16_t num_bits) {
-    // Combine the wrap counter with the current value of the SysTick register and mask to 48 bits.
+    uint32_t wraps, systick_counts;
+    bool wrap_pending;
+    do {
+        wraps = mlat_counter_1s_wraps_;
+        systick_counts = systick_hw->cvr;
+        wrap_pending = scb_hw->icsr & M0PLUS_ICSR_PENDSTSET_BITS;
+    } while (wraps != mlat_counter_1s_wraps_);  // OnSysTickWrap() ran in between, try again.
+    // When called from an interrupt that blocks the SysTick exception, the counter can reload before the wrap gets
+    // counted. SysTick counts down, so a counter that just reloaded is in the top half of its range.
+    if (wrap_pending && systick_counts > 0xFFFFFF / 2) {
+        wraps++;
+    }
+    // Combine the wrap counter with the current value of the SysTick register and mask to num_bits.
     // Note: 24-bit SysTick value is subtracted from UINT_24_MAX to make it count up instead of down.
-    return (mlat_counter_1s_wraps_ << 24 | (0xFFFFFF - systick_hw->cvr)) & (UINT64_MAX >> (64 - num_bits));
+    return ((static_cast<uint64_t>(wraps) << 24) | (0xFFFFFF - systick_counts)) & (UINT64_MAX >> (64 - num_bits));
+}
+
+uint64_t ADSBee::GetCapturedMLATCounts(uint16_t sm_index, uint64_t isr_mlat_counts) {
+    // Low 16 bits of the MLAT counter at the moment the first word was pushed, and the best guess at the full value.
+    uint16_t captured_counts_low = mlat_capture_pwm_counts_[sm_index] + mlat_capture_pwm_offset_counts_;
+    uint64_t expected_counts = isr_mlat_counts + mlat_first_word_offset_counts_;
+    // Move the guess to the nearest value with matching low bits.
+    int16_t correction_counts = static_cast<int16_t>(captured_counts_low - static_cast<uint16_t>(expected_counts));
+    return expected_counts + correction_counts - mlat_first_word_offset_counts_;
 }
 
 uint64_t ADSBee::GetMLAT12MHzCounts(uint16_t num_bits) {
@@ -353,9 +479,27 @@ uint64_t ADSBee::GetMLAT12MHzCounts(uint16_t num_bits) {
     return GetMLAT48MHzCounts(50) >> 2;  // Divide 48MHz counter by 4, widen the mask by 2 bits to compensate.
 }
 
+void ADSBee::GetAircraftDictionarySnapshot(AircraftDictionary &snapshot) {
+    mutex_enter_blocking(&aircraft_dictionary_mutex_);
+    snapshot = aircraft_dictionary;
+    mutex_exit(&aircraft_dictionary_mutex_);
+}
+
+AircraftDictionary::Metrics ADSBee::GetAircraftDictionaryMetrics() {
+    mutex_enter_blocking(&aircraft_dictionary_mutex_);
+    AircraftDictionary::Metrics metrics = aircraft_dictionary.metrics;
+    mutex_exit(&aircraft_dictionary_mutex_);
+    return metrics;
+}
+
 int ADSBee::GetNoiseFloordBm() { return AD8313MilliVoltsTodBm(noise_floor_mv_); }
 
-uint16_t ADSBee::GetTLLearningTemperatureMV() { return tl_learning_temperature_mv_; }
+bool ADSBee::GetReferencePosition(float &latitude_deg, float &longitude_deg) {
+    mutex_enter_blocking(&aircraft_dictionary_mutex_);
+    bool valid = aircraft_dictionary.GetReferencePosition(latitude_deg, longitude_deg);
+    mutex_exit(&aircraft_dictionary_mutex_);
+    return valid;
+}
 
 void ADSBee::OnDemodBegin(uint gpio) {
     uint16_t sm_index;
@@ -367,87 +511,119 @@ void ADSBee::OnDemodBegin(uint gpio) {
     if (sm_index >= kNumDemodStateMachines) return;  // Ignore; wasn't the start of a demod interval for a known SM.
     // Demodulation period is beginning!
     // Store the MLAT counter.
-    rx_packet_[sm_index].mlat_48mhz_64bit_counts = GetMLAT48MHzCounts();  // TODO: have separate RX packets
+    demod_dma_packets_[sm_index]->mlat_48mhz_64bit_counts = GetMLAT48MHzCounts();
+    // Mark where the packet starts in the ADC ring buffer, so its RSSI can be found when it's complete.
+    demod_begin_adc_indices_[sm_index] = GetADCRingBufferWriteIndex();
+    last_demod_activity_timestamp_us_ = time_us_32();
+
+    // Count demods that started while another demodulator was still busy. These would have been missed without the
+    // extra preamble detectors.
+    uint32_t gpio_states = gpio_get_all();
+    for (uint16_t other_sm_index = 0; other_sm_index < kNumDemodStateMachines; other_sm_index++) {
+        if (other_sm_index != sm_index && (gpio_states & (0b1 << config_.demod_pins[other_sm_index]))) {
+            // Only this ISR writes to the counter, so it doesn't need an atomic read-modify-write.
+            isr_demod_overlaps_1090_[sm_index].store(
+                isr_demod_overlaps_1090_[sm_index].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            break;
+        }
+    }
 }
 
 void ADSBee::OnDemodComplete() {
+    PERF_PROBE(PerfMonitor::kStageDemodISR);
+    uint32_t isr_start_systick_counts = systick_hw->cvr;
+    uint16_t demod_end_adc_index = GetADCRingBufferWriteIndex();
+    last_demod_activity_timestamp_us_ = time_us_32();
     for (uint16_t sm_index = 0; sm_index < kNumDemodStateMachines; sm_index++) {
         if (!pio_interrupt_get(config_.preamble_detector_pio, sm_index)) {
             continue;
         }
         pio_sm_set_enabled(config_.message_demodulator_pio, message_demodulator_sm_[sm_index], false);
-        // Read the RSSI level of the current packet.
-        rx_packet_[sm_index].sigs_dbm = ReadSignalStrengthdBm();
-        rx_packet_[sm_index].sigq_db = rx_packet_[sm_index].sigs_dbm - GetNoiseFloordBm();
-        rx_packet_[sm_index].source = sm_index;  // Record this state machine as the source of the packet.
+        RawTransponderPacket &packet = *demod_dma_packets_[sm_index];
+        // Use the peak RSSI sampled during the demod interval as the signal strength of the packet. The mean would be
+        // dragged down by the half of each bit where there is no pulse.
+        packet.sigs_dbm = AD8313MilliVoltsTodBm(
+            ADCCountsToMilliVolts(GetPeakRSSIADCCounts(demod_begin_adc_indices_[sm_index], demod_end_adc_index)));
+        packet.sigq_db = packet.sigs_dbm - GetNoiseFloordBm();
+        packet.source = sm_index;  // Record this state machine as the source of the packet.
         if (!pio_sm_is_rx_fifo_full(config_.message_demodulator_pio, message_demodulator_sm_[sm_index])) {
             // Push any partially complete 32-bit word onto the RX FIFO.
             pio_sm_exec_wait_blocking(config_.message_demodulator_pio, message_demodulator_sm_[sm_index],
                                       pio_encode_push(false, true));
         }
 
-        // Clear the transponder packet buffer.
-        memset((void *)rx_packet_[sm_index].buffer, 0x0, RawTransponderPacket::kMaxPacketLenWords32);
-
-        // Pull all words out of the RX FIFO.
-        volatile uint16_t packet_num_words =
-            pio_sm_get_rx_fifo_level(config_.message_demodulator_pio, message_demodulator_sm_[sm_index]);
-        if (packet_num_words > RawTransponderPacket::kMaxPacketLenWords32) {
-            // Packet length is invalid; dump everything and try again next time.
-            // Only enable this print for debugging! Printing from the interrupt causes the USB library to crash.
-            // CONSOLE_WARNING("ADSBee::OnDemodComplete", "Received a packet with %d 32-bit words, expected maximum of
-            // %d.",
-            //                 packet_num_words, DecodedTransponderPacket::kExtendedSquitterPacketNumWords32);
-            // pio_sm_clear_fifos(config_.message_demodulator_pio, message_demodulator_sm_);
-            packet_num_words = RawTransponderPacket::kMaxPacketLenWords32;
+        // Let the DMA channel catch up with the word that was just pushed. This only takes a few bus cycles. Words
+        // beyond kMaxPacketLenWords32 are left in the FIFO and get cleared below.
+        int dma_channel = demod_dma_channels_[sm_index];
+        while (dma_channel_is_busy(dma_channel) &&
+               !pio_sm_is_rx_fifo_empty(config_.message_demodulator_pio, message_demodulator_sm_[sm_index])) {
         }
-        // Track that we attempted to demodulate something.
-        aircraft_dictionary.RecordDemod1090();
-        // Create a RawTransponderPacket and push it onto the queue.
-        for (uint16_t i = 0; i < packet_num_words; i++) {
-            rx_packet_[sm_index].buffer[i] =
-                pio_sm_get(config_.message_demodulator_pio, message_demodulator_sm_[sm_index]);
-            if (i == packet_num_words - 1) {
-                // // Trim off extra ingested bit from last word in the packet.
-                // word  = word >> 1;
-                // Mask and left align final word based on bit length.
-                switch (packet_num_words) {
-                    case DecodedTransponderPacket::kSquitterPacketNumWords32:
-                        rx_packet_[sm_index].buffer[i] = (rx_packet_[sm_index].buffer[i] & 0xFFFFFF) << 8;
-                        rx_packet_[sm_index].buffer_len_bits = DecodedTransponderPacket::kSquitterPacketLenBits;
-                        transponder_packet_queue.Push(rx_packet_[sm_index]);
-                        break;
-                    case DecodedTransponderPacket::kExtendedSquitterPacketNumWords32:
-                        rx_packet_[sm_index].buffer[i] = (rx_packet_[sm_index].buffer[i] & 0xFFFF) << 16;
-                        rx_packet_[sm_index].buffer_len_bits = DecodedTransponderPacket::kExtendedSquitterPacketLenBits;
-                        transponder_packet_queue.Push(rx_packet_[sm_index]);
-                        break;
-                    default:
-                        // Don't push partial packets.
-                        // Printing to tinyUSB from within an interrupt causes crashes! Don't do it.
-                        // CONSOLE_WARNING(
-                        //     "ADSBee::OnDemodComplete",
-                        //     "Unhandled case while creating RawTransponderPacket, received packet with %d 32-bit
-                        //     words.", packet_num_words);
-                        break;
-                }
-            }
+        uint16_t packet_num_words =
+            RawTransponderPacket::kMaxPacketLenWords32 - dma_channel_hw_addr(dma_channel)->transfer_count;
+        dma_channel_abort(dma_channel);
+
+        // Swap the timestamp taken in OnDemodBegin() for the one captured by DMA, which doesn't suffer from interrupt
+        // latency. The capture fires on the first push, so it's only missing for packets shorter than one word.
+        if (dma_channel_hw_addr(mlat_dma_channels_[sm_index])->transfer_count == 0) {
+            uint64_t captured_mlat_counts = GetCapturedMLATCounts(sm_index, packet.mlat_48mhz_64bit_counts);
+            int32_t jitter_counts = static_cast<int32_t>(packet.mlat_48mhz_64bit_counts - captured_mlat_counts);
+            mlat_jitter_stats_.num_samples++;
+            mlat_jitter_stats_.min_counts = MIN(mlat_jitter_stats_.min_counts, jitter_counts);
+            mlat_jitter_stats_.max_counts = MAX(mlat_jitter_stats_.max_counts, jitter_counts);
+            mlat_jitter_stats_.sum_counts += jitter_counts;
+            mlat_jitter_stats_.sum_squares_counts += static_cast<int64_t>(jitter_counts) * jitter_counts;
+            packet.mlat_48mhz_64bit_counts = captured_mlat_counts;
         }
 
-        // Clear the FIFO by pushing partial word from ISR, not bothering to block if FIFO is full (it shouldn't be).
-        pio_sm_exec_wait_blocking(config_.message_demodulator_pio, message_demodulator_sm_[sm_index],
-                                  pio_encode_push(false, false));
-        while (!pio_sm_is_rx_fifo_empty(config_.message_demodulator_pio, message_demodulator_sm_[sm_index])) {
-            pio_sm_get(config_.message_demodulator_pio, message_demodulator_sm_[sm_index]);
+        // Track that we attempted to demodulate something. The mutex can't be taken from an ISR, so this is counted
+        // locally and folded into the aircraft dictionary metrics by UpdateDecode(). Only this ISR writes to the
+        // counter, so it doesn't need an atomic read-modify-write.
+        isr_demods_1090_[sm_index].store(isr_demods_1090_[sm_index].load(std::memory_order_relaxed) + 1,
+                                         std::memory_order_relaxed);
+
+        // Mask and left align final word based on bit length, and clear out stale words after the end of the packet.
+        bool packet_is_valid = true;
+        switch (packet_num_words) {
+            case DecodedTransponderPacket::kSquitterPacketNumWords32:
+                packet.buffer[packet_num_words - 1] = (packet.buffer[packet_num_words - 1] & 0xFFFFFF) << 8;
+                packet.buffer_len_bits = DecodedTransponderPacket::kSquitterPacketLenBits;
+                break;
+            case DecodedTransponderPacket::kExtendedSquitterPacketNumWords32:
+                packet.buffer[packet_num_words - 1] = (packet.buffer[packet_num_words - 1] & 0xFFFF) << 16;
+                packet.buffer_len_bits = DecodedTransponderPacket::kExtendedSquitterPacketLenBits;
+                break;
+            default:
+                // Don't push partial packets.
+                // Printing to tinyUSB from within an interrupt causes crashes! Don't do it.
+                packet_is_valid = false;
+                break;
         }
+        if (packet_is_valid) {
+            for (uint16_t i = packet_num_words; i < RawTransponderPacket::kMaxPacketLenWords32; i++) {
+                packet.buffer[i] = 0x0;
+            }
+            packet.num_corrected_bits = 0;
+            // Packets written into the overflow packet are dropped, since the queue was full when DMA was armed.
+            if (&packet != &demod_overflow_packets_[sm_index]) {
+                demod_packet_queues_[sm_index].CommitPush();
+                PERF_RECORD_QUEUE_LENGTH(PerfMonitor::kQueueDemodPackets, demod_packet_queues_[sm_index].Length());
+            } else {
+                PERF_RECORD_QUEUE_DROP(PerfMonitor::kQueueDemodPackets);
+            }
+        }
+
+        // Throw away anything left over in the FIFO, then point the DMA channel at the next free slot.
+        pio_sm_clear_fifos(config_.message_demodulator_pio, message_demodulator_sm_[sm_index]);
+        ArmDemodDMA(sm_index);
+        dma_channel_set_trans_count(mlat_dma_channels_[sm_index], 1, true);  // Capture the next packet's first word.
 
         // Reset the demodulator state machine to wait for the next decode interval, then enable it.
         pio_sm_restart(config_.message_demodulator_pio, message_demodulator_sm_[sm_index]);  // Reset FIFOs, ISRs, etc.
-        // The high power demodulator has a different start address to account for the fact that the index of its DEMOD
-        // pin is different. This only matters for the initial program wait, subsequent demod checks are done on the
-        // full GPIO input register.
+        // Demodulators without DEMOD directly after pulses (e.g. high power) have a different start address to account
+        // for the fact that the index of their DEMOD pin is different. This only matters for the initial program wait,
+        // subsequent demod checks are done on the full GPIO input register.
         uint demodulator_program_start =
-            sm_index == kHighPowerDemodStateMachineIndex
+            DemodUsesAlternateEntry(sm_index)
                 ? message_demodulator_offset_ + message_demodulator_offset_high_power_initial_entry
                 : message_demodulator_offset_ + message_demodulator_offset_initial_entry;
         pio_sm_exec_wait_blocking(config_.message_demodulator_pio, message_demodulator_sm_[sm_index],
@@ -475,25 +651,103 @@ void ADSBee::OnDemodComplete() {
         //                                          program.
         // pio_sm_set_enabled(config_.preamble_detector_pio, preamble_detector_sm_[sm_index], true);
     }
+
+    // SysTick counts down and wraps at 24 bits.
+    demod_complete_isr_stats_.last_cycles = (isr_start_systick_counts - systick_hw->cvr) & 0xFFFFFF;
+    demod_complete_isr_stats_.max_cycles =
+        MAX(demod_complete_isr_stats_.max_cycles, demod_complete_isr_stats_.last_cycles);
+    demod_complete_isr_stats_.num_calls++;
 }
 
 void ADSBee::OnSysTickWrap() { mlat_counter_1s_wraps_++; }
 
-int ADSBee::ReadSignalStrengthMilliVolts() {
-    adc_select_input(config_.rssi_adc_input);
-    int rssi_adc_counts = adc_read();
-    return rssi_adc_counts * 3300 / 4095;
-}
+int ADSBee::ReadSignalStrengthMilliVolts() { return ADCCountsToMilliVolts(GetLatestADCCounts(true)); }
 
 int ADSBee::ReadSignalStrengthdBm() { return AD8313MilliVoltsTodBm(ReadSignalStrengthMilliVolts()); }
 
 int ADSBee::ReadTLMilliVolts() {
     // Read back the low level TL bias output voltage.
-    adc_select_input(config_.tl_adc_input);
-    tl_adc_counts_ = adc_read();
+    tl_adc_counts_ = GetLatestADCCounts(false);
     return ADCCountsToMilliVolts(tl_adc_counts_);
 }
 
+uint16_t ADSBee::GetADCRingBufferWriteIndex() {
+    return ((dma_channel_hw_addr(adc_dma_channel_)->write_addr - reinterpret_cast<uintptr_t>(adc_ring_buffer_)) /
+            sizeof(uint16_t)) &
+           (kADCRingBufferLenSamples - 1);
+}
+
+uint16_t ADSBee::GetLatestADCCounts(bool get_rssi) {
+    uint16_t index = GetADCRingBufferWriteIndex() - 1;
+    uint16_t parity = get_rssi ? adc_rssi_sample_parity_ : !adc_rssi_sample_parity_;
+    if ((index & 0b1) != parity) {
+        index--;
+    }
+    return adc_ring_buffer_[index & (kADCRingBufferLenSamples - 1)];
+}
+
+uint16_t ADSBee::GetPeakRSSIADCCounts(uint16_t begin_index, uint16_t end_index) {
+    uint16_t window_len_samples = (end_index - begin_index) & (kADCRingBufferLenSamples - 1);
+    uint16_t first_offset = (begin_index & 0b1) != adc_rssi_sample_parity_ ? 1 : 0;
+    if (first_offset >= window_len_samples) {
+        return GetLatestADCCounts(true);  // No RSSI samples in the window.
+    }
+    uint16_t peak_counts = 0;
+    for (uint16_t offset = first_offset; offset < window_len_samples; offset += 2) {
+        peak_counts = MAX(peak_counts, adc_ring_buffer_[(begin_index + offset) & (kADCRingBufferLenSamples - 1)]);
+    }
+    return peak_counts;
+}
+
+uint16_t ADSBee::GetMeanRSSIADCCounts(uint16_t num_samples) {
+    uint16_t index = GetADCRingBufferWriteIndex() - 1;
+    if ((index & 0b1) != adc_rssi_sample_parity_) {
+        index--;
+    }
+    uint32_t sum_counts = 0;
+    for (uint16_t i = 0; i < num_samples; i++, index -= 2) {
+        sum_counts += adc_ring_buffer_[index & (kADCRingBufferLenSamples - 1)];
+    }
+    return sum_counts / num_samples;
+}
+
+void ADSBee::StartADCDMA() {
+    // Stop the ADC and wait for the last conversion to land, so that a stray sample doesn't swap which indices of the
+    // ring buffer hold RSSI and TL samples.
+    adc_run(false);
+    dma_channel_abort(adc_dma_channel_);
+    while (!(adc_hw->cs & ADC_CS_READY_BITS)) {
+    }
+    adc_fifo_drain();
+
+    // Round robin starts from the currently selected input and goes up.
+    adc_select_input(MIN(config_.tl_adc_input, config_.rssi_adc_input));
+    adc_set_round_robin((0b1 << config_.tl_adc_input) | (0b1 << config_.rssi_adc_input));
+    adc_fifo_setup(true,    // Write each conversion to the FIFO.
+                   true,    // Enable DMA data request (DREQ).
+                   1,       // DREQ asserted when at least 1 sample is present.
+                   false,   // Don't set the error bit in FIFO samples.
+                   false);  // Keep full 12-bit samples.
+    adc_set_clkdiv(0);      // Convert back to back: 96 cycles of the 48MHz ADC clock per sample.
+
+    dma_channel_config adc_dma_config = dma_channel_get_default_config(adc_dma_channel_);
+    channel_config_set_transfer_data_size(&adc_dma_config, DMA_SIZE_16);
+    channel_config_set_read_increment(&adc_dma_config, false);
+    channel_config_set_write_increment(&adc_dma_config, true);
+    channel_config_set_ring(&adc_dma_config, true, kADCRingBufferLenBytesLog2);  // Wrap writes around the buffer.
+    channel_config_set_dreq(&adc_dma_config, DREQ_ADC);
+    dma_channel_configure(adc_dma_channel_, &adc_dma_config, adc_ring_buffer_, &adc_hw->fifo,
+                          UINT32_MAX,  // About 2.4 hours at 500kS/s.
+                          true);       // Start now.
+    adc_run(true);
+}
+
+void ADSBee::SetReferencePosition(float latitude_deg, float longitude_deg) {
+    mutex_enter_blocking(&aircraft_dictionary_mutex_);
+    aircraft_dictionary.SetReferencePosition(latitude_deg, longitude_deg);
+    mutex_exit(&aircraft_dictionary_mutex_);
+}
+
 bool ADSBee::SetTLMilliVolts(int tl_mv) {
     if (tl_mv > kTLMaxMV || tl_mv < kTLMinMV) {
         CONSOLE_ERROR("ADSBee::SetTLMilliVolts", "Unable to set tl_mv_ to %d, outside of permissible range %d-%d.\r\n",
@@ -506,9 +760,6 @@ bool ADSBee::SetTLMilliVolts(int tl_mv) {
     return true;
 }
 
-void ADSBee::StartTLLearning(uint16_t tl_learning_num_cycles, uint16_t tl_learning_start_temperature_mv,
-                             uint16_t tl_min_mv, uint16_t tl_max_mv) {
-    tl_learning_temperature_mv_ = tl_learning_start_temperature_mv;
-    tl_learning_temperature_step_mv_ = tl_learning_start_temperature_mv / tl_learning_num_cycles;
-    tl_learning_cycle_start_timestamp_ms_ = get_time_since_boot_ms();
+void ADSBee::StartTLLearning(uint16_t tl_min_mv, uint16_t tl_max_mv) {
+    tl_controller_.Start(tl_mv_, noise_floor_mv_, tl_min_mv, tl_max_mv);
 }
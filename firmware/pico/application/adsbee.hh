@@ -1,16 +1,26 @@
 #ifndef _ADS_BEE_HH_
 #define _ADS_BEE_HH_
 
+#include <atomic>
+
 #include "aircraft_dictionary.hh"
 #include "cpp_at.hh"
-#include "data_structures.hh"  // For PFBQueue.
+#include "data_structures.hh"  // For SPSCQueue.
 #include "hardware/i2c.h"
 #include "hardware/pio.h"
 #include "hardware/watchdog.h"
 #include "macros.hh"  // For MAX / MIN.
+#include "math.h"    // For sqrtf.
+#include "pico/mutex.h"
 #include "settings.hh"
 #include "stdint.h"
 #include "transponder_packet.hh"
+#include "trigger_level_controller.hh"
+
+// Number of interleaved well formed preamble detectors. Can be overridden at build time with a compile definition.
+#ifndef ADSBEE_NUM_WELL_FORMED_PREAMBLE_DETECTORS
+#define ADSBEE_NUM_WELL_FORMED_PREAMBLE_DETECTORS 2
+#endif
 
 class ADSBee {
    public:
@@ -18,25 +28,39 @@ class ADSBee {
     static constexpr int kVDDMV = 3300;               // [mV] Voltage of positive supply rail.
     static constexpr int kTLMaxMV = 3300;             // [mV]
     static constexpr int kTLMinMV = 0;                // [mV]
-    static constexpr uint16_t kMaxNumTransponderPackets =
-        100;  // Defines size of ADSBPacket circular buffer (PFBQueue).
+    static constexpr uint16_t kMaxNumTransponderPackets = 100;  // Max number of packets reported in one batch.
+    static constexpr uint16_t kTransponderPacketQueueDepth = 128;  // Must be a power of two (SPSCQueue).
+    static constexpr uint16_t kDemodPacketQueueDepth = 32;  // Per demodulator state machine, must be a power of two.
     static const uint32_t kStatusLEDOnMs = 10;
-    static const uint16_t kNumDemodStateMachines = 3;  // 2x well-formed preamble, 1x high power preamble
-    static const uint16_t kHighPowerDemodStateMachineIndex = 2;
-
-    static const uint32_t kTLLearningIntervalMs =
-        10000;  // [ms] Length of Simulated Annealing interval for learning trigger level.
-    static const uint16_t kTLLearningNumCycles =
-        100;  // Number of simulated annealing cycles for learning trigger level.
-    static const uint16_t kTLLearningStartTemperatureMV =
-        1000;  // [mV] Starting value for simulated annealing temperature when learning triger level. This corresponds
-               // to the maximum value that the trigger level could be moved (up or down) when exploring a neighbor
-               // state.
+    // Well formed preamble detectors run round-robin on PIO0 state machines 0 to N-1, each paired with a message
+    // demodulator on PIO1. PIO0 only has 4 state machines, so the layout depends on N:
+    //   N=2: SM0-1 well formed, SM2 high power, SM3 IRQ wrapper (wraps IRQ 6 back to IRQ 4).
+    //   N=3: SM0-2 well formed, SM3 IRQ wrapper (wraps IRQ 7 back to IRQ 4). No high power detector.
+    //   N=4: SM0-3 well formed. Relative IRQs wrap from IRQ 7 to IRQ 4 on their own, so no IRQ wrapper is needed.
+    static const uint16_t kNumWellFormedPreambleDetectors = ADSBEE_NUM_WELL_FORMED_PREAMBLE_DETECTORS;
+    static_assert(kNumWellFormedPreambleDetectors >= 2 && kNumWellFormedPreambleDetectors <= 4,
+                  "ADSBEE_NUM_WELL_FORMED_PREAMBLE_DETECTORS must be 2, 3, or 4.");
+    static const bool kHasHighPowerPreambleDetector = kNumWellFormedPreambleDetectors == 2;
+    static const bool kHasIRQWrapper = kNumWellFormedPreambleDetectors < 4;
+    static const uint16_t kNumDemodStateMachines =
+        kNumWellFormedPreambleDetectors + (kHasHighPowerPreambleDetector ? 1 : 0);
+    // Equal to kNumDemodStateMachines (out of range) when there is no high power preamble detector.
+    static const uint16_t kHighPowerDemodStateMachineIndex = kNumWellFormedPreambleDetectors;
 
     static const int32_t kNoiseFloorExpoFilterPercent =
         50;  // [%] Weight to use for low pass expo filter of noise floor ADC counts. 0 = no filter, 100 = hold value.
     static const uint32_t kNoiseFloorADCSampleIntervalMs =
         1;  // [ms] Interval between ADC samples to approximate noise floor value.
+    static const uint16_t kNoiseFloorNumRSSISamples = 8;  // Number of RSSI samples averaged per noise floor update.
+    static const uint32_t kNoiseFloorQuietTimeUs =
+        40;  // [us] Time since the last demod began or ended before RSSI samples are considered to be noise floor.
+
+    // The ADC runs free in round-robin mode between the TL and RSSI inputs at 500kS/s (250kS/s per input), and is
+    // streamed by DMA into a ring buffer. Samples alternate between inputs, starting with the lower numbered input.
+    static const uint16_t kADCRingBufferLenSamples = 256;  // 512us of history. Must be a power of two.
+    static const uint16_t kADCRingBufferLenBytesLog2 = 9;  // DMA ring size, must match kADCRingBufferLenSamples.
+    static_assert((1 << kADCRingBufferLenBytesLog2) == kADCRingBufferLenSamples * sizeof(uint16_t),
+                  "kADCRingBufferLenBytesLog2 doesn't match kADCRingBufferLenSamples.");
 
     struct ADSBeeConfig {
         PIO preamble_detector_pio = pio0;
@@ -46,12 +70,24 @@ class ADSBee {
 
         uint16_t status_led_pin = 15;
         // Reading ADS-B on GPIO19. Will look for DEMOD signal on GPIO20.
+        // A demodulator whose DEMOD pin isn't right after its pulses pin starts from the alternate entry point of the
+        // message demodulator program, which waits on DEMOD at a fixed offset from the pulses pin. All demodulators
+        // using the alternate entry point must share the same offset (10 for GPIO19 -> GPIO29, 7 for GPIO19 -> GPIO26).
+#if ADSBEE_NUM_WELL_FORMED_PREAMBLE_DETECTORS == 4
+        uint16_t pulses_pins[kNumDemodStateMachines] = {19, 22, 19, 22};
+        uint16_t demod_pins[kNumDemodStateMachines] = {20, 23, 26, 29};
+        // Use GPIO21 and GPIO24 for the decode PIO program to output its recovered clock (for debugging only). The
+        // extra demodulators share them, since there are no spare pins.
+        uint16_t recovered_clk_pins[kNumDemodStateMachines] = {21, 24, 21, 24};
+#else
+        // With 3 well formed preamble detectors, the third one takes over the pins of the high power detector.
         uint16_t pulses_pins[kNumDemodStateMachines] = {19, 22, 19};
         uint16_t demod_pins[kNumDemodStateMachines] = {20, 23, 29};
         // Use GPIO22 for the decode PIO program to output its recovered clock (for debugging only).
         uint16_t recovered_clk_pins[kNumDemodStateMachines] = {
             21, 24, 26};  // Set RECOVERED_CLK to fake pin for high power preamble detector. Will be overridden by
                           // higher priority (lower index) SM.
+#endif
         // GPIO 24-25 used as PWM outputs for setting analog comparator threshold voltages.
         uint16_t tl_pwm_pin = 25;
         // GPIO 26-27 used as ADC inputs for reading analog comparator threshold voltages after RF filer.
@@ -73,13 +109,35 @@ class ADSBee {
 
         uint16_t bias_tee_enable_pin = 18;
 
+        // PWM slice that free-runs at clk_sys as the MLAT capture counter. Its pins aren't connected to the slice.
+        uint16_t mlat_capture_pwm_slice = 7;
+
         uint32_t aircraft_dictionary_update_interval_ms = 1000;
+
+        // Run packet decoding and aircraft dictionary ingestion on core 1 via UpdateDecode(). If false, the main loop
+        // schedules UpdateDecode() on core 0 instead. Nothing on the decode path prints directly, since the console
+        // (which is forwarded to the ESP32 over SPI) belongs to core 0. Logs from it go through the deferred log ring.
+        bool core1_decode_enabled = true;
     };
 
     ADSBee(ADSBeeConfig config_in);
     bool Init();
+
+    /**
+     * Housekeeping for core 0: status LED, aircraft dictionary metrics, trigger level learning and noise floor. Doesn't
+     * decode packets, see UpdateDecode().
+     * @retval True if successful, false otherwise.
+     */
     bool Update();
 
+    /**
+     * Pops packets off of the demodulator packet queues, decodes them, ingests them into the aircraft dictionary and
+     * forwards them to the reporting queue. Also prunes the aircraft dictionary. This is the only function that
+     * modifies the aircraft dictionary, and it is run in a loop on core 1 if core1_decode_enabled is true.
+     * @retval True if successful, false otherwise.
+     */
+    bool UpdateDecode();
+
     /**
      * Inlne helper function that converts milliVolts at the AD8313 input to a corresponding value in dBm, using values
      * from the AD8313 datasheet.
@@ -104,6 +162,12 @@ class ADSBee {
      */
     bool BiasTeeIsEnabled() { return bias_tee_enabled_; }
 
+    /**
+     * Returns whether packet decoding and aircraft dictionary ingestion should run on core 1.
+     * @retval True if UpdateDecode() needs to be run on core 1, false if it needs to be run on core 0.
+     */
+    bool Core1DecodeIsEnabled() { return config_.core1_decode_enabled; }
+
     /**
      * Convenience function for temporarily disabling the watchdog without changing its timeout.
      */
@@ -124,10 +188,11 @@ class ADSBee {
     /**
      * Creates a composite timestamp using the current value of the SysTick timer (running at 125MHz) and the SysTick
      * wrap counter to simulate a timer running at 48MHz (which matches the frequency of the preamble detector PIO).
+     * Safe to call from interrupts that block the SysTick wrap exception.
      * @param[in] num_bits Number of bits to mask the counter value to. Defaults to full resolution.
      * @retval 48MHz counter value.
      */
-    inline uint64_t GetMLAT48MHzCounts(uint16_t num_bits = 64);
+    uint64_t GetMLAT48MHzCounts(uint16_t num_bits = 64);
 
     /**
      * Creates a composite timestamp using the current value of the SysTick timer (running at 125MHz) and the SysTick
@@ -139,6 +204,76 @@ class ADSBee {
      */
     inline uint64_t GetMLAT12MHzCounts(uint16_t num_bits = 48);
 
+    /**
+     * Copies the aircraft dictionary while holding the aircraft dictionary mutex, so that core 0 can read a consistent
+     * set of aircraft while core 1 keeps ingesting packets.
+     * @param[out] snapshot AircraftDictionary to overwrite with the contents of the aircraft dictionary.
+     */
+    void GetAircraftDictionarySnapshot(AircraftDictionary &snapshot);
+
+    /**
+     * Returns the most recent aggregate metrics from the aircraft dictionary.
+     * @retval Copy of the aircraft dictionary metrics, taken while holding the aircraft dictionary mutex.
+     */
+    AircraftDictionary::Metrics GetAircraftDictionaryMetrics();
+
+    /**
+     * Statistics for the duration of OnDemodComplete(), measured in clk_sys cycles with the SysTick timer.
+     */
+    struct DemodCompleteISRStats {
+        uint32_t last_cycles = 0;
+        uint32_t max_cycles = 0;
+        uint32_t num_calls = 0;
+    };
+
+    /**
+     * Returns cycle count statistics for the demod complete ISR.
+     * @retval Copy of the ISR statistics.
+     */
+    DemodCompleteISRStats GetDemodCompleteISRStats() { return demod_complete_isr_stats_; }
+
+    /**
+     * Statistics for the difference between the MLAT timestamp taken by OnDemodBegin() in software and the one captured
+     * in hardware when the first word of the packet reaches the demodulator RX FIFO, in MLAT counts. The spread shows
+     * how much interrupt latency jitter the hardware capture removes.
+     */
+    struct MLATJitterStats {
+        uint32_t num_samples = 0;
+        int32_t min_counts = INT32_MAX;
+        int32_t max_counts = INT32_MIN;
+        int64_t sum_counts = 0;
+        uint64_t sum_squares_counts = 0;
+
+        inline float GetMeanCounts() const {
+            return num_samples > 0 ? static_cast<float>(sum_counts) / num_samples : 0;
+        }
+        inline float GetStdDevCounts() const {
+            if (num_samples == 0) {
+                return 0;
+            }
+            float mean_counts = GetMeanCounts();
+            return sqrtf(MAX(static_cast<float>(sum_squares_counts) / num_samples - mean_counts * mean_counts, 0.0f));
+        }
+    };
+
+    /**
+     * Returns MLAT jitter statistics collected since the last call to ResetMLATJitterStats().
+     * @retval Copy of the MLAT jitter statistics.
+     */
+    MLATJitterStats GetMLATJitterStats() { return mlat_jitter_stats_; }
+
+    /**
+     * Clears the MLAT jitter statistics.
+     */
+    void ResetMLATJitterStats() { mlat_jitter_stats_ = MLATJitterStats(); }
+
+    /**
+     * Returns the number of the PIO state machine used for a given message demodulator. Used by on-target tests.
+     * @param[in] sm_index Index of the demodulator, from 0 to kNumDemodStateMachines-1.
+     * @retval State machine number within config.message_demodulator_pio.
+     */
+    uint32_t GetMessageDemodulatorSM(uint16_t sm_index) { return message_demodulator_sm_[sm_index]; }
+
     /**
      * Returns the power level of the noise floor (signal strength sampled mostly during non-decode intervals and then
      * low-pass filtered).
@@ -146,13 +281,6 @@ class ADSBee {
      */
     int GetNoiseFloordBm();
 
-    /**
-     * Get the current temperature used in learning trigger level (simulated annealing). A temperature of 0 means
-     * learning has completed.
-     * @retval Current temperature used for simulated annealing, in milliVolts.
-     */
-    uint16_t GetTLLearningTemperatureMV();
-
     /**
      * Return the value of the low Minimum Trigger Level threshold in milliVolts.
      * @retval TL in milliVolts.
@@ -167,7 +295,9 @@ class ADSBee {
     void OnDemodBegin(uint gpio);
 
     /**
-     * ISR triggered by DECODE completing, via PIO0 IRQ0.
+     * ISR triggered by DECODE completing, via PIO0 IRQ0. Packet words have already been moved out of the demodulator's
+     * RX FIFO by DMA, so this only flushes the last partial word, stamps packet metadata, publishes the packet and
+     * re-arms the DMA channel and demodulator.
      */
     void OnDemodComplete();
 
@@ -176,14 +306,27 @@ class ADSBee {
      */
     void OnSysTickWrap();
 
+    /**
+     * Clears the demod complete ISR statistics.
+     */
+    void ResetDemodCompleteISRStats() { demod_complete_isr_stats_ = DemodCompleteISRStats(); }
+
     /**
      * Resets the watchdog counter to the value set in SetWatchdogTimeoutSec().
      */
     inline void PokeWatchdog() { watchdog_update(); }
 
+    /**
+     * Thread-safe wrappers around the aircraft dictionary reference position functions. Used by settings and AT
+     * commands on core 0.
+     */
+    void ClearReferencePosition();
+    bool GetReferencePosition(float &latitude_deg, float &longitude_deg);
+    void SetReferencePosition(float latitude_deg, float longitude_deg);
+
     /**
      * Returns the Receive Signal Strength Indicator (RSSI) of the signal currently provided by the RF power detector,
-     * in mV.
+     * in mV. Uses the latest sample from the free-running ADC, so this doesn't block.
      * @retval Voltage from the RF power detector, in mV.
      */
     inline int ReadSignalStrengthMilliVolts();
@@ -196,7 +339,7 @@ class ADSBee {
     inline int ReadSignalStrengthdBm();
 
     /**
-     * Read the low Minimum Trigger Level threshold via ADC.
+     * Read the low Minimum Trigger Level threshold via ADC. Uses the latest sample from the free-running ADC.
      * @retval TL in milliVolts.
      */
     int ReadTLMilliVolts();
@@ -267,24 +410,28 @@ class ADSBee {
     }
 
     /**
-     * Start learning the trigger level through Simulated Annealing. Will begin kTLLearningNumCycles annealing cycles
-     * with an annealing interval of kTLLearningIntervalMs milliseconds. Can be provided with maximum and minimum
-     * trigger level bounds to allow a narrower search.
-     * @param[in] tl_learning_num_cycles Number of cycles to use while annealing trigger level (sets the amount that the
-     * annealing temperature is decreased each cycle). Optional, defaults to kTLLearningNumCycles.
-     * @param[in] tl_learning_start_temperature_mv Annealing temperature to start with, in mV.
+     * Start controlling the trigger level in closed loop. The trigger level is tracked as a margin above the noise
+     * floor and adjusted once per aircraft dictionary metrics interval until StopTLLearning() is called. Can be
+     * provided with maximum and minimum trigger level bounds to allow a narrower search.
      * @param[in] tl_min_mv Minimum trigger level to use while learning, in milliVolts. Optional, defaults to full scale
      * (kTLMinMV).
      * @param[in] tl_max_mv Maximum trigger level to use while learning, in milliVolts. Optional, defaults to full scale
      * (kTLMaxMV).
      */
-    void StartTLLearning(uint16_t tl_learning_num_cycles = kTLLearningNumCycles,
-                         uint16_t tl_learning_start_temperature_mv = kTLLearningStartTemperatureMV,
-                         uint16_t tl_min_mv = kTLMinMV, uint16_t tl_max_mv = kTLMaxMV);
+    void StartTLLearning(uint16_t tl_min_mv = kTLMinMV, uint16_t tl_max_mv = kTLMaxMV);
 
-    PFBQueue<RawTransponderPacket> transponder_packet_queue = PFBQueue<RawTransponderPacket>(
-        {.buf_len_num_elements = kMaxNumTransponderPackets, .buffer = transponder_packet_queue_buffer_});
+    /**
+     * Stop controlling the trigger level. The trigger level stays where the controller left it.
+     */
+    void StopTLLearning() { tl_controller_.Stop(); }
+
+    /**
+     * Returns whether the trigger level is being controlled in closed loop.
+     */
+    bool TLLearningIsEnabled() const { return tl_controller_.IsEnabled(); }
 
+    // Owned by UpdateDecode(). Other functions should only access it while holding aircraft_dictionary_mutex_, e.g.
+    // via GetAircraftDictionarySnapshot().
     AircraftDictionary aircraft_dictionary;
 
    private:
@@ -310,21 +457,93 @@ class ADSBee {
 
     uint16_t tl_adc_counts_ = 0;
 
-    uint32_t tl_learning_cycle_start_timestamp_ms_ = 0;
-    uint16_t tl_learning_temperature_mv_ = 0;  // Don't learn automatically.
-    int16_t tl_learning_temperature_step_mv_ = 0;
-    uint16_t tl_learning_max_mv_ = kTLMaxMV;
-    uint16_t tl_learning_min_mv_ = kTLMinMV;
-    int16_t tl_learning_num_valid_packets_ = 0;
-    int16_t tl_learning_prev_num_valid_packets_ = 1;  // Set to 1 to avoid dividing by 0.
-    uint16_t tl_learning_prev_tl_mv_ = tl_mv_;
+    TriggerLevelController tl_controller_ = TriggerLevelController({.tl_min_mv = kTLMinMV, .tl_max_mv = kTLMaxMV});
+
+    volatile uint32_t mlat_counter_1s_wraps_ = 0;
+
+    /**
+     * Points the demodulator's DMA channel at the next free slot in its packet queue, or at its overflow packet if the
+     * queue is full, and starts the channel. Called from Init() and OnDemodComplete().
+     * @param[in] sm_index Index of the demodulator.
+     */
+    void ArmDemodDMA(uint16_t sm_index);
+
+    /**
+     * Returns whether a demodulator starts from the alternate entry point of the message demodulator program, which is
+     * the case when its DEMOD pin isn't directly after its pulses pin.
+     * @param[in] sm_index Index of the demodulator.
+     * @retval True if the demodulator uses high_power_initial_entry, false if it uses initial_entry.
+     */
+    inline bool DemodUsesAlternateEntry(uint16_t sm_index) {
+        return config_.demod_pins[sm_index] != config_.pulses_pins[sm_index] + 1;
+    }
+
+    /**
+     * Returns the index in adc_ring_buffer_ that the ADC DMA channel will write the next sample to.
+     * @retval Index from 0 to kADCRingBufferLenSamples-1.
+     */
+    uint16_t GetADCRingBufferWriteIndex();
+
+    /**
+     * Returns the most recent RSSI or TL sample from the ADC ring buffer.
+     * @param[in] get_rssi True to get the latest RSSI sample, false to get the latest TL sample.
+     * @retval ADC counts, 0 to 4095.
+     */
+    uint16_t GetLatestADCCounts(bool get_rssi);
+
+    /**
+     * Returns the largest RSSI sample taken in a window of the ADC ring buffer. Falls back to the latest RSSI sample if
+     * the window doesn't contain any RSSI samples. Windows longer than the ring buffer get truncated.
+     * @param[in] begin_index Index of the first sample in the window.
+     * @param[in] end_index Index one past the last sample in the window.
+     * @retval Peak RSSI, in ADC counts.
+     */
+    uint16_t GetPeakRSSIADCCounts(uint16_t begin_index, uint16_t end_index);
 
-    uint32_t mlat_counter_1s_wraps_ = 0;
+    /**
+     * Returns the mean of the most recent RSSI samples in the ADC ring buffer.
+     * @param[in] num_samples Number of RSSI samples to average.
+     * @retval Mean RSSI, in ADC counts.
+     */
+    uint16_t GetMeanRSSIADCCounts(uint16_t num_samples);
 
-    RawTransponderPacket rx_packet_[kNumDemodStateMachines];
-    RawTransponderPacket transponder_packet_queue_buffer_[kMaxNumTransponderPackets];
+    /**
+     * Builds the full MLAT timestamp of the start of a packet from the 16-bit PWM counter value captured by DMA when
+     * its first word was pushed. The upper bits come from the OnDemodBegin() timestamp, which is only off by interrupt
+     * latency, far less than half of a PWM wrap.
+     * @param[in] sm_index Index of the demodulator.
+     * @param[in] isr_mlat_counts Timestamp taken in OnDemodBegin().
+     * @retval MLAT counter value at the start of the demod interval.
+     */
+    uint64_t GetCapturedMLATCounts(uint16_t sm_index, uint64_t isr_mlat_counts);
 
-    uint32_t last_aircraft_dictionary_update_timestamp_ms_ = 0;
+    /**
+     * (Re)starts the free-running ADC and the DMA channel that streams it into adc_ring_buffer_. Called from Init(),
+     * and from Update() once the DMA transfer count runs out.
+     */
+    void StartADCDMA();
+
+    // One queue per demodulator state machine. Each demodulator's RX FIFO is streamed by DMA directly into the next
+    // free slot of its queue, which OnDemodComplete() publishes once the packet is complete. Drained by UpdateDecode().
+    SPSCQueue<RawTransponderPacket, kDemodPacketQueueDepth> demod_packet_queues_[kNumDemodStateMachines];
+    int demod_dma_channels_[kNumDemodStateMachines];
+    // Packet that each demodulator's DMA channel is currently writing into.
+    RawTransponderPacket *demod_dma_packets_[kNumDemodStateMachines];
+    // Landing spot for packets that arrive while a demodulator's queue is full. These are dropped.
+    RawTransponderPacket demod_overflow_packets_[kNumDemodStateMachines];
+
+    DemodCompleteISRStats demod_complete_isr_stats_;
+
+    mutex_t aircraft_dictionary_mutex_;
+    // Demod counts from OnDemodBegin() and OnDemodComplete(), which can't take aircraft_dictionary_mutex_. Each counter
+    // has a single ISR writing to it and only counts up. UpdateDecode() folds the counts added since its last visit
+    // into the aircraft dictionary metrics under the mutex.
+    std::atomic<uint32_t> isr_demods_1090_[kNumDemodStateMachines] = {};
+    std::atomic<uint32_t> isr_demod_overlaps_1090_[kNumDemodStateMachines] = {};
+    uint32_t folded_demods_1090_[kNumDemodStateMachines] = {0};
+    uint32_t folded_demod_overlaps_1090_[kNumDemodStateMachines] = {0};
+    uint32_t last_aircraft_dictionary_update_timestamp_ms_ = 0;   // Used by UpdateDecode() for pruning.
+    uint32_t last_aircraft_dictionary_metrics_timestamp_ms_ = 0;  // Used by Update() for reporting metrics.
 
     bool receiver_enabled_ = true;
     bool bias_tee_enabled_ = false;
@@ -332,6 +551,25 @@ class ADSBee {
 
     int32_t noise_floor_mv_;
     uint32_t noise_floor_last_sample_timestamp_ms_ = 0;
+
+    // Aligned to its size so that the DMA channel can wrap writes around it.
+    alignas(kADCRingBufferLenSamples * sizeof(uint16_t)) uint16_t adc_ring_buffer_[kADCRingBufferLenSamples] = {0};
+    int adc_dma_channel_ = -1;
+    uint16_t adc_rssi_sample_parity_ = 0;  // RSSI samples are at even (0) or odd (1) indices of adc_ring_buffer_.
+    // ADC ring buffer write index at the start of each demodulator's current demod interval.
+    volatile uint16_t demod_begin_adc_indices_[kNumDemodStateMachines] = {0};
+    volatile uint32_t last_demod_activity_timestamp_us_ = 0;  // Time the last demod interval began or ended.
+    uint32_t demod_pins_mask_ = 0;                            // GPIO mask with all DEMOD pins set.
+
+    // When the first word of a packet lands in a demodulator's RX FIFO, a DMA channel paced by the same DREQ copies the
+    // free-running MLAT capture PWM counter into mlat_capture_pwm_counts_.
+    int mlat_dma_channels_[kNumDemodStateMachines];
+    volatile uint32_t mlat_capture_pwm_counts_[kNumDemodStateMachines] = {0};
+    // SysTick and the capture PWM both run at clk_sys and wrap at multiples of 2^16 counts, so the low 16 bits of the
+    // MLAT counter are always the PWM counter plus this offset.
+    uint16_t mlat_capture_pwm_offset_counts_ = 0;
+    uint32_t mlat_first_word_offset_counts_ = 0;  // MLAT counts between start of demod and the first RX FIFO push.
+    MLATJitterStats mlat_jitter_stats_;
 };
 
 extern ADSBee adsbee;
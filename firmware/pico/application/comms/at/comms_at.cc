@@ -1,5 +1,6 @@
 #include <stdio.h>  // for printing
 
+#include <cstdlib>   // for strtof
 #include <cstring>   // for strcat
 #include <iostream>  // for AT command ingestion
 
@@ -8,10 +9,13 @@
 #include "eeprom.hh"
 #include "esp32_flasher.hh"
 #include "firmware_update.hh"
+#include "hardware/clocks.h"  // For converting MLAT counts to nanoseconds.
 #include "main.hh"
+#include "perf_monitor.hh"
 #include "pico/stdlib.h"  // for getchar etc
 #include "settings.hh"
 #include "spi_coprocessor.hh"  // For init / de-init before and after flashing ESP32.
+#include "task_scheduler.hh"
 
 #ifdef HARDWARE_UNIT_TESTS
 #include "hardware_unit_tests.hh"
@@ -28,6 +32,8 @@ const uint32_t kDeviceInfoProgrammingPassword = 0xDEDBEEF;
 // Heartbeat is required since the ESP32 firmware won't hand off the SPI mutex until it gets poked, so it needs a
 // heartbeat between each message (no ACK required).
 const uint32_t kOTAHeartbeatMs = 10;
+// Longest latitude or longitude argument accepted by AT+RX_POSITION, not including the null terminator.
+const uint16_t kATRxPositionArgMaxLen = 16;
 
 /** CppAT Printf Override **/
 int CppAT::cpp_at_printf(const char *format, ...) {
@@ -456,15 +462,14 @@ CPP_AT_CALLBACK(CommsManager::ATOTACallback) {
                                 }
                             } else {
                                 // Didn't receive any Bytes. Refresh network console and update timeout timestamp.
-                                // esp32.Update();
+                                // Nothing else runs the SPI transaction engine while this command blocks.
+                                esp32.Update();
                                 // Poll the ESP32 by sending a heartbeat message (no ACK required) get the ESP32
                                 // firmware to release the SPI mutex to the task that's forwarding data from the network
                                 // console.
                                 timestamp_ms = get_time_since_boot_ms();
                                 if (timestamp_ms - last_ota_heartbeat_timestamp_ms > kOTAHeartbeatMs) {
-                                    // Don't call update manually here, it gets taken care of in the Write function.
-                                    // Calling Update twice will result in the network console buffer overflowing if two
-                                    // blobs of characters are ready to be transmitted sequentially!
+                                    // Queued, and sent by the next calls to Update().
                                     esp32.Write(ObjectDictionary::kAddrScratch, timestamp_ms, false);
                                     last_ota_heartbeat_timestamp_ms = timestamp_ms;
                                 }
@@ -567,6 +572,95 @@ CPP_AT_CALLBACK(CommsManager::ATLogLevelCallback) {
     CPP_AT_ERROR("Operator '%c' not supported.", op);
 }
 
+/**
+ * AT+MLAT_JITTER Callback
+ * AT+MLAT_JITTER?
+ * +MLAT_JITTER=<num_samples>,<mean_ns>,<std_dev_ns>,<min_ns>,<max_ns>
+ * AT+MLAT_JITTER=RESET
+ */
+CPP_AT_CALLBACK(CommsManager::ATMLATJitterCallback) {
+    switch (op) {
+        case '?': {
+            ADSBee::MLATJitterStats stats = adsbee.GetMLATJitterStats();
+            // MLAT counts are clk_sys cycles.
+            float ns_per_count = 1e9f / clock_get_hz(clk_sys);
+            if (stats.num_samples == 0) {
+                CPP_AT_CMD_PRINTF("=0\r\n");
+            } else {
+                CPP_AT_CMD_PRINTF("=%lu,%.1f,%.1f,%.1f,%.1f\r\n", stats.num_samples,
+                                  stats.GetMeanCounts() * ns_per_count, stats.GetStdDevCounts() * ns_per_count,
+                                  stats.min_counts * ns_per_count, stats.max_counts * ns_per_count);
+            }
+            CPP_AT_SILENT_SUCCESS();
+            break;
+        }
+        case '=':
+            if (CPP_AT_HAS_ARG(0) && args[0].compare("RESET") == 0) {
+                adsbee.ResetMLATJitterStats();
+                CPP_AT_SUCCESS();
+            }
+            CPP_AT_ERROR("Unrecognized argument.");
+            break;
+    }
+    CPP_AT_ERROR("Operator '%c' not supported.", op);
+}
+
+/**
+ * AT+PERF Callback
+ * AT+PERF?
+ * +PERF=<stage>,<num_samples>,<min_us>,<mean_us>,<max_us>
+ * +PERF_QUEUE=<queue>,<high_water_mark>,<num_drops>
+ * AT+PERF=HISTOGRAM
+ * +PERF_HISTOGRAM=<stage>,<bin 0 count>,<bin 1 count>,...
+ * AT+PERF=RESET
+ */
+CPP_AT_CALLBACK(CommsManager::ATPerfCallback) {
+#if ADSBEE_PERF_PROBES_ENABLED
+    PerfMonitor::Stats stats = perf_monitor.GetStats();
+    switch (op) {
+        case '?': {
+            float us_per_cycle = 1.0f / stats.cycles_per_us;
+            for (uint16_t i = 0; i < PerfMonitor::kNumStages; i++) {
+                const PerfMonitor::StageStats &stage = stats.stages[i];
+                CPP_AT_CMD_PRINTF("=%s,%lu,%.2f,%.2f,%.2f\r\n", PerfMonitor::kStageStrs[i], stage.num_samples,
+                                  stage.num_samples > 0 ? stage.min_cycles * us_per_cycle : 0.0f,
+                                  stage.GetMeanCycles() * us_per_cycle, stage.max_cycles * us_per_cycle);
+            }
+            for (uint16_t i = 0; i < PerfMonitor::kNumQueues; i++) {
+                CPP_AT_PRINTF("+PERF_QUEUE=%s,%u,%lu\r\n", PerfMonitor::kQueueStrs[i], stats.queues[i].high_water_mark,
+                              stats.queues[i].num_drops);
+            }
+            CPP_AT_SILENT_SUCCESS();
+            break;
+        }
+        case '=':
+            if (CPP_AT_HAS_ARG(0) && args[0].compare("HISTOGRAM") == 0) {
+                CPP_AT_PRINTF("+PERF_HISTOGRAM=BIN_MIN_CYCLES");
+                for (uint16_t bin = 0; bin < PerfMonitor::kNumHistogramBins; bin++) {
+                    CPP_AT_PRINTF(",%lu", PerfMonitor::GetHistogramBinMinCycles(bin));
+                }
+                CPP_AT_PRINTF("\r\n");
+                for (uint16_t i = 0; i < PerfMonitor::kNumStages; i++) {
+                    CPP_AT_PRINTF("+PERF_HISTOGRAM=%s", PerfMonitor::kStageStrs[i]);
+                    for (uint16_t bin = 0; bin < PerfMonitor::kNumHistogramBins; bin++) {
+                        CPP_AT_PRINTF(",%lu", stats.stages[i].histogram[bin]);
+                    }
+                    CPP_AT_PRINTF("\r\n");
+                }
+                CPP_AT_SILENT_SUCCESS();
+            } else if (CPP_AT_HAS_ARG(0) && args[0].compare("RESET") == 0) {
+                perf_monitor.Reset();
+                CPP_AT_SUCCESS();
+            }
+            CPP_AT_ERROR("Unrecognized argument.");
+            break;
+    }
+    CPP_AT_ERROR("Operator '%c' not supported.", op);
+#else
+    CPP_AT_ERROR("Perf probes are compiled out of this build.");
+#endif
+}
+
 CPP_AT_CALLBACK(CommsManager::ATNetworkInfoCallback) {
     switch (op) {
         case '?':
@@ -692,6 +786,76 @@ CPP_AT_CALLBACK(CommsManager::ATRxEnableCallback) {
     CPP_AT_ERROR("Operator '%c' not supported.", op);
 }
 
+CPP_AT_CALLBACK(CommsManager::ATRxPositionCallback) {
+    switch (op) {
+        case '=':
+            if (CPP_AT_HAS_ARG(0) && args[0].compare("CLEAR") == 0) {
+                adsbee.ClearReferencePosition();
+                CPP_AT_SUCCESS();
+            } else if (CPP_AT_HAS_ARG(0) && CPP_AT_HAS_ARG(1)) {
+                // Copy args into null terminated buffers, since floats can't be parsed directly from a string_view.
+                char lat_str[kATRxPositionArgMaxLen + 1] = {'\0'};
+                char lon_str[kATRxPositionArgMaxLen + 1] = {'\0'};
+                strncpy(lat_str, args[0].data(), MIN(args[0].length(), kATRxPositionArgMaxLen));
+                strncpy(lon_str, args[1].data(), MIN(args[1].length(), kATRxPositionArgMaxLen));
+                char *lat_end, *lon_end;
+                float latitude_deg = strtof(lat_str, &lat_end);
+                float longitude_deg = strtof(lon_str, &lon_end);
+                if (lat_end == lat_str || *lat_end != '\0' || latitude_deg < -90.0f || latitude_deg > 90.0f) {
+                    CPP_AT_ERROR("Invalid latitude %s, must be between -90 and 90 degrees.", lat_str);
+                }
+                if (lon_end == lon_str || *lon_end != '\0' || longitude_deg < -180.0f || longitude_deg > 180.0f) {
+                    CPP_AT_ERROR("Invalid longitude %s, must be between -180 and 180 degrees.", lon_str);
+                }
+                adsbee.SetReferencePosition(latitude_deg, longitude_deg);
+                CPP_AT_SUCCESS();
+            }
+            break;
+        case '?': {
+            float latitude_deg, longitude_deg;
+            if (adsbee.GetReferencePosition(latitude_deg, longitude_deg)) {
+                CPP_AT_CMD_PRINTF("=%.5f,%.5f", latitude_deg, longitude_deg);
+            } else {
+                CPP_AT_CMD_PRINTF("=CLEAR");
+            }
+            CPP_AT_SILENT_SUCCESS();
+            break;
+        }
+    }
+    CPP_AT_ERROR("Operator '%c' not supported.", op);
+}
+
+/**
+ * AT+SCHEDULER Callback
+ * AT+SCHEDULER?
+ * +SCHEDULER=<task>,<priority>,<period_us>,<deadline_us>,<budget_us>,<num_runs>,<num_deadline_misses>,
+ * <num_budget_overruns>,<max_latency_us>,<max_runtime_us>
+ * AT+SCHEDULER=RESET
+ */
+CPP_AT_CALLBACK(CommsManager::ATSchedulerCallback) {
+    switch (op) {
+        case '?':
+            for (uint16_t i = 0; i < task_scheduler.GetNumTasks(); i++) {
+                const TaskScheduler::Task &task = task_scheduler.GetTask(i);
+                TaskScheduler::TaskStats stats = task_scheduler.GetTaskStats(i);
+                CPP_AT_CMD_PRINTF("=%s,%u,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\r\n", task.name, task.priority,
+                                  task.period_us, task.deadline_us, task.budget_us, stats.num_runs,
+                                  stats.num_deadline_misses, stats.num_budget_overruns, stats.max_latency_us,
+                                  stats.max_runtime_us);
+            }
+            CPP_AT_SILENT_SUCCESS();
+            break;
+        case '=':
+            if (CPP_AT_HAS_ARG(0) && args[0].compare("RESET") == 0) {
+                task_scheduler.ResetStats();
+                CPP_AT_SUCCESS();
+            }
+            CPP_AT_ERROR("Unrecognized argument.");
+            break;
+    }
+    CPP_AT_ERROR("Operator '%c' not supported.", op);
+}
+
 CPP_AT_CALLBACK(CommsManager::ATSettingsCallback) {
     switch (op) {
         case '=':
@@ -737,7 +901,9 @@ CPP_AT_CALLBACK(CommsManager::ATTLReadCallback) {
 /**
  * AT+TL_SET Callback
  * AT+TL_SET=<tl_mv>
- *  tl_mv = Trigger Level, in milliVolts.
+ *  tl_mv = Trigger Level, in milliVolts. Stops closed-loop trigger level control.
+ * AT+TL_SET=LEARN
+ *  Start closed-loop trigger level control.
  * AT+TL_SET?
  * +TL_SET=
  */
@@ -754,10 +920,11 @@ CPP_AT_CALLBACK(CommsManager::ATTLSetCallback) {
             // Attempt setting LO TL value, in milliVolts, if first argument is not blank.
             if (CPP_AT_HAS_ARG(0)) {
                 if (args[0].compare("LEARN") == 0) {
-                    // Starting a new trigger level learning session.
+                    // Start closed-loop trigger level control from the current trigger level.
                     adsbee.StartTLLearning();
                 } else {
                     // Assigning trigger level manually.
+                    adsbee.StopTLLearning();
                     uint16_t new_tl_mv;
                     CPP_AT_TRY_ARG2NUM(0, new_tl_mv);
                     if (!adsbee.SetTLMilliVolts(new_tl_mv)) {
@@ -950,6 +1117,13 @@ const CppAT::ATCommandDef_t at_command_list[] = {
          "AT+LOG_LEVEL=<log_level [SILENT ERRORS WARNINGS LOGS]>\r\n\tSet how much stuff gets printed to the "
          "console.\r\n\t",
      .callback = CPP_AT_BIND_MEMBER_CALLBACK(CommsManager::ATLogLevelCallback, comms_manager)},
+    {.command_buf = "+MLAT_JITTER",
+     .min_args = 0,
+     .max_args = 1,
+     .help_string_buf = "AT+MLAT_JITTER?\r\n\t+MLAT_JITTER=<num_samples>,<mean_ns>,<std_dev_ns>,<min_ns>,<max_ns>\r\n\t"
+                        "Query how far interrupt timestamps land from hardware captured MLAT timestamps.\r\n\t"
+                        "AT+MLAT_JITTER=RESET\r\n\tClear the statistics.",
+     .callback = CPP_AT_BIND_MEMBER_CALLBACK(CommsManager::ATMLATJitterCallback, comms_manager)},
     {.command_buf = "+NETWORK_INFO",
      .min_args = 0,
      .max_args = 0,
@@ -960,6 +1134,15 @@ const CppAT::ATCommandDef_t at_command_list[] = {
      .max_args = 4,
      .help_callback = CPP_AT_BIND_MEMBER_HELP_CALLBACK(CommsManager::ATOTAHelpCallback, comms_manager),
      .callback = CPP_AT_BIND_MEMBER_CALLBACK(CommsManager::ATOTACallback, comms_manager)},
+    {.command_buf = "+PERF",
+     .min_args = 0,
+     .max_args = 1,
+     .help_string_buf = "AT+PERF?\r\n\t+PERF=<stage>,<num_samples>,<min_us>,<mean_us>,<max_us>\r\n\t"
+                        "+PERF_QUEUE=<queue>,<high_water_mark>,<num_drops>\r\n\t"
+                        "Query time spent in each stage of the receive pipeline, and queue usage.\r\n\t"
+                        "AT+PERF=HISTOGRAM\r\n\tPrint duration histograms for each stage, in cycles.\r\n\t"
+                        "AT+PERF=RESET\r\n\tClear the statistics.",
+     .callback = CPP_AT_BIND_MEMBER_CALLBACK(CommsManager::ATPerfCallback, comms_manager)},
     {.command_buf = "+PROTOCOL",
      .min_args = 0,
      .max_args = 2,
@@ -979,6 +1162,21 @@ const CppAT::ATCommandDef_t at_command_list[] = {
      .callback = CPP_AT_BIND_MEMBER_CALLBACK(CommsManager::ATRxEnableCallback, comms_manager)
 
     },
+    {.command_buf = "+RX_POSITION",
+     .min_args = 0,
+     .max_args = 2,
+     .help_string_buf = "RX_POSITION=<lat_deg>,<lon_deg>\r\n\tOK\r\n\tSets the receiver position, used to decode an "
+                        "aircraft's position from a single packet.\r\n\tAT+RX_POSITION=CLEAR\r\n\tOK\r\n\tForgets "
+                        "the receiver position.\r\n\tAT+RX_POSITION?\r\n\t+RX_POSITION=<lat_deg>,<lon_deg>\r\n\t"
+                        "Query the receiver position.",
+     .callback = CPP_AT_BIND_MEMBER_CALLBACK(CommsManager::ATRxPositionCallback, comms_manager)},
+    {.command_buf = "+SCHEDULER",
+     .min_args = 0,
+     .max_args = 1,
+     .help_string_buf = "AT+SCHEDULER?\r\n\t+SCHEDULER=<task>,<priority>,<period_us>,<deadline_us>,<budget_us>,"
+                        "<num_runs>,<num_deadline_misses>,<num_budget_overruns>,<max_latency_us>,<max_runtime_us>\r\n\t"
+                        "Query main loop tasks and their timing.\r\n\tAT+SCHEDULER=RESET\r\n\tClear the statistics.",
+     .callback = CPP_AT_BIND_MEMBER_CALLBACK(CommsManager::ATSchedulerCallback, comms_manager)},
     {.command_buf = "+SETTINGS",
      .min_args = 0,
      .max_args = 3,
@@ -1003,6 +1201,7 @@ const CppAT::ATCommandDef_t at_command_list[] = {
      .min_args = 0,
      .max_args = 1,
      .help_string_buf = "Set minimum trigger level threshold for RF power detector.\r\n\tAT+TLSet=<tl_mv>"
+                        "\tStart closed-loop trigger level control.\r\n\tAT+TL_SET=LEARN\r\n"
                         "\tQuery trigger level.\r\n\tAT+TL_SET?\r\n\t+TLSet=<tl_mv>.",
      .callback = CPP_AT_BIND_MEMBER_CALLBACK(CommsManager::ATTLSetCallback, comms_manager)},
     {.command_buf = "+WATCHDOG",
@@ -1032,17 +1231,21 @@ bool CommsManager::UpdateAT() {
     static char stdio_at_command_buf[kATCommandBufMaxLen];
     static uint16_t stdio_at_command_buf_len = 0;
     // Check for new AT commands from STDIO. Process up to one line per loop.
-    char c = static_cast<char>(getchar_timeout_us(0));
-    while (static_cast<int8_t>(c) != PICO_ERROR_TIMEOUT) {
-        stdio_at_command_buf[stdio_at_command_buf_len] = c;
-        stdio_at_command_buf_len++;
-        stdio_at_command_buf[stdio_at_command_buf_len] = '\0';
-        if (c == '\n') {
-            at_parser_.ParseMessage(std::string_view(stdio_at_command_buf));
-            stdio_at_command_buf_len = 0;
-            stdio_at_command_buf[stdio_at_command_buf_len] = '\0';  // clear command buffer
-        }
+    char c;
+    {
+        PERF_PROBE(PerfMonitor::kStageUSBConsole);
         c = static_cast<char>(getchar_timeout_us(0));
+        while (static_cast<int8_t>(c) != PICO_ERROR_TIMEOUT) {
+            stdio_at_command_buf[stdio_at_command_buf_len] = c;
+            stdio_at_command_buf_len++;
+            stdio_at_command_buf[stdio_at_command_buf_len] = '\0';
+            if (c == '\n') {
+                at_parser_.ParseMessage(std::string_view(stdio_at_command_buf));
+                stdio_at_command_buf_len = 0;
+                stdio_at_command_buf[stdio_at_command_buf_len] = '\0';  // clear command buffer
+            }
+            c = static_cast<char>(getchar_timeout_us(0));
+        }
     }
 
     if (esp32.IsEnabled()) {
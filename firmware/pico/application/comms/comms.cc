@@ -35,6 +35,27 @@ bool CommsManager::Update() {
     UpdateAT();
     UpdateNetworkConsole();
     UpdateReporting();
+    UpdateDeferredLog();
+    return true;
+}
+
+bool CommsManager::UpdateDeferredLog() {
+    DeferredLog::Entry entry;
+    char buf[kPrintfBufferMaxSize];
+    for (uint16_t i = 0; i < kMaxNumDeferredLogEntriesPerUpdate && deferred_log.Pop(entry); i++) {
+        if (log_level < entry.level) {
+            continue;  // Log level may have been turned down since the message was stored.
+        }
+        DeferredLog::Format(entry, buf, kPrintfBufferMaxSize);
+        iface_puts(SettingsManager::SerialInterface::kConsole, buf);
+    }
+
+    uint32_t num_dropped_entries = deferred_log.GetNumDroppedEntries();
+    if (num_dropped_entries != deferred_log_num_dropped_entries_reported_) {
+        CONSOLE_WARNING("CommsManager::UpdateDeferredLog", "Dropped %lu deferred log messages.",
+                        num_dropped_entries - deferred_log_num_dropped_entries_reported_);
+        deferred_log_num_dropped_entries_reported_ = num_dropped_entries;
+    }
     return true;
 }
 
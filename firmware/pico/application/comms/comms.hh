@@ -4,7 +4,8 @@
 // #include "transponder_packet.hh"  // For DecodedTransponderPacket.
 #include "adsbee.hh"
 #include "cpp_at.hh"
-#include "data_structures.hh"  // For PFBQueue.
+#include "data_structures.hh"  // For PFBQueue and SPSCQueue.
+#include "deferred_log.hh"
 #include "hardware/uart.h"
 #include "settings.hh"
 
@@ -13,6 +14,8 @@ class CommsManager {
     static const uint16_t kATCommandBufMaxLen = 1000;
     static const uint16_t kNetworkConsoleBufMaxLen = 4096;
     static const uint16_t kPrintfBufferMaxSize = 500;
+    // Bounds the time spent printing deferred log messages in each call to Update().
+    static const uint16_t kMaxNumDeferredLogEntriesPerUpdate = 8;
     static const uint32_t kRawReportingIntervalMs = 50;  // Report packets internally at 20Hz.
     static const uint32_t kMAVLINKReportingIntervalMs = 1000;
     static const uint32_t kCSBeeReportingIntervalMs = 1000;
@@ -52,6 +55,12 @@ class CommsManager {
      */
     bool UpdateNetworkConsole();
 
+    /**
+     * Formats and prints messages from the deferred log (CONSOLE_*_DEFERRED macros). Called as part of Update().
+     * @retval True if update succeeded, false otherwise.
+     */
+    bool UpdateDeferredLog();
+
     CPP_AT_CALLBACK(ATBaudrateCallback);
     CPP_AT_CALLBACK(ATBiasTeeEnableCallback);
     CPP_AT_CALLBACK(ATDeviceInfoCallback);
@@ -63,11 +72,15 @@ class CommsManager {
     CPP_AT_CALLBACK(ATOTACallback);
     CPP_AT_HELP_CALLBACK(ATOTAHelpCallback);
     CPP_AT_CALLBACK(ATLogLevelCallback);
+    CPP_AT_CALLBACK(ATMLATJitterCallback);
     CPP_AT_CALLBACK(ATNetworkInfoCallback);
+    CPP_AT_CALLBACK(ATPerfCallback);
     CPP_AT_CALLBACK(ATProtocolCallback);
     CPP_AT_HELP_CALLBACK(ATProtocolHelpCallback);
     CPP_AT_CALLBACK(ATRebootCallback);
     CPP_AT_CALLBACK(ATRxEnableCallback);
+    CPP_AT_CALLBACK(ATRxPositionCallback);
+    CPP_AT_CALLBACK(ATSchedulerCallback);
     CPP_AT_CALLBACK(ATSettingsCallback);
     CPP_AT_CALLBACK(ATTLReadCallback);
     CPP_AT_CALLBACK(ATTLSetCallback);
@@ -165,10 +178,9 @@ class CommsManager {
     // Public console settings.
     SettingsManager::LogLevel log_level = SettingsManager::LogLevel::kInfo;  // Start with highest verbosity by default.
 
-    // Queue for storing transponder packets before they get reported.
-    PFBQueue<DecodedTransponderPacket> transponder_packet_reporting_queue =
-        PFBQueue<DecodedTransponderPacket>({.buf_len_num_elements = ADSBee::kMaxNumTransponderPackets,
-                                            .buffer = transponder_packet_reporting_queue_buffer_});
+    // Queue for storing transponder packets before they get reported. Filled by ADSBee::UpdateDecode() (core 1 in
+    // multicore mode), drained by UpdateReporting().
+    SPSCQueue<DecodedTransponderPacket, ADSBee::kTransponderPacketQueueDepth> transponder_packet_reporting_queue;
 
     // Queues for incoming / outgoing network characters.
     PFBQueue<char> esp32_console_rx_queue =
@@ -244,8 +256,8 @@ class CommsManager {
     char esp32_console_rx_queue_buffer_[kNetworkConsoleBufMaxLen];
     char esp32_console_tx_queue_buffer_[kNetworkConsoleBufMaxLen];
 
-    // Queue for holding new transponder packets before they get reported.
-    DecodedTransponderPacket transponder_packet_reporting_queue_buffer_[ADSBee::kMaxNumTransponderPackets];
+    // Copy of the aircraft dictionary used for reporting, since the live dictionary may be modified by core 1.
+    AircraftDictionary aircraft_dictionary_snapshot_;
 
     // Reporting Settings
     uint32_t comms_uart_baudrate_ = SettingsManager::Settings::kDefaultCommsUARTBaudrate;
@@ -265,6 +277,9 @@ class CommsManager {
     // OTA configuration. Used to ignore incoming UART commands while processing OTA data.
     uint32_t ota_transfer_begin_timestamp_ms_ = 0;
     uint32_t ota_transfer_bytes_remaining_ = 0;
+
+    // Number of dropped deferred log messages that have already been warned about.
+    uint32_t deferred_log_num_dropped_entries_reported_ = 0;
 };
 
 extern CommsManager comms_manager;
@@ -289,16 +304,54 @@ extern const uint16_t at_command_list_num_commands;
 
 #define TEXT_COLOR_RESET            "\033[0m"
 
+// Most verbose log level compiled into the firmware, as a SettingsManager::LogLevel value (0 = SILENT, 1 = ERRORS,
+// 2 = WARNINGS, 3 = INFO). Log statements above this level compile away entirely, including their arguments, and can't
+// be turned back on with AT+LOG_LEVEL. Override with e.g. -DADSBEE_COMPILED_LOG_LEVEL=1 to only keep errors.
+#ifndef ADSBEE_COMPILED_LOG_LEVEL
+#define ADSBEE_COMPILED_LOG_LEVEL 3
+#endif
+
+// Checks the runtime log level before evaluating any arguments.
+#define CONSOLE_LEVEL_PRINTF(level, format, ...)                                                                    \
+    (comms_manager.log_level >= level ? comms_manager.console_level_printf(level, format __VA_OPT__(, ) __VA_ARGS__) \
+                                      : 0)
+// Stores the message in the deferred log to be printed by CommsManager::UpdateDeferredLog(). Use in hot paths and on
+// core 1, which can't print directly since console output is forwarded to the ESP32 over SPI from core 0. Used as the
+// sink of CONSOLE_*_DEFERRED (see deferred_log.hh).
+#define CONSOLE_LEVEL_DEFERRED(level, format, ...) \
+    (comms_manager.log_level >= level ? deferred_log.Log(level, format __VA_OPT__(, ) __VA_ARGS__) : false)
+
 #define CONSOLE_PRINTF(format, ...) comms_manager.console_printf(format __VA_OPT__(, ) __VA_ARGS__);
-#define CONSOLE_INFO(tag, format, ...)                                   \
-    comms_manager.console_level_printf(SettingsManager::LogLevel::kInfo, \
-                                       tag ": " format "\r\n" __VA_OPT__(, ) __VA_ARGS__);
-#define CONSOLE_WARNING(tag, format, ...)                                                                       \
-    comms_manager.console_level_printf(SettingsManager::LogLevel::kWarnings,                                    \
-                                       tag ": " TEXT_COLOR_YELLOW format TEXT_COLOR_RESET "\r\n" __VA_OPT__(, ) \
-                                           __VA_ARGS__);
-#define CONSOLE_ERROR(tag, format, ...)                                        \
-    comms_manager.console_level_printf(SettingsManager::LogLevel::kErrors, tag \
-                                       ": " TEXT_COLOR_RED format TEXT_COLOR_RESET "\r\n" __VA_OPT__(, ) __VA_ARGS__);
+#if ADSBEE_COMPILED_LOG_LEVEL >= 3
+#define CONSOLE_INFO(tag, format, ...) \
+    CONSOLE_LEVEL_PRINTF(SettingsManager::LogLevel::kInfo, tag ": " format "\r\n" __VA_OPT__(, ) __VA_ARGS__);
+#define CONSOLE_INFO_DEFERRED_SINK(tag, format, ...) \
+    CONSOLE_LEVEL_DEFERRED(SettingsManager::LogLevel::kInfo, tag ": " format "\r\n" __VA_OPT__(, ) __VA_ARGS__);
+#else
+#define CONSOLE_INFO(tag, format, ...)               ((void)0);
+#define CONSOLE_INFO_DEFERRED_SINK(tag, format, ...) ((void)0);
+#endif
+#if ADSBEE_COMPILED_LOG_LEVEL >= 2
+#define CONSOLE_WARNING(tag, format, ...)                                                                      \
+    CONSOLE_LEVEL_PRINTF(SettingsManager::LogLevel::kWarnings,                                                 \
+                         tag ": " TEXT_COLOR_YELLOW format TEXT_COLOR_RESET "\r\n" __VA_OPT__(, ) __VA_ARGS__);
+#define CONSOLE_WARNING_DEFERRED_SINK(tag, format, ...)                                                        \
+    CONSOLE_LEVEL_DEFERRED(SettingsManager::LogLevel::kWarnings,                                               \
+                           tag ": " TEXT_COLOR_YELLOW format TEXT_COLOR_RESET "\r\n" __VA_OPT__(, ) __VA_ARGS__);
+#else
+#define CONSOLE_WARNING(tag, format, ...)               ((void)0);
+#define CONSOLE_WARNING_DEFERRED_SINK(tag, format, ...) ((void)0);
+#endif
+#if ADSBEE_COMPILED_LOG_LEVEL >= 1
+#define CONSOLE_ERROR(tag, format, ...)                                                                        \
+    CONSOLE_LEVEL_PRINTF(SettingsManager::LogLevel::kErrors,                                                   \
+                         tag ": " TEXT_COLOR_RED format TEXT_COLOR_RESET "\r\n" __VA_OPT__(, ) __VA_ARGS__);
+#define CONSOLE_ERROR_DEFERRED_SINK(tag, format, ...)                                                          \
+    CONSOLE_LEVEL_DEFERRED(SettingsManager::LogLevel::kErrors,                                                 \
+                           tag ": " TEXT_COLOR_RED format TEXT_COLOR_RESET "\r\n" __VA_OPT__(, ) __VA_ARGS__);
+#else
+#define CONSOLE_ERROR(tag, format, ...)               ((void)0);
+#define CONSOLE_ERROR_DEFERRED_SINK(tag, format, ...) ((void)0);
+#endif
 
 #endif /* COMMS_HH_ */
\ No newline at end of file
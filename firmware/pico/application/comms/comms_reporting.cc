@@ -5,6 +5,8 @@
 #include "gdl90_utils.hh"
 #include "hal.hh"  // For timestamping.
 #include "mavlink/mavlink.h"
+#include "perf_monitor.hh"
+#include "raw_packet_batch.hh"
 #include "spi_coprocessor.hh"
 #include "unit_conversions.hh"
 
@@ -23,36 +25,55 @@ bool CommsManager::UpdateReporting() {
     }
     // Proceed with update and record timestamp.
     last_raw_report_timestamp_ms_ = timestamp_ms;
+    PERF_PROBE(PerfMonitor::kStageReporting);
 
     DecodedTransponderPacket packets_to_report[ADSBee::kMaxNumTransponderPackets];
     /**
-     * Raw packet reporting buffer used to transfer multiple packets at once over SPI.
-     * [<uint8_t num_packets to report> <packet 1> <packet 2> ...]
+     * Raw packet reporting buffer used to transfer multiple packets at once over SPI, encoded as a RawPacketBatch.
+     * Sized to fit in a single queued SPI write block, since the ESP32 decodes each block as a batch.
      */
-    uint8_t spi_raw_packet_reporting_buffer[sizeof(uint8_t) + ADSBee::kMaxNumTransponderPackets];
+    uint8_t spi_raw_packet_reporting_buffer[SPICoprocessor::SCWritePacket::kQueuedDataMaxLenBytes];
+    RawPacketBatch::Writer raw_packet_batch =
+        RawPacketBatch::Writer(spi_raw_packet_reporting_buffer, sizeof(spi_raw_packet_reporting_buffer));
 
-    // Fill up the array of DecodedTransponderPackets for internal functions, and the buffer of RawTransponderPackets to
-    // send to the ESP32 over SPI. RawTransponderPackets are used instead of DecodedTransponderPackets over the SPI link
-    // in order to preserve bandwidth.
-    uint16_t num_packets_to_report = 0;
-    for (; num_packets_to_report < ADSBee::kMaxNumTransponderPackets &&
-           transponder_packet_reporting_queue.Pop(packets_to_report[num_packets_to_report]);
-         num_packets_to_report++) {
-        if (esp32.IsEnabled()) {
-            // Pop all the packets to report (up to max limit of the buffer).
-            RawTransponderPacket raw_packet = packets_to_report[num_packets_to_report].GetRaw();
-            spi_raw_packet_reporting_buffer[0] = num_packets_to_report;
-            memcpy(spi_raw_packet_reporting_buffer + sizeof(uint8_t) +
-                       sizeof(RawTransponderPacket) * num_packets_to_report,
-                   &raw_packet, sizeof(RawTransponderPacket));
+    // Fill up the array of DecodedTransponderPackets for internal functions, and the batch of packets to send to the
+    // ESP32 over SPI. The batch holds raw packets in order to preserve bandwidth, along with what the aircraft
+    // dictionary made of them so that the ESP32 doesn't have to decode them again.
+    uint16_t num_packets_to_report =
+        transponder_packet_reporting_queue.PopN(packets_to_report, ADSBee::kMaxNumTransponderPackets);
+    for (uint16_t i = 0; i < num_packets_to_report; i++) {
+        const RawTransponderPacket &raw_packet = packets_to_report[i].GetRaw();
+        if (raw_packet.buffer_len_bits == DecodedTransponderPacket::kExtendedSquitterPacketLenBits) {
+            CONSOLE_INFO_DEFERRED("CommsManager::UpdateReporting",
+                                  "New message: 0x%08x|%08x|%08x|%04x SRC=%d SIGS=%ddBm SIGQ=%ddB MLAT=%u",
+                                  raw_packet.buffer[0], raw_packet.buffer[1], raw_packet.buffer[2],
+                                  (raw_packet.buffer[3]) >> (4 * kBitsPerNibble), raw_packet.source,
+                                  raw_packet.sigs_dbm, raw_packet.sigq_db, raw_packet.mlat_48mhz_64bit_counts);
+        } else {
+            CONSOLE_INFO_DEFERRED("CommsManager::UpdateReporting",
+                                  "New message: 0x%08x|%06x SRC=%d SIGS=%ddBm SIGQ=%ddB MLAT=%u", raw_packet.buffer[0],
+                                  (raw_packet.buffer[1]) >> (2 * kBitsPerNibble), raw_packet.source,
+                                  raw_packet.sigs_dbm, raw_packet.sigq_db, raw_packet.mlat_48mhz_64bit_counts);
+        }
+        CONSOLE_INFO_DEFERRED("CommsManager::UpdateReporting", "\tdf=%d icao_address=0x%06x",
+                              packets_to_report[i].GetDownlinkFormat(), packets_to_report[i].GetICAOAddress());
+
+        if (esp32.IsEnabled() && !raw_packet_batch.Append(packets_to_report[i])) {
+            // Batch is full. Send it off and start a new one. WriteAsync() copies the batch, so the buffer can be
+            // reused.
+            esp32.WriteAsync(ObjectDictionary::kAddrRawTransponderPacketArray, spi_raw_packet_reporting_buffer,
+                             true,  // require_ack
+                             raw_packet_batch.GetLenBytes());
+            raw_packet_batch.Clear();
+            raw_packet_batch.Append(packets_to_report[i]);
         }
     }
-    if (esp32.IsEnabled() && num_packets_to_report > 0) {
-        // Write packet to ESP32 with a forced ACK.
-        esp32.Write(ObjectDictionary::kAddrRawTransponderPacketArray,                       // addr
-                    spi_raw_packet_reporting_buffer,                                        // buf
-                    true,                                                                   // require_ack
-                    sizeof(uint8_t) + num_packets_to_report * sizeof(RawTransponderPacket)  // len
+    if (esp32.IsEnabled() && raw_packet_batch.GetNumPackets() > 0) {
+        // Write packets to ESP32 with a forced ACK. Don't wait for the ack, nothing is done if it fails.
+        esp32.WriteAsync(ObjectDictionary::kAddrRawTransponderPacketArray,  // addr
+                         spi_raw_packet_reporting_buffer,                   // buf
+                         true,                                              // require_ack
+                         raw_packet_batch.GetLenBytes()                     // len
         );
     }
 
@@ -116,12 +137,13 @@ bool CommsManager::ReportBeast(SettingsManager::SerialInterface iface,
 }
 
 bool CommsManager::ReportCSBee(SettingsManager::SerialInterface iface) {
+    adsbee.GetAircraftDictionarySnapshot(aircraft_dictionary_snapshot_);
     // Write out a CSBee Aircraft message for each aircraft in the aircraft dictionary.
-    for (auto &itr : adsbee.aircraft_dictionary.dict) {
-        const Aircraft &aircraft = itr.second;
+    for (const Aircraft &aircraft : aircraft_dictionary_snapshot_.dict) {
 
         char message[kCSBeeMessageStrMaxLen];
-        int16_t message_len_bytes = WriteCSBeeAircraftMessageStr(message, aircraft);
+        int16_t message_len_bytes = WriteCSBeeAircraftMessageStr(
+            message, aircraft, aircraft_dictionary_snapshot_.GetAircraftMetadata(aircraft));
         if (message_len_bytes < 0) {
             CONSOLE_ERROR("CommsManager::ReportCSBee",
                           "Encountered an error in WriteCSBeeAircraftMessageStr, error code %d.", message_len_bytes);
@@ -132,16 +154,17 @@ bool CommsManager::ReportCSBee(SettingsManager::SerialInterface iface) {
 
     // Write a CSBee Statistics message.
     char message[kCSBeeMessageStrMaxLen];
+    const AircraftDictionary::Metrics &metrics = aircraft_dictionary_snapshot_.metrics;
     int16_t message_len_bytes =
-        WriteCSBeeStatisticsMessageStr(message,                                                 // Buffer to write into.
-                                       adsbee.aircraft_dictionary.metrics.demods_1090,          // DPS
-                                       adsbee.aircraft_dictionary.metrics.raw_squitter_frames,  // RAW_SFPS
-                                       adsbee.aircraft_dictionary.metrics.valid_squitter_frames,           // SFPS
-                                       adsbee.aircraft_dictionary.metrics.raw_extended_squitter_frames,    // RAW_ESFPS
-                                       adsbee.aircraft_dictionary.metrics.valid_extended_squitter_frames,  // ESFPS
-                                       adsbee.aircraft_dictionary.GetNumAircraft(),  // NUM_AIRCRAFT
-                                       0u,                                           // TSCAL
-                                       get_time_since_boot_ms() / 1000               // UPTIME
+        WriteCSBeeStatisticsMessageStr(message,                                         // Buffer to write into.
+                                       metrics.demods_1090,                             // DPS
+                                       metrics.raw_squitter_frames,                     // RAW_SFPS
+                                       metrics.valid_squitter_frames,                   // SFPS
+                                       metrics.raw_extended_squitter_frames,            // RAW_ESFPS
+                                       metrics.valid_extended_squitter_frames,          // ESFPS
+                                       aircraft_dictionary_snapshot_.GetNumAircraft(),  // NUM_AIRCRAFT
+                                       0u,                                              // TSCAL
+                                       get_time_since_boot_ms() / 1000                  // UPTIME
         );
     if (message_len_bytes < 0) {
         CONSOLE_ERROR("CommsManager::ReportCSBee",
@@ -208,8 +231,8 @@ bool CommsManager::ReportMAVLINK(SettingsManager::SerialInterface iface) {
     uint16_t mavlink_version = reporting_protocols_[iface] == SettingsManager::kMAVLINK1 ? 1 : 2;
     mavlink_set_proto_version(SettingsManager::SerialInterface::kCommsUART, mavlink_version);
 
-    for (auto &itr : adsbee.aircraft_dictionary.dict) {
-        const Aircraft &aircraft = itr.second;
+    adsbee.GetAircraftDictionarySnapshot(aircraft_dictionary_snapshot_);
+    for (const Aircraft &aircraft : aircraft_dictionary_snapshot_.dict) {
 
         // Initialize the message
         mavlink_adsb_vehicle_t adsb_vehicle_msg = {
@@ -269,9 +292,11 @@ bool CommsManager::ReportGDL90(SettingsManager::SerialInterface iface) {
     uint8_t buf[GDL90Reporter::kGDL90MessageMaxLenBytes];
     uint16_t msg_len;
 
+    adsbee.GetAircraftDictionarySnapshot(aircraft_dictionary_snapshot_);
+
     // Heartbeat Message
     msg_len = gdl90.WriteGDL90HeartbeatMessage(buf, get_time_since_boot_ms() / 1000,
-                                               adsbee.aircraft_dictionary.metrics.valid_extended_squitter_frames);
+                                               aircraft_dictionary_snapshot_.metrics.valid_extended_squitter_frames);
     SendBuf(iface, (char *)buf, msg_len);
 
     // Ownship Report
@@ -281,8 +306,7 @@ bool CommsManager::ReportGDL90(SettingsManager::SerialInterface iface) {
     SendBuf(iface, (char *)buf, msg_len);
 
     // Traffic Reports
-    for (auto &itr : adsbee.aircraft_dictionary.dict) {
-        const Aircraft &aircraft = itr.second;
+    for (const Aircraft &aircraft : aircraft_dictionary_snapshot_.dict) {
         msg_len = gdl90.WriteGDL90TargetReportMessage(buf, aircraft, false);
         SendBuf(iface, (char *)buf, msg_len);
     }
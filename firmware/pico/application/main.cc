@@ -4,9 +4,13 @@
 #include "esp32_flasher.hh"
 #include "firmware_update.hh"  // For figuring out which flash partition we're in.
 #include "hal.hh"
+#include "hardware/structs/systick.h"  // For running SysTick on core 1.
 #include "hardware_unit_tests.hh"  // For testing only!
+#include "perf_monitor.hh"
 #include "pico/binary_info.h"
+#include "pico/multicore.h"
 #include "spi_coprocessor.hh"
+#include "task_scheduler.hh"
 #include "transponder_packet.hh"
 #include "unit_conversions.hh"
 
@@ -16,6 +20,7 @@
 const uint16_t kStatusLEDBootupBlinkPeriodMs = 200;
 const uint32_t kESP32BootupTimeoutMs = 10000;
 const uint32_t kESP32BootupCommsRetryMs = 500;
+const uint32_t kESP32HeartbeatIntervalUs = 200000;  // Set to 5Hz to make network terminal commands pass less laggy.
 
 // Override default config params here.
 ADSBee adsbee = ADSBee({});
@@ -24,7 +29,104 @@ ESP32SerialFlasher esp32_flasher = ESP32SerialFlasher({});
 EEPROM eeprom = EEPROM({});
 SettingsManager settings_manager;
 ObjectDictionary object_dictionary;
-SPICoprocessor esp32 = SPICoprocessor({});
+TaskScheduler task_scheduler;
+int16_t esp32_update_task_id = -1;
+// The SPI coprocessor's HANDSHAKE and DMA interrupts release the ESP32 update task, so that it doesn't wait for its
+// next period to move a transaction along.
+SPICoprocessor esp32 = SPICoprocessor({.event_callback = []() {
+    if (esp32_update_task_id >= 0) {
+        task_scheduler.Release(esp32_update_task_id, get_time_since_boot_us());
+    }
+}});
+
+/**
+ * Services transactions that the ESP32 requests with the handshake line, and sends queued transactions to the ESP32.
+ */
+void ESP32UpdateTask() {
+    if (esp32.IsEnabled()) {
+        esp32.Update();
+    }
+}
+
+/**
+ * Called once the ESP32 has acked a heartbeat, or the heartbeat has failed.
+ */
+void OnESP32HeartbeatComplete(bool success, void *context) {
+    if (!success) {
+        CONSOLE_ERROR("main", "ESP32 heartbeat failed.");
+        return;
+    }
+    // ESP32 acknowledged the heartbeat: poke the watchdog since nothing seems amiss.
+    adsbee.PokeWatchdog();
+}
+
+/**
+ * Sends a heartbeat to the ESP32. The watchdog is poked once the heartbeat is acked, or right away if the ESP32 is
+ * disabled.
+ */
+void ESP32HeartbeatTask() {
+    if (esp32.IsEnabled()) {
+        uint32_t esp32_heartbeat_timestamp_ms = get_time_since_boot_ms();
+        if (!esp32.WriteAsync(ObjectDictionary::kAddrScratch, esp32_heartbeat_timestamp_ms, true, 0,
+                              OnESP32HeartbeatComplete)) {
+            CONSOLE_ERROR("main", "Unable to queue ESP32 heartbeat.");
+        }
+        return;
+    }
+    // Don't need to talk to the ESP32: poke the watchdog since nothing seems amiss.
+    adsbee.PokeWatchdog();
+}
+
+// Main loop tasks, run by task_scheduler on core 0. Lower priority values run first.
+const TaskScheduler::Task kMainLoopTasks[] = {
+    // Only scheduled if packet decoding isn't running on core 1.
+    {.name = "DECODE",
+     .function = []() { adsbee.UpdateDecode(); },
+     .priority = 0,
+     .period_us = 1000,
+     .deadline_us = 2000,
+     .budget_us = 1000},
+    {.name = "ESP32_UPDATE",
+     .function = ESP32UpdateTask,
+     .priority = 1,
+     .period_us = 1000,
+     .deadline_us = 5000,
+     .budget_us = 2000},
+    // AT commands, network console, reporting, and the deferred log.
+    {.name = "COMMS",
+     .function = []() { comms_manager.Update(); },
+     .priority = 2,
+     .period_us = 1000,
+     .deadline_us = 10000,
+     .budget_us = 5000},
+    // Status LED, aircraft dictionary metrics, trigger level learning, and noise floor.
+    {.name = "HOUSEKEEPING",
+     .function = []() { adsbee.Update(); },
+     .priority = 3,
+     .period_us = 10000,
+     .deadline_us = 0,  // Use period.
+     .budget_us = 5000},
+    {.name = "HEARTBEAT",
+     .function = ESP32HeartbeatTask,
+     .priority = 4,
+     .period_us = kESP32HeartbeatIntervalUs,
+     .deadline_us = 0,  // Use period.
+     .budget_us = 1000}};
+
+/**
+ * Entry point for core 1. Decodes packets captured on core 0 and ingests them into the aircraft dictionary, so that
+ * blocking comms on core 0 (e.g. ESP32 SPI transfers and ESP32 flashing) don't stall decoding.
+ */
+void main_core1() {
+    // Allow core 0 to pause this core while it writes to flash, since core 1 can't execute from XIP flash then.
+    multicore_lockout_victim_init();
+    // Each core has its own SysTick. Free-run this one so that perf probes on core 1 can count cycles.
+    systick_hw->rvr = 0xFFFFFF;
+    systick_hw->csr = 0b101;  // Source = Processor Clock, TickInt = Disabled, Counter = Enabled.
+    while (true) {
+        adsbee.UpdateDecode();
+    }
+}
 
 int main() {
     bi_decl(bi_program_description("ADSBee 1090 ADSB Receiver"));
@@ -38,6 +140,10 @@ int main() {
 
     settings_manager.Load();
 
+    if (adsbee.Core1DecodeIsEnabled()) {
+        multicore_launch_core1(main_core1);
+    }
+
     uint16_t num_status_led_blinks = FirmwareUpdateManager::AmWithinFlashPartition(0) ? 1 : 2;
     // Blink the LED a few times to indicate a successful startup.
     for (uint16_t i = 0; i < num_status_led_blinks; i++) {
@@ -108,38 +214,19 @@ int main() {
     // test_aircraft.velocity_kts = 200;
     // adsbee.aircraft_dictionary.InsertAircraft(test_aircraft);
 
-    uint16_t esp32_heartbeat_interval_ms = 200;  // Set to 5Hz to make network terminal commands pass less laggy.
-    uint32_t esp32_heartbeat_last_sent_timestamp_ms = get_time_since_boot_ms();
-
-    while (true) {
-        // Loop forever.
-
-        comms_manager.Update();
-        adsbee.Update();
-
-        bool esp32_heartbeat_was_acked = false;
-        if (esp32.IsEnabled()) {
-            // Send ESP32 heartbeat.
-            uint32_t esp32_heartbeat_timestamp_ms = get_time_since_boot_ms();
-            if (esp32_heartbeat_timestamp_ms - esp32_heartbeat_last_sent_timestamp_ms > esp32_heartbeat_interval_ms) {
-                if (!esp32.Write(ObjectDictionary::kAddrScratch, esp32_heartbeat_timestamp_ms, true)) {
-                    CONSOLE_ERROR("main", "ESP32 heartbeat failed.");
-                } else {
-                    esp32_heartbeat_was_acked = true;
-                }
-
-                esp32_heartbeat_last_sent_timestamp_ms = esp32_heartbeat_timestamp_ms;
-            } else {
-                // The heartbeat write calls Update() if the handshake line is pending, so only call Update() manually
-                // if no heartbeat packet was sent.
-                esp32.Update();
-            }
+    // Skip the DECODE task if core 1 is decoding.
+    for (uint16_t i = adsbee.Core1DecodeIsEnabled() ? 1 : 0; i < sizeof(kMainLoopTasks) / sizeof(kMainLoopTasks[0]);
+         i++) {
+        int16_t task_id = task_scheduler.AddTask(kMainLoopTasks[i]);
+        if (kMainLoopTasks[i].function == ESP32UpdateTask) {
+            esp32_update_task_id = task_id;
         }
+    }
 
-        if (!esp32.IsEnabled() || esp32_heartbeat_was_acked) {
-            // Don't need to talk to the ESP32, or it acknowledged a heartbeat just now: poke the watchdog since nothing
-            // seems amiss.
-            adsbee.PokeWatchdog();
-        }
+    while (true) {
+        // Loop forever. Each pass runs the highest priority task that is due, so packet decoding never waits on more
+        // than one housekeeping task.
+        PERF_PROBE(PerfMonitor::kStageMainLoop);
+        task_scheduler.Update();
     }
 }
\ No newline at end of file
@@ -33,6 +33,8 @@ bool SettingsManager::Save() {
     settings.tl_mv = adsbee.GetTLMilliVolts();
     settings.bias_tee_enabled = adsbee.BiasTeeIsEnabled();
     settings.watchdog_timeout_sec = adsbee.GetWatchdogTimeoutSec();
+    settings.receiver_position_valid =
+        adsbee.GetReferencePosition(settings.receiver_latitude_deg, settings.receiver_longitude_deg);
 
     // Save log level.
     settings.log_level = comms_manager.log_level;
@@ -91,6 +93,11 @@ bool SettingsManager::Apply() {
     adsbee.SetTLMilliVolts(settings.tl_mv);
     adsbee.SetBiasTeeEnable(settings.bias_tee_enabled);
     adsbee.SetWatchdogTimeoutSec(settings.watchdog_timeout_sec);
+    if (settings.receiver_position_valid) {
+        adsbee.SetReferencePosition(settings.receiver_latitude_deg, settings.receiver_longitude_deg);
+    } else {
+        adsbee.ClearReferencePosition();
+    }
 
     // Apply log level.
     comms_manager.log_level = settings.log_level;
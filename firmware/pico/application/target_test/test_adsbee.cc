@@ -0,0 +1,150 @@
+#include "adsbee.hh"
+#include "comms.hh"
+#include "hal.hh"
+#include "hardware/pio.h"
+#include "hardware/structs/systick.h"
+#include "hardware_unit_tests.hh"
+#include "pico/stdlib.h"
+
+// 8D4840D6202CC371C32CE0576098, split up the way the message demodulator leaves it in its RX FIFO.
+static const uint32_t kTestPacketWords[] = {0x8D4840D6, 0x202CC371, 0xC32CE057, 0x6098};
+static const uint16_t kTestPacketLastWordNumBits = 16;
+
+/**
+ * Shifts a word into the ISR of a disabled state machine a few bits at a time with forced instructions. With autopush
+ * enabled, full words land in the RX FIFO.
+ * @param[in] pio PIO block of the state machine.
+ * @param[in] sm State machine to inject into.
+ * @param[in] word Word to inject, right aligned.
+ * @param[in] num_bits Number of bits from word to inject.
+ */
+static void InjectWord(PIO pio, uint sm, uint32_t word, uint16_t num_bits = 32) {
+    static const uint16_t kMaxChunkLenBits = 5;  // Largest immediate that fits in a SET instruction.
+    for (int16_t bits_remaining = num_bits; bits_remaining > 0;) {
+        uint16_t chunk_len_bits = MIN(bits_remaining, kMaxChunkLenBits);
+        bits_remaining -= chunk_len_bits;
+        pio_sm_exec(pio, sm, pio_encode_set(pio_x, (word >> bits_remaining) & ((1u << chunk_len_bits) - 1)));
+        pio_sm_exec(pio, sm, pio_encode_in(pio_x, chunk_len_bits));
+    }
+}
+
+static void InjectTestPacket(PIO pio, uint sm) {
+    uint16_t num_full_words = sizeof(kTestPacketWords) / sizeof(kTestPacketWords[0]) - 1;
+    for (uint16_t i = 0; i < num_full_words; i++) {
+        InjectWord(pio, sm, kTestPacketWords[i]);
+    }
+    InjectWord(pio, sm, kTestPacketWords[num_full_words], kTestPacketLastWordNumBits);
+}
+
+UTEST(ADSBee, DemodCompleteISRCycles) {
+    const ADSBee::ADSBeeConfig config;
+    PIO pio = config.message_demodulator_pio;
+
+    // Before: the old OnDemodComplete() body pulled packet words out of the RX FIFO one at a time. Replay it on a spare
+    // state machine set up with the same shift and FIFO config as the demodulator.
+    uint spare_sm = pio_claim_unused_sm(pio, true);
+    pio_sm_config spare_sm_config = pio_get_default_sm_config();
+    sm_config_set_in_shift(&spare_sm_config, false, true, 32);  // Shift left, autopush at 32 bits.
+    sm_config_set_fifo_join(&spare_sm_config, PIO_FIFO_JOIN_RX);
+    pio_sm_init(pio, spare_sm, 0, &spare_sm_config);  // Leaves the state machine disabled.
+    InjectTestPacket(pio, spare_sm);
+
+    SPSCQueue<RawTransponderPacket, 4> legacy_packet_queue;
+    RawTransponderPacket legacy_packet;
+    uint32_t legacy_start_systick_counts = systick_hw->cvr;
+    // Stand-in for the blocking RSSI adc_read(), which would knock the free-running ADC out of step.
+    busy_wait_us_32(2);  // One conversion.
+    legacy_packet.sigs_dbm = ADSBee::AD8313MilliVoltsTodBm(ADSBee::ADCCountsToMilliVolts(0));
+    if (!pio_sm_is_rx_fifo_full(pio, spare_sm)) {
+        pio_sm_exec_wait_blocking(pio, spare_sm, pio_encode_push(false, true));
+    }
+    memset((void *)legacy_packet.buffer, 0x0, RawTransponderPacket::kMaxPacketLenWords32);
+    uint16_t legacy_num_words =
+        MIN(pio_sm_get_rx_fifo_level(pio, spare_sm), RawTransponderPacket::kMaxPacketLenWords32);
+    for (uint16_t i = 0; i < legacy_num_words; i++) {
+        legacy_packet.buffer[i] = pio_sm_get(pio, spare_sm);
+        if (i == legacy_num_words - 1 &&
+            legacy_num_words == DecodedTransponderPacket::kExtendedSquitterPacketNumWords32) {
+            legacy_packet.buffer[i] = (legacy_packet.buffer[i] & 0xFFFF) << 16;
+            legacy_packet.buffer_len_bits = DecodedTransponderPacket::kExtendedSquitterPacketLenBits;
+            legacy_packet_queue.Push(legacy_packet);
+        }
+    }
+    pio_sm_exec_wait_blocking(pio, spare_sm, pio_encode_push(false, false));
+    while (!pio_sm_is_rx_fifo_empty(pio, spare_sm)) {
+        pio_sm_get(pio, spare_sm);
+    }
+    pio_sm_restart(pio, spare_sm);
+    uint32_t legacy_cycles = (legacy_start_systick_counts - systick_hw->cvr) & 0xFFFFFF;
+    pio_sm_unclaim(pio, spare_sm);
+
+    ASSERT_EQ(legacy_packet_queue.Length(), 1);
+    EXPECT_EQ(legacy_packet.buffer[0], kTestPacketWords[0]);
+    EXPECT_EQ(legacy_packet.buffer[3], kTestPacketWords[3] << 16);
+
+    // After: run the real ISR on demodulator 0. Hold off the interrupt while the packet is injected, then force the
+    // demod complete IRQ flag and let it fire.
+    adsbee.SetReceiverEnable(false);
+    uint demod_sm = adsbee.GetMessageDemodulatorSM(0);
+    pio_sm_set_enabled(pio, demod_sm, false);
+    pio_sm_restart(pio, demod_sm);  // Clear out any partially demodulated bits.
+    InjectTestPacket(pio, demod_sm);
+    adsbee.ResetDemodCompleteISRStats();
+    config.preamble_detector_pio->irq_force = 0b1;  // IRQ flag 0 belongs to demodulator 0.
+    adsbee.SetReceiverEnable(true);
+    sleep_ms(10);  // Give the packet time to make it through decoding.
+    if (!adsbee.Core1DecodeIsEnabled()) {
+        adsbee.UpdateDecode();
+    }
+
+    ADSBee::DemodCompleteISRStats isr_stats = adsbee.GetDemodCompleteISRStats();
+    ASSERT_GE(isr_stats.num_calls, 1u);
+    EXPECT_LT(isr_stats.max_cycles, legacy_cycles);
+    CONSOLE_PRINTF("OnDemodComplete: %lu cycles draining FIFO, %lu cycles with DMA (max %lu over %lu calls).\r\n",
+                   legacy_cycles, isr_stats.last_cycles, isr_stats.max_cycles, isr_stats.num_calls);
+
+    // Core 0 is the consumer of the reporting queue, so it's safe to look through it from here.
+    bool found_test_packet = false;
+    DecodedTransponderPacket decoded_packet;
+    for (uint16_t i = 0; i < comms_manager.transponder_packet_reporting_queue.Length(); i++) {
+        if (comms_manager.transponder_packet_reporting_queue.Peek(decoded_packet, i) &&
+            decoded_packet.GetRaw().buffer[0] == kTestPacketWords[0] &&
+            decoded_packet.GetRaw().buffer[3] == kTestPacketWords[3] << 16) {
+            found_test_packet = true;
+            break;
+        }
+    }
+    EXPECT_TRUE(found_test_packet);
+}
+
+UTEST(ADSBee, FreeRunningADCReadsTL) {
+    // The TL readback comes from the ADC ring buffer, so it should follow the TL PWM output without a blocking read.
+    static const int kTLToleranceMV = 250;
+    int tl_mv = adsbee.GetTLMilliVolts();
+    sleep_ms(10);  // Let the PWM filter settle in case TL was just changed.
+    uint32_t read_start_systick_counts = systick_hw->cvr;
+    int tl_readback_mv = adsbee.ReadTLMilliVolts();
+    uint32_t read_cycles = (read_start_systick_counts - systick_hw->cvr) & 0xFFFFFF;
+    EXPECT_NEAR(tl_readback_mv, tl_mv, kTLToleranceMV);
+    EXPECT_LT(read_cycles, 250u);  // A blocking conversion takes 2us, which is 250 cycles at 125MHz.
+}
+
+UTEST(ADSBee, MLATCounterMonotonicAcrossWraps) {
+    // Run across a couple of SysTick wraps, reading the counter in bursts with interrupts disabled so that some wraps
+    // are left pending while it's being read.
+    static const uint32_t kTestDurationMs = 300;  // SysTick wraps about every 134ms.
+    static const uint16_t kReadsPerBurst = 1000;
+    bool counter_went_backwards = false;
+    uint64_t prev_mlat_counts = adsbee.GetMLAT48MHzCounts();
+    uint32_t end_timestamp_ms = get_time_since_boot_ms() + kTestDurationMs;
+    while (get_time_since_boot_ms() < end_timestamp_ms && !counter_went_backwards) {
+        uint32_t interrupts = save_and_disable_interrupts();
+        for (uint16_t i = 0; i < kReadsPerBurst; i++) {
+            uint64_t mlat_counts = adsbee.GetMLAT48MHzCounts();
+            counter_went_backwards |= mlat_counts < prev_mlat_counts;
+            prev_mlat_counts = mlat_counts;
+        }
+        restore_interrupts(interrupts);
+    }
+    EXPECT_FALSE(counter_went_backwards);
+}
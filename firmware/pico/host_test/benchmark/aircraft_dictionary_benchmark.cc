@@ -0,0 +1,185 @@
+/**
+ * Speed and size of the aircraft table behind AircraftDictionary, and the cost of pruning it in
+ * AircraftDictionary::Update(), on the host. Built with ADSBEE_MAX_NUM_AIRCRAFT=1000, so that Update() runs on a
+ * dictionary far bigger than the one on the RP2040.
+ *
+ * Usage: aircraft_dictionary_benchmark
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_map>
+#include <vector>
+
+#include "aircraft_dictionary.hh"
+
+/**
+ * Simulates ingesting kNumPackets packets from num_aircraft aircraft into an aircraft map. One in ten packets is from
+ * an ICAO that isn't in the map (e.g. a corrupted squitter), and gets checked but not inserted.
+ * @retval Average time per packet, in nanoseconds.
+ */
+template <class InsertOrUpdateFn, class ContainsFn>
+double BenchmarkAircraftIngestion(const std::vector<uint32_t> &icaos, InsertOrUpdateFn insert_or_update,
+                                  ContainsFn contains) {
+    const uint32_t kNumPackets = 200000;
+    uint32_t num_found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < kNumPackets; i++) {
+        uint32_t icao = icaos[(i * 7919) % icaos.size()];
+        if (i % 10 == 0) {
+            num_found += contains(icao ^ 0x800000);  // Miss.
+        } else {
+            insert_or_update(icao, i);
+        }
+    }
+    auto elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    if (num_found > 0) {
+        fprintf(stderr, "Found %u aircraft that were never inserted.\r\n", num_found);
+    }
+    return elapsed_ns.count() / static_cast<double>(kNumPackets);
+}
+
+template <uint16_t kNumAircraft>
+void BenchmarkAircraftTable() {
+    std::vector<uint32_t> icaos;
+    srand(kNumAircraft);
+    while (icaos.size() < kNumAircraft) {
+        icaos.push_back(rand() & 0x7FFFFF);  // Leave MSb clear so that flipping it is guaranteed to miss.
+    }
+
+    auto static_map = new StaticHashMap<Aircraft, kNumAircraft>();  // Too big for the stack at 2000 aircraft.
+    double static_map_ns = BenchmarkAircraftIngestion(
+        icaos,
+        [&](uint32_t icao, uint32_t timestamp_ms) {
+            Aircraft *aircraft = static_map->Find(icao);
+            if (aircraft == nullptr) aircraft = static_map->Insert(icao, Aircraft(icao));
+            aircraft->last_message_timestamp_ms = timestamp_ms;
+        },
+        [&](uint32_t icao) { return static_map->Contains(icao); });
+
+    std::unordered_map<uint32_t, Aircraft> unordered_map;
+    double unordered_map_ns = BenchmarkAircraftIngestion(
+        icaos,
+        [&](uint32_t icao, uint32_t timestamp_ms) {
+            auto itr = unordered_map.find(icao);
+            if (itr == unordered_map.end()) itr = unordered_map.emplace(icao, Aircraft(icao)).first;
+            itr->second.last_message_timestamp_ms = timestamp_ms;
+        },
+        [&](uint32_t icao) { return unordered_map.count(icao) > 0; });
+
+    // Estimate heap usage of the unordered_map as one node (value + next pointer) per element plus the bucket array.
+    size_t unordered_map_bytes = unordered_map.size() * (sizeof(std::pair<const uint32_t, Aircraft>) + sizeof(void *)) +
+                                 unordered_map.bucket_count() * sizeof(void *);
+    printf("AircraftTable Benchmark (%u aircraft):\r\n", kNumAircraft);
+    printf("\tStaticHashMap:      %6.1f ns/packet, %7zu bytes (static)\r\n", static_map_ns,
+           sizeof(StaticHashMap<Aircraft, kNumAircraft>));
+    printf("\tstd::unordered_map: %6.1f ns/packet, %7zu bytes (heap, approx.)\r\n", unordered_map_ns,
+           unordered_map_bytes);
+    delete static_map;
+}
+
+/**
+ * Simulates kNumUpdates dictionary updates, one per second, with 3/4 of num_aircraft aircraft that keep sending
+ * messages. Every second, each of those aircraft has a small chance of going silent and being replaced by a new one, so
+ * that there is a steady trickle of stale aircraft to prune.
+ * @param[in] refresh Function that marks an aircraft as having sent a message, inserting it if it's new.
+ * @param[in] update Function that prunes stale aircraft.
+ * @param[out] max_ns Longest time taken by a single update, in nanoseconds.
+ * @retval Average time per update, in nanoseconds.
+ */
+template <class RefreshFn, class UpdateFn>
+double BenchmarkAircraftPruning(uint16_t num_aircraft, RefreshFn refresh, UpdateFn update, double &max_ns) {
+    const uint32_t kNumUpdates = 300;
+    std::vector<uint32_t> active_icaos;
+    srand(num_aircraft);
+    uint32_t next_icao = 1;
+    while (active_icaos.size() < num_aircraft * 3u / 4u) {
+        active_icaos.push_back(next_icao++);
+    }
+
+    double total_ns = 0;
+    max_ns = 0;
+    for (uint32_t i = 0; i < kNumUpdates; i++) {
+        uint32_t timestamp_ms = 100e3 + i * 1000;
+        for (uint32_t &icao : active_icaos) {
+            if (rand() % 200 == 0) icao = next_icao++;  // Aircraft goes silent, new aircraft shows up.
+            refresh(icao, timestamp_ms);
+        }
+        auto start = std::chrono::steady_clock::now();
+        update(timestamp_ms);
+        double elapsed_ns =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        total_ns += elapsed_ns;
+        if (elapsed_ns > max_ns) max_ns = elapsed_ns;
+    }
+    return total_ns / kNumUpdates;
+}
+
+/**
+ * Times AircraftDictionary::Update at the capacity that this benchmark is built with, against a full scan of a table
+ * of the same size that prunes stale aircraft and rolls over the metrics of all the others, like
+ * AircraftDictionary::Update did before aircraft were kept in order of age.
+ */
+void BenchmarkDictionaryPruning() {
+    const uint16_t kNumAircraft = AircraftDictionary::kMaxNumAircraft;
+    const uint32_t kPruneIntervalMs = AircraftDictionary::AircraftDictionaryConfig_t().aircraft_prune_interval_ms;
+
+    struct ScanTable {
+        StaticHashMap<Aircraft, kNumAircraft> map;
+        AircraftMetadata metadata[kNumAircraft];
+        Aircraft::Metrics metrics[kNumAircraft];
+    };
+    auto scan = new ScanTable();  // Too big for the stack.
+    double scan_max_ns;
+    double scan_ns = BenchmarkAircraftPruning(
+        kNumAircraft,
+        [&](uint32_t icao, uint32_t timestamp_ms) {
+            Aircraft *aircraft = scan->map.Find(icao);
+            if (aircraft == nullptr) aircraft = scan->map.Insert(icao, Aircraft(icao));
+            if (aircraft != nullptr) aircraft->last_message_timestamp_ms = timestamp_ms;
+        },
+        [&](uint32_t timestamp_ms) {
+            for (Aircraft *it = scan->map.begin(); it != scan->map.end();) {
+                uint16_t index = scan->map.GetIndex(it);
+                if (timestamp_ms - it->last_message_timestamp_ms > kPruneIntervalMs) {
+                    scan->metadata[index] = scan->metadata[scan->map.Size() - 1];
+                    it = scan->map.Erase(it);
+                } else {
+                    scan->metrics[index] = scan->metadata[index].GetMetrics();  // Eager metrics roll over.
+                    it++;
+                }
+            }
+        },
+        scan_max_ns);
+
+    AircraftDictionary *dictionary = new AircraftDictionary();
+    double dictionary_max_ns;
+    double dictionary_ns = BenchmarkAircraftPruning(
+        kNumAircraft,
+        [&](uint32_t icao, uint32_t timestamp_ms) {
+            Aircraft *aircraft = dictionary->GetAircraftPtr(icao);
+            if (aircraft != nullptr) dictionary->RefreshAircraft(*aircraft, timestamp_ms);
+        },
+        [&](uint32_t timestamp_ms) { dictionary->Update(timestamp_ms); }, dictionary_max_ns);
+
+    if (dictionary->GetNumAircraft() != scan->map.Size()) {
+        fprintf(stderr, "Dictionary has %u aircraft, full scan has %u.\r\n", dictionary->GetNumAircraft(),
+                scan->map.Size());
+    }
+    printf("AircraftDictionary::Update Benchmark (%u aircraft max, %u in dictionary):\r\n", kNumAircraft,
+           dictionary->GetNumAircraft());
+    printf("\tFull scan: %10.1f ns/update average, %10.1f ns/update worst case\r\n", scan_ns, scan_max_ns);
+    printf("\tUpdate:    %10.1f ns/update average, %10.1f ns/update worst case\r\n", dictionary_ns,
+           dictionary_max_ns);
+    delete scan;
+    delete dictionary;
+}
+
+int main(int argc, char **argv) {
+    BenchmarkAircraftTable<100>();
+    BenchmarkAircraftTable<500>();
+    BenchmarkAircraftTable<2000>();
+    BenchmarkDictionaryPruning();
+    return 0;
+}
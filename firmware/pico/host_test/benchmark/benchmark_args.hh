@@ -0,0 +1,25 @@
+#ifndef BENCHMARK_ARGS_HH_
+#define BENCHMARK_ARGS_HH_
+
+#include <cstdlib>
+#include <cstring>
+
+#include "stdint.h"
+
+/**
+ * Parses a command line argument of the form --name=value.
+ * @param[in] arg Argument from argv.
+ * @param[in] name Name of the argument, including the leading dashes.
+ * @param[out] value Parsed value. Left alone if the argument doesn't match.
+ * @retval True if the argument matched, false otherwise.
+ */
+inline bool ParseArg(const char *arg, const char *name, uint32_t &value) {
+    size_t name_len = strlen(name);
+    if (strncmp(arg, name, name_len) != 0 || arg[name_len] != '=') {
+        return false;
+    }
+    value = strtoul(arg + name_len + 1, nullptr, 10);
+    return true;
+}
+
+#endif /* BENCHMARK_ARGS_HH_ */
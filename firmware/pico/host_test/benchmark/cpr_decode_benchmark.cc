@@ -0,0 +1,79 @@
+/**
+ * Speed of CPR decoding with fixed-point binary angles and an NL table, against the floating point NL calculation that
+ * it replaced, on the host.
+ *
+ * Usage: cpr_decode_benchmark [--num_iterations=N]
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+#include "benchmark_args.hh"
+#include "decode_utils.hh"
+
+/**
+ * Previous floating point implementation of CalcNLCPRFromLat, kept for comparison.
+ */
+static uint16_t CalcNLCPRFromLatFloat(float lat) {
+    lat = floorf(lat);
+    if (lat == 0) return 59;
+    if (lat == 87 || lat == -87) return 2;
+    if (lat > 87 || lat < -87) return 1;
+    return floorf(2.0f * (float)M_PI /
+                  acosf(1 - (1 - cosf((float)M_PI / (2.0f * kCPRNz))) / powf(cosf((float)M_PI / 180.0f * lat), 2)));
+}
+
+int main(int argc, char **argv) {
+    uint32_t num_iterations = 1'000'000;
+    for (int i = 1; i < argc; i++) {
+        if (!ParseArg(argv[i], "--num_iterations", num_iterations)) {
+            fprintf(stderr, "Unknown argument %s.\r\n", argv[i]);
+            return 1;
+        }
+    }
+    volatile uint32_t sink = 0;  // Keep the compiler from optimizing the loops away.
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < num_iterations; i++) {
+        sink = sink + CalcNLCPRFromLatFloat((i % 18000) * 0.01f - 90.0f);
+    }
+    double float_nl_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start)
+                             .count() /
+                         static_cast<double>(num_iterations);
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < num_iterations; i++) {
+        sink = sink + CalcNLCPRFromBinaryAngle(DegreesToBinaryAngle(-90.0) + (i % 18000) * 23860929);
+    }
+    double table_nl_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start)
+                             .count() /
+                         static_cast<double>(num_iterations);
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < num_iterations; i++) {
+        int32_t lat, lon;
+        sink = sink + DecodeCPRGlobal(93000 + (i & 0xFF), 51372, 74158 + (i & 0xFF), 50194, i & 0b1, lat, lon) + lon;
+    }
+    double global_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start)
+                           .count() /
+                       static_cast<double>(num_iterations);
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < num_iterations; i++) {
+        int32_t lat, lon;
+        sink = sink + DecodeCPRLocal(93000 + (i & 0xFF), 51372, i & 0b1, false, DegreesToBinaryAngle(52.258),
+                                     DegreesToBinaryAngle(3.918), lat, lon) +
+               lon;
+    }
+    double local_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start)
+                          .count() /
+                      static_cast<double>(num_iterations);
+
+    printf("CPRDecode Benchmark (host has an FPU, so float math is much cheaper here than on the RP2040):\r\n");
+    printf("\tCalcNLCPRFromLat (float trig):    %6.1f ns/call\r\n", float_nl_ns);
+    printf("\tCalcNLCPRFromBinaryAngle (table): %6.1f ns/call\r\n", table_nl_ns);
+    printf("\tDecodeCPRGlobal:                  %6.1f ns/call\r\n", global_ns);
+    printf("\tDecodeCPRLocal:                   %6.1f ns/call\r\n", local_ns);
+    return 0;
+}
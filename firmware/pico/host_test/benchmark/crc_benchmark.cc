@@ -0,0 +1,52 @@
+/**
+ * Speed of the table-driven Mode S CRC-24 against the bit-serial implementation that it replaced, on the host.
+ *
+ * Usage: crc_benchmark [--num_iterations=N]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+#include "benchmark_args.hh"
+#include "crc.hh"
+#include "crc_reference.hh"
+
+static const uint16_t kNumTestPackets = 256;
+
+int main(int argc, char **argv) {
+    uint32_t num_iterations = 1'000'000;
+    for (int i = 1; i < argc; i++) {
+        if (!ParseArg(argv[i], "--num_iterations", num_iterations)) {
+            fprintf(stderr, "Unknown argument %s.\r\n", argv[i]);
+            return 1;
+        }
+    }
+
+    // Made up 112-bit packets.
+    static uint32_t packets[kNumTestPackets][DecodedTransponderPacket::kMaxPacketLenWords32];
+    std::mt19937 rng(0xADBEE);
+    for (uint16_t i = 0; i < kNumTestPackets; i++) {
+        for (uint16_t j = 0; j < DecodedTransponderPacket::kMaxPacketLenWords32; j++) {
+            packets[i][j] = rng();
+        }
+    }
+    volatile uint32_t sink = 0;  // Keep the compiler from optimizing away the loops.
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < num_iterations; i++) {
+        sink = sink ^ CalculateCRC24BitSerial(packets[i % kNumTestPackets], 112);
+    }
+    auto bit_serial_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < num_iterations; i++) {
+        sink = sink ^ CalculateModeSCRC24(packets[i % kNumTestPackets], 88);
+    }
+    auto table_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+    printf("ModeSCRC24 Benchmark (%u x 112-bit packets):\r\n", num_iterations);
+    printf("\tBit-serial:   %8.1f ns/packet\r\n", bit_serial_ns.count() / static_cast<double>(num_iterations));
+    printf("\tTable-driven: %8.1f ns/packet\r\n", table_ns.count() / static_cast<double>(num_iterations));
+    return 0;
+}
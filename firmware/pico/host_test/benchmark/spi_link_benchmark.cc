@@ -0,0 +1,182 @@
+/**
+ * Throughput benchmark for the SPI link between the RP2040 and the ESP32, run on the host against SPILinkShim, i.e. the
+ * real builds of SPICoprocessor on both ends. Each traffic mix runs back to back for a fixed amount of simulated time,
+ * so the numbers are what the link can carry at saturation. The ESP32 is counted as taking no time to process anything.
+ * Writes from the ESP32 that lose their ack stall until SPILinkShim gives up on them, so bit errors hit ESP32 to RP2040
+ * traffic much harder here than on a device with other traffic on the link. Ack latency runs from the first send of
+ * each request that asks for an ack to the end of the ack, so it includes any retries.
+ *
+ * Usage: spi_link_benchmark [--duration_s=N] [--clk_rate_hz=N] [--handshake_latency_us=N] [--slave_rearm_us=N]
+ */
+
+#include <cstdio>
+#include <random>
+
+#include "benchmark_args.hh"
+#include "raw_packet_batch.hh"
+#include "settings.hh"
+#include "spi_coprocessor.hh"
+#include "spi_link_shim.hh"
+
+static const uint32_t kUsPerSecond = 1'000'000;
+static const uint16_t kConsoleCommandLenBytes = 64;    // AT command from the ESP32 network console.
+static const uint16_t kConsoleReplyLenBytes = 1024;    // Console output forwarded to the ESP32.
+static const uint16_t kNetworkConsoleLenBytes = 4000;  // ObjectDictionary::kNetworkConsoleMessageMaxLenBytes.
+static const uint16_t kBulkLenBytes = 16 * 1024;       // Multi-block write, e.g. a firmware image chunk.
+
+enum TrafficMix : uint16_t { kMixRawPackets = 0, kMixConsole, kMixSettings, kMixBulk, kMixAll, kNumTrafficMixes };
+static const char *kTrafficMixNames[kNumTrafficMixes] = {"raw packets", "console", "settings", "bulk", "all"};
+
+/**
+ * Fills a batch with made up packets, 3/4 extended squitters and 1/4 short squitters.
+ * @retval Number of packets in the batch.
+ */
+static uint16_t FillRawPacketBatch(RawPacketBatch::Writer &writer, std::mt19937 &rng, uint64_t &mlat_counts) {
+    writer.Clear();
+    RawTransponderPacket packet;
+    while (true) {
+        packet.buffer_len_bits = rng() % 4 == 0 ? DecodedTransponderPacket::kSquitterPacketLenBits
+                                                : DecodedTransponderPacket::kExtendedSquitterPacketLenBits;
+        for (uint16_t i = 0; i < RawTransponderPacket::kMaxPacketLenWords32; i++) {
+            packet.buffer[i] = rng();
+        }
+        mlat_counts += 48 * (50 + rng() % 1000);  // 50us to 1ms apart.
+        packet.mlat_48mhz_64bit_counts = mlat_counts;
+        packet.sigs_dbm = -90 + rng() % 60;
+        packet.sigq_db = rng() % 30;
+        packet.source = rng() % 3;
+        if (!writer.Append(packet)) {
+            return writer.GetNumPackets();
+        }
+    }
+}
+
+struct BenchmarkResult {
+    uint64_t num_packets = 0;
+    uint64_t num_operations = 0;
+    uint64_t num_payload_bytes = 0;  // Object Bytes that went through.
+    SPILinkShim::SPILinkStats stats;
+    uint64_t elapsed_us = 0;
+    uint32_t clk_rate_hz = 0;
+};
+
+/**
+ * Counts the packets in a raw packet batch once its write has been acked.
+ */
+struct RawPacketBatchWrite {
+    BenchmarkResult *result;
+    uint16_t num_packets;
+    uint16_t len_bytes;
+};
+
+static void OnRawPacketBatchWriteComplete(bool success, void *context) {
+    RawPacketBatchWrite *write = static_cast<RawPacketBatchWrite *>(context);
+    if (success) {
+        write->result->num_packets += write->num_packets;
+        write->result->num_payload_bytes += write->len_bytes;
+    }
+}
+
+static BenchmarkResult RunTrafficMix(TrafficMix mix, SPILinkShim::SPILinkShimConfig config, uint32_t duration_s) {
+    SPILinkShim shim = SPILinkShim(config);
+    BenchmarkResult result;
+    std::mt19937 rng(config.seed);
+    uint64_t mlat_counts = 0;
+
+    // Batches go out like the ones from CommsManager, queued on the RP2040 and acked by the ESP32.
+    static uint8_t batch_buf[SPICoprocessor::SCWritePacket::kQueuedDataMaxLenBytes];
+    RawPacketBatch::Writer writer = RawPacketBatch::Writer(batch_buf, sizeof(batch_buf));
+    RawPacketBatchWrite batch_write = {.result = &result, .num_packets = 0, .len_bytes = 0};
+    static uint8_t console_buf[kNetworkConsoleLenBytes];
+    static SettingsManager::Settings settings;
+    static uint8_t bulk_buf[kBulkLenBytes];
+
+    // Tallies the payload of blocking operations that went through.
+    auto tally = [&result](bool success, uint16_t len_bytes) {
+        result.num_operations++;
+        if (success) {
+            result.num_payload_bytes += len_bytes;
+        }
+    };
+
+    for (uint32_t cycle = 0; shim.GetTimeUs() < static_cast<uint64_t>(duration_s) * kUsPerSecond; cycle++) {
+        if (mix == kMixRawPackets || mix == kMixAll) {
+            batch_write.num_packets = FillRawPacketBatch(writer, rng, mlat_counts);
+            batch_write.len_bytes = writer.GetLenBytes();
+            shim.MasterWriteAsync(ObjectDictionary::Address::kAddrRawTransponderPacketArray, batch_buf,
+                                  batch_write.len_bytes, true, OnRawPacketBatchWriteComplete, &batch_write);
+            shim.MasterUpdate(true);
+            result.num_operations++;
+        }
+        if (mix == kMixConsole || (mix == kMixAll && cycle % 10 == 0)) {
+            tally(shim.SlaveWrite(ObjectDictionary::Address::kAddrConsole, console_buf, kConsoleCommandLenBytes, true),
+                  kConsoleCommandLenBytes);
+            tally(shim.MasterWrite(ObjectDictionary::Address::kAddrConsole, console_buf, kConsoleReplyLenBytes, true),
+                  kConsoleReplyLenBytes);
+            // Console output that fills a whole network console message takes more than one block.
+            tally(shim.SlaveWrite(ObjectDictionary::Address::kAddrConsole, console_buf, kNetworkConsoleLenBytes, true),
+                  kNetworkConsoleLenBytes);
+        }
+        if (mix == kMixSettings || (mix == kMixAll && cycle % 100 == 0)) {
+            tally(shim.SlaveRead(ObjectDictionary::Address::kAddrSettingsData, reinterpret_cast<uint8_t *>(&settings),
+                                 sizeof(settings)),
+                  sizeof(settings));
+            tally(shim.MasterWrite(ObjectDictionary::Address::kAddrSettingsData,
+                                   reinterpret_cast<uint8_t *>(&settings), sizeof(settings), true),
+                  sizeof(settings));
+        }
+        if (mix == kMixBulk || (mix == kMixAll && cycle % 100 == 50)) {
+            tally(shim.MasterWrite(ObjectDictionary::Address::kAddrScratch, bulk_buf, kBulkLenBytes, true),
+                  kBulkLenBytes);
+            tally(shim.SlaveWrite(ObjectDictionary::Address::kAddrScratch, bulk_buf, kBulkLenBytes, true),
+                  kBulkLenBytes);
+        }
+    }
+    result.stats = shim.GetStats();
+    result.elapsed_us = shim.GetTimeUs();
+    result.clk_rate_hz = shim.GetClkRateHz();
+    return result;
+}
+
+int main(int argc, char **argv) {
+    uint32_t duration_s = 10;
+    SPILinkShim::SPILinkShimConfig link_config;
+    for (int i = 1; i < argc; i++) {
+        if (!ParseArg(argv[i], "--duration_s", duration_s) &&
+            !ParseArg(argv[i], "--clk_rate_hz", link_config.clk_rate_hz) &&
+            !ParseArg(argv[i], "--handshake_latency_us", link_config.handshake_latency_us) &&
+            !ParseArg(argv[i], "--slave_rearm_us", link_config.slave_rearm_us)) {
+            fprintf(stderr, "Unknown argument %s.\r\n", argv[i]);
+            return 1;
+        }
+    }
+
+    printf("%u s per run, %u us handshake latency, %u us slave re-arm time.\r\n", duration_s,
+           link_config.handshake_latency_us, link_config.slave_rearm_us);
+    printf("%-12s %-8s %8s %10s %10s %10s %8s %8s %8s %8s %8s %8s %8s\r\n", "mix", "BER", "clk_MHz", "ops/s",
+           "packets/s", "bytes/s", "wire%", "bit_errs", "retries", "failures", "ack_p50", "ack_p90", "ack_p99");
+    const double kBitErrorRates[] = {0.0, 1e-6, 1e-5};
+    for (uint16_t mix = 0; mix < kNumTrafficMixes; mix++) {
+        for (double bit_error_rate : kBitErrorRates) {
+            link_config.bit_error_rate = bit_error_rate;
+            BenchmarkResult result = RunTrafficMix(static_cast<TrafficMix>(mix), link_config, duration_s);
+            double elapsed_s = static_cast<double>(result.elapsed_us) / kUsPerSecond;
+            double wire_utilization =
+                100.0 * result.stats.num_wire_bytes * kBitsPerByte / (elapsed_s * result.clk_rate_hz);
+            uint32_t num_retries = 0;
+            uint32_t num_failures = 0;
+            for (uint16_t endpoint = 0; endpoint < SPILinkShim::kNumEndpoints; endpoint++) {
+                num_retries += result.stats.num_retries[endpoint];
+                num_failures += result.stats.num_failures[endpoint];
+            }
+            printf("%-12s %-8.0e %8.1f %10.0f %10.0f %10.0f %8.1f %8u %8u %8u %8u %8u %8u\r\n", kTrafficMixNames[mix],
+                   bit_error_rate, result.clk_rate_hz / 1e6, result.num_operations / elapsed_s,
+                   result.num_packets / elapsed_s, result.num_payload_bytes / elapsed_s, wire_utilization,
+                   result.stats.num_bit_errors, num_retries, num_failures,
+                   result.stats.GetAckLatencyPercentileUs(50), result.stats.GetAckLatencyPercentileUs(90),
+                   result.stats.GetAckLatencyPercentileUs(99));
+        }
+    }
+    printf("Ack latencies in us.\r\n");
+    return 0;
+}
@@ -0,0 +1,97 @@
+/**
+ * Throughput of the lock-free SPSCQueue against PFBQueue, single threaded and with the producer and consumer on
+ * separate threads, on the host.
+ *
+ * Usage: spsc_queue_benchmark [--num_elements=N]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#include "benchmark_args.hh"
+#include "data_structures.hh"
+
+static const uint16_t kBatchLen = 32;
+
+int main(int argc, char **argv) {
+    uint32_t num_elements = 10'000'000;
+    for (int i = 1; i < argc; i++) {
+        if (!ParseArg(argv[i], "--num_elements", num_elements)) {
+            fprintf(stderr, "Unknown argument %s.\r\n", argv[i]);
+            return 1;
+        }
+    }
+    volatile uint32_t sink = 0;  // Keep the compiler from optimizing the loops away.
+
+    // Single threaded, one element at a time, so that only the cost of the queue operations is measured.
+    PFBQueue<uint32_t> pfb_queue = PFBQueue<uint32_t>({.buf_len_num_elements = 129, .buffer = nullptr});
+    uint32_t out;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < num_elements; i++) {
+        pfb_queue.Push(i);
+        pfb_queue.Pop(out);
+        sink = sink + out;
+    }
+    double pfb_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start)
+                        .count() /
+                    static_cast<double>(num_elements);
+
+    static SPSCQueue<uint32_t, 128> spsc_queue;
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < num_elements; i++) {
+        spsc_queue.Push(i);
+        spsc_queue.Pop(out);
+        sink = sink + out;
+    }
+    double spsc_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start)
+                         .count() /
+                     static_cast<double>(num_elements);
+
+    uint32_t batch[kBatchLen];
+    for (uint16_t i = 0; i < kBatchLen; i++) {
+        batch[i] = i;
+    }
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < num_elements; i += kBatchLen) {
+        spsc_queue.PushN(batch, kBatchLen);
+        spsc_queue.PopN(batch, kBatchLen);
+        sink = sink + batch[0];
+    }
+    double spsc_bulk_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start)
+                              .count() /
+                          static_cast<double>(num_elements);
+
+    // Producer and consumer on separate threads, moving elements in batches.
+    start = std::chrono::steady_clock::now();
+    std::thread producer([&batch, num_elements]() {
+        for (uint32_t num_pushed = 0; num_pushed < num_elements;) {
+            uint16_t batch_len = std::min(static_cast<uint32_t>(kBatchLen), num_elements - num_pushed);
+            uint16_t num_pushed_now = spsc_queue.PushN(batch, batch_len);
+            if (num_pushed_now == 0) {
+                std::this_thread::yield();  // Queue is full. Yield in case the host only has one core.
+            }
+            num_pushed += num_pushed_now;
+        }
+    });
+    uint32_t consumer_batch[kBatchLen];
+    for (uint32_t num_popped = 0; num_popped < num_elements;) {
+        uint16_t num_popped_now = spsc_queue.PopN(consumer_batch, kBatchLen);
+        if (num_popped_now == 0) {
+            std::this_thread::yield();  // Queue is empty.
+        }
+        num_popped += num_popped_now;
+    }
+    producer.join();
+    double threaded_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start)
+                             .count() /
+                         static_cast<double>(num_elements);
+
+    printf("Queue Throughput Benchmark:\r\n");
+    printf("\tPFBQueue Push + Pop:            %6.2f ns/element\r\n", pfb_ns);
+    printf("\tSPSCQueue Push + Pop:           %6.2f ns/element\r\n", spsc_ns);
+    printf("\tSPSCQueue PushN + PopN (x%d):   %6.2f ns/element\r\n", kBatchLen, spsc_bulk_ns);
+    printf("\tSPSCQueue 2 threads (x%d):      %6.2f ns/element\r\n", kBatchLen, threaded_ns);
+    return 0;
+}
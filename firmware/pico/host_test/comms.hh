@@ -3,9 +3,15 @@
 
 #include <cstdio>
 
+#include "deferred_log.hh"  // For CONSOLE_*_DEFERRED.
+
 // Use do while(0) structure to enforce semicolon usage after macro.
 #define CONSOLE_INFO(tag, format, ...)    printf("INFO: " tag ": " format "\r\n" __VA_OPT__(, ) __VA_ARGS__)
 #define CONSOLE_WARNING(tag, format, ...) printf("WARNING: " tag ": " format "\r\n" __VA_OPT__(, ) __VA_ARGS__)
 #define CONSOLE_ERROR(tag, format, ...)   printf("ERROR: " tag ": " format "\r\n" __VA_OPT__(, ) __VA_ARGS__)
+// Nothing runs on a second core or in an ISR here, so deferred messages are printed right away.
+#define CONSOLE_INFO_DEFERRED_SINK    CONSOLE_INFO
+#define CONSOLE_WARNING_DEFERRED_SINK CONSOLE_WARNING
+#define CONSOLE_ERROR_DEFERRED_SINK   CONSOLE_ERROR
 
 #endif /* COMMS_HH_ */
\ No newline at end of file
@@ -0,0 +1,29 @@
+#ifndef CRC_REFERENCE_HH_
+#define CRC_REFERENCE_HH_
+
+#include "buffer_utils.hh"
+#include "stdint.h"
+#include "transponder_packet.hh"
+
+/**
+ * Original bit-serial CRC-24 implementation from DecodedTransponderPacket::CalculateCRC24, kept here as a reference for
+ * checking and benchmarking the table-driven implementation.
+ */
+inline uint32_t CalculateCRC24BitSerial(const uint32_t buffer[DecodedTransponderPacket::kMaxPacketLenWords32],
+                                 uint16_t packet_len_bits) {
+    const uint32_t kGenerator = 0x1FFF409;
+    uint32_t crc_buffer[DecodedTransponderPacket::kMaxPacketLenWords32];
+    for (uint16_t i = 0; i < DecodedTransponderPacket::kMaxPacketLenWords32; i++) {
+        crc_buffer[i] = buffer[i];
+    }
+    SetNBitWordInBuffer(24, 0x0, packet_len_bits - 24, crc_buffer);
+    for (uint16_t i = 0; i < packet_len_bits - 24; i++) {
+        uint32_t word = GetNBitWordFromBuffer(25, i, crc_buffer);
+        if (word & (0b1 << 24)) {
+            SetNBitWordInBuffer(25, word ^ kGenerator, i, crc_buffer);
+        }
+    }
+    return GetNBitWordFromBuffer(24, packet_len_bits - 24, crc_buffer);
+}
+
+#endif /* CRC_REFERENCE_HH_ */
@@ -3,6 +3,7 @@
 #include "hal_god_powers.hh"
 
 uint64_t time_since_boot_us = 0;
+uint32_t time_since_boot_us_per_read = 0;
 
 /** Mock Pico SDK functions here for testing. **/
 
@@ -40,3 +41,5 @@ void inc_time_since_boot_us(uint64_t inc) { time_since_boot_us += inc; }
 void set_time_since_boot_ms(uint32_t time_ms) { time_since_boot_us = 1e3 * time_ms; }
 
 void inc_time_since_boot_ms(uint32_t inc) { time_since_boot_us += 1e3 * inc; }
+
+void set_time_since_boot_us_per_read(uint32_t inc) { time_since_boot_us_per_read = inc; }
@@ -10,6 +10,9 @@ void set_time_since_boot_us(uint64_t time_us);
 void inc_time_since_boot_us(uint64_t inc = 5);
 void set_time_since_boot_ms(uint32_t time_ms);
 void inc_time_since_boot_ms(uint32_t inc = 5);
+// Advance the time by this much every time it's read, so that code that busy-waits on the time makes progress. 0 stops
+// the time from advancing on its own.
+void set_time_since_boot_us_per_read(uint32_t inc);
 
 std::tuple<uint32_t, uint32_t, uint16_t> get_last_pwm_set_vals(); // currently unused
 
@@ -0,0 +1,6 @@
+#ifndef MOCK_ADSBEE_SERVER_HH_
+#define MOCK_ADSBEE_SERVER_HH_
+
+// Nothing from the ESP32 application is needed by the host SPI link.
+
+#endif /* MOCK_ADSBEE_SERVER_HH_ */
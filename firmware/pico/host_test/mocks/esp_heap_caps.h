@@ -0,0 +1,12 @@
+#ifndef MOCK_ESP_HEAP_CAPS_H_
+#define MOCK_ESP_HEAP_CAPS_H_
+
+#include <cstdint>
+#include <cstdlib>
+
+#define MALLOC_CAP_DMA (1 << 3)
+
+static inline void *heap_caps_malloc(size_t size, uint32_t caps) { return malloc(size); }
+static inline void heap_caps_free(void *ptr) { free(ptr); }
+
+#endif /* MOCK_ESP_HEAP_CAPS_H_ */
@@ -0,0 +1,8 @@
+#ifndef MOCK_ESP_LOG_H_
+#define MOCK_ESP_LOG_H_
+
+#include <cstdio>
+
+#define ESP_LOGE(tag, format, ...) printf("E %s: " format "\r\n", tag __VA_OPT__(, ) __VA_ARGS__)
+
+#endif /* MOCK_ESP_LOG_H_ */
@@ -0,0 +1,16 @@
+#ifndef MOCK_FREERTOS_H_
+#define MOCK_FREERTOS_H_
+
+#include <cstdint>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+
+#define pdFALSE            0
+#define pdTRUE             1
+#define portTICK_PERIOD_MS 1
+#define portMAX_DELAY      (TickType_t)0xffffffffUL
+
+#define IRAM_ATTR
+
+#endif /* MOCK_FREERTOS_H_ */
@@ -0,0 +1,19 @@
+#ifndef MOCK_SEMPHR_H_
+#define MOCK_SEMPHR_H_
+
+#include "freertos/FreeRTOS.h"
+
+// Mutexes are only used by the ESP32 end of the host SPI link, which runs on a single thread, so they are never
+// contended.
+
+typedef struct {
+    bool taken;
+} StaticSemaphore_t;
+
+typedef StaticSemaphore_t *SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks_to_wait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+
+#endif /* MOCK_SEMPHR_H_ */
@@ -0,0 +1,8 @@
+#ifndef MOCK_TASK_H_
+#define MOCK_TASK_H_
+
+#include "freertos/FreeRTOS.h"
+
+TickType_t xTaskGetTickCount();
+
+#endif /* MOCK_TASK_H_ */
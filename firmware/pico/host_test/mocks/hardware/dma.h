@@ -0,0 +1,51 @@
+#ifndef MOCK_DMA_H_
+#define MOCK_DMA_H_
+
+#include <cstdint>
+
+// Transfers between an SPI peripheral and memory run on the host SPI link, see spi_link_shim.hh. Nothing else is
+// supported.
+
+#define NUM_DMA_CHANNELS 12u
+
+#define DMA_SNIFF_CTRL_EN_BITS    0x00000001u
+#define DMA_SNIFF_CTRL_DMACH_BITS 0x0000001eu
+#define DMA_SNIFF_CTRL_DMACH_LSB  1u
+#define DMA_SNIFF_CTRL_CALC_BITS  0x000001e0u
+#define DMA_SNIFF_CTRL_CALC_LSB   5u
+
+typedef struct {
+    volatile uint32_t sniff_ctrl;
+    volatile uint32_t sniff_data;
+} dma_hw_t;
+
+extern dma_hw_t *dma_hw;
+
+enum dma_channel_transfer_size { DMA_SIZE_8 = 0, DMA_SIZE_16 = 1, DMA_SIZE_32 = 2 };
+
+typedef struct {
+    enum dma_channel_transfer_size transfer_data_size;
+    uint32_t dreq;
+    bool read_increment;
+    bool write_increment;
+    bool sniff_enable;
+} dma_channel_config;
+
+int dma_claim_unused_channel(bool required);
+dma_channel_config dma_channel_get_default_config(uint32_t channel);
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size);
+void channel_config_set_dreq(dma_channel_config *c, uint32_t dreq);
+void channel_config_set_read_increment(dma_channel_config *c, bool incr);
+void channel_config_set_write_increment(dma_channel_config *c, bool incr);
+void channel_config_set_sniff_enable(dma_channel_config *c, bool sniff_enable);
+void dma_channel_configure(uint32_t channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, uint32_t transfer_count, bool trigger);
+void dma_start_channel_mask(uint32_t chan_mask);
+void dma_channel_abort(uint32_t channel);
+void dma_sniffer_enable(uint32_t channel, uint32_t mode, bool force_channel_enable);
+
+void dma_channel_set_irq1_enabled(uint32_t channel, bool enabled);
+bool dma_channel_get_irq1_status(uint32_t channel);
+void dma_channel_acknowledge_irq1(uint32_t channel);
+
+#endif /* MOCK_DMA_H_ */
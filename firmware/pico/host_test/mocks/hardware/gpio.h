@@ -0,0 +1,36 @@
+#ifndef MOCK_GPIO_H_
+#define MOCK_GPIO_H_
+
+#include <cstdint>
+
+// Pins are wired to the host SPI link, see spi_link_shim.hh.
+
+#define GPIO_OUT 1
+#define GPIO_IN  0
+
+enum gpio_function { GPIO_FUNC_SPI = 1, GPIO_FUNC_SIO = 5 };
+
+enum gpio_irq_level {
+    GPIO_IRQ_LEVEL_LOW = 0x1u,
+    GPIO_IRQ_LEVEL_HIGH = 0x2u,
+    GPIO_IRQ_EDGE_FALL = 0x4u,
+    GPIO_IRQ_EDGE_RISE = 0x8u,
+};
+
+typedef void (*irq_handler_t)(void);
+
+void gpio_init(uint32_t gpio);
+void gpio_deinit(uint32_t gpio);
+void gpio_set_dir(uint32_t gpio, bool out);
+void gpio_set_pulls(uint32_t gpio, bool up, bool down);
+void gpio_set_function(uint32_t gpio, enum gpio_function fn);
+void gpio_put(uint32_t gpio, bool value);
+bool gpio_get(uint32_t gpio);
+
+void gpio_add_raw_irq_handler(uint32_t gpio, irq_handler_t handler);
+void gpio_remove_raw_irq_handler(uint32_t gpio, irq_handler_t handler);
+void gpio_set_irq_enabled(uint32_t gpio, uint32_t event_mask, bool enabled);
+uint32_t gpio_get_irq_event_mask(uint32_t gpio);
+void gpio_acknowledge_irq(uint32_t gpio, uint32_t event_mask);
+
+#endif /* MOCK_GPIO_H_ */
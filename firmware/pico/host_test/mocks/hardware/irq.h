@@ -0,0 +1,15 @@
+#ifndef MOCK_IRQ_H_
+#define MOCK_IRQ_H_
+
+#include <cstdint>
+
+#include "hardware/gpio.h"  // For irq_handler_t.
+#include "hardware/regs/intctrl.h"
+
+#define PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY 0x80
+
+void irq_set_enabled(uint32_t num, bool enabled);
+void irq_add_shared_handler(uint32_t num, irq_handler_t handler, uint8_t order_priority);
+void irq_remove_handler(uint32_t num, irq_handler_t handler);
+
+#endif /* MOCK_IRQ_H_ */
@@ -0,0 +1,33 @@
+#ifndef MOCK_SPI_H_
+#define MOCK_SPI_H_
+
+#include <cstddef>
+#include <cstdint>
+
+typedef struct {
+    volatile uint32_t dr;  // Data register, used as the DMA source and destination.
+} spi_hw_t;
+
+typedef struct spi_inst {
+    spi_hw_t hw;
+    uint32_t baudrate;
+    uint32_t dreq_tx;
+    uint32_t dreq_rx;
+} spi_inst_t;
+
+extern spi_inst_t *spi0;
+extern spi_inst_t *spi1;
+
+typedef enum { SPI_CPOL_0 = 0, SPI_CPOL_1 = 1 } spi_cpol_t;
+typedef enum { SPI_CPHA_0 = 0, SPI_CPHA_1 = 1 } spi_cpha_t;
+typedef enum { SPI_LSB_FIRST = 0, SPI_MSB_FIRST = 1 } spi_order_t;
+
+uint32_t spi_init(spi_inst_t *spi, uint32_t baudrate);
+void spi_deinit(spi_inst_t *spi);
+void spi_set_format(spi_inst_t *spi, uint32_t data_bits, spi_cpol_t cpol, spi_cpha_t cpha, spi_order_t order);
+int spi_read_blocking(spi_inst_t *spi, uint8_t repeated_tx_data, uint8_t *dst, size_t len);
+
+static inline spi_hw_t *spi_get_hw(spi_inst_t *spi) { return &spi->hw; }
+static inline uint32_t spi_get_dreq(spi_inst_t *spi, bool is_tx) { return is_tx ? spi->dreq_tx : spi->dreq_rx; }
+
+#endif /* MOCK_SPI_H_ */
@@ -0,0 +1,830 @@
+#include "spi_link_shim.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "buffer_utils.hh"
+#include "driver/gpio.h"
+#include "driver/spi_slave.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "hal.hh"
+#include "hardware/dma.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/spi.h"
+#include "macros.hh"
+#include "spi_coprocessor.hh"
+#include "unit_conversions.hh"
+
+// Wired like the default SPICoprocessorConfig on each end.
+static const uint32_t kRP2040CSPin = 9;
+static const uint32_t kRP2040HandshakePin = 13;
+static const gpio_num_t kESP32HandshakePin = GPIO_NUM_0;
+
+// How long each read of the time takes on the RP2040, see SPILinkShim.
+static const uint32_t kRP2040TimePerReadUs = 1;
+// Jobs on the ESP32 that take longer than this are given up on. SPICoprocessor on the ESP32 waits in
+// spi_slave_transmit() without a timeout, so a lost ack from the RP2040 holds up a job until the RP2040 clocks
+// something else, which nothing does while the job is running.
+static const uint64_t kESP32JobTimeoutUs = 1'000'000;
+static const uint64_t kUsPerSecond = 1'000'000;
+
+typedef SPICoprocessor::SCCommand SCCommand;
+
+// Requests are told apart by their header and CRC, see RecordRequest().
+static_assert(sizeof(SPICoprocessor::SCWriteHeader) == sizeof(SPICoprocessor::SCReadRequestHeader));
+static_assert(sizeof(SPICoprocessor::SCWriteHeader) + SPICoprocessor::SCWritePacket::kCRCLenBytes <= sizeof(uint64_t));
+
+/**
+ * DMA channel as set up by dma_channel_configure().
+ */
+struct DMAChannel {
+    dma_channel_config config;
+    volatile void *write_addr = nullptr;
+    const volatile void *read_addr = nullptr;
+    uint32_t transfer_count = 0;
+    bool irq1_enabled = false;
+    bool irq1_status = false;
+};
+
+/**
+ * Write queued with SPILinkShim::MasterWriteAsync(), waiting for its callback.
+ */
+struct AsyncWrite {
+    SPILinkShim::SPITransactionCallback callback;
+    void *callback_context;
+};
+
+/**
+ * Everything on the link that both ends can see, plus the mocked peripherals. Only one end touches it at a time, see
+ * RunESP32() and WaitForRP2040().
+ */
+struct SPILinkState {
+    SPILinkState(SPILinkShim::SPILinkShimConfig config_in)
+        : config(config_in),
+          rng(config_in.seed),
+          bit_error_distribution(config_in.bit_error_rate > 0.0 ? config_in.bit_error_rate : 1.0) {
+        if (config.bit_error_rate > 0.0) {
+            bits_until_next_error = bit_error_distribution(rng);
+        }
+    }
+
+    SPILinkShim::SPILinkShimConfig config;
+    SPILinkShim::SPILinkStats stats;
+
+    // Turn taking between the RP2040 (calling thread) and the ESP32 thread.
+    std::mutex mutex;
+    std::condition_variable turn_changed;
+    bool esp32_turn = false;
+
+    // ESP32 thread.
+    std::thread esp32_thread;
+    bool esp32_should_exit = false;
+    bool esp32_idle = false;  // Waiting for the RP2040 in SPICoprocessor::Update().
+    std::function<bool()> esp32_job = nullptr;
+    bool esp32_job_done = false;
+    bool esp32_job_result = false;
+
+    // Wires.
+    bool cs_level = true;
+    uint64_t transfer_start_timestamp_us = 0;  // When the first Byte since chip select went LO was clocked.
+    bool handshake_level = false;
+    bool handshake_rise_pending = false;          // Not seen by the RP2040 yet.
+    uint64_t handshake_visible_timestamp_us = 0;  // When the RP2040 sees the last rising edge.
+    uint16_t num_clocked_bytes = 0;               // Since chip select went LO.
+
+    // ESP32 SPI slave.
+    spi_slave_interface_config_t slave_config = {};
+    spi_slave_transaction_t *slave_transaction = nullptr;  // Waiting in spi_slave_transmit().
+    bool slave_transaction_done = false;
+    uint64_t slave_ready_timestamp_us = 0;  // When the transaction waiting in spi_slave_transmit() can be clocked.
+    uint64_t slave_transaction_end_timestamp_us = 0;
+    bool slave_transaction_ready = false;  // The transaction was ready when the transfer started.
+    std::vector<std::unique_ptr<StaticSemaphore_t>> semaphores;
+
+    // RP2040 peripherals.
+    DMAChannel dma_channels[NUM_DMA_CHANNELS];
+    irq_handler_t dma_irq1_handler = nullptr;
+    irq_handler_t handshake_irq_handler = nullptr;
+    uint32_t handshake_irq_mask = 0;
+    uint32_t handshake_irq_events = 0;
+    bool irq_enabled[RTC_IRQ + 1] = {false};
+
+    // Bit errors.
+    std::mt19937 rng;
+    std::geometric_distribution<uint64_t> bit_error_distribution;
+    uint64_t bits_until_next_error = 0;
+
+    // Bytes of the current transfer as each end sent them and received them, see RecordTransfer().
+    std::vector<uint8_t> sent_bytes[SPILinkShim::kNumEndpoints];
+    std::vector<uint8_t> received_bytes[SPILinkShim::kNumEndpoints];
+    // Requests that each end has sent during its current operation, with the time that each was first sent.
+    std::unordered_map<uint64_t, uint64_t> requests_sent[SPILinkShim::kNumEndpoints];
+    // Last request from each end that asked for an ack and hasn't gotten one yet.
+    bool awaiting_ack[SPILinkShim::kNumEndpoints] = {false};
+    uint64_t awaiting_ack_request[SPILinkShim::kNumEndpoints] = {0};
+
+    std::list<AsyncWrite> async_writes;
+};
+
+static SPILinkState *link_state = nullptr;
+
+/**
+ * Returns the level of the HANDSHAKE line as the RP2040 sees it, and raises the rising edge interrupt once the RP2040
+ * can see the edge, see SPILinkShimConfig::handshake_latency_us.
+ */
+static bool GetRP2040HandshakeLevel() {
+    if (!link_state->handshake_level || time_since_boot_us < link_state->handshake_visible_timestamp_us) {
+        return false;
+    }
+    if (link_state->handshake_rise_pending) {
+        link_state->handshake_irq_events |= GPIO_IRQ_EDGE_RISE;
+        link_state->handshake_rise_pending = false;
+    }
+    return true;
+}
+
+static void ServiceHandshakeIRQ() {
+    GetRP2040HandshakeLevel();
+    if ((link_state->handshake_irq_events & link_state->handshake_irq_mask) &&
+        link_state->irq_enabled[IO_IRQ_BANK0] && link_state->handshake_irq_handler != nullptr) {
+        link_state->handshake_irq_handler();
+    }
+}
+
+/**
+ * Lets the ESP32 run until it's waiting in spi_slave_transmit() again, or until its thread exits. Called by the
+ * RP2040.
+ */
+static void RunESP32() {
+    {
+        std::unique_lock<std::mutex> lock(link_state->mutex);
+        link_state->esp32_turn = true;
+        link_state->turn_changed.notify_all();
+        link_state->turn_changed.wait(lock, [] { return !link_state->esp32_turn; });
+    }
+    // Interrupts that the ESP32 raised while it was running.
+    ServiceHandshakeIRQ();
+}
+
+/**
+ * Hands the bus back to the RP2040 and waits for the next turn. Called by the ESP32.
+ */
+static void WaitForRP2040() {
+    std::unique_lock<std::mutex> lock(link_state->mutex);
+    link_state->esp32_turn = false;
+    link_state->turn_changed.notify_all();
+    link_state->turn_changed.wait(lock, [] { return link_state->esp32_turn; });
+}
+
+static void ESP32Thread() {
+    {
+        std::unique_lock<std::mutex> lock(link_state->mutex);
+        link_state->turn_changed.wait(lock, [] { return link_state->esp32_turn; });
+    }
+    spi_link_shim_esp32::Init();
+    // Stands in for the tasks on the ESP32 that share the SPI peripheral: writes and reads get their turn between
+    // transfers from the RP2040, see spi_slave_transmit().
+    while (!link_state->esp32_should_exit) {
+        if (link_state->esp32_job) {
+            link_state->esp32_job_result = link_state->esp32_job();
+            link_state->esp32_job = nullptr;
+            link_state->esp32_job_done = true;
+        } else {
+            link_state->esp32_idle = true;
+            spi_link_shim_esp32::Update();
+            link_state->esp32_idle = false;
+        }
+    }
+    spi_link_shim_esp32::DeInit();
+    std::unique_lock<std::mutex> lock(link_state->mutex);
+    link_state->esp32_turn = false;
+    link_state->turn_changed.notify_all();
+}
+
+static uint8_t InjectBitErrors(uint8_t byte) {
+    if (link_state->config.bit_error_rate <= 0.0) {
+        return byte;
+    }
+    // Skip straight to the next bit error instead of rolling the dice for every bit.
+    while (link_state->bits_until_next_error < kBitsPerByte) {
+        byte ^= 0b1 << link_state->bits_until_next_error;
+        link_state->stats.num_bit_errors++;
+        link_state->bits_until_next_error += 1 + link_state->bit_error_distribution(link_state->rng);
+    }
+    link_state->bits_until_next_error -= kBitsPerByte;
+    return byte;
+}
+
+/**
+ * Clocks one Byte between the RP2040 and the transaction that the ESP32 has waiting.
+ * @param[in] mosi Byte sent by the RP2040.
+ * @param[in] rp2040_keeps_miso False if the RP2040 throws away the Byte that it receives.
+ * @retval Byte received by the RP2040.
+ */
+static uint8_t ExchangeByte(uint8_t mosi, bool rp2040_keeps_miso) {
+    uint8_t miso = 0x0;  // Data lines are LO when the ESP32 isn't driving them.
+    spi_slave_transaction_t *transaction = link_state->slave_transaction;
+    if (link_state->num_clocked_bytes == 0) {
+        // The transfer starts with the clock rather than with chip select, since the RP2040 holds chip select LO from
+        // Init() until its first transfer.
+        link_state->transfer_start_timestamp_us = time_since_boot_us;
+        link_state->slave_transaction_ready =
+            transaction != nullptr && time_since_boot_us >= link_state->slave_ready_timestamp_us;
+    }
+    if (!link_state->cs_level && link_state->slave_transaction_ready && transaction != nullptr &&
+        link_state->num_clocked_bytes < transaction->length / kBitsPerByte) {
+        if (transaction->tx_buffer != nullptr) {
+            miso = static_cast<const uint8_t *>(transaction->tx_buffer)[link_state->num_clocked_bytes];
+            link_state->sent_bytes[SPILinkShim::kESP32].push_back(miso);
+        }
+        if (transaction->rx_buffer != nullptr) {
+            uint8_t mosi_received = InjectBitErrors(mosi);
+            static_cast<uint8_t *>(transaction->rx_buffer)[link_state->num_clocked_bytes] = mosi_received;
+            link_state->received_bytes[SPILinkShim::kESP32].push_back(mosi_received);
+        }
+    }
+    link_state->sent_bytes[SPILinkShim::kRP2040].push_back(mosi);
+    link_state->num_clocked_bytes++;
+    link_state->stats.num_wire_bytes++;
+    uint8_t miso_received = InjectBitErrors(miso);
+    if (rp2040_keeps_miso) {
+        link_state->received_bytes[SPILinkShim::kRP2040].push_back(miso_received);
+    }
+    return miso_received;
+}
+
+/**
+ * Counts a retry if a transfer carries a request that its sender already sent during the current operation.
+ * @param[in] endpoint End that sent the transfer.
+ * @param[in] bytes Bytes that it sent.
+ */
+static void RecordRequest(SPILinkShim::Endpoint endpoint, std::vector<uint8_t> &bytes) {
+    if (bytes.empty()) {
+        return;
+    }
+    SCCommand cmd = static_cast<SCCommand>(bytes[0]);
+    bool asks_for_ack = false;
+    bool is_read_request = false;
+    switch (cmd) {
+        case SPICoprocessor::kCmdWriteToSlaveRequireAck:
+        case SPICoprocessor::kCmdWriteToMasterRequireAck:
+        case SPICoprocessor::kCmdStreamWriteToSlaveRequireAck:
+        case SPICoprocessor::kCmdStreamWriteToMasterRequireAck:
+            asks_for_ack = true;
+            break;
+        case SPICoprocessor::kCmdWriteToSlave:
+        case SPICoprocessor::kCmdWriteToMaster:
+        case SPICoprocessor::kCmdStreamWriteToSlave:
+        case SPICoprocessor::kCmdStreamWriteToMaster:
+            break;
+        case SPICoprocessor::kCmdReadFromSlave:
+        case SPICoprocessor::kCmdReadFromMaster:
+            is_read_request = true;
+            break;
+        default:
+            return;  // Not a request.
+    }
+    if (bytes.size() < sizeof(SPICoprocessor::SCWriteHeader)) {
+        return;  // Cut short, so the request never made it across.
+    }
+    uint16_t len_bytes = is_read_request
+                             ? SPICoprocessor::SCReadRequestPacket::kBufLenBytes
+                             : SPICoprocessor::SCWritePacket(bytes.data(), bytes.size()).GetBufLenBytes();
+    if (bytes.size() < len_bytes) {
+        return;  // Cut short, so the request never made it across.
+    }
+    // Header, followed by the CRC, which covers the data.
+    uint64_t request = 0;
+    memcpy(&request, bytes.data(), sizeof(SPICoprocessor::SCWriteHeader));
+    memcpy(reinterpret_cast<uint8_t *>(&request) + sizeof(SPICoprocessor::SCWriteHeader),
+           bytes.data() + len_bytes - SPICoprocessor::SCWritePacket::kCRCLenBytes,
+           SPICoprocessor::SCWritePacket::kCRCLenBytes);
+    if (!link_state->requests_sent[endpoint].emplace(request, link_state->transfer_start_timestamp_us).second) {
+        link_state->stats.num_retries[endpoint]++;
+    }
+    if (asks_for_ack) {
+        link_state->awaiting_ack[endpoint] = true;
+        link_state->awaiting_ack_request[endpoint] = request;
+    }
+}
+
+/**
+ * Records the ack latency of the request that an end is waiting on, if a transfer carries an intact ack for it.
+ * @param[in] endpoint End that received the transfer.
+ * @param[in] bytes Bytes that it received.
+ */
+static void RecordAck(SPILinkShim::Endpoint endpoint, std::vector<uint8_t> &bytes) {
+    if (!link_state->awaiting_ack[endpoint] || bytes.empty()) {
+        return;
+    }
+    SCCommand cmd = static_cast<SCCommand>(bytes[0]);
+    uint16_t len_bytes = 0;
+    if (cmd == SPICoprocessor::kCmdAck) {
+        len_bytes = SPICoprocessor::SCResponsePacket::kAckLenBytes;
+    } else if (cmd == SPICoprocessor::kCmdStreamAck) {
+        len_bytes = SPICoprocessor::SCResponsePacket::kStreamAckLenBytes;
+    } else {
+        return;
+    }
+    SPICoprocessor::SCResponsePacket ack_packet = SPICoprocessor::SCResponsePacket(bytes.data(), bytes.size());
+    ack_packet.SetDataLenBytes(len_bytes - SPICoprocessor::SCResponsePacket::kBufMinLenBytes);
+    if (!ack_packet.IsValid() || (cmd == SPICoprocessor::kCmdAck && !ack_packet.GetData()[0])) {
+        return;  // Corrupted or NACK, so the request gets sent again.
+    }
+    uint64_t first_sent_timestamp_us =
+        link_state->requests_sent[endpoint][link_state->awaiting_ack_request[endpoint]];
+    link_state->stats.ack_latencies_us.push_back(time_since_boot_us - first_sent_timestamp_us);
+    link_state->awaiting_ack[endpoint] = false;
+}
+
+/**
+ * Looks at the packets in a transfer that just finished: requests from either end for retries, and acks for ack
+ * latency. Requests count as sent, and acks as received, only if they were clocked in full.
+ */
+static void RecordTransfer() {
+    for (SPILinkShim::Endpoint endpoint : {SPILinkShim::kRP2040, SPILinkShim::kESP32}) {
+        RecordRequest(endpoint, link_state->sent_bytes[endpoint]);
+        RecordAck(endpoint, link_state->received_bytes[endpoint]);
+    }
+}
+
+/**
+ * Calls the callback of a write queued with SPILinkShim::MasterWriteAsync(), after counting a failure if it failed.
+ */
+static void OnMasterWriteAsyncComplete(bool success, void *context) {
+    AsyncWrite *write = static_cast<AsyncWrite *>(context);
+    if (!success) {
+        link_state->stats.num_failures[SPILinkShim::kRP2040]++;
+    }
+    if (write->callback != nullptr) {
+        write->callback(success, write->callback_context);
+    }
+    link_state->async_writes.remove_if([write](const AsyncWrite &async_write) { return &async_write == write; });
+}
+
+static void AdvanceTimeForTransfer(spi_inst_t *spi, uint32_t len_bytes) {
+    if (spi->baudrate == 0) {
+        return;
+    }
+    inc_time_since_boot_us((static_cast<uint64_t>(len_bytes) * kBitsPerByte * kUsPerSecond + spi->baudrate - 1) /
+                           spi->baudrate);
+}
+
+/** SPILinkShim **/
+
+uint32_t SPILinkShim::SPILinkStats::GetAckLatencyPercentileUs(double percentile) const {
+    if (ack_latencies_us.empty()) {
+        return 0;
+    }
+    std::vector<uint32_t> latencies_us = ack_latencies_us;
+    size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * latencies_us.size()));
+    size_t index = rank > 0 ? MIN(rank, latencies_us.size()) - 1 : 0;
+    std::nth_element(latencies_us.begin(), latencies_us.begin() + index, latencies_us.end());
+    return latencies_us[index];
+}
+
+SPILinkShim::SPILinkShim(SPILinkShimConfig config_in) {
+    link_state = new SPILinkState(config_in);
+    set_time_since_boot_us_per_read(kRP2040TimePerReadUs);
+    link_state->esp32_thread = std::thread(ESP32Thread);
+    RunESP32();  // The ESP32 comes up first, so that it's driving the HANDSHAKE line when the RP2040 looks at it.
+    spi_link_shim_rp2040::Init();
+    start_time_us_ = time_since_boot_us;
+}
+
+SPILinkShim::~SPILinkShim() {
+    spi_link_shim_rp2040::DeInit();
+    link_state->esp32_should_exit = true;
+    RunESP32();
+    link_state->esp32_thread.join();
+    set_time_since_boot_us_per_read(0);
+    delete link_state;
+    link_state = nullptr;
+}
+
+bool SPILinkShim::MasterWrite(ObjectDictionary::Address addr, const uint8_t *buf, uint16_t len_bytes,
+                              bool require_ack) {
+    BeginOperation(kRP2040);
+    bool ret = spi_link_shim_rp2040::Write(addr, buf, len_bytes, require_ack);
+    spi_link_shim_rp2040::Update(true);  // Writes without an ack are only queued.
+    return RecordResult(kRP2040, ret);
+}
+
+bool SPILinkShim::MasterWriteAsync(ObjectDictionary::Address addr, const uint8_t *buf, uint16_t len_bytes,
+                                   bool require_ack, SPITransactionCallback callback, void *callback_context) {
+    BeginOperation(kRP2040);
+    // Failures are counted by OnMasterWriteAsyncComplete() once the write is done, unless it can't be queued at all.
+    link_state->async_writes.push_back({.callback = callback, .callback_context = callback_context});
+    AsyncWrite *write = &link_state->async_writes.back();
+    if (!spi_link_shim_rp2040::WriteAsync(addr, buf, len_bytes, require_ack, OnMasterWriteAsyncComplete, write)) {
+        link_state->async_writes.pop_back();
+        return RecordResult(kRP2040, false);
+    }
+    return true;
+}
+
+bool SPILinkShim::MasterRead(ObjectDictionary::Address addr, uint8_t *buf, uint16_t len_bytes) {
+    BeginOperation(kRP2040);
+    return RecordResult(kRP2040, spi_link_shim_rp2040::Read(addr, buf, len_bytes));
+}
+
+bool SPILinkShim::MasterUpdate(bool blocking) { return spi_link_shim_rp2040::Update(blocking); }
+
+bool SPILinkShim::SlaveWrite(ObjectDictionary::Address addr, const uint8_t *buf, uint16_t len_bytes,
+                             bool require_ack) {
+    BeginOperation(kESP32);
+    return RecordResult(kESP32, RunOnESP32([addr, buf, len_bytes, require_ack] {
+                            return spi_link_shim_esp32::Write(addr, const_cast<uint8_t *>(buf), len_bytes, require_ack);
+                        }));
+}
+
+bool SPILinkShim::SlaveRead(ObjectDictionary::Address addr, uint8_t *buf, uint16_t len_bytes) {
+    BeginOperation(kESP32);
+    return RecordResult(kESP32,
+                        RunOnESP32([addr, buf, len_bytes] { return spi_link_shim_esp32::Read(addr, buf, len_bytes); }));
+}
+
+uint8_t *SPILinkShim::GetMasterObject(ObjectDictionary::Address addr) {
+    return spi_link_shim_rp2040::object_dictionary.GetObject(addr);
+}
+
+uint8_t *SPILinkShim::GetSlaveObject(ObjectDictionary::Address addr) {
+    return spi_link_shim_esp32::object_dictionary.GetObject(addr);
+}
+
+const SPILinkShim::SPILinkStats &SPILinkShim::GetStats() const { return link_state->stats; }
+
+uint32_t SPILinkShim::GetClkRateHz() const { return spi1->baudrate; }
+
+uint64_t SPILinkShim::GetTimeUs() const { return time_since_boot_us - start_time_us_; }
+
+void SPILinkShim::BeginOperation(Endpoint endpoint) {
+    link_state->requests_sent[endpoint].clear();
+    link_state->awaiting_ack[endpoint] = false;
+}
+
+bool SPILinkShim::RecordResult(Endpoint endpoint, bool success) {
+    if (!success) {
+        link_state->stats.num_failures[endpoint]++;
+    }
+    return success;
+}
+
+void SPILinkShim::RecordConsoleMessage(Endpoint endpoint, bool is_error) {
+    if (link_state == nullptr) {
+        return;
+    }
+    if (is_error) {
+        link_state->stats.num_errors[endpoint]++;
+    } else {
+        link_state->stats.num_warnings[endpoint]++;
+    }
+}
+
+bool SPILinkShim::RunOnESP32(std::function<bool()> job) {
+    if (link_state->esp32_job) {
+        return false;  // An earlier job timed out and is still running.
+    }
+    link_state->esp32_job = job;
+    link_state->esp32_job_done = false;
+    RunESP32();  // Gets the ESP32 out of SPICoprocessor::Update() and onto the job.
+    uint64_t timeout_timestamp_us = time_since_boot_us + kESP32JobTimeoutUs;
+    while (!link_state->esp32_job_done) {
+        if (time_since_boot_us > timeout_timestamp_us) {
+            return false;
+        }
+        spi_link_shim_rp2040::Update(false);
+    }
+    return link_state->esp32_job_result;
+}
+
+/** SPILinkShimObjectDictionary **/
+
+bool SPILinkShimObjectDictionary::SetBytes(ObjectDictionary::Address addr, uint8_t *buf, uint16_t buf_len,
+                                           uint16_t offset) {
+    if (addr >= ObjectDictionary::kNumAddrs ||
+        static_cast<uint32_t>(offset) + buf_len > SPILinkShim::kObjectMaxLenBytes) {
+        return false;
+    }
+    memcpy(objects_[addr] + offset, buf, buf_len);
+    return true;
+}
+
+bool SPILinkShimObjectDictionary::GetBytes(ObjectDictionary::Address addr, uint8_t *buf, uint16_t buf_len,
+                                           uint16_t offset) {
+    if (addr >= ObjectDictionary::kNumAddrs ||
+        static_cast<uint32_t>(offset) + buf_len > SPILinkShim::kObjectMaxLenBytes) {
+        return false;
+    }
+    memcpy(buf, objects_[addr] + offset, buf_len);
+    return true;
+}
+
+/** Pico SDK mocks, see mocks/hardware. **/
+
+static spi_inst_t spi_0 = {.hw = {}, .baudrate = 0, .dreq_tx = 16, .dreq_rx = 17};
+static spi_inst_t spi_1 = {.hw = {}, .baudrate = 0, .dreq_tx = 18, .dreq_rx = 19};
+spi_inst_t *spi0 = &spi_0;
+spi_inst_t *spi1 = &spi_1;
+
+static dma_hw_t dma_hw_regs = {};
+dma_hw_t *dma_hw = &dma_hw_regs;
+
+uint32_t spi_init(spi_inst_t *spi, uint32_t baudrate) {
+    spi->baudrate = link_state->config.clk_rate_hz > 0 ? link_state->config.clk_rate_hz : baudrate;
+    return spi->baudrate;
+}
+
+void spi_deinit(spi_inst_t *spi) { spi->baudrate = 0; }
+
+void spi_set_format(spi_inst_t *spi, uint32_t data_bits, spi_cpol_t cpol, spi_cpha_t cpha, spi_order_t order) {}
+
+int spi_read_blocking(spi_inst_t *spi, uint8_t repeated_tx_data, uint8_t *dst, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        dst[i] = ExchangeByte(repeated_tx_data, true);
+    }
+    AdvanceTimeForTransfer(spi, len);
+    return len;
+}
+
+void gpio_init(uint32_t gpio) {}
+
+void gpio_deinit(uint32_t gpio) {}
+
+void gpio_set_dir(uint32_t gpio, bool out) {}
+
+void gpio_set_pulls(uint32_t gpio, bool up, bool down) {}
+
+void gpio_set_function(uint32_t gpio, enum gpio_function fn) {}
+
+void gpio_put(uint32_t gpio, bool value) {
+    if (gpio != kRP2040CSPin || value == link_state->cs_level) {
+        return;
+    }
+    link_state->cs_level = value;
+    if (!value) {
+        link_state->num_clocked_bytes = 0;
+        for (uint16_t endpoint = 0; endpoint < SPILinkShim::kNumEndpoints; endpoint++) {
+            link_state->sent_bytes[endpoint].clear();
+            link_state->received_bytes[endpoint].clear();
+        }
+        return;
+    }
+    if (link_state->num_clocked_bytes == 0) {
+        return;  // Nothing happened on the bus.
+    }
+    link_state->stats.num_transfers++;
+    RecordTransfer();
+    spi_slave_transaction_t *transaction = link_state->slave_transaction;
+    if (transaction != nullptr && link_state->slave_transaction_ready) {
+        // Chip select going HI finishes the transaction that the ESP32 was waiting on.
+        transaction->trans_len = MIN(link_state->num_clocked_bytes * kBitsPerByte, transaction->length);
+        link_state->slave_transaction_done = true;
+        link_state->slave_transaction_end_timestamp_us = time_since_boot_us;
+        RunESP32();
+    }
+}
+
+bool gpio_get(uint32_t gpio) { return gpio == kRP2040HandshakePin && GetRP2040HandshakeLevel(); }
+
+void gpio_add_raw_irq_handler(uint32_t gpio, irq_handler_t handler) {
+    if (gpio == kRP2040HandshakePin) {
+        link_state->handshake_irq_handler = handler;
+    }
+}
+
+void gpio_remove_raw_irq_handler(uint32_t gpio, irq_handler_t handler) {
+    if (gpio == kRP2040HandshakePin && link_state->handshake_irq_handler == handler) {
+        link_state->handshake_irq_handler = nullptr;
+    }
+}
+
+void gpio_set_irq_enabled(uint32_t gpio, uint32_t event_mask, bool enabled) {
+    if (gpio != kRP2040HandshakePin) {
+        return;
+    }
+    if (enabled) {
+        link_state->handshake_irq_mask |= event_mask;
+    } else {
+        link_state->handshake_irq_mask &= ~event_mask;
+    }
+}
+
+uint32_t gpio_get_irq_event_mask(uint32_t gpio) {
+    return gpio == kRP2040HandshakePin ? link_state->handshake_irq_events : 0;
+}
+
+void gpio_acknowledge_irq(uint32_t gpio, uint32_t event_mask) {
+    if (gpio == kRP2040HandshakePin) {
+        link_state->handshake_irq_events &= ~event_mask;
+    }
+}
+
+void irq_set_enabled(uint32_t num, bool enabled) { link_state->irq_enabled[num] = enabled; }
+
+void irq_add_shared_handler(uint32_t num, irq_handler_t handler, uint8_t order_priority) {
+    if (num == DMA_IRQ_1) {
+        link_state->dma_irq1_handler = handler;
+    }
+}
+
+void irq_remove_handler(uint32_t num, irq_handler_t handler) {
+    if (num == DMA_IRQ_1 && link_state->dma_irq1_handler == handler) {
+        link_state->dma_irq1_handler = nullptr;
+    }
+}
+
+int dma_claim_unused_channel(bool required) {
+    // Channels stay claimed by the SPICoprocessor that claimed them, across links.
+    static uint32_t num_claimed_channels = 0;
+    return num_claimed_channels < NUM_DMA_CHANNELS ? num_claimed_channels++ : -1;
+}
+
+dma_channel_config dma_channel_get_default_config(uint32_t channel) {
+    return {.transfer_data_size = DMA_SIZE_32,
+            .dreq = 0x3f,  // Permanent, i.e. unpaced.
+            .read_increment = true,
+            .write_increment = false,
+            .sniff_enable = false};
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size) {
+    c->transfer_data_size = size;
+}
+
+void channel_config_set_dreq(dma_channel_config *c, uint32_t dreq) { c->dreq = dreq; }
+
+void channel_config_set_read_increment(dma_channel_config *c, bool incr) { c->read_increment = incr; }
+
+void channel_config_set_write_increment(dma_channel_config *c, bool incr) { c->write_increment = incr; }
+
+void channel_config_set_sniff_enable(dma_channel_config *c, bool sniff_enable) { c->sniff_enable = sniff_enable; }
+
+void dma_channel_configure(uint32_t channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, uint32_t transfer_count, bool trigger) {
+    DMAChannel &dma_channel = link_state->dma_channels[channel];
+    dma_channel.config = *config;
+    dma_channel.write_addr = write_addr;
+    dma_channel.read_addr = read_addr;
+    dma_channel.transfer_count = transfer_count;
+    if (trigger) {
+        dma_start_channel_mask(0b1 << channel);
+    }
+}
+
+void dma_start_channel_mask(uint32_t chan_mask) {
+    // Pair up the channels that feed and drain an SPI peripheral, and run the whole transfer right away.
+    spi_inst_t *spi = nullptr;
+    uint32_t tx_channel = NUM_DMA_CHANNELS;
+    uint32_t rx_channel = NUM_DMA_CHANNELS;
+    for (uint32_t channel = 0; channel < NUM_DMA_CHANNELS; channel++) {
+        if (!(chan_mask & (0b1 << channel))) {
+            continue;
+        }
+        for (spi_inst_t *spi_inst : {spi0, spi1}) {
+            if (link_state->dma_channels[channel].config.dreq == spi_get_dreq(spi_inst, true)) {
+                tx_channel = channel;
+                spi = spi_inst;
+            } else if (link_state->dma_channels[channel].config.dreq == spi_get_dreq(spi_inst, false)) {
+                rx_channel = channel;
+            }
+        }
+    }
+    if (tx_channel >= NUM_DMA_CHANNELS || rx_channel >= NUM_DMA_CHANNELS) {
+        return;  // Not supported.
+    }
+    DMAChannel &tx = link_state->dma_channels[tx_channel];
+    DMAChannel &rx = link_state->dma_channels[rx_channel];
+    const volatile uint8_t *tx_buf = static_cast<const volatile uint8_t *>(tx.read_addr);
+    volatile uint8_t *rx_buf = static_cast<volatile uint8_t *>(rx.write_addr);
+    uint32_t sniff_ctrl = dma_hw->sniff_ctrl;
+    // Only the CRC-16-CCITT calculation (0x2) is supported by the sniffer.
+    bool sniff = rx.config.sniff_enable && (sniff_ctrl & DMA_SNIFF_CTRL_EN_BITS) &&
+                 ((sniff_ctrl & DMA_SNIFF_CTRL_DMACH_BITS) >> DMA_SNIFF_CTRL_DMACH_LSB) == rx_channel &&
+                 ((sniff_ctrl & DMA_SNIFF_CTRL_CALC_BITS) >> DMA_SNIFF_CTRL_CALC_LSB) == 0x2;
+    for (uint32_t i = 0; i < tx.transfer_count; i++) {
+        // Received Bytes are thrown away into a single sink when nobody needs them.
+        uint8_t miso = ExchangeByte(tx_buf[tx.config.read_increment ? i : 0], rx.config.write_increment);
+        rx_buf[rx.config.write_increment ? i : 0] = miso;
+        if (sniff) {
+            dma_hw->sniff_data = UpdateCRC16(dma_hw->sniff_data, &miso, 1);
+        }
+    }
+    AdvanceTimeForTransfer(spi, tx.transfer_count);
+    if (rx.irq1_enabled) {
+        rx.irq1_status = true;
+        if (link_state->irq_enabled[DMA_IRQ_1] && link_state->dma_irq1_handler != nullptr) {
+            link_state->dma_irq1_handler();
+        }
+    }
+}
+
+void dma_channel_abort(uint32_t channel) {}  // Transfers finish as soon as they start.
+
+void dma_sniffer_enable(uint32_t channel, uint32_t mode, bool force_channel_enable) {
+    dma_hw->sniff_ctrl = DMA_SNIFF_CTRL_EN_BITS | (channel << DMA_SNIFF_CTRL_DMACH_LSB) |
+                         (mode << DMA_SNIFF_CTRL_CALC_LSB);
+}
+
+void dma_channel_set_irq1_enabled(uint32_t channel, bool enabled) {
+    link_state->dma_channels[channel].irq1_enabled = enabled;
+}
+
+bool dma_channel_get_irq1_status(uint32_t channel) { return link_state->dma_channels[channel].irq1_status; }
+
+void dma_channel_acknowledge_irq1(uint32_t channel) { link_state->dma_channels[channel].irq1_status = false; }
+
+/** ESP-IDF mocks, see mocks/driver, mocks/freertos, and friends. **/
+
+esp_err_t gpio_config(const gpio_config_t *config) { return ESP_OK; }
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode) { return ESP_OK; }
+
+esp_err_t gpio_set_pull_mode(gpio_num_t gpio_num, gpio_pull_mode_t pull) { return ESP_OK; }
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level) {
+    if (gpio_num != kESP32HandshakePin) {
+        return ESP_OK;
+    }
+    if (level && !link_state->handshake_level) {
+        // The ESP32 raises HANDSHAKE once its transaction is ready, and the RP2040 sees it some time after that.
+        link_state->handshake_rise_pending = true;
+        link_state->handshake_visible_timestamp_us = MAX(time_since_boot_us, link_state->slave_ready_timestamp_us) +
+                                                     link_state->config.handshake_latency_us;
+    } else if (!level) {
+        link_state->handshake_rise_pending = false;
+    }
+    link_state->handshake_level = level;
+    return ESP_OK;
+}
+
+esp_err_t spi_slave_initialize(spi_host_device_t host, const spi_bus_config_t *bus_config,
+                               const spi_slave_interface_config_t *slave_config, spi_dma_chan_t dma_chan) {
+    link_state->slave_config = *slave_config;
+    return ESP_OK;
+}
+
+esp_err_t spi_slave_transmit(spi_host_device_t host, spi_slave_transaction_t *trans_desc, TickType_t ticks_to_wait) {
+    if (link_state->esp32_should_exit) {
+        return ESP_ERR_TIMEOUT;
+    }
+    trans_desc->trans_len = 0;
+    link_state->slave_transaction = trans_desc;
+    link_state->slave_transaction_done = false;
+    link_state->slave_ready_timestamp_us =
+        MAX(time_since_boot_us, link_state->slave_transaction_end_timestamp_us + link_state->config.slave_rearm_us);
+    if (link_state->slave_config.post_setup_cb != nullptr) {
+        link_state->slave_config.post_setup_cb(trans_desc);
+    }
+    esp_err_t status = ESP_OK;
+    while (true) {
+        WaitForRP2040();
+        if (link_state->slave_transaction_done) {
+            break;
+        }
+        // A job can't start while SPICoprocessor::Update() holds the SPI mutex. On the ESP32, the next transfer from
+        // the RP2040 lets it go. Here, the wait is cut short instead, as long as nothing is on the bus.
+        bool job_waiting = link_state->esp32_idle && link_state->esp32_job && !link_state->handshake_level &&
+                           (link_state->cs_level || link_state->num_clocked_bytes == 0);
+        if (link_state->esp32_should_exit || job_waiting) {
+            status = ESP_ERR_TIMEOUT;
+            break;
+        }
+    }
+    link_state->slave_transaction = nullptr;
+    if (link_state->slave_config.post_trans_cb != nullptr) {
+        link_state->slave_config.post_trans_cb(trans_desc);
+    }
+    return status;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    link_state->semaphores.push_back(std::make_unique<StaticSemaphore_t>());
+    return link_state->semaphores.back().get();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks_to_wait) {
+    if (semaphore->taken) {
+        return pdFALSE;  // Only one task, so nobody else can give it back.
+    }
+    semaphore->taken = true;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    semaphore->taken = false;
+    return pdTRUE;
+}
+
+TickType_t xTaskGetTickCount() { return get_time_since_boot_ms() / portTICK_PERIOD_MS; }
@@ -0,0 +1,212 @@
+#ifndef SPI_LINK_SHIM_HH_
+#define SPI_LINK_SHIM_HH_
+
+#include <functional>
+#include <vector>
+
+#include "object_dictionary.hh"
+#include "stdint.h"
+
+/**
+ * Host-side SPI link between the RP2040 (master) and ESP32 (slave) builds of SPICoprocessor. spi_link_shim_rp2040.cc
+ * and spi_link_shim_esp32.cc compile spi_coprocessor.cpp with ON_PICO and with ON_ESP32, each in a namespace of its
+ * own, on top of the Pico SDK and ESP-IDF mocks in mocks/. This file wires the mocks together: chip select and the
+ * HANDSHAKE line are shared, and every Byte that the RP2040 clocks with spi_read_blocking() or DMA is exchanged with
+ * the transaction that the ESP32 has waiting in spi_slave_transmit(), optionally flipping bits on the way.
+ *
+ * The ESP32 end runs on a thread of its own, since spi_slave_transmit() blocks. The two ends take turns: the ESP32 runs
+ * whenever the RP2040 finishes a transfer with it, until it's waiting in spi_slave_transmit() again, so runs are
+ * repeatable. Time comes from the host HAL. Every read of the time advances it by a microsecond, so that the busy loops
+ * on the RP2040 make progress, and every transfer advances it by its duration on the bus.
+ *
+ * The shim also watches the packets on the bus. A request that its sender has already sent during the same operation
+ * is counted as a retry, and the time from the first send of a request that asks for an ack to the end of that ack is
+ * recorded as its ack latency.
+ *
+ * Only one SPILinkShim can exist at a time, since the mocked peripherals are global.
+ */
+class SPILinkShim {
+   public:
+    static const uint32_t kObjectMaxLenBytes = 32 * 1024;  // Room for the largest object on either side.
+
+    enum Endpoint : uint8_t { kRP2040 = 0, kESP32, kNumEndpoints };
+
+    struct SPILinkShimConfig {
+        // Probability that each bit on the wire is flipped, in either direction.
+        double bit_error_rate = 0.0;
+        uint32_t seed = 1;  // For bit error injection.
+        // SPI clock rate. 0 uses the rate that the RP2040 asks for in spi_init().
+        uint32_t clk_rate_hz = 0;
+        // Time from the ESP32 raising the HANDSHAKE line to the RP2040 seeing it go HI. Falling edges are seen right
+        // away.
+        uint32_t handshake_latency_us = 0;
+        // Time that the ESP32 SPI slave takes to get the next transaction ready after chip select goes HI. Transfers
+        // that start before then don't reach the ESP32.
+        uint32_t slave_rearm_us = 0;
+    };
+
+    struct SPILinkStats {
+        uint32_t num_transfers = 0;     // Chip select assertions that clocked at least one Byte.
+        uint64_t num_wire_bytes = 0;    // Everything clocked over the bus, including headers, CRCs, and acks.
+        uint32_t num_bit_errors = 0;
+        // Requests sent again by the end that started them, within the same operation.
+        uint32_t num_retries[kNumEndpoints] = {0};
+        // Operations started on each end that didn't go through, see MasterWrite() and friends.
+        uint32_t num_failures[kNumEndpoints] = {0};
+        // CONSOLE_WARNING() and CONSOLE_ERROR() messages logged by SPICoprocessor on each end.
+        uint32_t num_warnings[kNumEndpoints] = {0};
+        uint32_t num_errors[kNumEndpoints] = {0};
+        // Time from the first send of each request that asked for an ack to the end of the ack, from either end.
+        std::vector<uint32_t> ack_latencies_us;
+
+        /**
+         * Returns a percentile of the ack latencies, using the nearest rank method.
+         * @param[in] percentile Percentile to return, from 0 to 100.
+         * @retval Ack latency at the percentile, in microseconds, or 0 if nothing was acked.
+         */
+        uint32_t GetAckLatencyPercentileUs(double percentile) const;
+    };
+
+    /**
+     * Same as SPICoprocessor::SPITransactionCallback on the RP2040.
+     */
+    typedef void (*SPITransactionCallback)(bool success, void *context);
+
+    /**
+     * Constructor. Starts the ESP32 thread and runs Init() on both ends.
+     */
+    SPILinkShim(SPILinkShimConfig config_in);
+
+    /**
+     * Destructor. Runs DeInit() on both ends and stops the ESP32 thread.
+     */
+    ~SPILinkShim();
+
+    /**
+     * Writes an object from the RP2040 to the ESP32 with SPICoprocessor::Write(), then runs SPICoprocessor::Update()
+     * until the transaction queue is empty.
+     * @retval True if the write went through (and was acked, if require_ack is set), false otherwise.
+     */
+    bool MasterWrite(ObjectDictionary::Address addr, const uint8_t *buf, uint16_t len_bytes, bool require_ack);
+
+    /**
+     * Queues a write from the RP2040 to the ESP32 with SPICoprocessor::WriteAsync(). Use MasterUpdate() to send it.
+     * @retval True if the write was queued, false otherwise.
+     */
+    bool MasterWriteAsync(ObjectDictionary::Address addr, const uint8_t *buf, uint16_t len_bytes, bool require_ack,
+                          SPITransactionCallback callback = nullptr, void *callback_context = nullptr);
+
+    /**
+     * Reads an object on the ESP32 from the RP2040 with SPICoprocessor::Read().
+     * @retval True if the read went through, false otherwise.
+     */
+    bool MasterRead(ObjectDictionary::Address addr, uint8_t *buf, uint16_t len_bytes);
+
+    /**
+     * Runs SPICoprocessor::Update() on the RP2040.
+     * @param[in] blocking Keep running until the transaction queue is empty and the bus is idle.
+     */
+    bool MasterUpdate(bool blocking = false);
+
+    /**
+     * Writes an object from the ESP32 to the RP2040 with SPICoprocessor::Write() on the ESP32 thread, and runs
+     * SPICoprocessor::Update() on the RP2040 until it's done.
+     * @retval True if the write went through (and was acked, if require_ack is set), false otherwise.
+     */
+    bool SlaveWrite(ObjectDictionary::Address addr, const uint8_t *buf, uint16_t len_bytes, bool require_ack);
+
+    /**
+     * Reads an object on the RP2040 from the ESP32 with SPICoprocessor::Read() on the ESP32 thread, and runs
+     * SPICoprocessor::Update() on the RP2040 until it's done.
+     * @retval True if the read went through, false otherwise.
+     */
+    bool SlaveRead(ObjectDictionary::Address addr, uint8_t *buf, uint16_t len_bytes);
+
+    /**
+     * Returns the copy of an object that lives on the RP2040 or the ESP32. Writes land here, and reads come from here.
+     */
+    uint8_t *GetMasterObject(ObjectDictionary::Address addr);
+    uint8_t *GetSlaveObject(ObjectDictionary::Address addr);
+
+    const SPILinkStats &GetStats() const;
+
+    /**
+     * Returns the SPI clock rate on the bus, i.e. SPILinkShimConfig::clk_rate_hz if it's set, otherwise the rate that
+     * the RP2040 set up in SPICoprocessor::Init().
+     */
+    uint32_t GetClkRateHz() const;
+
+    /**
+     * Returns the time since the link was brought up, not counting the wait for the ESP32 to boot in
+     * SPICoprocessor::Init().
+     */
+    uint64_t GetTimeUs() const;
+
+    /**
+     * Called by the CONSOLE_WARNING() and CONSOLE_ERROR() macros in the SPICoprocessor builds.
+     */
+    static void RecordConsoleMessage(Endpoint endpoint, bool is_error);
+
+   private:
+    /**
+     * Starts tracking requests for a new operation on one end, so that its requests aren't mistaken for retries of the
+     * last operation's.
+     */
+    void BeginOperation(Endpoint endpoint);
+
+    /**
+     * Counts an operation that didn't go through.
+     * @param[in] endpoint End that started the operation.
+     * @param[in] success Result of the operation.
+     * @retval success, for chaining.
+     */
+    bool RecordResult(Endpoint endpoint, bool success);
+
+    /**
+     * Runs a job on the ESP32 thread and runs SPICoprocessor::Update() on the RP2040 until it's done, or until it has
+     * taken kESP32JobTimeoutUs.
+     * @retval Result of the job, or false if it timed out.
+     */
+    bool RunOnESP32(std::function<bool()> job);
+
+    uint64_t start_time_us_ = 0;
+};
+
+/**
+ * Stands in for the object dictionary on each end of the link. Every address is a plain buffer that writes land in and
+ * reads come from.
+ */
+class SPILinkShimObjectDictionary {
+   public:
+    bool SetBytes(ObjectDictionary::Address addr, uint8_t *buf, uint16_t buf_len, uint16_t offset = 0);
+    bool GetBytes(ObjectDictionary::Address addr, uint8_t *buf, uint16_t buf_len, uint16_t offset = 0);
+    uint8_t *GetObject(ObjectDictionary::Address addr) { return objects_[addr]; }
+
+   private:
+    uint8_t objects_[ObjectDictionary::kNumAddrs][SPILinkShim::kObjectMaxLenBytes] = {};
+};
+
+// Each end of the link wraps its SPICoprocessor in a few functions, since the two builds of the class can't be seen
+// from the same place.
+
+namespace spi_link_shim_rp2040 {
+extern SPILinkShimObjectDictionary object_dictionary;
+bool Init();
+bool DeInit();
+bool Update(bool blocking);
+bool Write(ObjectDictionary::Address addr, const uint8_t *buf, uint16_t len_bytes, bool require_ack);
+bool WriteAsync(ObjectDictionary::Address addr, const uint8_t *buf, uint16_t len_bytes, bool require_ack,
+                SPILinkShim::SPITransactionCallback callback, void *callback_context);
+bool Read(ObjectDictionary::Address addr, uint8_t *buf, uint16_t len_bytes);
+}  // namespace spi_link_shim_rp2040
+
+namespace spi_link_shim_esp32 {
+extern SPILinkShimObjectDictionary object_dictionary;
+bool Init();
+bool DeInit();
+bool Update();
+bool Write(ObjectDictionary::Address addr, uint8_t *buf, uint16_t len_bytes, bool require_ack);
+bool Read(ObjectDictionary::Address addr, uint8_t *buf, uint16_t len_bytes);
+}  // namespace spi_link_shim_esp32
+
+#endif /* SPI_LINK_SHIM_HH_ */
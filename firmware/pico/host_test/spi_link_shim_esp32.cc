@@ -0,0 +1,54 @@
+// ESP32 end of the host SPI link: spi_coprocessor.cpp built with ON_ESP32, see spi_link_shim.hh.
+
+// Everything that spi_coprocessor.cpp includes outside of its platform blocks is included here first, so that the host
+// build of it is shared with the rest of the tests instead of ending up in the namespace below.
+#include "adsbee_server.hh"
+#include "aircraft_dictionary.hh"
+#include "buffer_utils.hh"
+#include "comms.hh"
+#include "data_structures.hh"
+#include "driver/gpio.h"
+#include "driver/spi_slave.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "hal.hh"
+#include "macros.hh"
+#include "object_dictionary.hh"
+#include "perf_monitor.hh"
+#include "settings.hh"
+#include "spi_link_shim.hh"
+#include "transponder_packet.hh"
+
+// Count warnings and errors instead of printing them, see SPILinkShim::SPILinkStats.
+#undef CONSOLE_WARNING
+#define CONSOLE_WARNING(tag, format, ...) SPILinkShim::RecordConsoleMessage(SPILinkShim::kESP32, false)
+#undef CONSOLE_ERROR
+#define CONSOLE_ERROR(tag, format, ...) SPILinkShim::RecordConsoleMessage(SPILinkShim::kESP32, true)
+
+namespace spi_link_shim_esp32 {
+
+// Found before the global object dictionary by spi_coprocessor.cpp.
+SPILinkShimObjectDictionary object_dictionary;
+
+#define ON_ESP32 1
+#include "spi_coprocessor.cpp"
+#undef ON_ESP32
+
+SPICoprocessor pico = SPICoprocessor({});
+
+bool Init() { return pico.Init(); }
+
+bool DeInit() { return pico.DeInit(); }
+
+bool Update() { return pico.Update(); }
+
+bool Write(ObjectDictionary::Address addr, uint8_t *buf, uint16_t len_bytes, bool require_ack) {
+    return pico.Write(addr, *buf, require_ack, len_bytes);
+}
+
+bool Read(ObjectDictionary::Address addr, uint8_t *buf, uint16_t len_bytes) { return pico.Read(addr, *buf, len_bytes); }
+
+}  // namespace spi_link_shim_esp32
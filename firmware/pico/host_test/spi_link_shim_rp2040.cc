@@ -0,0 +1,57 @@
+// RP2040 end of the host SPI link: spi_coprocessor.cpp built with ON_PICO, see spi_link_shim.hh.
+
+// Everything that spi_coprocessor.cpp includes outside of its platform blocks is included here first, so that the host
+// build of it is shared with the rest of the tests instead of ending up in the namespace below.
+#include "aircraft_dictionary.hh"
+#include "buffer_utils.hh"
+#include "comms.hh"
+#include "data_structures.hh"
+#include "hal.hh"
+#include "hardware/dma.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/spi.h"
+#include "macros.hh"
+#include "object_dictionary.hh"
+#include "perf_monitor.hh"
+#include "settings.hh"
+#include "spi_link_shim.hh"
+#include "transponder_packet.hh"
+
+// Count warnings and errors instead of printing them, see SPILinkShim::SPILinkStats.
+#undef CONSOLE_WARNING
+#define CONSOLE_WARNING(tag, format, ...) SPILinkShim::RecordConsoleMessage(SPILinkShim::kRP2040, false)
+#undef CONSOLE_ERROR
+#define CONSOLE_ERROR(tag, format, ...) SPILinkShim::RecordConsoleMessage(SPILinkShim::kRP2040, true)
+
+namespace spi_link_shim_rp2040 {
+
+// Found before the global object dictionary by spi_coprocessor.cpp.
+SPILinkShimObjectDictionary object_dictionary;
+
+#define ON_PICO 1
+#include "spi_coprocessor.cpp"
+#undef ON_PICO
+
+SPICoprocessor esp32 = SPICoprocessor({});
+
+bool Init() { return esp32.Init(); }
+
+bool DeInit() { return esp32.DeInit(); }
+
+bool Update(bool blocking) { return esp32.Update(blocking); }
+
+bool Write(ObjectDictionary::Address addr, const uint8_t *buf, uint16_t len_bytes, bool require_ack) {
+    return esp32.Write(addr, *buf, require_ack, len_bytes);
+}
+
+bool WriteAsync(ObjectDictionary::Address addr, const uint8_t *buf, uint16_t len_bytes, bool require_ack,
+                SPILinkShim::SPITransactionCallback callback, void *callback_context) {
+    return esp32.WriteAsync(addr, *buf, require_ack, len_bytes, callback, callback_context);
+}
+
+bool Read(ObjectDictionary::Address addr, uint8_t *buf, uint16_t len_bytes) {
+    return esp32.Read(addr, *buf, len_bytes);
+}
+
+}  // namespace spi_link_shim_rp2040
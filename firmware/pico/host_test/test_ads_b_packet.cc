@@ -1,3 +1,6 @@
+#include <cstring>
+
+#include "crc.hh"
 #include "gtest/gtest.h"
 #include "transponder_packet.hh"
 
@@ -164,9 +167,14 @@ TEST(DecodedTransponderPacket, CRC24Checksum) {
     EXPECT_FALSE(packet.IsValid());
     packet_buffer[0] = 0x8D76CE88u;  // reset first word
 
-    packet_buffer[3] = 0x504E0000u;  // error near end
+    packet_buffer[3] = 0x504E0000u;  // 2-bit error near end, fixed by error correction
+    packet = DecodedTransponderPacket(packet_buffer, packet_buffer_used_len);
+    EXPECT_TRUE(packet.IsValid());
+    EXPECT_EQ(packet.GetNumCorrectedBits(), 2);
+    packet_buffer[3] = 0x504A0000u;  // 3-bit error near end, too many to correct
     packet = DecodedTransponderPacket(packet_buffer, packet_buffer_used_len);
     EXPECT_FALSE(packet.IsValid());
+    EXPECT_EQ(packet.GetNumCorrectedBits(), 0);
     packet_buffer[3] = 0x504D0000u;  // reset last word
 
     // Extra bit ingestion (last word eats preamble from subsequent packet).
@@ -237,4 +245,90 @@ TEST(DecodedTransponderPacket, DumpPacketBufferBytes) {
         EXPECT_EQ((packet_buffer_words[i] >> 8) & 0xFF, check_buffer_bytes[i * kBytesPerWord + 2]);
         EXPECT_EQ(packet_buffer_words[i] & 0xFF, check_buffer_bytes[i * kBytesPerWord + 3]);
     }
-}
\ No newline at end of file
+}
+TEST(DecodedTransponderPacket, CorrectBitErrors) {
+    const uint32_t kCleanBuffer[DecodedTransponderPacket::kMaxPacketLenWords32] = {0x8D76CE88u, 0x204C9072u,
+                                                                                   0xCB48209Au, 0x504D0000u};
+    uint32_t packet_buffer[DecodedTransponderPacket::kMaxPacketLenWords32];
+    uint32_t check_buffer[DecodedTransponderPacket::kMaxPacketLenWords32];
+
+    // Clean packet doesn't get touched.
+    memcpy(packet_buffer, kCleanBuffer, sizeof(packet_buffer));
+    DecodedTransponderPacket packet = DecodedTransponderPacket(packet_buffer, 4);
+    EXPECT_TRUE(packet.IsValid());
+    EXPECT_EQ(packet.GetNumCorrectedBits(), 0);
+
+    // Every single bit error outside of the DF field is corrected.
+    for (uint16_t bit = DecodedTransponderPacket::kDFNUmBits; bit < 112; bit++) {
+        memcpy(packet_buffer, kCleanBuffer, sizeof(packet_buffer));
+        packet_buffer[bit / 32] ^= 0b1 << (31 - bit % 32);
+        packet = DecodedTransponderPacket(packet_buffer, 4);
+        ASSERT_TRUE(packet.IsValid());
+        ASSERT_EQ(packet.GetNumCorrectedBits(), 1);
+        ASSERT_EQ(packet.GetICAOAddress(), 0x76CE88u);
+        packet.DumpPacketBuffer(check_buffer);
+        ASSERT_EQ(memcmp(check_buffer, kCleanBuffer, sizeof(check_buffer)), 0);
+    }
+
+    // Two bit error spanning the ICAO address and ME field.
+    memcpy(packet_buffer, kCleanBuffer, sizeof(packet_buffer));
+    packet_buffer[0] ^= 0x00000100u;
+    packet_buffer[2] ^= 0x00010000u;
+    packet = DecodedTransponderPacket(packet_buffer, 4);
+    EXPECT_TRUE(packet.IsValid());
+    EXPECT_EQ(packet.GetNumCorrectedBits(), 2);
+    EXPECT_EQ(packet.GetICAOAddress(), 0x76CE88u);
+    packet.DumpPacketBuffer(check_buffer);
+    EXPECT_EQ(memcmp(check_buffer, kCleanBuffer, sizeof(check_buffer)), 0);
+
+    // Bit errors in the DF field are never corrected.
+    memcpy(packet_buffer, kCleanBuffer, sizeof(packet_buffer));
+    packet_buffer[0] ^= 0x08000000u;  // DF 17 -> DF 16.
+    packet = DecodedTransponderPacket(packet_buffer, 4);
+    EXPECT_FALSE(packet.IsValid());
+    EXPECT_EQ(packet.GetNumCorrectedBits(), 0);
+}
+
+TEST(DecodedTransponderPacket, MaxNumCorrectedBitsByDownlinkFormat) {
+    const uint16_t kDF17MaxNumCorrectedBits = DecodedTransponderPacket::kDF17MaxNumCorrectedBits;
+    const uint16_t kDF18MaxNumCorrectedBits = DecodedTransponderPacket::kDF18MaxNumCorrectedBits;
+    typedef DecodedTransponderPacket DTP;
+    EXPECT_EQ(DTP::GetMaxNumCorrectedBits(DTP::kDownlinkFormatExtendedSquitter), kDF17MaxNumCorrectedBits);
+    EXPECT_EQ(DTP::GetMaxNumCorrectedBits(DTP::kDownlinkFormatExtendedSquitterNonTransponder), kDF18MaxNumCorrectedBits);
+    EXPECT_EQ(DTP::GetMaxNumCorrectedBits(DTP::kDownlinkFormatCommBAltitudeReply), 0);
+    EXPECT_EQ(DTP::GetMaxNumCorrectedBits(DTP::kDownlinkFormatAltitudeReply), 0);
+
+    // DF18 packet with a 2-bit error is left uncorrected if the DF18 limit is 1 bit.
+    if (kDF18MaxNumCorrectedBits < 2) {
+        uint32_t packet_buffer[DecodedTransponderPacket::kMaxPacketLenWords32] = {0x9076CE88u, 0x204C9072u,
+                                                                                  0xCB482000u, 0x00000000u};
+        uint32_t parity = CalculateModeSCRC24(packet_buffer, 88);
+        packet_buffer[2] |= parity >> 16;
+        packet_buffer[3] |= (parity & 0xFFFF) << 16;
+        DecodedTransponderPacket packet = DecodedTransponderPacket(packet_buffer, 4);
+        ASSERT_TRUE(packet.IsValid());
+        packet_buffer[1] ^= 0x00000003u;
+        packet = DecodedTransponderPacket(packet_buffer, 4);
+        EXPECT_FALSE(packet.IsValid());
+    }
+}
+
+TEST(DecodedTransponderPacket, PrintDebugString) {
+    char debug_string[DecodedTransponderPacket::kDebugStrLen];
+
+    DecodedTransponderPacket packet = DecodedTransponderPacket((char *)"8D76CE88204C9072CB48209A504D");
+    EXPECT_GT(packet.PrintDebugString(debug_string), 0);
+    EXPECT_STREQ(debug_string, "Valid packet, 0 bits corrected.\r\n");
+
+    // 3-bit error that can't be corrected.
+    packet = DecodedTransponderPacket((char *)"8D76CE88204C9072CB48209A504A");
+    EXPECT_FALSE(packet.IsValid());
+    uint16_t num_chars = packet.PrintDebugString(debug_string);
+    EXPECT_EQ(num_chars, strlen(debug_string));
+    EXPECT_STREQ(debug_string, "Invalid checksum, expected 9a504a but calculated 9a504d.\r\n");
+
+    packet = DecodedTransponderPacket((char *)"8D76CE88204C9072CB48");
+    EXPECT_FALSE(packet.IsValid());
+    packet.PrintDebugString(debug_string);
+    EXPECT_STREQ(debug_string, "Bit number mismatch while decoding packet. Expected 112 or 56 but got 80!\r\n");
+}
@@ -79,6 +79,70 @@ TEST(AircraftDictionary, UseAircraftPtr) {
     ASSERT_EQ(aircraft_out.category, Aircraft::kCategoryHeavy);
 }
 
+TEST(AircraftDictionary, PruneStaleAircraft) {
+    AircraftDictionary::AircraftDictionaryConfig_t config;
+    config.aircraft_prune_interval_ms = 1000;
+    AircraftDictionary dictionary = AircraftDictionary(config);
+
+    // Aircraft inserted out of order get pruned oldest first.
+    Aircraft aircraft;
+    const uint32_t kTimestampsMs[] = {5000, 3000, 4000, 6000, 2000};
+    for (uint16_t i = 0; i < 5; i++) {
+        aircraft.icao_address = i;
+        aircraft.last_message_timestamp_ms = kTimestampsMs[i];
+        EXPECT_TRUE(dictionary.InsertAircraft(aircraft));
+    }
+    dictionary.Update(4500);  // Prunes anything older than 3500ms.
+    EXPECT_EQ(dictionary.GetNumAircraft(), 3);
+    EXPECT_FALSE(dictionary.ContainsAircraft(1));
+    EXPECT_FALSE(dictionary.ContainsAircraft(4));
+
+    // Refreshing an aircraft keeps it around.
+    dictionary.RefreshAircraft(*dictionary.GetAircraftPtr(2), 5500);
+    dictionary.Update(6200);  // Prunes anything older than 5200ms.
+    EXPECT_EQ(dictionary.GetNumAircraft(), 2);
+    EXPECT_TRUE(dictionary.ContainsAircraft(2));
+    EXPECT_TRUE(dictionary.ContainsAircraft(3));
+
+    // Aircraft that were created without a message timestamp are the first to go.
+    EXPECT_TRUE(dictionary.GetAircraftPtr(0xBEEB));
+    dictionary.Update(6300);
+    EXPECT_EQ(dictionary.GetNumAircraft(), 2);
+    EXPECT_FALSE(dictionary.ContainsAircraft(0xBEEB));
+
+    dictionary.Update(10000);
+    EXPECT_EQ(dictionary.GetNumAircraft(), 0);
+}
+
+TEST(AircraftDictionary, MetadataFollowsAircraft) {
+    AircraftDictionary dictionary = AircraftDictionary();
+    AircraftMetadata metadata;
+    for (uint16_t i = 0; i < 10; i++) {
+        metadata.length_m = i;
+        EXPECT_TRUE(dictionary.InsertAircraft(Aircraft(i * 599), metadata));
+    }
+
+    // Removing aircraft moves other aircraft around in the dictionary. Their metadata needs to move with them.
+    EXPECT_TRUE(dictionary.RemoveAircraft(0));
+    EXPECT_TRUE(dictionary.RemoveAircraft(4 * 599));
+    AircraftMetadata metadata_out;
+    EXPECT_FALSE(dictionary.GetAircraftMetadata(0, metadata_out));
+    for (uint16_t i = 1; i < 10; i++) {
+        if (i == 4) continue;
+        ASSERT_TRUE(dictionary.GetAircraftMetadata(i * 599, metadata_out));
+        EXPECT_EQ(metadata_out.length_m, i);
+    }
+    for (const Aircraft &aircraft : dictionary.dict) {
+        EXPECT_EQ(dictionary.GetAircraftMetadata(aircraft).length_m, aircraft.icao_address / 599);
+    }
+
+    // Aircraft that get created by ingesting a packet start with fresh metadata, even if they reuse a slot.
+    Aircraft *aircraft = dictionary.GetAircraftPtr(0xBEEB);
+    ASSERT_TRUE(aircraft);
+    EXPECT_EQ(dictionary.GetAircraftMetadata(*aircraft).length_m, 0);
+    EXPECT_EQ(dictionary.GetAircraftMetadata(*aircraft).adsb_version, -1);
+}
+
 TEST(AircraftDictionary, AccessFakeAircraft) {
     AircraftDictionary dictionary = AircraftDictionary();
     EXPECT_EQ(dictionary.GetNumAircraft(), 0);
@@ -143,6 +207,20 @@ TEST(AircraftDictionary, IngestInvalidAircrfaftIDMessage) {
     EXPECT_EQ(dictionary.GetNumAircraft(), 0);
 }
 
+TEST(AircraftDictionary, IngestCorrectedAircraftIDMessage) {
+    AircraftDictionary dictionary = AircraftDictionary();
+    // 8D76CE88204C9072CB48209A504D with a single bit error in the ICAO address.
+    DecodedTransponderPacket tpacket = DecodedTransponderPacket((char *)"8D76CE89204C9072CB48209A504D", 1);
+    EXPECT_TRUE(tpacket.IsValid());
+    EXPECT_EQ(tpacket.GetNumCorrectedBits(), 1);
+    EXPECT_TRUE(dictionary.IngestDecodedTransponderPacket(tpacket));
+    EXPECT_TRUE(dictionary.ContainsAircraft(0x76CE88));
+    dictionary.Update(get_time_since_boot_ms());
+    EXPECT_EQ(dictionary.metrics.valid_extended_squitter_frames, 1u);
+    EXPECT_EQ(dictionary.metrics.corrected_extended_squitter_frames, 1u);
+    EXPECT_EQ(dictionary.metrics.corrected_extended_squitter_frames_by_source[1], 1u);
+}
+
 TEST(decode_utils, CalcNLCPRFromLat) {
     EXPECT_EQ(CalcNLCPRFromLat(0), 59);
     EXPECT_EQ(CalcNLCPRFromLat(87), 2);
@@ -153,68 +231,74 @@ TEST(decode_utils, CalcNLCPRFromLat) {
 
 TEST(Aircraft, SetCPRLatLon) {
     Aircraft aircraft;
+    AircraftMetadata metadata;
     EXPECT_FALSE(aircraft.HasBitFlag(Aircraft::BitFlag::kBitFlagPositionValid));
 
     // Send n_lat_cpr out of bounds (bigger than 2^17 bits max value).
-    EXPECT_FALSE(aircraft.SetCPRLatLon(0xFFFFFF, 53663, true));
-    EXPECT_FALSE(aircraft.SetCPRLatLon(0xFFFFFF, 53663, false));
+    EXPECT_FALSE(metadata.SetCPRLatLon(0xFFFFFF, 53663, true));
+    EXPECT_FALSE(metadata.SetCPRLatLon(0xFFFFFF, 53663, false));
     // Send n_lon_cpr out of bounds (bigger than 2^17 bits max value).
-    EXPECT_FALSE(aircraft.SetCPRLatLon(52455, 0xFFFFFF, false));
-    EXPECT_FALSE(aircraft.SetCPRLatLon(52455, 0xFFFFFF, true));
+    EXPECT_FALSE(metadata.SetCPRLatLon(52455, 0xFFFFFF, false));
+    EXPECT_FALSE(metadata.SetCPRLatLon(52455, 0xFFFFFF, true));
 
     // Send two even packets at startup, no odd packets.
     aircraft = Aircraft();  // clear everything
+    metadata = AircraftMetadata();
     EXPECT_FALSE(aircraft.HasBitFlag(Aircraft::BitFlag::kBitFlagUpdatedPosition));
     inc_time_since_boot_ms();
-    EXPECT_TRUE(aircraft.SetCPRLatLon(578, 13425, false));
+    EXPECT_TRUE(metadata.SetCPRLatLon(578, 13425, false));
     inc_time_since_boot_ms();
-    EXPECT_TRUE(aircraft.SetCPRLatLon(578, 4651, false));
-    EXPECT_FALSE(aircraft.DecodePosition());
+    EXPECT_TRUE(metadata.SetCPRLatLon(578, 4651, false));
+    EXPECT_FALSE(metadata.DecodePosition(aircraft));
     EXPECT_FALSE(aircraft.HasBitFlag(Aircraft::BitFlag::kBitFlagPositionValid));
 
     // Send two odd packets at startup, no even packets.
     aircraft = Aircraft();  // clear everything
+    metadata = AircraftMetadata();
     inc_time_since_boot_ms();
-    EXPECT_TRUE(aircraft.SetCPRLatLon(236, 13425, true));
+    EXPECT_TRUE(metadata.SetCPRLatLon(236, 13425, true));
     inc_time_since_boot_ms();
-    EXPECT_TRUE(aircraft.SetCPRLatLon(236, 857, true));
-    EXPECT_FALSE(aircraft.DecodePosition());
+    EXPECT_TRUE(metadata.SetCPRLatLon(236, 857, true));
+    EXPECT_FALSE(metadata.DecodePosition(aircraft));
     EXPECT_FALSE(aircraft.HasBitFlag(Aircraft::BitFlag::kBitFlagPositionValid));
 
     // Send one odd packet and one even packet at startup.
     aircraft = Aircraft();  // clear everything
+    metadata = AircraftMetadata();
     inc_time_since_boot_ms();
-    EXPECT_TRUE(aircraft.SetCPRLatLon(74158, 50194, true));
+    EXPECT_TRUE(metadata.SetCPRLatLon(74158, 50194, true));
     inc_time_since_boot_ms();
-    EXPECT_TRUE(aircraft.SetCPRLatLon(93000, 51372, false));
-    EXPECT_TRUE(aircraft.DecodePosition());
+    EXPECT_TRUE(metadata.SetCPRLatLon(93000, 51372, false));
+    EXPECT_TRUE(metadata.DecodePosition(aircraft));
     EXPECT_TRUE(aircraft.HasBitFlag(Aircraft::BitFlag::kBitFlagPositionValid));
     EXPECT_NEAR(aircraft.latitude_deg, 52.25720f, 1e-4);  // even latitude
     EXPECT_NEAR(aircraft.longitude_deg, 3.91937f, 1e-4);  // longitude calculated from even latitude
 
     // Send one even packet and one odd packet at startup.
     aircraft = Aircraft();  // clear everything
+    metadata = AircraftMetadata();
     inc_time_since_boot_ms();
-    EXPECT_TRUE(aircraft.SetCPRLatLon(93000, 51372, false));
+    EXPECT_TRUE(metadata.SetCPRLatLon(93000, 51372, false));
     inc_time_since_boot_ms();
-    EXPECT_TRUE(aircraft.SetCPRLatLon(74158, 50194, true));
-    EXPECT_TRUE(aircraft.DecodePosition());
+    EXPECT_TRUE(metadata.SetCPRLatLon(74158, 50194, true));
+    EXPECT_TRUE(metadata.DecodePosition(aircraft));
     EXPECT_TRUE(aircraft.HasBitFlag(Aircraft::BitFlag::kBitFlagPositionValid));
     EXPECT_NEAR(aircraft.latitude_deg, 52.26578f, 1e-4);  // odd latitude
     // don't have a test value available for the longitude calculated from odd latitude
 
     // Straddle two position packets between different latitude
     aircraft = Aircraft();  // clear everything
-    EXPECT_TRUE(aircraft.SetCPRLatLon(93006, 50194, true));
+    metadata = AircraftMetadata();
+    EXPECT_TRUE(metadata.SetCPRLatLon(93006, 50194, true));
     inc_time_since_boot_ms();
-    EXPECT_TRUE(aircraft.SetCPRLatLon(93000, 51372, false));
+    EXPECT_TRUE(metadata.SetCPRLatLon(93000, 51372, false));
     inc_time_since_boot_ms();
-    EXPECT_TRUE(aircraft.DecodePosition());
+    EXPECT_TRUE(metadata.DecodePosition(aircraft));
     inc_time_since_boot_ms();
     // Position established, now send the curveball.
-    EXPECT_TRUE(aircraft.SetCPRLatLon(93000 - 5000, 50194, true));
+    EXPECT_TRUE(metadata.SetCPRLatLon(93000 - 5000, 50194, true));
     inc_time_since_boot_ms();
-    EXPECT_FALSE(aircraft.DecodePosition());
+    EXPECT_FALSE(metadata.DecodePosition(aircraft));
 
     // EXPECT_NEAR(aircraft.latitude, 52.25720f, 1e-4);
     // EXPECT_NEAR(aircraft.longitude, 3.91937f, 1e-4);
@@ -222,9 +306,9 @@ TEST(Aircraft, SetCPRLatLon) {
     // Another test message.
     // aircraft = Aircraft(); // clear everything
     // inc_time_since_boot_ms();
-    // EXPECT_TRUE(aircraft.SetCPRLatLon(74158, 50194, true));
+    // EXPECT_TRUE(metadata.SetCPRLatLon(74158, 50194, true));
     // inc_time_since_boot_ms();
-    // EXPECT_TRUE(aircraft.SetCPRLatLon(93000, 51372, false));
+    // EXPECT_TRUE(metadata.SetCPRLatLon(93000, 51372, false));
     // EXPECT_TRUE(aircraft.position_valid);
     // EXPECT_FLOAT_EQ(aircraft.latitude, 52.25720f);
     // EXPECT_FLOAT_EQ(aircraft.longitude, 3.91937f);
@@ -250,7 +334,7 @@ TEST(AircraftDictionary, ApplyAirbornePositionMessage) {
     ASSERT_TRUE(dictionary.IngestDecodedTransponderPacket(even_tpacket));
     ASSERT_EQ(dictionary.GetNumAircraft(), 1);
     auto itr = dictionary.dict.begin();
-    auto &aircraft = itr->second;
+    auto &aircraft = *itr;
 
     // Aircraft should exist but not have its location filled out.
     EXPECT_TRUE(aircraft.HasBitFlag(Aircraft::BitFlag::kBitFlagIsAirborne));
@@ -278,6 +362,163 @@ TEST(AircraftDictionary, ApplyAirbornePositionMessage) {
     EXPECT_EQ(aircraft.baro_altitude_ft, 17000);
 }
 
+TEST(AircraftDictionary, LocalDecodeFirstPositionFromReceiverPosition) {
+    AircraftDictionary dictionary = AircraftDictionary();
+    DecodedTransponderPacket even_tpacket = DecodedTransponderPacket((char *)"8da6147f5859f18cdf4d244ac6fa");
+    DecodedTransponderPacket odd_tpacket = DecodedTransponderPacket((char *)"8da6147f585b05533e2ba73e43cb");
+    float latitude_deg, longitude_deg;
+    EXPECT_FALSE(dictionary.GetReferencePosition(latitude_deg, longitude_deg));
+    dictionary.SetReferencePosition(20.0f, -156.0f);  // Receiver on Maui.
+    EXPECT_TRUE(dictionary.GetReferencePosition(latitude_deg, longitude_deg));
+    EXPECT_FLOAT_EQ(latitude_deg, 20.0f);
+    EXPECT_FLOAT_EQ(longitude_deg, -156.0f);
+
+    set_time_since_boot_ms(1e3);
+
+    // A single even packet is enough for a position fix.
+    ASSERT_TRUE(dictionary.IngestDecodedTransponderPacket(even_tpacket));
+    Aircraft *aircraft = dictionary.GetAircraftPtr(0xA6147F);
+    ASSERT_TRUE(aircraft);
+    EXPECT_TRUE(aircraft->HasBitFlag(Aircraft::BitFlag::kBitFlagPositionValid));
+    EXPECT_TRUE(aircraft->HasBitFlag(Aircraft::BitFlag::kBitFlagUpdatedPosition));
+    EXPECT_NEAR(aircraft->latitude_deg, 20.32541f, kLatDegCloseEnough);
+    EXPECT_NEAR(aircraft->longitude_deg, -156.53141f, kLonDegCloseEnough);
+
+    // Once the pair is complete, the position comes from a global decode.
+    inc_time_since_boot_ms(1e3);
+    ASSERT_TRUE(dictionary.IngestDecodedTransponderPacket(odd_tpacket));
+    EXPECT_NEAR(aircraft->latitude_deg, 20.326522568524894f, kLatDegCloseEnough);
+    EXPECT_NEAR(aircraft->longitude_deg, -156.5328535600142f, kLonDegCloseEnough);
+
+    // Forgetting the receiver position means a new aircraft needs a full pair again.
+    dictionary.ClearReferencePosition();
+    EXPECT_FALSE(dictionary.GetReferencePosition(latitude_deg, longitude_deg));
+    dictionary.Init();
+    ASSERT_TRUE(dictionary.IngestDecodedTransponderPacket(even_tpacket));
+    aircraft = dictionary.GetAircraftPtr(0xA6147F);
+    ASSERT_TRUE(aircraft);
+    EXPECT_FALSE(aircraft->HasBitFlag(Aircraft::BitFlag::kBitFlagPositionValid));
+}
+
+TEST(AircraftDictionary, ReceiverRelativePositionIsCheckedAndUnconfirmed) {
+    AircraftDictionary dictionary = AircraftDictionary();
+    DecodedTransponderPacket even_tpacket = DecodedTransponderPacket((char *)"8da6147f5859f18cdf4d244ac6fa");
+    DecodedTransponderPacket odd_tpacket = DecodedTransponderPacket((char *)"8da6147f585b05533e2ba73e43cb");
+
+    // Aircraft is ~200NM from the receiver, which is too far to trust a decode relative to the receiver.
+    dictionary.SetReferencePosition(18.0f, -154.0f);
+    set_time_since_boot_ms(1e3);
+    ASSERT_TRUE(dictionary.IngestDecodedTransponderPacket(even_tpacket));
+    Aircraft *aircraft = dictionary.GetAircraftPtr(0xA6147F);
+    ASSERT_TRUE(aircraft);
+    EXPECT_FALSE(aircraft->HasBitFlag(Aircraft::BitFlag::kBitFlagPositionValid));
+
+    // Receiver on Maui is close enough.
+    dictionary.Init();
+    dictionary.SetReferencePosition(20.0f, -156.0f);
+    ASSERT_TRUE(dictionary.IngestDecodedTransponderPacket(even_tpacket));
+    aircraft = dictionary.GetAircraftPtr(0xA6147F);
+    ASSERT_TRUE(aircraft);
+    EXPECT_TRUE(aircraft->HasBitFlag(Aircraft::BitFlag::kBitFlagPositionValid));
+
+    // The fix relative to the receiver isn't used as the reference for the aircraft's next position.
+    dictionary.ClearReferencePosition();
+    inc_time_since_boot_ms(1e3);
+    aircraft->ResetUpdatedBitFlags();
+    ASSERT_TRUE(dictionary.IngestDecodedTransponderPacket(even_tpacket));
+    EXPECT_FALSE(aircraft->HasBitFlag(Aircraft::BitFlag::kBitFlagUpdatedPosition));
+
+    // Until a global decode confirms it.
+    inc_time_since_boot_ms(500);
+    ASSERT_TRUE(dictionary.IngestDecodedTransponderPacket(odd_tpacket));
+    EXPECT_TRUE(aircraft->HasBitFlag(Aircraft::BitFlag::kBitFlagUpdatedPosition));
+    inc_time_since_boot_ms(AircraftMetadata::kCPRMaxPairAgeMs - 100);
+    aircraft->ResetUpdatedBitFlags();
+    ASSERT_TRUE(dictionary.IngestDecodedTransponderPacket(odd_tpacket));
+    EXPECT_TRUE(aircraft->HasBitFlag(Aircraft::BitFlag::kBitFlagUpdatedPosition));
+    EXPECT_NEAR(aircraft->latitude_deg, 20.326522568524894f, kLatDegCloseEnough);
+    EXPECT_NEAR(aircraft->longitude_deg, -156.5328535600142f, kLonDegCloseEnough);
+}
+
+TEST(AircraftDictionary, LocalDecodeFromLastKnownPosition) {
+    AircraftDictionary dictionary = AircraftDictionary();
+    DecodedTransponderPacket even_tpacket = DecodedTransponderPacket((char *)"8da6147f5859f18cdf4d244ac6fa");
+    DecodedTransponderPacket odd_tpacket = DecodedTransponderPacket((char *)"8da6147f585b05533e2ba73e43cb");
+
+    // Get a global position fix without a receiver position.
+    set_time_since_boot_ms(1e3);
+    ASSERT_TRUE(dictionary.IngestDecodedTransponderPacket(even_tpacket));
+    inc_time_since_boot_ms(500);
+    ASSERT_TRUE(dictionary.IngestDecodedTransponderPacket(odd_tpacket));
+    Aircraft *aircraft = dictionary.GetAircraftPtr(0xA6147F);
+    ASSERT_TRUE(aircraft);
+    EXPECT_TRUE(aircraft->HasBitFlag(Aircraft::BitFlag::kBitFlagPositionValid));
+
+    // New even packet is too far from the odd packet to pair with it, but the last position is still recent enough to
+    // be used as a reference.
+    inc_time_since_boot_ms(AircraftMetadata::kCPRMaxReferenceAgeMs - 100);
+    aircraft->ResetUpdatedBitFlags();
+    ASSERT_TRUE(dictionary.IngestDecodedTransponderPacket(even_tpacket));
+    EXPECT_TRUE(aircraft->HasBitFlag(Aircraft::BitFlag::kBitFlagUpdatedPosition));
+    EXPECT_NEAR(aircraft->latitude_deg, 20.32541f, kLatDegCloseEnough);
+    EXPECT_NEAR(aircraft->longitude_deg, -156.53141f, kLonDegCloseEnough);
+
+    // Once the last position is stale, it's no longer used as a reference.
+    inc_time_since_boot_ms(AircraftMetadata::kCPRMaxReferenceAgeMs);
+    aircraft->ResetUpdatedBitFlags();
+    ASSERT_TRUE(dictionary.IngestDecodedTransponderPacket(odd_tpacket));
+    EXPECT_FALSE(aircraft->HasBitFlag(Aircraft::BitFlag::kBitFlagUpdatedPosition));
+}
+
+TEST(AircraftDictionary, StaleCPRPairNotGloballyDecoded) {
+    AircraftDictionary dictionary = AircraftDictionary();
+    DecodedTransponderPacket even_tpacket = DecodedTransponderPacket((char *)"8da6147f5859f18cdf4d244ac6fa");
+    DecodedTransponderPacket odd_tpacket = DecodedTransponderPacket((char *)"8da6147f585b05533e2ba73e43cb");
+
+    set_time_since_boot_ms(1e3);
+    ASSERT_TRUE(dictionary.IngestDecodedTransponderPacket(even_tpacket));
+    inc_time_since_boot_ms(AircraftMetadata::kCPRMaxPairAgeMs + 1);
+    ASSERT_TRUE(dictionary.IngestDecodedTransponderPacket(odd_tpacket));
+    Aircraft *aircraft = dictionary.GetAircraftPtr(0xA6147F);
+    ASSERT_TRUE(aircraft);
+    EXPECT_FALSE(aircraft->HasBitFlag(Aircraft::BitFlag::kBitFlagPositionValid));
+    EXPECT_FALSE(aircraft->HasBitFlag(Aircraft::BitFlag::kBitFlagUpdatedPosition));
+
+    // A fresh packet completes the pair again.
+    inc_time_since_boot_ms(1e3);
+    ASSERT_TRUE(dictionary.IngestDecodedTransponderPacket(even_tpacket));
+    EXPECT_TRUE(aircraft->HasBitFlag(Aircraft::BitFlag::kBitFlagPositionValid));
+    EXPECT_NEAR(aircraft->latitude_deg, 20.32541f, kLatDegCloseEnough);
+}
+
+TEST(AircraftDictionary, ApplySurfacePositionMessage) {
+    AircraftDictionary dictionary = AircraftDictionary();
+    // TC=7 surface position message: 20kts, track 42.1875 degrees, even CPR format.
+    DecodedTransponderPacket tpacket = DecodedTransponderPacket((char *)"8DC8200A3AC8F009BCDEF274C77E");
+    ASSERT_TRUE(tpacket.IsValid());
+
+    // Without a reference position, speed and track are decoded but position isn't.
+    set_time_since_boot_ms(1e3);
+    ASSERT_TRUE(dictionary.IngestDecodedTransponderPacket(tpacket));
+    Aircraft *aircraft = dictionary.GetAircraftPtr(0xC8200A);
+    ASSERT_TRUE(aircraft);
+    EXPECT_FALSE(aircraft->HasBitFlag(Aircraft::BitFlag::kBitFlagIsAirborne));
+    EXPECT_EQ(aircraft->velocity_source, Aircraft::VelocitySource::kVelocitySourceGroundSpeed);
+    EXPECT_NEAR(aircraft->velocity_kts, 20.0f, kFloatCloseEnough);
+    EXPECT_TRUE(aircraft->HasBitFlag(Aircraft::BitFlag::kBitFlagUpdatedTrack));
+    EXPECT_NEAR(aircraft->direction_deg, 42.1875f, kFloatCloseEnough);
+    EXPECT_FALSE(aircraft->HasBitFlag(Aircraft::BitFlag::kBitFlagPositionValid));
+
+    // Surface positions need a reference to decode, even from a single packet.
+    dictionary.SetReferencePosition(-43.5f, 172.5f);
+    inc_time_since_boot_ms(1e3);
+    ASSERT_TRUE(dictionary.IngestDecodedTransponderPacket(tpacket));
+    EXPECT_TRUE(aircraft->HasBitFlag(Aircraft::BitFlag::kBitFlagPositionValid));
+    EXPECT_TRUE(aircraft->HasBitFlag(Aircraft::BitFlag::kBitFlagUpdatedPosition));
+    EXPECT_NEAR(aircraft->latitude_deg, -43.48574f, kLatDegCloseEnough);
+    EXPECT_NEAR(aircraft->longitude_deg, 172.53930f, kLonDegCloseEnough);
+}
+
 // TODO: Add test case for ingesting Airborne Position message with GNSS altitude.
 
 TEST(AircraftDictionary, IngestAirborneVelocityMessage) {
@@ -291,7 +532,7 @@ TEST(AircraftDictionary, IngestAirborneVelocityMessage) {
     ASSERT_TRUE(dictionary.IngestADSBPacket(packet));
     ASSERT_EQ(dictionary.GetNumAircraft(), 1);
     auto itr = dictionary.dict.begin();
-    auto &aircraft = itr->second;  // NOTE: Aircraft is a mutable reference until we get to Message A!
+    auto &aircraft = *itr;  // NOTE: Aircraft is a mutable reference until we get to Message A!
 
     // Aircraft should now have velocities populated.
     EXPECT_TRUE(aircraft.HasBitFlag(Aircraft::BitFlag::kBitFlagUpdatedTrack));
@@ -396,6 +637,32 @@ TEST(AircraftDictionary, IngestModeC) {
     EXPECT_FALSE(aircraft.HasBitFlag(Aircraft::BitFlag::kBitFlagAlert));
 }
 
+TEST(AircraftDictionary, IngestSettledSquitter) {
+    // Validate a Mode C packet against one dictionary, like the RP2040 does.
+    AircraftDictionary rp2040_dictionary = AircraftDictionary();
+    DecodedTransponderPacket tpacket = DecodedTransponderPacket((char *)"200006A2DE8B1C");
+    EXPECT_FALSE(tpacket.IsValiditySettled());
+    rp2040_dictionary.InsertAircraft(Aircraft(0x7C1B28u));
+    EXPECT_TRUE(rp2040_dictionary.IngestDecodedTransponderPacket(tpacket));
+    EXPECT_TRUE(tpacket.IsValid());
+
+    // Another dictionary that hasn't seen the aircraft yet takes the first dictionary's word for it.
+    AircraftDictionary esp32_dictionary = AircraftDictionary();
+    DecodedTransponderPacket forwarded_tpacket =
+        DecodedTransponderPacket(tpacket.GetRaw(), tpacket.IsValid(), tpacket.GetICAOAddress());
+    EXPECT_TRUE(forwarded_tpacket.IsValiditySettled());
+    EXPECT_EQ(forwarded_tpacket.GetDownlinkFormat(), DecodedTransponderPacket::kDownlinkFormatAltitudeReply);
+    EXPECT_EQ(forwarded_tpacket.GetICAOAddress(), 0x7C1B28u);
+    EXPECT_TRUE(esp32_dictionary.IngestDecodedTransponderPacket(forwarded_tpacket));
+    Aircraft aircraft;
+    EXPECT_TRUE(esp32_dictionary.GetAircraft(0x7C1B28u, aircraft));
+    EXPECT_EQ(aircraft.baro_altitude_ft, 10000);
+
+    // Packets that the first dictionary rejected stay rejected, even if the address is known here.
+    DecodedTransponderPacket rejected_tpacket = DecodedTransponderPacket(tpacket.GetRaw(), false);
+    EXPECT_FALSE(esp32_dictionary.IngestDecodedTransponderPacket(rejected_tpacket));
+}
+
 TEST(AircraftDictionary, IngestModeA) {
     // Ingest a Mode A packet with an alert and ident.
     AircraftDictionary dictionary = AircraftDictionary();
@@ -447,41 +714,61 @@ TEST(AircraftDictionary, MetricsToJSON) {
                                            .valid_squitter_frames = 7,
                                            .raw_extended_squitter_frames = 30,
                                            .valid_extended_squitter_frames = 16,
+                                           .corrected_extended_squitter_frames = 4,
                                            .demods_1090 = 50,
-                                           .raw_squitter_frames_by_source = {2, 3, 5},
-                                           .valid_squitter_frames_by_source = {1, 2, 4},
-                                           .raw_extended_squitter_frames_by_source = {10, 11, 9},
-                                           .valid_extended_squitter_frames_by_source = {3, 5, 8},
-                                           .demods_1090_by_source = {19, 10, 21}};
+                                           .demod_overlaps_1090 = 6,
+                                           .raw_squitter_frames_by_source = {2, 3, 5, 0},
+                                           .valid_squitter_frames_by_source = {1, 2, 4, 0},
+                                           .raw_extended_squitter_frames_by_source = {10, 11, 9, 0},
+                                           .valid_extended_squitter_frames_by_source = {3, 5, 8, 0},
+                                           .corrected_extended_squitter_frames_by_source = {1, 1, 2, 0},
+                                           .demods_1090_by_source = {19, 10, 21, 0},
+                                           .demod_overlaps_1090_by_source = {0, 4, 2, 0}};
     char buf[AircraftDictionary::Metrics::kMetricsJSONMaxLen] = {'\0'};
     char * expected_result =
         (char *)"{ \"raw_squitter_frames\": 10, \
 \"valid_squitter_frames\": 7, \
 \"raw_extended_squitter_frames\": 30, \
 \"valid_extended_squitter_frames\": 16, \
+\"corrected_extended_squitter_frames\": 4, \
 \"demods_1090\": 50, \
-\"raw_squitter_frames_by_source\": [2, 3, 5], \
-\"valid_squitter_frames_by_source\": [1, 2, 4], \
-\"raw_extended_squitter_frames_by_source\": [10, 11, 9], \
-\"valid_extended_squitter_frames_by_source\": [3, 5, 8], \
-\"demods_1090_by_source\": [19, 10, 21] \
+\"demod_overlaps_1090\": 6, \
+\"raw_squitter_frames_by_source\": [2, 3, 5, 0], \
+\"valid_squitter_frames_by_source\": [1, 2, 4, 0], \
+\"raw_extended_squitter_frames_by_source\": [10, 11, 9, 0], \
+\"valid_extended_squitter_frames_by_source\": [3, 5, 8, 0], \
+\"corrected_extended_squitter_frames_by_source\": [1, 1, 2, 0], \
+\"demods_1090_by_source\": [19, 10, 21, 0], \
+\"demod_overlaps_1090_by_source\": [0, 4, 2, 0] \
 }";
     EXPECT_EQ(metrics.ToJSON(buf, AircraftDictionary::Metrics::kMetricsJSONMaxLen), strlen(expected_result));
     EXPECT_STREQ(buf, expected_result);
 }
 
 TEST(Aircraft, AircraftStats) {
-    Aircraft aircraft;
-    aircraft.IncrementNumFramesReceived();
-    EXPECT_EQ(aircraft.metrics.valid_extended_squitter_frames + aircraft.metrics.valid_squitter_frames, 0);
-    aircraft.UpdateMetrics();
-    EXPECT_EQ(aircraft.metrics.valid_extended_squitter_frames + aircraft.metrics.valid_squitter_frames, 1);
-    EXPECT_EQ(aircraft.metrics.valid_extended_squitter_frames, 0);
-    EXPECT_EQ(aircraft.metrics.valid_squitter_frames, 1);
-    aircraft.IncrementNumFramesReceived(false);
-    aircraft.IncrementNumFramesReceived(true);
-    aircraft.UpdateMetrics();
-    EXPECT_EQ(aircraft.metrics.valid_extended_squitter_frames + aircraft.metrics.valid_squitter_frames, 2);
-    EXPECT_EQ(aircraft.metrics.valid_extended_squitter_frames, 1);
-    EXPECT_EQ(aircraft.metrics.valid_squitter_frames, 1);
-}
\ No newline at end of file
+    AircraftMetadata metadata;
+    // Start at the beginning of a metrics interval.
+    inc_time_since_boot_ms(AircraftMetadata::kMetricsIntervalMs -
+                           get_time_since_boot_ms() % AircraftMetadata::kMetricsIntervalMs);
+    metadata.IncrementNumFramesReceived();
+    Aircraft::Metrics metrics = metadata.GetMetrics();
+    EXPECT_EQ(metrics.valid_extended_squitter_frames + metrics.valid_squitter_frames, 0);
+    inc_time_since_boot_ms(AircraftMetadata::kMetricsIntervalMs);
+    metrics = metadata.GetMetrics();
+    EXPECT_EQ(metrics.valid_extended_squitter_frames + metrics.valid_squitter_frames, 1);
+    EXPECT_EQ(metrics.valid_extended_squitter_frames, 0);
+    EXPECT_EQ(metrics.valid_squitter_frames, 1);
+    metadata.IncrementNumFramesReceived(false);
+    metadata.IncrementNumFramesReceived(true);
+    metrics = metadata.GetMetrics();  // Metrics from the previous interval are still visible until it ends.
+    EXPECT_EQ(metrics.valid_squitter_frames, 1);
+    inc_time_since_boot_ms(AircraftMetadata::kMetricsIntervalMs);
+    metrics = metadata.GetMetrics();
+    EXPECT_EQ(metrics.valid_extended_squitter_frames + metrics.valid_squitter_frames, 2);
+    EXPECT_EQ(metrics.valid_extended_squitter_frames, 1);
+    EXPECT_EQ(metrics.valid_squitter_frames, 1);
+    // An interval with no frames reports zeros, even though no frames arrived to trigger a roll over.
+    inc_time_since_boot_ms(AircraftMetadata::kMetricsIntervalMs);
+    metrics = metadata.GetMetrics();
+    EXPECT_EQ(metrics.valid_extended_squitter_frames + metrics.valid_squitter_frames, 0);
+}
@@ -0,0 +1,134 @@
+#include <cstdlib>
+#include <cstring>
+
+#include "buffer_utils.hh"
+#include "crc.hh"
+#include "crc_reference.hh"
+#include "gtest/gtest.h"
+#include "transponder_packet.hh"
+
+/**
+ * Original bit-serial CRC16 implementation from CalculateCRC16, kept here as a reference for checking the table-driven
+ * implementation.
+ */
+uint16_t CalculateCRC16BitSerial(const uint8_t *data_p, int32_t length) {
+    uint8_t x;
+    uint16_t crc = 0xFFFF;
+    while (length--) {
+        x = crc >> 8 ^ *data_p++;
+        x ^= x >> 4;
+        crc = (crc << 8) ^ ((uint16_t)(x << 12)) ^ ((uint16_t)(x << 5)) ^ ((uint16_t)x);
+    }
+    return (crc << 8) | (crc >> 8);
+}
+
+// Test vectors taken from test_ads_b_packet.cc.
+static const uint16_t kNumTestPackets = 4;
+static const uint32_t kTestPackets[kNumTestPackets][DecodedTransponderPacket::kMaxPacketLenWords32] = {
+    {0x8D406B90u, 0x2015A678u, 0xD4D22000u, 0x00000000u},
+    {0x8D76CE88u, 0x204C9072u, 0xCB48209Au, 0x504D0000u},
+    {0x8D4840D6u, 0x202CC371u, 0xC32CE057u, 0x60980000u},
+    {0x8D7C80ADu, 0x2358F6B1u, 0xE35C60FFu, 0x19250000u}};
+
+TEST(ModeSCRC24, TableMatchesGenerator) {
+    EXPECT_EQ(kCRC24Table[0], 0u);
+    EXPECT_EQ(kCRC24Table[1], kCRC24Generator);  // Single bit shifted into the top of the register is the generator.
+}
+
+TEST(ModeSCRC24, KnownVectors) {
+    // Test packet from https://mode-s.org/decode/book-the_1090mhz_riddle-junzi_sun.pdf pg. 91.
+    EXPECT_EQ(CalculateModeSCRC24(kTestPackets[0], 88), 0xAA4BDAu);
+    // Remaining test packets are valid, so the CRC must match the parity field.
+    for (uint16_t i = 1; i < kNumTestPackets; i++) {
+        EXPECT_EQ(CalculateModeSCRC24(kTestPackets[i], 88), GetNBitWordFromBuffer(24, 88, kTestPackets[i]));
+    }
+}
+
+TEST(ModeSCRC24, MatchesBitSerialReference) {
+    srand(0xADBEE);
+    uint32_t buffer[DecodedTransponderPacket::kMaxPacketLenWords32];
+    for (uint16_t trial = 0; trial < 1000; trial++) {
+        for (uint16_t i = 0; i < DecodedTransponderPacket::kMaxPacketLenWords32; i++) {
+            buffer[i] = (static_cast<uint32_t>(rand()) << 16) ^ static_cast<uint32_t>(rand());
+        }
+        ASSERT_EQ(CalculateModeSCRC24(buffer, 88), CalculateCRC24BitSerial(buffer, 112));
+        ASSERT_EQ(CalculateModeSCRC24(buffer, 32), CalculateCRC24BitSerial(buffer, 56));
+        // Odd lengths exercise the bit-serial tail.
+        ASSERT_EQ(CalculateModeSCRC24(buffer, 45), CalculateCRC24BitSerial(buffer, 69));
+    }
+}
+
+TEST(ModeSCRC24, SyndromesAreUnique) {
+    // All 1-bit and 2-bit error patterns in a 112-bit frame must have distinct, nonzero syndromes for correction to be
+    // unambiguous.
+    for (uint16_t i = 1; i < kCRC24SyndromeTableNumBits; i++) {
+        ASSERT_LT(kCRC24SyndromeTable[i - 1].syndrome, kCRC24SyndromeTable[i].syndrome);
+    }
+    for (uint16_t i = 0; i < kCRC24SyndromeTableNumBits; i++) {
+        for (uint16_t j = i + 1; j < kCRC24SyndromeTableNumBits; j++) {
+            uint32_t syndrome = kCRC24SingleBitSyndromes[i] ^ kCRC24SingleBitSyndromes[j];
+            ASSERT_NE(syndrome, 0u);
+            for (uint16_t k = 0; k < kCRC24SyndromeTableNumBits; k++) {
+                ASSERT_NE(syndrome, kCRC24SingleBitSyndromes[k]);
+            }
+        }
+    }
+}
+
+TEST(ModeSCRC24, SingleBitSyndromesMatchCRC) {
+    uint32_t buffer[DecodedTransponderPacket::kMaxPacketLenWords32];
+    for (uint16_t bit = 0; bit < 88; bit++) {
+        memset(buffer, 0, sizeof(buffer));
+        buffer[bit / 32] = 0b1 << (31 - bit % 32);
+        ASSERT_EQ(CalculateModeSCRC24(buffer, 88), kCRC24SingleBitSyndromes[bit]);
+    }
+}
+
+TEST(ModeSCRC24, CorrectShortFrame) {
+    // Syndrome table lines up with the end of shorter frames. Build a valid 56-bit frame and flip a bit.
+    uint32_t buffer[DecodedTransponderPacket::kMaxPacketLenWords32] = {0x5D76CE88u, 0x0, 0x0, 0x0};
+    buffer[1] = CalculateModeSCRC24(buffer, 32) << 8;
+    uint32_t clean_word_0 = buffer[0];
+    buffer[0] ^= 0x00010000u;
+    uint32_t syndrome = CalculateModeSCRC24(buffer, 32) ^ (buffer[1] >> 8);
+    EXPECT_EQ(CorrectModeSCRC24Errors(buffer, 56, syndrome, 1), 1);
+    EXPECT_EQ(buffer[0], clean_word_0);
+}
+
+TEST(CRC16, KnownVector) {
+    // CRC-16/CCITT-FALSE check value, returned with its Bytes swapped.
+    const char *kCheckString = "123456789";
+    EXPECT_EQ(UpdateCRC16(kCRC16Init, (const uint8_t *)kCheckString, strlen(kCheckString)), 0x29B1);
+    EXPECT_EQ(CalculateCRC16((const uint8_t *)kCheckString, strlen(kCheckString)), 0xB129);
+    EXPECT_EQ(CalculateCRC16(nullptr, 0), 0xFFFF);
+}
+
+TEST(CRC16, MatchesBitSerialReference) {
+    srand(0xADBEE);
+    uint8_t buffer[300];
+    for (uint16_t trial = 0; trial < 100; trial++) {
+        for (uint16_t i = 0; i < sizeof(buffer); i++) {
+            buffer[i] = rand();
+        }
+        int32_t len_bytes = rand() % sizeof(buffer);
+        ASSERT_EQ(CalculateCRC16(buffer, len_bytes), CalculateCRC16BitSerial(buffer, len_bytes));
+    }
+}
+
+TEST(CRC16, RunningCRCAndResidue) {
+    uint8_t buffer[100];
+    for (uint16_t i = 0; i < sizeof(buffer); i++) {
+        buffer[i] = i * 7;
+    }
+    // Splitting the buffer doesn't change the CRC, e.g. when the DMA sniffer is seeded with the CRC of a header.
+    uint16_t crc = UpdateCRC16(kCRC16Init, buffer, 9);
+    crc = UpdateCRC16(crc, buffer + 9, sizeof(buffer) - 2 - 9);
+    EXPECT_EQ(crc, UpdateCRC16(kCRC16Init, buffer, sizeof(buffer) - 2));
+
+    // A buffer that ends in its own CRC, stored the same way as in an SCPacket, has a CRC of 0.
+    uint16_t packet_crc = CalculateCRC16(buffer, sizeof(buffer) - 2);
+    memcpy(buffer + sizeof(buffer) - 2, &packet_crc, sizeof(uint16_t));
+    EXPECT_EQ(CalculateCRC16(buffer, sizeof(buffer)), 0);
+    buffer[50] ^= 0x10;
+    EXPECT_NE(CalculateCRC16(buffer, sizeof(buffer)), 0);
+}
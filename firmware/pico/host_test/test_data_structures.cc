@@ -1,3 +1,6 @@
+#include <thread>
+#include <unordered_map>
+
 #include "data_structures.hh"
 #include "gtest/gtest.h"
 
@@ -104,4 +107,312 @@ TEST(PFBQueue, OverwriteWhenFull) {
         EXPECT_TRUE(queue.Pop(out));
         EXPECT_EQ(out, i);
     }
-}
\ No newline at end of file
+}
+
+TEST(SPSCQueue, PushPopWrap) {
+    SPSCQueue<uint32_t, 8> queue;
+    EXPECT_EQ(queue.MaxNumElements(), 8);
+    uint32_t out = UINT32_MAX;
+    EXPECT_FALSE(queue.Pop(out));
+    EXPECT_FALSE(queue.Peek(out));
+
+    // Walk the head and tail around the buffer a few times, filling it completely each time.
+    uint32_t next_push = 0, next_pop = 0;
+    for (uint16_t round = 0; round < 5; round++) {
+        for (uint16_t i = 0; i < 3; i++) {
+            ASSERT_TRUE(queue.Push(next_push++));
+            ASSERT_TRUE(queue.Pop(out));
+            ASSERT_EQ(out, next_pop++);
+        }
+        while (queue.Push(next_push)) {
+            next_push++;
+        }
+        ASSERT_EQ(queue.Length(), queue.MaxNumElements());
+        ASSERT_TRUE(queue.Peek(out, 7));
+        ASSERT_EQ(out, next_push - 1);
+        ASSERT_FALSE(queue.Peek(out, 8));
+        while (queue.Pop(out)) {
+            ASSERT_EQ(out, next_pop++);
+        }
+        ASSERT_EQ(queue.Length(), 0);
+    }
+    EXPECT_EQ(next_push, next_pop);
+}
+
+TEST(SPSCQueue, PushSlotCommit) {
+    SPSCQueue<uint32_t, 4> queue;
+    uint32_t out = UINT32_MAX;
+
+    // A slot that is written but not committed is invisible to the consumer, and gets handed out again.
+    uint32_t *slot = queue.GetPushSlot();
+    ASSERT_NE(slot, nullptr);
+    *slot = 1;
+    EXPECT_EQ(queue.Length(), 0);
+    EXPECT_FALSE(queue.Pop(out));
+    EXPECT_EQ(queue.GetPushSlot(), slot);
+
+    // Fill the queue through slots.
+    for (uint32_t i = 0; i < queue.MaxNumElements(); i++) {
+        slot = queue.GetPushSlot();
+        ASSERT_NE(slot, nullptr);
+        *slot = 10 + i;
+        queue.CommitPush();
+    }
+    EXPECT_EQ(queue.GetPushSlot(), nullptr);
+    EXPECT_FALSE(queue.Push(0));
+
+    // Slots and regular pushes can be mixed once there is room again.
+    ASSERT_TRUE(queue.Pop(out));
+    EXPECT_EQ(out, 10u);
+    slot = queue.GetPushSlot();
+    ASSERT_NE(slot, nullptr);
+    *slot = 20;
+    queue.CommitPush();
+    for (uint32_t expected : {11, 12, 13, 20}) {
+        ASSERT_TRUE(queue.Pop(out));
+        EXPECT_EQ(out, expected);
+    }
+    EXPECT_EQ(queue.Length(), 0);
+}
+
+TEST(SPSCQueue, PopSlot) {
+    SPSCQueue<uint32_t, 4> queue;
+    EXPECT_EQ(queue.GetPopSlot(), nullptr);
+
+    for (uint32_t i = 0; i < queue.MaxNumElements(); i++) {
+        ASSERT_TRUE(queue.Push(i));
+    }
+    // The front element can be worked on in place, and stays in the queue until it's committed.
+    uint32_t *slot = queue.GetPopSlot();
+    ASSERT_NE(slot, nullptr);
+    EXPECT_EQ(*slot, 0u);
+    *slot = 100;
+    EXPECT_EQ(queue.GetPopSlot(), slot);
+    EXPECT_FALSE(queue.Push(4));
+    queue.CommitPop();
+
+    // Committing the pop frees the slot for the producer.
+    ASSERT_TRUE(queue.Push(4));
+    // Elements behind the front can be worked on in place too, e.g. to send ahead while earlier ones are in flight.
+    ASSERT_NE(queue.GetPopSlot(3), nullptr);
+    EXPECT_EQ(*queue.GetPopSlot(3), 4u);
+    EXPECT_EQ(queue.GetPopSlot(4), nullptr);
+    for (uint32_t expected : {1, 2, 3, 4}) {
+        slot = queue.GetPopSlot();
+        ASSERT_NE(slot, nullptr);
+        EXPECT_EQ(*slot, expected);
+        queue.CommitPop();
+    }
+    EXPECT_EQ(queue.GetPopSlot(), nullptr);
+    EXPECT_EQ(queue.Length(), 0);
+}
+
+TEST(SPSCQueue, PushNPopNWrap) {
+    SPSCQueue<uint32_t, 8> queue;
+    uint32_t in[12], out[12];
+    for (uint32_t i = 0; i < 12; i++) {
+        in[i] = i;
+    }
+
+    // Offset the head and tail so that bulk operations need to wrap around the end of the buffer.
+    EXPECT_EQ(queue.PushN(in, 5), 5);
+    EXPECT_EQ(queue.PopN(out, 5), 5);
+
+    EXPECT_EQ(queue.PushN(in, 12), 8);  // Only 8 fit.
+    EXPECT_EQ(queue.PushN(in, 1), 0);
+    EXPECT_EQ(queue.Length(), 8);
+    EXPECT_EQ(queue.PopN(out, 6), 6);
+    for (uint32_t i = 0; i < 6; i++) {
+        EXPECT_EQ(out[i], i);
+    }
+    EXPECT_EQ(queue.PushN(in + 8, 4), 4);
+    EXPECT_EQ(queue.PopN(out, 12), 6);  // Only 6 available.
+    const uint32_t kExpected[] = {6, 7, 8, 9, 10, 11};
+    for (uint32_t i = 0; i < 6; i++) {
+        EXPECT_EQ(out[i], kExpected[i]);
+    }
+    EXPECT_EQ(queue.PopN(out, 1), 0);
+
+    queue.Push(1);
+    queue.Clear();
+    EXPECT_EQ(queue.Length(), 0);
+}
+
+struct SPSCTestElement {
+    uint32_t sequence;
+    uint32_t check;  // Complement of sequence, used to catch elements that were read while being written.
+    uint8_t padding[24];
+};
+
+TEST(SPSCQueue, MultithreadedStress) {
+    static const uint32_t kNumElements = 1000000;
+    static SPSCQueue<SPSCTestElement, 64> queue;
+
+    std::thread producer([]() {
+        SPSCTestElement batch[7];
+        uint32_t sequence = 0;
+        while (sequence < kNumElements) {
+            if (sequence % 3 == 0) {
+                // Push a single element.
+                SPSCTestElement element = {.sequence = sequence, .check = ~sequence};
+                if (queue.Push(element)) {
+                    sequence++;
+                } else {
+                    std::this_thread::yield();  // Queue is full. Yield in case the host only has one core.
+                }
+            } else {
+                // Push a batch, which may only partially fit.
+                uint16_t batch_len = std::min(7u, kNumElements - sequence);
+                for (uint16_t i = 0; i < batch_len; i++) {
+                    batch[i] = {.sequence = sequence + i, .check = ~(sequence + i)};
+                }
+                uint16_t num_pushed = queue.PushN(batch, batch_len);
+                if (num_pushed == 0) {
+                    std::this_thread::yield();
+                }
+                sequence += num_pushed;
+            }
+        }
+    });
+
+    SPSCTestElement batch[5];
+    uint32_t expected_sequence = 0;
+    bool in_order = true;
+    while (expected_sequence < kNumElements && in_order) {
+        uint16_t num_popped = 0;
+        if (expected_sequence % 2 == 0) {
+            num_popped = queue.Pop(batch[0]) ? 1 : 0;
+        } else {
+            num_popped = queue.PopN(batch, 5);
+        }
+        if (num_popped == 0) {
+            std::this_thread::yield();  // Queue is empty.
+        }
+        for (uint16_t i = 0; i < num_popped; i++) {
+            in_order &= batch[i].sequence == expected_sequence && batch[i].check == ~expected_sequence;
+            expected_sequence++;
+        }
+    }
+    producer.join();
+    EXPECT_TRUE(in_order);
+    EXPECT_EQ(expected_sequence, kNumElements);
+    EXPECT_EQ(queue.Length(), 0);
+}
+
+TEST(StaticHashMap, InsertFindErase) {
+    StaticHashMap<uint32_t, 10> map;
+    EXPECT_EQ(map.Size(), 0);
+    EXPECT_EQ(map.MaxSize(), 10);
+    EXPECT_EQ(map.Find(0xABCDEF), nullptr);
+    EXPECT_FALSE(map.Erase(0xABCDEF));
+
+    // Fill the map.
+    for (uint32_t i = 0; i < 10; i++) {
+        uint32_t *value = map.Insert(0x100000 + i, i);
+        ASSERT_NE(value, nullptr);
+        EXPECT_EQ(*value, i);
+        EXPECT_EQ(map.Size(), i + 1);
+    }
+    // No room for new keys, but existing keys can be overwritten.
+    EXPECT_EQ(map.Insert(0xABCDEF, 100), nullptr);
+    EXPECT_EQ(map.Size(), 10);
+    ASSERT_NE(map.Insert(0x100005, 55), nullptr);
+    EXPECT_EQ(*map.Find(0x100005), 55u);
+    EXPECT_EQ(map.Size(), 10);
+
+    // Erase and re-insert.
+    EXPECT_TRUE(map.Erase(0x100003));
+    EXPECT_FALSE(map.Contains(0x100003));
+    EXPECT_EQ(map.Size(), 9);
+    for (uint32_t i = 0; i < 10; i++) {
+        if (i == 3) continue;
+        ASSERT_TRUE(map.Contains(0x100000 + i));
+    }
+    ASSERT_NE(map.Insert(0xABCDEF, 100), nullptr);
+    EXPECT_EQ(*map.Find(0xABCDEF), 100u);
+
+    map.Clear();
+    EXPECT_EQ(map.Size(), 0);
+    EXPECT_FALSE(map.Contains(0xABCDEF));
+}
+
+TEST(StaticHashMap, EraseWhileIterating) {
+    StaticHashMap<uint32_t, 50> map;
+    for (uint32_t i = 0; i < 50; i++) {
+        map.Insert(i * 7919, i);
+    }
+    // Erase all odd values, visiting each element exactly once.
+    uint16_t num_visited = 0;
+    for (uint32_t *it = map.begin(); it != map.end();) {
+        num_visited++;
+        EXPECT_EQ(map.GetKey(it), *it * 7919);
+        if (*it % 2) {
+            it = map.Erase(it);
+        } else {
+            it++;
+        }
+    }
+    EXPECT_EQ(num_visited, 50);
+    EXPECT_EQ(map.Size(), 25);
+    for (uint32_t i = 0; i < 50; i++) {
+        ASSERT_EQ(map.Contains(i * 7919), i % 2 == 0);
+    }
+}
+
+TEST(StaticHashMap, MatchesReferenceMap) {
+    // Random inserts and erases with a small key space to exercise probe chains and backward shift deletion.
+    static const uint16_t kMaxNumElements = 100;
+    StaticHashMap<uint32_t, kMaxNumElements> map;
+    std::unordered_map<uint32_t, uint32_t> reference;
+    srand(0xADBEE);
+    for (uint32_t i = 0; i < 100000; i++) {
+        uint32_t key = (rand() % 300) << 12;  // Keys that collide in the low bits.
+        if (rand() % 2) {
+            bool inserted = map.Insert(key, i) != nullptr;
+            if (reference.count(key) || reference.size() < kMaxNumElements) {
+                ASSERT_TRUE(inserted);
+                reference[key] = i;
+            } else {
+                ASSERT_FALSE(inserted);
+            }
+        } else {
+            ASSERT_EQ(map.Erase(key), reference.erase(key) > 0);
+        }
+        ASSERT_EQ(map.Size(), reference.size());
+    }
+    for (auto &itr : reference) {
+        ASSERT_NE(map.Find(itr.first), nullptr);
+        ASSERT_EQ(*map.Find(itr.first), itr.second);
+    }
+}
+
+TEST(StaticLRUList, OrderAndRelocate) {
+    StaticLRUList<10> list;
+    EXPECT_EQ(list.GetOldest(), StaticLRUList<10>::kInvalidIndex);
+    EXPECT_EQ(list.GetNewest(), StaticLRUList<10>::kInvalidIndex);
+
+    for (uint16_t i = 0; i < 5; i++) {
+        list.PushNewest(i);
+    }
+    list.MoveToNewest(0);        // 1 2 3 4 0
+    list.Remove(3);              // 1 2 4 0
+    list.PushOldest(7);          // 7 1 2 4 0
+    list.Relocate(4, 3);         // 7 1 2 3 0
+    list.InsertNewerThan(2, 9);  // 7 1 2 9 3 0
+
+    const uint16_t kExpectedOrder[] = {7, 1, 2, 9, 3, 0};
+    uint16_t i = 0;
+    for (uint16_t index = list.GetOldest(); index != StaticLRUList<10>::kInvalidIndex; index = list.GetNewer(index)) {
+        ASSERT_LT(i, 6);
+        EXPECT_EQ(index, kExpectedOrder[i++]);
+    }
+    EXPECT_EQ(i, 6);
+    i = 6;
+    for (uint16_t index = list.GetNewest(); index != StaticLRUList<10>::kInvalidIndex; index = list.GetOlder(index)) {
+        EXPECT_EQ(index, kExpectedOrder[--i]);
+    }
+    EXPECT_EQ(i, 0);
+
+    list.Clear();
+    EXPECT_EQ(list.GetOldest(), StaticLRUList<10>::kInvalidIndex);
+}
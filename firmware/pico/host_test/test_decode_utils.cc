@@ -1,4 +1,7 @@
+#include <cmath>
+
 #include "decode_utils.hh"  // for location calculation utility functions
+#include "macros.hh"
 #include "gtest/gtest.h"
 
 TEST(DecodeUtils, GrayCodeConversion) {
@@ -399,4 +402,175 @@ TEST(DecodeUtils, AltitudeCodeToAltitudeFt) {
 
 TEST(DecodeUtils, IdentityCodeToSquawk) {
     EXPECT_EQ(IdentityCodeToSquawk(0b1000101101101), 0356);  // Octal 0356.
-}
\ No newline at end of file
+}
+/**
+ * Wrapper for DecodeCPRLocal that takes and returns degrees, to keep the test cases readable.
+ */
+bool DecodeCPRLocalDeg(uint32_t n_lat_cpr, uint32_t n_lon_cpr, bool odd, bool surface, float reference_lat_deg,
+                       float reference_lon_deg, float &lat_deg, float &lon_deg) {
+    int32_t lat, lon;
+    if (!DecodeCPRLocal(n_lat_cpr, n_lon_cpr, odd, surface, DegreesToBinaryAngle(reference_lat_deg),
+                        DegreesToBinaryAngle(reference_lon_deg), lat, lon)) {
+        return false;
+    }
+    lat_deg = BinaryAngleToDegrees(lat);
+    lon_deg = BinaryAngleToDegrees(lon);
+    return true;
+}
+
+TEST(DecodeUtils, DecodeCPRLocalAirborne) {
+    float lat_deg, lon_deg;
+    // Counts out of bounds.
+    EXPECT_FALSE(DecodeCPRLocalDeg(0xFFFFFF, 51372, false, false, 52.258f, 3.918f, lat_deg, lon_deg));
+    EXPECT_FALSE(DecodeCPRLocalDeg(93000, 0xFFFFFF, false, false, 52.258f, 3.918f, lat_deg, lon_deg));
+
+    // Even packet 8D40621D58C382D690C8AC2863A7 with a nearby reference.
+    EXPECT_TRUE(DecodeCPRLocalDeg(93000, 51372, false, false, 52.258f, 3.918f, lat_deg, lon_deg));
+    EXPECT_NEAR(lat_deg, 52.25720f, 1e-4);
+    EXPECT_NEAR(lon_deg, 3.91937f, 1e-4);
+
+    // Reference can be off by more than a degree as long as it's within half a zone of the aircraft.
+    EXPECT_TRUE(DecodeCPRLocalDeg(93000, 51372, false, false, 51.0f, 5.5f, lat_deg, lon_deg));
+    EXPECT_NEAR(lat_deg, 52.25720f, 1e-4);
+    EXPECT_NEAR(lon_deg, 3.91937f, 1e-4);
+
+    // Even and odd packets from 0xA6147F, referenced to a point near Maui (western hemisphere).
+    EXPECT_TRUE(DecodeCPRLocalDeg(50799, 85284, false, false, 20.0f, -156.0f, lat_deg, lon_deg));
+    EXPECT_NEAR(lat_deg, 20.32541f, 1e-4);
+    EXPECT_NEAR(lon_deg, -156.53141f, 1e-4);
+    EXPECT_TRUE(DecodeCPRLocalDeg(43423, 11175, true, false, 20.0f, -156.0f, lat_deg, lon_deg));
+    EXPECT_NEAR(lat_deg, 20.32654f, 1e-4);
+    EXPECT_NEAR(lon_deg, -156.53285f, 1e-4);
+}
+
+TEST(DecodeUtils, DecodeCPRLocalSurface) {
+    float lat_deg, lon_deg;
+    // Even surface position packet near Christchurch, NZ (southern and eastern hemispheres).
+    EXPECT_TRUE(DecodeCPRLocalDeg(1246, 57074, false, true, -43.5f, 172.5f, lat_deg, lon_deg));
+    EXPECT_NEAR(lat_deg, -43.48574f, 1e-4);
+    EXPECT_NEAR(lon_deg, 172.53930f, 1e-4);
+
+    // Decoding the same counts as an airborne position lands somewhere completely different.
+    EXPECT_TRUE(DecodeCPRLocalDeg(1246, 57074, false, false, -43.5f, 172.5f, lat_deg, lon_deg));
+    EXPECT_GT(fabsf(lat_deg - -43.48574f), 1.0f);
+}
+
+/**
+ * Reference implementation of equation 5.3 in double precision, without flooring the latitude.
+ */
+uint16_t CalcNLCPRReference(double lat) {
+    if (fabs(lat) >= 87.0) return fabs(lat) > 87.0 ? 1 : 2;
+    return floor(2.0 * M_PI / acos(1.0 - (1.0 - cos(M_PI / (2.0 * kCPRNz))) / pow(cos(M_PI / 180.0 * lat), 2)));
+}
+
+/**
+ * Reference implementation of the global airborne CPR decode in double precision.
+ */
+bool DecodeCPRGlobalReference(uint32_t n_lat_even, uint32_t n_lon_even, uint32_t n_lat_odd, uint32_t n_lon_odd,
+                              bool odd, double &lat, double &lon) {
+    const double kCountsPerZone = 1 << kCPRNumBits;
+    double lat_cpr_even = n_lat_even / kCountsPerZone, lat_cpr_odd = n_lat_odd / kCountsPerZone;
+    double lon_cpr_even = n_lon_even / kCountsPerZone, lon_cpr_odd = n_lon_odd / kCountsPerZone;
+    double j = floor(59.0 * lat_cpr_even - 60.0 * lat_cpr_odd + 0.5);
+    double lat_even = 360.0 / 60.0 * (fmod(fmod(j, 60.0) + 60.0, 60.0) + lat_cpr_even);
+    double lat_odd = 360.0 / 59.0 * (fmod(fmod(j, 59.0) + 59.0, 59.0) + lat_cpr_odd);
+    if (lat_even >= 270.0) lat_even -= 360.0;
+    if (lat_odd >= 270.0) lat_odd -= 360.0;
+    if (fabs(lat_even) > 90.0 || fabs(lat_odd) > 90.0) return false;
+    uint16_t nl = CalcNLCPRReference(lat_even);
+    if (CalcNLCPRReference(lat_odd) != nl) return false;
+    lat = odd ? lat_odd : lat_even;
+    double m = floor(lon_cpr_even * (nl - 1) - lon_cpr_odd * nl + 0.5);
+    double ni = MAX(nl - (odd ? 1 : 0), 1);
+    lon = 360.0 / ni * (fmod(fmod(m, ni) + ni, ni) + (odd ? lon_cpr_odd : lon_cpr_even));
+    if (lon >= 180.0) lon -= 360.0;
+    return true;
+}
+
+/**
+ * Encodes a position into a 17-bit airborne CPR latitude / longitude count pair.
+ */
+void EncodeCPRReference(double lat, double lon, bool odd, uint32_t &n_lat, uint32_t &n_lon) {
+    const double kCountsPerZone = 1 << kCPRNumBits;
+    double d_lat = 360.0 / (60 - (odd ? 1 : 0));
+    n_lat = static_cast<uint32_t>(floor(kCountsPerZone * fmod(fmod(lat, d_lat) + d_lat, d_lat) / d_lat + 0.5)) &
+            kCPRLatLonMaxCount;
+    double r_lat = d_lat * (n_lat / kCountsPerZone + floor(lat / d_lat));
+    double d_lon = 360.0 / MAX(CalcNLCPRReference(r_lat) - (odd ? 1 : 0), 1);
+    n_lon = static_cast<uint32_t>(floor(kCountsPerZone * fmod(fmod(lon, d_lon) + d_lon, d_lon) / d_lon + 0.5)) &
+            kCPRLatLonMaxCount;
+}
+
+TEST(DecodeUtils, CalcNLCPRFromBinaryAngleMatchesReference) {
+    // Sweep latitudes finely enough to land within ~1e-5 degrees of every NL transition.
+    for (int32_t lat_e5 = -9000000; lat_e5 <= 9000000; lat_e5 += 7) {
+        double lat = lat_e5 * 1e-5;
+        ASSERT_EQ(CalcNLCPRFromBinaryAngle(DegreesToBinaryAngle(lat)), CalcNLCPRReference(lat)) << "lat=" << lat;
+    }
+    EXPECT_EQ(CalcNLCPRFromLat(10.4704f), 59);
+    EXPECT_EQ(CalcNLCPRFromLat(10.4705f), 58);  // Flooring the latitude used to return 59 here.
+    EXPECT_EQ(CalcNLCPRFromLat(-10.4705f), 58);
+    EXPECT_EQ(CalcNLCPRFromLat(87.0f), 2);
+    EXPECT_EQ(CalcNLCPRFromLat(87.001f), 1);
+    EXPECT_EQ(CalcNLCPRFromLat(90.0f), 1);
+}
+
+TEST(DecodeUtils, DecodeCPRGlobalMatchesReference) {
+    int32_t lat, lon;
+    // Counts out of bounds.
+    EXPECT_FALSE(DecodeCPRGlobal(0xFFFFFF, 51372, 74158, 50194, false, lat, lon));
+    EXPECT_FALSE(DecodeCPRGlobal(93000, 51372, 74158, 0xFFFFFF, false, lat, lon));
+
+    // Known position pair 8D40621D58C382D690C8AC2863A7 (even) and 8D40621D58C386435CC412692AD6 (odd).
+    EXPECT_TRUE(DecodeCPRGlobal(93000, 51372, 74158, 50194, false, lat, lon));
+    EXPECT_NEAR(BinaryAngleToDegrees(lat), 52.25720f, 1e-5);
+    EXPECT_NEAR(BinaryAngleToDegrees(lon), 3.91937f, 1e-5);
+    EXPECT_TRUE(DecodeCPRGlobal(93000, 51372, 74158, 50194, true, lat, lon));
+    EXPECT_NEAR(BinaryAngleToDegrees(lat), 52.26578f, 1e-5);
+
+    // Random positions all over the globe should decode to within a few binary angle counts of a double precision
+    // decode of the same counts.
+    const double kMaxErrorDeg = 1e-6;
+    srand(0);
+    for (uint16_t i = 0; i < 10000; i++) {
+        double true_lat = (rand() / static_cast<double>(RAND_MAX)) * 180.0 - 90.0;
+        double true_lon = (rand() / static_cast<double>(RAND_MAX)) * 360.0 - 180.0;
+        bool odd = rand() & 0b1;
+        uint32_t n_lat_even, n_lon_even, n_lat_odd, n_lon_odd;
+        EncodeCPRReference(true_lat, true_lon, false, n_lat_even, n_lon_even);
+        EncodeCPRReference(true_lat, true_lon, true, n_lat_odd, n_lon_odd);
+
+        double ref_lat, ref_lon;
+        bool ref_ok = DecodeCPRGlobalReference(n_lat_even, n_lon_even, n_lat_odd, n_lon_odd, odd, ref_lat, ref_lon);
+        ASSERT_EQ(DecodeCPRGlobal(n_lat_even, n_lon_even, n_lat_odd, n_lon_odd, odd, lat, lon), ref_ok)
+            << "lat=" << true_lat << " lon=" << true_lon;
+        if (!ref_ok) continue;  // Straddles an NL transition.
+        EXPECT_NEAR(lat * (360.0 / 4294967296.0), ref_lat, kMaxErrorDeg);
+        double lon_error = fabs(lon * (360.0 / 4294967296.0) - ref_lon);
+        EXPECT_LT(MIN(lon_error, 360.0 - lon_error), kMaxErrorDeg) << "lat=" << true_lat << " lon=" << true_lon;
+
+        // Local decode relative to the true position should land on the same spot.
+        int32_t local_lat, local_lon;
+        ASSERT_TRUE(DecodeCPRLocal(odd ? n_lat_odd : n_lat_even, odd ? n_lon_odd : n_lon_even, odd, false,
+                                   DegreesToBinaryAngle(true_lat), DegreesToBinaryAngle(true_lon), local_lat,
+                                   local_lon));
+        EXPECT_NEAR(local_lat, lat, 1);
+        EXPECT_NEAR(local_lon, lon, 1);
+    }
+}
+
+TEST(DecodeUtils, SurfaceMovementToGroundSpeedKts) {
+    EXPECT_FLOAT_EQ(SurfaceMovementToGroundSpeedKts(0), -1.0f);  // Not available.
+    EXPECT_FLOAT_EQ(SurfaceMovementToGroundSpeedKts(1), 0.0f);   // Stopped.
+    EXPECT_FLOAT_EQ(SurfaceMovementToGroundSpeedKts(2), 0.125f);
+    EXPECT_FLOAT_EQ(SurfaceMovementToGroundSpeedKts(9), 1.0f);
+    EXPECT_FLOAT_EQ(SurfaceMovementToGroundSpeedKts(13), 2.0f);
+    EXPECT_FLOAT_EQ(SurfaceMovementToGroundSpeedKts(38), 14.5f);
+    EXPECT_FLOAT_EQ(SurfaceMovementToGroundSpeedKts(39), 15.0f);
+    EXPECT_FLOAT_EQ(SurfaceMovementToGroundSpeedKts(44), 20.0f);
+    EXPECT_FLOAT_EQ(SurfaceMovementToGroundSpeedKts(94), 70.0f);
+    EXPECT_FLOAT_EQ(SurfaceMovementToGroundSpeedKts(109), 100.0f);
+    EXPECT_FLOAT_EQ(SurfaceMovementToGroundSpeedKts(123), 170.0f);
+    EXPECT_FLOAT_EQ(SurfaceMovementToGroundSpeedKts(124), 175.0f);
+    EXPECT_FLOAT_EQ(SurfaceMovementToGroundSpeedKts(125), -1.0f);  // Reserved.
+}
@@ -0,0 +1,97 @@
+#include "deferred_log.hh"
+#include "gtest/gtest.h"
+
+TEST(DeferredLog, FormatIntegers) {
+    DeferredLog log;
+    DeferredLog::Entry entry;
+    char buf[100];
+
+    int8_t negative = -5;
+    uint32_t icao_address = 0xABCDEF;
+    ASSERT_TRUE(log.Log(3, "a=%d b=%-4d| c=0x%06lx d=%u e=%c", negative, 42, icao_address, 7u, 'z'));
+    ASSERT_TRUE(log.Pop(entry));
+    EXPECT_EQ(entry.level, 3);
+    EXPECT_EQ(entry.num_args, 5);
+    DeferredLog::Format(entry, buf, sizeof(buf));
+    EXPECT_STREQ(buf, "a=-5 b=42  | c=0xabcdef d=7 e=z");
+
+    uint64_t big = 0x123456789ABCull;
+    int64_t big_negative = -1234567890123ll;
+    ASSERT_TRUE(log.Log(3, "%llx %lld %lu", big, big_negative, 4000000000ul));
+    ASSERT_TRUE(log.Pop(entry));
+    DeferredLog::Format(entry, buf, sizeof(buf));
+    EXPECT_STREQ(buf, "123456789abc -1234567890123 4000000000");
+}
+
+TEST(DeferredLog, FormatFloatsAndPointers) {
+    DeferredLog log;
+    DeferredLog::Entry entry;
+    char buf[100];
+
+    float f = 1.5f;
+    ASSERT_TRUE(log.Log(1, "%.2f %e %d%% %d", f, 1234.5, 10, 2.9));
+    ASSERT_TRUE(log.Pop(entry));
+    EXPECT_EQ(entry.float_arg_mask, 0b1011);
+    DeferredLog::Format(entry, buf, sizeof(buf));
+    EXPECT_STREQ(buf, "1.50 1.234500e+03 10% 2");  // Floats printed as integers are truncated.
+
+    int value = 0;
+    char expected[30];
+    snprintf(expected, sizeof(expected), "%p", static_cast<void *>(&value));
+    ASSERT_TRUE(log.Log(1, "%p", &value));
+    ASSERT_TRUE(log.Pop(entry));
+    DeferredLog::Format(entry, buf, sizeof(buf));
+    EXPECT_STREQ(buf, expected);
+}
+
+TEST(DeferredLog, FormatMalformed) {
+    DeferredLog log;
+    DeferredLog::Entry entry;
+    char buf[100];
+
+    // Missing arguments and string conversions don't read past the stored arguments.
+    ASSERT_TRUE(log.Log(1, "%d %s %d", 1, 2));
+    ASSERT_TRUE(log.Pop(entry));
+    DeferredLog::Format(entry, buf, sizeof(buf));
+    EXPECT_STREQ(buf, "1 <?> <?>");
+
+    // Format string ending partway through a conversion spec.
+    ASSERT_TRUE(log.Log(1, "abc %08"));
+    ASSERT_TRUE(log.Pop(entry));
+    DeferredLog::Format(entry, buf, sizeof(buf));
+    EXPECT_STREQ(buf, "abc ");
+}
+
+TEST(DeferredLog, FormatTruncates) {
+    DeferredLog log;
+    DeferredLog::Entry entry;
+    char buf[8];
+
+    ASSERT_TRUE(log.Log(1, "abc %d def", 123456));
+    ASSERT_TRUE(log.Pop(entry));
+    EXPECT_EQ(DeferredLog::Format(entry, buf, sizeof(buf)), 7u);
+    EXPECT_STREQ(buf, "abc 123");
+
+    EXPECT_EQ(DeferredLog::Format(entry, buf, 1), 0u);
+    EXPECT_STREQ(buf, "");
+}
+
+TEST(DeferredLog, QueueOrderAndDrops) {
+    DeferredLog log;
+    DeferredLog::Entry entry;
+    EXPECT_FALSE(log.Pop(entry));
+
+    for (uint16_t i = 0; i < DeferredLog::kQueueDepth; i++) {
+        EXPECT_TRUE(log.Log(2, "%u", i));
+    }
+    EXPECT_FALSE(log.Log(2, "dropped"));
+    EXPECT_FALSE(log.Log(2, "dropped"));
+    EXPECT_EQ(log.GetNumDroppedEntries(), 2u);
+
+    for (uint16_t i = 0; i < DeferredLog::kQueueDepth; i++) {
+        ASSERT_TRUE(log.Pop(entry));
+        EXPECT_EQ(entry.args[0], i);
+    }
+    EXPECT_FALSE(log.Pop(entry));
+    EXPECT_EQ(log.GetNumDroppedEntries(), 2u);
+}
@@ -2,9 +2,10 @@
 #include "transponder_packet.hh"
 
 TEST(ModeCPacket, JasonPlaynePackets) {
-    ModeCPacket packet = ModeCPacket(DecodedTransponderPacket((char *)"200006A2DE8B1C"));
+    DecodedTransponderPacket tpacket = DecodedTransponderPacket((char *)"200006A2DE8B1C");
+    ModeCPacket packet = ModeCPacket(tpacket);  // View into tpacket, sees changes to tpacket.
     EXPECT_FALSE(packet.IsValid());
-    packet.ForceValid();
+    tpacket.ForceValid();
     EXPECT_TRUE(packet.IsValid());
     EXPECT_EQ(packet.GetUtilityMessage(), 0);
     EXPECT_FALSE(packet.HasAlert());
@@ -12,9 +13,9 @@ TEST(ModeCPacket, JasonPlaynePackets) {
     EXPECT_TRUE(packet.IsAirborne());
     EXPECT_EQ(packet.GetICAOAddress(), 0x7C1B28u);
 
-    packet = ModeCPacket(DecodedTransponderPacket((char *)"210000992F8C48"));
+    tpacket = DecodedTransponderPacket((char *)"210000992F8C48");
     EXPECT_FALSE(packet.IsValid());
-    packet.ForceValid();
+    tpacket.ForceValid();
     EXPECT_TRUE(packet.IsValid());
     EXPECT_EQ(packet.GetUtilityMessage(), 0);
     EXPECT_FALSE(packet.HasAlert());
@@ -24,9 +25,10 @@ TEST(ModeCPacket, JasonPlaynePackets) {
 }
 
 TEST(ModeAPacket, JasonPlaynePackets) {
-    ModeAPacket packet = ModeAPacket(DecodedTransponderPacket((char *)"29001B3AF47E76"));
+    DecodedTransponderPacket tpacket = DecodedTransponderPacket((char *)"29001B3AF47E76");
+    ModeAPacket packet = ModeAPacket(tpacket);  // View into tpacket, sees changes to tpacket.
     EXPECT_FALSE(packet.IsValid());
-    packet.ForceValid();
+    tpacket.ForceValid();
     EXPECT_TRUE(packet.IsValid());
     EXPECT_EQ(packet.GetUtilityMessage(), ModeAPacket::UtilityMessageType::kUtilityMessageNoInformation);
     EXPECT_FALSE(packet.HasAlert());
@@ -35,9 +37,9 @@ TEST(ModeAPacket, JasonPlaynePackets) {
     EXPECT_EQ(packet.GetICAOAddress(), 0x7C1474u);
     EXPECT_FALSE(packet.HasIdent());
 
-    packet = ModeAPacket(DecodedTransponderPacket((char *)"2820050BD0D698"));
+    tpacket = DecodedTransponderPacket((char *)"2820050BD0D698");
     EXPECT_FALSE(packet.IsValid());
-    packet.ForceValid();
+    tpacket.ForceValid();
     EXPECT_TRUE(packet.IsValid());
     EXPECT_EQ(packet.GetUtilityMessage(), ModeAPacket::UtilityMessageType::kUtilityMessageNoInformation);
     EXPECT_EQ(packet.GetDownlinkRequest(),
@@ -49,7 +51,7 @@ TEST(ModeAPacket, JasonPlaynePackets) {
     EXPECT_FALSE(packet.HasIdent());
 
     // Edit the previous packet to force an ident.
-    packet = ModeAPacket(DecodedTransponderPacket((char *)"2D20050BD0D698"));
+    tpacket = DecodedTransponderPacket((char *)"2D20050BD0D698");
     EXPECT_EQ(packet.GetUtilityMessage(), ModeAPacket::UtilityMessageType::kUtilityMessageNoInformation);
     EXPECT_EQ(packet.GetDownlinkRequest(),
               ModeAPacket::DownlinkRequest::kDownlinkRequestCommBBroadcastMessage1Available);
@@ -59,7 +61,7 @@ TEST(ModeAPacket, JasonPlaynePackets) {
     EXPECT_TRUE(packet.HasIdent());
 
     // Edit the previous packet to force an ident and alert.
-    packet = ModeAPacket(DecodedTransponderPacket((char *)"2C20050BD0D698"));
+    tpacket = DecodedTransponderPacket((char *)"2C20050BD0D698");
     EXPECT_EQ(packet.GetUtilityMessage(), ModeAPacket::UtilityMessageType::kUtilityMessageNoInformation);
     EXPECT_EQ(packet.GetDownlinkRequest(),
               ModeAPacket::DownlinkRequest::kDownlinkRequestCommBBroadcastMessage1Available);
@@ -67,4 +69,12 @@ TEST(ModeAPacket, JasonPlaynePackets) {
     EXPECT_EQ(packet.GetSquawk(), 00664u);
     EXPECT_FALSE(packet.IsAirborne());  // Not sure if in air or on ground, default to on ground.
     EXPECT_TRUE(packet.HasIdent());
-}
\ No newline at end of file
+}
+TEST(ModeAPacket, ViewIsLightweight) {
+    // Views only hold a reference to their parent packet, and shouldn't copy it.
+    EXPECT_EQ(sizeof(ModeAPacket), sizeof(DecodedTransponderPacket *));
+    EXPECT_EQ(sizeof(ModeCPacket), sizeof(DecodedTransponderPacket *));
+    EXPECT_EQ(sizeof(ADSBPacket), sizeof(DecodedTransponderPacket *));
+    EXPECT_TRUE(std::is_trivially_copyable<DecodedTransponderPacket>::value);
+    EXPECT_LE(sizeof(DecodedTransponderPacket), 48u);
+}
@@ -0,0 +1,99 @@
+#include "gtest/gtest.h"
+#include "hal_god_powers.hh"
+#include "perf_monitor.hh"
+
+TEST(PerfMonitor, HistogramBins) {
+    EXPECT_EQ(PerfMonitor::GetHistogramBin(0), 0);
+    EXPECT_EQ(PerfMonitor::GetHistogramBin(63), 0);
+    EXPECT_EQ(PerfMonitor::GetHistogramBin(64), 1);
+    EXPECT_EQ(PerfMonitor::GetHistogramBin(127), 1);
+    EXPECT_EQ(PerfMonitor::GetHistogramBin(128), 2);
+    EXPECT_EQ(PerfMonitor::GetHistogramBin(UINT32_MAX), PerfMonitor::kNumHistogramBins - 1);
+    for (uint16_t bin = 0; bin < PerfMonitor::kNumHistogramBins; bin++) {
+        EXPECT_EQ(PerfMonitor::GetHistogramBin(PerfMonitor::GetHistogramBinMinCycles(bin)), bin);
+        if (bin > 0) {
+            EXPECT_EQ(PerfMonitor::GetHistogramBin(PerfMonitor::GetHistogramBinMinCycles(bin) - 1), bin - 1);
+        }
+    }
+}
+
+TEST(PerfMonitor, RecordStage) {
+    PerfMonitor monitor;
+    monitor.SetCyclesPerUs(125);
+    monitor.RecordStage(PerfMonitor::kStageIngest, 100);
+    monitor.RecordStage(PerfMonitor::kStageIngest, 300);
+    monitor.RecordStage(PerfMonitor::kStageIngest, 20);
+
+    PerfMonitor::Stats stats = monitor.GetStats();
+    const PerfMonitor::StageStats &ingest = stats.stages[PerfMonitor::kStageIngest];
+    EXPECT_EQ(ingest.num_samples, 3u);
+    EXPECT_EQ(ingest.min_cycles, 20u);
+    EXPECT_EQ(ingest.max_cycles, 300u);
+    EXPECT_EQ(ingest.GetMeanCycles(), 140u);
+    EXPECT_EQ(ingest.histogram[0], 1u);  // 20
+    EXPECT_EQ(ingest.histogram[1], 1u);  // 100
+    EXPECT_EQ(ingest.histogram[3], 1u);  // 300
+    // Other stages are untouched.
+    EXPECT_EQ(stats.stages[PerfMonitor::kStageCRC].num_samples, 0u);
+    EXPECT_EQ(stats.stages[PerfMonitor::kStageCRC].GetMeanCycles(), 0u);
+
+    monitor.Reset();
+    stats = monitor.GetStats();
+    EXPECT_EQ(stats.stages[PerfMonitor::kStageIngest].num_samples, 0u);
+    EXPECT_EQ(stats.stages[PerfMonitor::kStageIngest].histogram[1], 0u);
+    EXPECT_EQ(stats.cycles_per_us, 125u);  // Conversion factor survives a reset.
+}
+
+TEST(PerfMonitor, QueueStats) {
+    PerfMonitor monitor;
+    monitor.RecordQueueLength(PerfMonitor::kQueueDemodPackets, 3);
+    monitor.RecordQueueLength(PerfMonitor::kQueueDemodPackets, 7);
+    monitor.RecordQueueLength(PerfMonitor::kQueueDemodPackets, 2);
+    monitor.RecordQueueDrop(PerfMonitor::kQueueTransponderPacketReporting);
+    monitor.RecordQueueDrop(PerfMonitor::kQueueTransponderPacketReporting);
+
+    PerfMonitor::Stats stats = monitor.GetStats();
+    EXPECT_EQ(stats.queues[PerfMonitor::kQueueDemodPackets].high_water_mark, 7u);
+    EXPECT_EQ(stats.queues[PerfMonitor::kQueueDemodPackets].num_drops, 0u);
+    EXPECT_EQ(stats.queues[PerfMonitor::kQueueTransponderPacketReporting].high_water_mark, 0u);
+    EXPECT_EQ(stats.queues[PerfMonitor::kQueueTransponderPacketReporting].num_drops, 2u);
+}
+
+TEST(PerfMonitor, ProbeRecordsScope) {
+    perf_monitor.Reset();
+    {
+        PerfProbe probe(PerfMonitor::kStageReporting);
+        inc_time_since_boot_us(500);  // Host cycle counter runs off of the microsecond clock.
+    }
+    PerfMonitor::StageStats reporting = perf_monitor.GetStats().stages[PerfMonitor::kStageReporting];
+    EXPECT_EQ(reporting.num_samples, 1u);
+    EXPECT_EQ(reporting.min_cycles, 500u);
+    EXPECT_EQ(reporting.max_cycles, 500u);
+}
+
+TEST(PerfMonitor, StatsToJSON) {
+    PerfMonitor monitor;
+    monitor.SetCyclesPerUs(125);
+    monitor.RecordStage(PerfMonitor::kStageDemodISR, 900);
+    monitor.RecordQueueDrop(PerfMonitor::kQueueDemodPackets);
+
+    char buf[PerfMonitor::kStatsJSONMaxLen];
+    uint16_t len = monitor.GetStats().ToJSON(buf, sizeof(buf));
+    EXPECT_EQ(len, strlen(buf));
+    EXPECT_NE(strstr(buf, "\"cycles_per_us\": 125"), nullptr);
+    EXPECT_NE(strstr(buf, "\"DEMOD_ISR\": { \"num\": 1, \"min\": 900, \"mean\": 900, \"max\": 900, "
+                          "\"histogram\": [0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0] }"),
+              nullptr);
+    EXPECT_NE(strstr(buf, "\"DEMOD_PACKETS\": { \"high_water_mark\": 0, \"drops\": 1 }"), nullptr);
+    EXPECT_EQ(buf[len - 1], '}');
+
+    // Worst case values still fit in the buffer.
+    for (uint16_t i = 0; i < PerfMonitor::kNumStages; i++) {
+        for (uint16_t j = 0; j < PerfMonitor::kNumHistogramBins; j++) {
+            monitor.RecordStage(static_cast<PerfMonitor::Stage>(i), UINT32_MAX);
+        }
+    }
+    len = monitor.GetStats().ToJSON(buf, sizeof(buf));
+    EXPECT_EQ(len, strlen(buf));
+    EXPECT_EQ(buf[len - 1], '}');
+}
@@ -0,0 +1,151 @@
+#include "gtest/gtest.h"
+#include "raw_packet_batch.hh"
+#include "spi_coprocessor.hh"
+
+namespace {
+void ExpectPacketsEqual(const RawTransponderPacket &expected, const RawTransponderPacket &actual) {
+    EXPECT_EQ(expected.buffer_len_bits, actual.buffer_len_bits);
+    // Only the bits of the frame are sent, whatever is left over in the last word isn't.
+    for (uint16_t i = 0; i < expected.buffer_len_bits / 8; i++) {
+        uint16_t shift = 24 - 8 * (i % 4);
+        EXPECT_EQ((expected.buffer[i / 4] >> shift) & 0xFF, (actual.buffer[i / 4] >> shift) & 0xFF) << "i=" << i;
+    }
+    EXPECT_EQ(expected.mlat_48mhz_64bit_counts, actual.mlat_48mhz_64bit_counts);
+    EXPECT_EQ(expected.sigs_dbm, actual.sigs_dbm);
+    EXPECT_EQ(expected.sigq_db, actual.sigq_db);
+    EXPECT_EQ(expected.source, actual.source);
+    EXPECT_EQ(expected.num_corrected_bits, actual.num_corrected_bits);
+}
+}  // namespace
+
+TEST(RawPacketBatch, RoundTrip) {
+    RawTransponderPacket packets[4] = {
+        RawTransponderPacket((char *)"8D7C1BE8581B66E9BD8CEEDC1C9F", 0, -75, 12, 0x123456789AB),
+        RawTransponderPacket((char *)"5D4CA2D4F1C9A8", 2, -60, 20, 0x123456789AB + 48000),
+        // Out of order MLAT timestamps, e.g. from different state machines.
+        RawTransponderPacket((char *)"8DA0B5F1990D4B8E3004128C8A4B", 1, -90, 3, 0x123456789AB + 1000),
+        RawTransponderPacket((char *)"02E197B00179C3", -1, INT32_MIN, INT32_MIN, 0)};
+    packets[0].num_corrected_bits = 1;
+
+    uint8_t buf[200];
+    RawPacketBatch::Writer writer = RawPacketBatch::Writer(buf, sizeof(buf));
+    for (uint16_t i = 0; i < 4; i++) {
+        EXPECT_TRUE(writer.Append(packets[i]));
+    }
+    EXPECT_EQ(writer.GetNumPackets(), 4);
+
+    RawPacketBatch::Reader reader = RawPacketBatch::Reader(buf, writer.GetLenBytes());
+    EXPECT_TRUE(reader.IsValid());
+    EXPECT_EQ(reader.GetNumPackets(), 4);
+    RawTransponderPacket packet;
+    for (uint16_t i = 0; i < 4; i++) {
+        ASSERT_TRUE(reader.Next(packet));
+        ExpectPacketsEqual(packets[i], packet);
+    }
+    EXPECT_FALSE(reader.Next(packet));
+}
+
+TEST(RawPacketBatch, ForwardsDecodeResults) {
+    DecodedTransponderPacket packets[4] = {
+        // Extended squitter with a bit error that gets corrected.
+        DecodedTransponderPacket((char *)"8D76CE88204C9072CB48209A504C", 0, -75, 12, 1000),
+        // Mode C reply, validated against the sender's aircraft dictionary below.
+        DecodedTransponderPacket((char *)"200006A2DE8B1C", 1, -60, 20, 2000),
+        // Mode C reply that the sender's aircraft dictionary didn't know about.
+        DecodedTransponderPacket((char *)"24000E3956BBA1", 2, -80, 5, 3000),
+        // Extended squitter that failed CRC.
+        DecodedTransponderPacket((char *)"8D76CE88204C9072CB48209A5000", 3, -90, 3, 4000)};
+    packets[1].ForceValid();
+    EXPECT_TRUE(packets[0].IsValid());
+    EXPECT_EQ(packets[0].GetNumCorrectedBits(), 1);
+    EXPECT_FALSE(packets[2].IsValid());
+    EXPECT_FALSE(packets[3].IsValid());
+
+    uint8_t buf[200];
+    RawPacketBatch::Writer writer = RawPacketBatch::Writer(buf, sizeof(buf));
+    for (uint16_t i = 0; i < 4; i++) {
+        uint16_t len_bytes = writer.GetLenBytes();
+        EXPECT_TRUE(writer.Append(packets[i]));
+        if (i == 1) {
+            // Only valid 56-bit frames need their address sent along with them.
+            uint16_t record_len_bytes = writer.GetLenBytes() - len_bytes;
+            EXPECT_EQ(record_len_bytes, 1 + 2 + 2 + 7 + RawPacketBatch::kICAOAddressLenBytes);
+        }
+    }
+
+    RawPacketBatch::Reader reader = RawPacketBatch::Reader(buf, writer.GetLenBytes());
+    DecodedTransponderPacket packet;
+    for (uint16_t i = 0; i < 4; i++) {
+        ASSERT_TRUE(reader.Next(packet));
+        ExpectPacketsEqual(packets[i].GetRaw(), packet.GetRaw());
+        EXPECT_TRUE(packet.IsValiditySettled());
+        EXPECT_EQ(packet.IsValid(), packets[i].IsValid()) << "i=" << i;
+        EXPECT_EQ(packet.GetDownlinkFormat(), packets[i].GetDownlinkFormat()) << "i=" << i;
+        if (packet.IsValid()) {
+            EXPECT_EQ(packet.GetICAOAddress(), packets[i].GetICAOAddress()) << "i=" << i;
+        }
+    }
+    EXPECT_FALSE(reader.Next(packet));
+
+    // Packets that were appended without decode results get decoded by the receiver.
+    writer.Clear();
+    EXPECT_TRUE(writer.Append(packets[0].GetRaw()));
+    RawPacketBatch::Reader raw_reader = RawPacketBatch::Reader(buf, writer.GetLenBytes());
+    ASSERT_TRUE(raw_reader.Next(packet));
+    EXPECT_FALSE(packet.IsValiditySettled());
+    EXPECT_TRUE(packet.IsValid());
+    EXPECT_EQ(packet.GetICAOAddress(), 0x76CE88u);
+}
+
+TEST(RawPacketBatch, ClampsSignalLevels) {
+    RawTransponderPacket packet = RawTransponderPacket((char *)"5D4CA2D4F1C9A8", 0, -200, 300, 0);
+    uint8_t buf[100];
+    RawPacketBatch::Writer writer = RawPacketBatch::Writer(buf, sizeof(buf));
+    EXPECT_TRUE(writer.Append(packet));
+    RawPacketBatch::Reader reader = RawPacketBatch::Reader(buf, writer.GetLenBytes());
+    ASSERT_TRUE(reader.Next(packet));
+    EXPECT_EQ(packet.sigs_dbm, INT8_MIN + 1);  // INT8_MIN is reserved for no measurement.
+    EXPECT_EQ(packet.sigq_db, INT8_MAX);
+}
+
+TEST(RawPacketBatch, FitsTwiceAsManyPacketsPerTransfer) {
+    uint8_t buf[SPICoprocessor::SCWritePacket::kDataMaxLenBytes];
+    RawPacketBatch::Writer writer = RawPacketBatch::Writer(buf, sizeof(buf));
+    // Extended squitters about 100us apart, the worst case for packet size.
+    RawTransponderPacket packet = RawTransponderPacket((char *)"8D7C1BE8581B66E9BD8CEEDC1C9F", 0, -75, 12, 0);
+    while (writer.Append(packet)) {
+        packet.mlat_48mhz_64bit_counts += 4800;
+    }
+    EXPECT_GE(writer.GetNumPackets(), 2 * sizeof(buf) / sizeof(RawTransponderPacket));
+    EXPECT_LE(writer.GetLenBytes(), sizeof(buf));
+
+    // Clearing starts a new batch in the same buffer.
+    writer.Clear();
+    uint16_t header_len_bytes = RawPacketBatch::kHeaderLenBytes;
+    EXPECT_EQ(writer.GetNumPackets(), 0);
+    EXPECT_EQ(writer.GetLenBytes(), header_len_bytes);
+}
+
+TEST(RawPacketBatch, RejectsBadBatches) {
+    RawTransponderPacket packet = RawTransponderPacket((char *)"8D7C1BE8581B66E9BD8CEEDC1C9F", 0, -75, 12, 1000);
+    uint8_t buf[100];
+    RawPacketBatch::Writer writer = RawPacketBatch::Writer(buf, sizeof(buf));
+    EXPECT_TRUE(writer.Append(packet));
+    EXPECT_TRUE(writer.Append(packet));
+
+    // Too short for a header.
+    EXPECT_FALSE(RawPacketBatch::Reader(buf, RawPacketBatch::kHeaderLenBytes - 1).IsValid());
+
+    // Truncated in the middle of the second record.
+    RawPacketBatch::Reader truncated_reader = RawPacketBatch::Reader(buf, writer.GetLenBytes() - 1);
+    EXPECT_TRUE(truncated_reader.IsValid());
+    EXPECT_TRUE(truncated_reader.Next(packet));
+    EXPECT_FALSE(truncated_reader.Next(packet));
+    EXPECT_FALSE(truncated_reader.IsValid());
+
+    // Unsupported format version.
+    buf[0] = RawPacketBatch::kFormatVersion + 1;
+    RawPacketBatch::Reader version_reader = RawPacketBatch::Reader(buf, writer.GetLenBytes());
+    EXPECT_FALSE(version_reader.IsValid());
+    EXPECT_FALSE(version_reader.Next(packet));
+}
@@ -1,6 +1,7 @@
 #include "aircraft_dictionary.hh"
 #include "csbee_utils.hh"
 #include "gtest/gtest.h"
+#include "hal_god_powers.hh"
 
 std::string_view GetNextToken(std::string_view* message_in = nullptr, char delimiter = ',') {
     static uint16_t token_start;
@@ -18,12 +19,11 @@ TEST(CSBeeUtils, AircraftToCSBeeString) {
     char message[kCSBeeMessageStrMaxLen];
 
     Aircraft aircraft;
+    AircraftMetadata metadata;
     aircraft.flags = UINT32_MAX;  // Set allll the flags.
     aircraft.last_message_timestamp_ms = 1000;
     aircraft.last_message_signal_strength_dbm = -75;
     aircraft.last_message_signal_quality_db = 2;
-    aircraft.metrics.valid_squitter_frames = 1;
-    aircraft.metrics.valid_extended_squitter_frames = 3;
     aircraft.transponder_capability = ADSBPacket::Capability::kCALevel2PlusTransponderOnSurfaceCanSetCA7;
     aircraft.icao_address = 0x12345E;
     strcpy(aircraft.callsign, "ABCDEFG");
@@ -40,19 +40,26 @@ TEST(CSBeeUtils, AircraftToCSBeeString) {
     aircraft.vertical_rate_fpm = -200;
     aircraft.vertical_rate_source = Aircraft::VerticalRateSource::kVerticalRateSourceBaro;
     aircraft.navigation_integrity_category = static_cast<Aircraft::NICRadiusOfContainment>(0b1011);
-    aircraft.navigation_integrity_category_baro = static_cast<Aircraft::NICBarometricAltitudeIntegrity>(0b1);
-    aircraft.navigation_accuracy_category_velocity = static_cast<Aircraft::NACHorizontalVelocityError>(0b101);
-    aircraft.navigation_accuracy_category_position = static_cast<Aircraft::NACEstimatedPositionUncertainty>(0b1101);
-    aircraft.geometric_vertical_accuracy = static_cast<Aircraft::GVA>(0b11);
-    aircraft.source_integrity_level = static_cast<Aircraft::SILProbabilityOfExceedingNICRadiusOfContainmnent>(
+    metadata.navigation_integrity_category_baro = static_cast<Aircraft::NICBarometricAltitudeIntegrity>(0b1);
+    metadata.navigation_accuracy_category_velocity = static_cast<Aircraft::NACHorizontalVelocityError>(0b101);
+    metadata.navigation_accuracy_category_position = static_cast<Aircraft::NACEstimatedPositionUncertainty>(0b1101);
+    metadata.geometric_vertical_accuracy = static_cast<Aircraft::GVA>(0b11);
+    metadata.source_integrity_level = static_cast<Aircraft::SILProbabilityOfExceedingNICRadiusOfContainmnent>(
         Aircraft::kPOERCLessThanOrEqualTo1em5PerFlightHour);
-    aircraft.system_design_assurance = static_cast<Aircraft::SystemDesignAssurance>(0b11);
-    aircraft.gnss_antenna_offset_right_of_roll_axis_m = -6;
-    aircraft.length_m = 10;
-    aircraft.width_m = 20;
-    aircraft.adsb_version = 3;
+    metadata.system_design_assurance = static_cast<Aircraft::SystemDesignAssurance>(0b11);
+    metadata.gnss_antenna_offset_right_of_roll_axis_m = -6;
+    metadata.length_m = 10;
+    metadata.width_m = 20;
+    metadata.adsb_version = 3;
 
-    WriteCSBeeAircraftMessageStr(message, aircraft);
+    // Receive 1 squitter and 3 extended squitter frames, then move into the next metrics interval.
+    metadata.IncrementNumFramesReceived(false);
+    for (uint16_t i = 0; i < 3; i++) {
+        metadata.IncrementNumFramesReceived(true);
+    }
+    inc_time_since_boot_ms(AircraftMetadata::kMetricsIntervalMs);
+
+    WriteCSBeeAircraftMessageStr(message, aircraft, metadata);
     std::string_view message_view(message);
     printf("%s\r\n", message_view.data());
     printf("%s\r\n", message_view.data());
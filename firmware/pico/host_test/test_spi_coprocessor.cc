@@ -2,64 +2,83 @@
 #include "spi_coprocessor.hh"
 
 TEST(SPICoprocessor, SCWritePacket) {
-    SPICoprocessor::SCWritePacket packet;
-    packet.cmd = SPICoprocessor::SCCommand::kCmdWriteToSlave;
-    packet.addr = ObjectDictionary::Address::kAddrRawTransponderPacket;
+    uint8_t buf[SPICoprocessor::kSPITransactionMaxLenBytes];
+    SPICoprocessor::SCWritePacket packet = SPICoprocessor::SCWritePacket(buf, sizeof(buf));
     RawTransponderPacket tpacket = RawTransponderPacket((char *)"8D7C1BE8581B66E9BD8CEEDC1C9F");
-    packet.len = sizeof(RawTransponderPacket);
-    memcpy(packet.data, &tpacket, packet.len);
-    // Calculate CRC and add it to the data buffer.
+    packet.SetHeader({.cmd = SPICoprocessor::SCCommand::kCmdWriteToSlave,
+                      .addr = ObjectDictionary::Address::kAddrRawTransponderPacket,
+                      .offset = 0,
+                      .len = sizeof(RawTransponderPacket)});
+    memcpy(packet.GetData(), &tpacket, sizeof(RawTransponderPacket));
+    // Calculate CRC and add it to the end of the data.
     uint16_t crc =
         CalculateCRC16(packet.GetBuf(), packet.GetBufLenBytes() - SPICoprocessor::SCWritePacket::kCRCLenBytes);
-    memcpy(packet.data + packet.len, &crc, sizeof(uint16_t));
+    memcpy(packet.GetData() + sizeof(RawTransponderPacket), &crc, sizeof(uint16_t));
     EXPECT_TRUE(packet.IsValid());
 
     packet.PopulateCRC();
     EXPECT_TRUE(packet.IsValid());
+    EXPECT_EQ(packet.GetCRC(), crc);
 
     EXPECT_EQ(packet.GetBufLenBytes(), sizeof(RawTransponderPacket) + sizeof(SPICoprocessor::SCCommand) +
                                            sizeof(ObjectDictionary::Address) + 2 * sizeof(uint16_t) +
                                            SPICoprocessor::SCWritePacket::kCRCLenBytes);
 
-    SPICoprocessor::SCWritePacket packet_copy = SPICoprocessor::SCWritePacket(packet.GetBuf(), packet.GetBufLenBytes());
-    EXPECT_EQ(packet.cmd, packet_copy.cmd);
-    EXPECT_EQ(packet.addr, packet_copy.addr);
-    EXPECT_EQ(packet.IsValid(), packet_copy.IsValid());
-    RawTransponderPacket *tpacket_copy = (RawTransponderPacket *)packet_copy.data;
+    // Parse the packet from a received buffer, in place.
+    uint8_t rx_buf[SPICoprocessor::kSPITransactionMaxLenBytes];
+    memcpy(rx_buf, buf, packet.GetBufLenBytes());
+    SPICoprocessor::SCWritePacket packet_copy = SPICoprocessor::SCWritePacket(rx_buf, packet.GetBufLenBytes());
+    EXPECT_EQ(packet_copy.GetBuf(), rx_buf);
+    EXPECT_EQ(packet_copy.GetHeader().cmd, SPICoprocessor::SCCommand::kCmdWriteToSlave);
+    EXPECT_EQ(packet_copy.GetHeader().addr, ObjectDictionary::Address::kAddrRawTransponderPacket);
+    EXPECT_EQ(packet_copy.GetDataLenBytes(), sizeof(RawTransponderPacket));
+    EXPECT_TRUE(packet_copy.IsValid());
+    RawTransponderPacket *tpacket_copy = (RawTransponderPacket *)packet_copy.GetData();
     EXPECT_EQ(tpacket.buffer_len_bits, tpacket_copy->buffer_len_bits);
     EXPECT_EQ(tpacket.buffer[0], tpacket_copy->buffer[0]);
     EXPECT_EQ(tpacket.buffer[1], tpacket_copy->buffer[1]);
     EXPECT_EQ(tpacket.buffer[2], tpacket_copy->buffer[2]);
     EXPECT_EQ(tpacket.buffer[3], tpacket_copy->buffer[3]);
 
+    // A packet that claims to be longer than what was received is invalid.
+    EXPECT_FALSE(SPICoprocessor::SCWritePacket(rx_buf, packet.GetBufLenBytes() - 1).IsValid());
+    EXPECT_FALSE(SPICoprocessor::SCWritePacket(rx_buf, SPICoprocessor::SCWritePacket::kBufMinLenBytes - 1).IsValid());
+
     // Poke packet and make checksum fail.
-    packet.data[0] = ~packet.data[0];
+    packet.GetData()[0] = ~packet.GetData()[0];
     EXPECT_FALSE(packet.IsValid());
 }
 
 TEST(SPICoprocessor, SCReadRequestPacket) {
     // Test packet creation.
-    SPICoprocessor::SCReadRequestPacket packet;
-    packet.cmd = SPICoprocessor::SCCommand::kCmdReadFromMaster;
-    packet.addr = ObjectDictionary::Address::kAddrSettingsData;
-    packet.offset = 0xFEBC;
-    packet.len = 40;
+    uint8_t buf[SPICoprocessor::SCReadRequestPacket::kBufLenBytes];
+    uint16_t buf_len_bytes = SPICoprocessor::SCReadRequestPacket::kBufLenBytes;
+    EXPECT_EQ(buf_len_bytes,
+              sizeof(SPICoprocessor::SCCommand) + sizeof(ObjectDictionary::Address) + 3 * sizeof(uint16_t));
+    SPICoprocessor::SCReadRequestPacket packet = SPICoprocessor::SCReadRequestPacket(buf, sizeof(buf));
+    packet.SetHeader({.cmd = SPICoprocessor::SCCommand::kCmdReadFromMaster,
+                      .addr = ObjectDictionary::Address::kAddrSettingsData,
+                      .offset = 0xFEBC,
+                      .len = 40});
     // Make sure that CRC generation works as expected.
     packet.PopulateCRC();
     EXPECT_TRUE(packet.IsValid());
+    EXPECT_EQ(packet.GetBufLenBytes(), buf_len_bytes);
     EXPECT_EQ(
         CalculateCRC16(packet.GetBuf(), packet.GetBufLenBytes() - SPICoprocessor::SCReadRequestPacket::kCRCLenBytes),
-        packet.crc);
+        packet.GetCRC());
 
     // Test packet ingestion.
-    SPICoprocessor::SCReadRequestPacket packet_copy =
-        SPICoprocessor::SCReadRequestPacket(packet.GetBuf(), packet.GetBufLenBytes());
-    EXPECT_EQ(packet_copy.cmd, packet.cmd);
-    EXPECT_EQ(packet_copy.addr, packet.addr);
-    EXPECT_EQ(packet_copy.offset, packet.offset);
-    EXPECT_EQ(packet_copy.len, packet.len);
+    uint8_t rx_buf[SPICoprocessor::SCReadRequestPacket::kBufLenBytes];
+    memcpy(rx_buf, buf, sizeof(buf));
+    SPICoprocessor::SCReadRequestPacket packet_copy = SPICoprocessor::SCReadRequestPacket(rx_buf, sizeof(rx_buf));
+    SPICoprocessor::SCReadRequestHeader header = packet_copy.GetHeader();
+    EXPECT_EQ(header.cmd, SPICoprocessor::SCCommand::kCmdReadFromMaster);
+    EXPECT_EQ(header.addr, ObjectDictionary::Address::kAddrSettingsData);
+    EXPECT_EQ(header.offset, 0xFEBC);
+    EXPECT_EQ(header.len, 40);
     EXPECT_TRUE(packet_copy.IsValid());
-    // Changes to packet should not affect packet_copy.
+    // Changes to packet should not affect packet_copy, since they look at different buffers.
     packet.GetBuf()[0] = ~packet.GetBuf()[0];
     EXPECT_FALSE(packet.IsValid());
     EXPECT_TRUE(packet_copy.IsValid());
@@ -67,22 +86,30 @@ TEST(SPICoprocessor, SCReadRequestPacket) {
 
 TEST(SPICoprocessor, SCResponsePacket) {
     // Test packet creation.
-    SPICoprocessor::SCResponsePacket packet;
-    packet.cmd = SPICoprocessor::SCCommand::kCmdDataBlock;
+    uint8_t buf[SPICoprocessor::kSPITransactionMaxLenBytes];
+    SPICoprocessor::SCResponsePacket packet = SPICoprocessor::SCResponsePacket(buf, sizeof(buf));
+    uint16_t data_max_len_bytes = SPICoprocessor::SCResponsePacket::kDataMaxLenBytes;
+    EXPECT_EQ(packet.GetDataLenBytes(), data_max_len_bytes);  // Fills the buffer until the data length is set.
+    packet.SetHeader({.cmd = SPICoprocessor::SCCommand::kCmdDataBlock});
     EXPECT_EQ(packet.GetBuf()[0], SPICoprocessor::SCCommand::kCmdDataBlock);
     RawTransponderPacket tpacket = RawTransponderPacket((char *)"8D7C1BE8581B66E9BD8CEEDC1C9F");
-    packet.data_len_bytes = sizeof(RawTransponderPacket);
-    memcpy(packet.data, &tpacket, packet.data_len_bytes);
+    packet.SetDataLenBytes(sizeof(RawTransponderPacket));
+    memcpy(packet.GetData(), &tpacket, sizeof(RawTransponderPacket));
+    memset(packet.GetData() + sizeof(RawTransponderPacket), 0, SPICoprocessor::SCResponsePacket::kCRCLenBytes);
     EXPECT_FALSE(packet.IsValid());
     packet.PopulateCRC();
     EXPECT_TRUE(packet.IsValid());
+    EXPECT_EQ(packet.GetBufLenBytes(),
+              SPICoprocessor::SCResponsePacket::GetBufLenForPayloadLenBytes(sizeof(RawTransponderPacket)));
 
-    // Test packet ingestion.
-    SPICoprocessor::SCResponsePacket packet_copy =
-        SPICoprocessor::SCResponsePacket(packet.GetBuf(), packet.GetBufLenBytes());
+    // Test packet ingestion. The data length comes from the length of the received buffer.
+    uint8_t rx_buf[SPICoprocessor::kSPITransactionMaxLenBytes];
+    memcpy(rx_buf, buf, packet.GetBufLenBytes());
+    SPICoprocessor::SCResponsePacket packet_copy = SPICoprocessor::SCResponsePacket(rx_buf, packet.GetBufLenBytes());
     EXPECT_TRUE(packet_copy.IsValid());
-    EXPECT_EQ(packet_copy.cmd, packet.cmd);
-    RawTransponderPacket *tpacket_copy = (RawTransponderPacket *)packet_copy.data;
+    EXPECT_EQ(packet_copy.GetHeader().cmd, SPICoprocessor::SCCommand::kCmdDataBlock);
+    EXPECT_EQ(packet_copy.GetDataLenBytes(), sizeof(RawTransponderPacket));
+    RawTransponderPacket *tpacket_copy = (RawTransponderPacket *)packet_copy.GetData();
     EXPECT_EQ(tpacket_copy->buffer[0], 0x8D7C1BE8u);
     EXPECT_EQ(tpacket_copy->buffer[1], 0x581B66E9u);
     EXPECT_EQ(tpacket_copy->buffer[2], 0xBD8CEEDCu);
@@ -92,4 +119,58 @@ TEST(SPICoprocessor, SCResponsePacket) {
     EXPECT_FALSE(packet_copy.IsValid());
     // Make sure original packet was not affected.
     EXPECT_TRUE(packet.IsValid());
-}
\ No newline at end of file
+}
+
+TEST(SPICoprocessor, SCResponsePacketAck) {
+    uint8_t buf[SPICoprocessor::SCResponsePacket::kAckLenBytes];
+    SPICoprocessor::SCResponsePacket packet = SPICoprocessor::SCResponsePacket(buf, sizeof(buf));
+    EXPECT_EQ(packet.GetDataLenBytes(), 1);
+    packet.SetHeader({.cmd = SPICoprocessor::SCCommand::kCmdAck});
+    packet.GetData()[0] = true;
+    packet.PopulateCRC();
+    EXPECT_TRUE(packet.IsValid());
+    uint16_t ack_len_bytes = SPICoprocessor::SCResponsePacket::kAckLenBytes;
+    EXPECT_EQ(packet.GetBufLenBytes(), ack_len_bytes);
+
+    // Too short to hold a response at all.
+    SPICoprocessor::SCResponsePacket short_packet =
+        SPICoprocessor::SCResponsePacket(buf, SPICoprocessor::SCResponsePacket::kBufMinLenBytes - 1);
+    EXPECT_FALSE(short_packet.IsValid());
+}
+
+TEST(SPICoprocessor, SCStreamReceiver) {
+    SPICoprocessor::SCStreamReceiver receiver;
+    uint16_t block_len_bytes = SPICoprocessor::SCWritePacket::kDataMaxLenBytes;
+    // Blocks that don't start at offset 0 can't start a stream.
+    EXPECT_FALSE(receiver.IsNextBlock(ObjectDictionary::Address::kAddrSettingsData, block_len_bytes));
+
+    EXPECT_TRUE(receiver.IsNextBlock(ObjectDictionary::Address::kAddrSettingsData, 0));
+    receiver.Advance(block_len_bytes);
+    // The third block shows up because the second one was lost, so it's dropped.
+    EXPECT_FALSE(receiver.IsNextBlock(ObjectDictionary::Address::kAddrSettingsData, 2 * block_len_bytes));
+    // Blocks for some other object don't belong to the stream either.
+    EXPECT_FALSE(receiver.IsNextBlock(ObjectDictionary::Address::kAddrRawTransponderPacket, block_len_bytes));
+    EXPECT_EQ(receiver.GetNextOffset(), block_len_bytes);
+
+    // The ack asks for the window to be sent again from the second block.
+    uint8_t buf[SPICoprocessor::SCResponsePacket::kStreamAckLenBytes];
+    receiver.PopulateAck(buf);
+    SPICoprocessor::SCResponsePacket ack_packet = SPICoprocessor::SCResponsePacket(buf, sizeof(buf));
+    EXPECT_TRUE(ack_packet.IsValid());
+    EXPECT_EQ(ack_packet.GetHeader().cmd, SPICoprocessor::SCCommand::kCmdStreamAck);
+    SPICoprocessor::SCStreamAck ack;
+    memcpy(&ack, ack_packet.GetData(), sizeof(ack));
+    EXPECT_EQ(ack.addr, ObjectDictionary::Address::kAddrSettingsData);
+    EXPECT_EQ(ack.next_offset, block_len_bytes);
+
+    // Once the second block is sent again, the rest of the window follows on.
+    EXPECT_TRUE(receiver.IsNextBlock(ObjectDictionary::Address::kAddrSettingsData, block_len_bytes));
+    receiver.Advance(block_len_bytes);
+    EXPECT_TRUE(receiver.IsNextBlock(ObjectDictionary::Address::kAddrSettingsData, 2 * block_len_bytes));
+    receiver.Advance(100);
+    EXPECT_EQ(receiver.GetNextOffset(), 2 * block_len_bytes + 100);
+
+    // A block at offset 0 starts over, e.g. when the whole write is sent again.
+    EXPECT_TRUE(receiver.IsNextBlock(ObjectDictionary::Address::kAddrSettingsData, 0));
+    EXPECT_EQ(receiver.GetNextOffset(), 0);
+}
@@ -0,0 +1,164 @@
+#include <random>
+
+#include "gtest/gtest.h"
+#include "spi_coprocessor.hh"
+#include "spi_link_shim.hh"
+
+namespace {
+void FillRandom(uint8_t *buf, uint16_t len_bytes, uint32_t seed) {
+    std::mt19937 rng(seed);
+    for (uint16_t i = 0; i < len_bytes; i++) {
+        buf[i] = static_cast<uint8_t>(rng());
+    }
+}
+}  // namespace
+
+TEST(SPILinkShim, CleanLinkDeliversEverything) {
+    SPILinkShim shim = SPILinkShim({});
+    // Several blocks, so that the write is windowed.
+    static uint8_t object_out[10000];
+    FillRandom(object_out, sizeof(object_out), 1);
+    EXPECT_TRUE(shim.MasterWrite(ObjectDictionary::Address::kAddrScratch, object_out, sizeof(object_out), true));
+    EXPECT_EQ(memcmp(shim.GetSlaveObject(ObjectDictionary::Address::kAddrScratch), object_out, sizeof(object_out)), 0);
+
+    uint8_t console_out[64];
+    FillRandom(console_out, sizeof(console_out), 2);
+    EXPECT_TRUE(shim.SlaveWrite(ObjectDictionary::Address::kAddrConsole, console_out, sizeof(console_out), true));
+    EXPECT_EQ(memcmp(shim.GetMasterObject(ObjectDictionary::Address::kAddrConsole), console_out, sizeof(console_out)),
+              0);
+
+    // Read back from both sides.
+    static uint8_t object_in[10000];
+    EXPECT_TRUE(shim.MasterRead(ObjectDictionary::Address::kAddrScratch, object_in, sizeof(object_in)));
+    EXPECT_EQ(memcmp(object_in, object_out, sizeof(object_out)), 0);
+    uint8_t console_in[64];
+    EXPECT_TRUE(shim.SlaveRead(ObjectDictionary::Address::kAddrConsole, console_in, sizeof(console_in)));
+    EXPECT_EQ(memcmp(console_in, console_out, sizeof(console_out)), 0);
+
+    const SPILinkShim::SPILinkStats &stats = shim.GetStats();
+    EXPECT_EQ(stats.num_bit_errors, 0u);
+    EXPECT_GT(stats.num_wire_bytes, 2 * sizeof(object_out) + 2 * sizeof(console_out));
+    for (uint16_t endpoint = 0; endpoint < SPILinkShim::kNumEndpoints; endpoint++) {
+        EXPECT_EQ(stats.num_retries[endpoint], 0u);
+        EXPECT_EQ(stats.num_failures[endpoint], 0u);
+        EXPECT_EQ(stats.num_warnings[endpoint], 0u);
+        EXPECT_EQ(stats.num_errors[endpoint], 0u);
+    }
+    // Both writes asked for acks.
+    EXPECT_GE(stats.ack_latencies_us.size(), 2u);
+    EXPECT_GT(stats.GetAckLatencyPercentileUs(50), 0u);
+}
+
+TEST(SPILinkShim, MasterWindowedWriteSharesAcks) {
+    SPILinkShim shim = SPILinkShim({});
+    static uint8_t object_out[3 * SPICoprocessor::SCWritePacket::kQueuedDataMaxLenBytes];
+    FillRandom(object_out, sizeof(object_out), 3);
+    EXPECT_TRUE(shim.MasterWrite(ObjectDictionary::Address::kAddrScratch, object_out, sizeof(object_out), true));
+    EXPECT_EQ(memcmp(shim.GetSlaveObject(ObjectDictionary::Address::kAddrScratch), object_out, sizeof(object_out)), 0);
+    // The first block is acked on its own and the other two share an ack, instead of an ack for every block.
+    EXPECT_EQ(shim.GetStats().num_transfers, 5u);
+}
+
+TEST(SPILinkShim, SlaveStreamsMultiWindowObject) {
+    SPILinkShim shim = SPILinkShim({});
+    // The first block, a full window, and one more block that makes a window of its own.
+    static const uint16_t kNumBlocks = 2 + SPICoprocessor::kSPIWriteWindowNumBlocks;
+    static uint8_t object_out[kNumBlocks * SPICoprocessor::SCWritePacket::kDataMaxLenBytes];
+    FillRandom(object_out, sizeof(object_out), 4);
+    EXPECT_TRUE(shim.SlaveWrite(ObjectDictionary::Address::kAddrScratch, object_out, sizeof(object_out), true));
+    uint8_t *object_in = shim.GetMasterObject(ObjectDictionary::Address::kAddrScratch);
+    for (uint32_t i = 0; i < sizeof(object_out); i++) {
+        ASSERT_EQ(object_in[i], object_out[i]) << "Byte " << i << " of " << sizeof(object_out) << " didn't arrive.";
+    }
+    // A transfer for each block, plus an ack for each window.
+    EXPECT_EQ(shim.GetStats().num_transfers, kNumBlocks + 3u);
+
+    const SPILinkShim::SPILinkStats &stats = shim.GetStats();
+    for (uint16_t endpoint = 0; endpoint < SPILinkShim::kNumEndpoints; endpoint++) {
+        EXPECT_EQ(stats.num_retries[endpoint], 0u);
+        EXPECT_EQ(stats.num_failures[endpoint], 0u);
+        EXPECT_EQ(stats.num_warnings[endpoint], 0u);
+        EXPECT_EQ(stats.num_errors[endpoint], 0u);
+    }
+    // One ack for each window.
+    EXPECT_EQ(stats.ack_latencies_us.size(), 3u);
+}
+
+TEST(SPILinkShim, RetriesThroughBitErrors) {
+    SPILinkShim shim = SPILinkShim({.bit_error_rate = 1e-5, .seed = 4});
+    static uint8_t object_out[10000];
+    uint16_t num_writes_ok = 0;
+    for (uint32_t i = 0; i < 20; i++) {
+        FillRandom(object_out, sizeof(object_out), 100 + i);
+        if (shim.MasterWrite(ObjectDictionary::Address::kAddrScratch, object_out, sizeof(object_out), true)) {
+            // Corrupted blocks never make it into the object.
+            EXPECT_EQ(
+                memcmp(shim.GetSlaveObject(ObjectDictionary::Address::kAddrScratch), object_out, sizeof(object_out)),
+                0);
+            num_writes_ok++;
+        }
+    }
+    const SPILinkShim::SPILinkStats &stats = shim.GetStats();
+    EXPECT_GT(stats.num_bit_errors, 0u);
+    EXPECT_GT(stats.num_retries[SPILinkShim::kRP2040], 0u);
+    EXPECT_GT(stats.num_warnings[SPILinkShim::kRP2040], 0u);
+    EXPECT_EQ(stats.num_failures[SPILinkShim::kRP2040], 20u - num_writes_ok);
+    EXPECT_GT(num_writes_ok, 15u);
+}
+
+TEST(SPILinkShim, ClockRateOverride) {
+    SPILinkShim shim = SPILinkShim({.clk_rate_hz = 10'000'000});
+    EXPECT_EQ(shim.GetClkRateHz(), 10'000'000u);
+    uint8_t object_out[64];
+    FillRandom(object_out, sizeof(object_out), 5);
+    EXPECT_TRUE(shim.MasterWrite(ObjectDictionary::Address::kAddrScratch, object_out, sizeof(object_out), true));
+}
+
+TEST(SPILinkShim, HandshakeLatencyDelaysAcks) {
+    static const uint32_t kHandshakeLatencyUs = 100;
+    uint8_t object_out[64];
+    FillRandom(object_out, sizeof(object_out), 6);
+    uint32_t ack_latency_us[2];
+    for (uint16_t i = 0; i < 2; i++) {
+        SPILinkShim shim = SPILinkShim({.handshake_latency_us = i * kHandshakeLatencyUs});
+        EXPECT_TRUE(shim.MasterWrite(ObjectDictionary::Address::kAddrScratch, object_out, sizeof(object_out), true));
+        ASSERT_EQ(shim.GetStats().ack_latencies_us.size(), 1u);
+        ack_latency_us[i] = shim.GetStats().GetAckLatencyPercentileUs(50);
+    }
+    // The ack is announced with the HANDSHAKE line, which the RP2040 can't see until kHandshakeLatencyUs after the
+    // request.
+    EXPECT_GE(ack_latency_us[1], kHandshakeLatencyUs);
+    EXPECT_GT(ack_latency_us[1], ack_latency_us[0]);
+}
+
+TEST(SPILinkShim, SlaveRearmTime) {
+    static uint8_t object_out[3 * SPICoprocessor::SCWritePacket::kQueuedDataMaxLenBytes];
+    FillRandom(object_out, sizeof(object_out), 7);
+    {
+        // Re-arms within the 600 us that the RP2040 waits between transfers.
+        SPILinkShim shim = SPILinkShim({.slave_rearm_us = 500});
+        EXPECT_TRUE(shim.MasterWrite(ObjectDictionary::Address::kAddrScratch, object_out, sizeof(object_out), true));
+        EXPECT_EQ(shim.GetStats().num_retries[SPILinkShim::kRP2040], 0u);
+        EXPECT_EQ(shim.GetStats().num_failures[SPILinkShim::kRP2040], 0u);
+    }
+    {
+        // Misses every block that follows right after another transfer, so the window is sent again until the write
+        // gives up.
+        SPILinkShim shim = SPILinkShim({.slave_rearm_us = 1000});
+        EXPECT_FALSE(shim.MasterWrite(ObjectDictionary::Address::kAddrScratch, object_out, sizeof(object_out), true));
+        EXPECT_GT(shim.GetStats().num_retries[SPILinkShim::kRP2040], 0u);
+        EXPECT_EQ(shim.GetStats().num_failures[SPILinkShim::kRP2040], 1u);
+    }
+}
+
+TEST(SPILinkShimStats, AckLatencyPercentiles) {
+    SPILinkShim::SPILinkStats stats;
+    EXPECT_EQ(stats.GetAckLatencyPercentileUs(50), 0u);
+    for (uint32_t latency_us = 100; latency_us >= 1; latency_us--) {
+        stats.ack_latencies_us.push_back(latency_us);
+    }
+    EXPECT_EQ(stats.GetAckLatencyPercentileUs(0), 1u);
+    EXPECT_EQ(stats.GetAckLatencyPercentileUs(50), 50u);
+    EXPECT_EQ(stats.GetAckLatencyPercentileUs(99), 99u);
+    EXPECT_EQ(stats.GetAckLatencyPercentileUs(100), 100u);
+}
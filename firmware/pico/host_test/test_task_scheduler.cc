@@ -0,0 +1,166 @@
+#include "gtest/gtest.h"
+#include "hal_god_powers.hh"
+#include "task_scheduler.hh"
+
+namespace {
+// Order in which tasks ran, as a string of task letters.
+std::string task_run_order;
+uint32_t slow_task_runtime_us = 0;
+
+void TaskA() { task_run_order += "A"; }
+void TaskB() { task_run_order += "B"; }
+void SlowTask() {
+    task_run_order += "S";
+    inc_time_since_boot_us(slow_task_runtime_us);
+}
+}  // namespace
+
+TEST(TaskScheduler, AddTask) {
+    TaskScheduler scheduler;
+    TaskScheduler::Task task = {.name = "A", .function = TaskA, .priority = 0, .period_us = 1000};
+    uint16_t max_num_tasks = TaskScheduler::kMaxNumTasks;
+    for (uint16_t i = 0; i < max_num_tasks; i++) {
+        EXPECT_EQ(scheduler.AddTask(task), i);
+    }
+    EXPECT_EQ(scheduler.AddTask(task), -1);
+    EXPECT_EQ(scheduler.GetNumTasks(), max_num_tasks);
+
+    TaskScheduler empty_scheduler;
+    task.function = nullptr;
+    EXPECT_EQ(empty_scheduler.AddTask(task), -1);
+    EXPECT_FALSE(empty_scheduler.Update());
+}
+
+TEST(TaskScheduler, PeriodicTasksRunInPriorityOrder) {
+    set_time_since_boot_us(0);
+    task_run_order = "";
+    TaskScheduler scheduler;
+    // Add the lower priority task first to make sure that priority wins over insertion order.
+    scheduler.AddTask({.name = "B", .function = TaskB, .priority = 1, .period_us = 1000});
+    scheduler.AddTask({.name = "A", .function = TaskA, .priority = 0, .period_us = 500});
+
+    // Both are released at time 0.
+    while (scheduler.Update()) {
+    }
+    EXPECT_EQ(task_run_order, "AB");
+
+    inc_time_since_boot_us(499);
+    EXPECT_FALSE(scheduler.Update());
+    inc_time_since_boot_us(1);
+    while (scheduler.Update()) {
+    }
+    EXPECT_EQ(task_run_order, "ABA");
+    inc_time_since_boot_us(500);
+    while (scheduler.Update()) {
+    }
+    EXPECT_EQ(task_run_order, "ABAAB");
+
+    EXPECT_EQ(scheduler.GetTaskStats(0).num_runs, 2u);
+    EXPECT_EQ(scheduler.GetTaskStats(1).num_runs, 3u);
+    EXPECT_EQ(scheduler.GetNumDeadlineMisses(), 0u);
+}
+
+TEST(TaskScheduler, HighPriorityTaskPreemptsBetweenTasks) {
+    set_time_since_boot_us(0);
+    task_run_order = "";
+    slow_task_runtime_us = 3000;
+    TaskScheduler scheduler;
+    scheduler.AddTask({.name = "A", .function = TaskA, .priority = 0, .period_us = 1000, .deadline_us = 2000});
+    scheduler.AddTask({.name = "S", .function = SlowTask, .priority = 1, .period_us = 10000});
+    scheduler.AddTask({.name = "B", .function = TaskB, .priority = 2, .period_us = 10000});
+
+    // A runs first, then S. S runs long enough for A to come due again, and A gets to go before B.
+    for (uint16_t i = 0; i < 4; i++) {
+        EXPECT_TRUE(scheduler.Update());
+    }
+    EXPECT_EQ(task_run_order, "ASAB");
+
+    // A was released at 1000us and started at 3000us, right at its deadline. Missed releases are skipped instead of
+    // run back to back.
+    TaskScheduler::TaskStats stats = scheduler.GetTaskStats(0);
+    EXPECT_EQ(stats.max_latency_us, 2000u);
+    EXPECT_EQ(stats.num_deadline_misses, 0u);
+    EXPECT_FALSE(scheduler.Update());
+
+    // Now S runs past A's deadline.
+    set_time_since_boot_us(0);
+    task_run_order = "";
+    slow_task_runtime_us = 5000;
+    scheduler = TaskScheduler();
+    scheduler.AddTask({.name = "A", .function = TaskA, .priority = 0, .period_us = 1000, .deadline_us = 2000});
+    scheduler.AddTask({.name = "S", .function = SlowTask, .priority = 1, .period_us = 10000});
+    while (scheduler.Update()) {
+    }
+    EXPECT_EQ(task_run_order, "ASA");
+    stats = scheduler.GetTaskStats(0);
+    EXPECT_EQ(stats.num_deadline_misses, 1u);
+    EXPECT_EQ(stats.max_latency_us, 4000u);
+    EXPECT_EQ(scheduler.GetNumDeadlineMisses(), 1u);
+
+    scheduler.ResetStats();
+    EXPECT_EQ(scheduler.GetNumDeadlineMisses(), 0u);
+    EXPECT_EQ(scheduler.GetTaskStats(0).num_runs, 0u);
+}
+
+TEST(TaskScheduler, DeadlineTaskRunsWhenReleased) {
+    set_time_since_boot_us(1000);
+    task_run_order = "";
+    TaskScheduler scheduler;
+    int16_t task_id = scheduler.AddTask({.name = "A", .function = TaskA, .priority = 0, .deadline_us = 100});
+    EXPECT_FALSE(scheduler.Update());
+
+    // Latency is measured from the first release.
+    scheduler.Release(task_id, 1000);
+    inc_time_since_boot_us(50);
+    scheduler.Release(task_id, 1050);
+    inc_time_since_boot_us(100);
+    EXPECT_TRUE(scheduler.Update());
+    EXPECT_FALSE(scheduler.Update());
+    EXPECT_EQ(task_run_order, "A");
+
+    TaskScheduler::TaskStats stats = scheduler.GetTaskStats(task_id);
+    EXPECT_EQ(stats.num_runs, 1u);
+    EXPECT_EQ(stats.max_latency_us, 150u);
+    EXPECT_EQ(stats.num_deadline_misses, 1u);
+}
+
+TEST(TaskScheduler, PeriodicTaskReleasedEarly) {
+    set_time_since_boot_us(0);
+    task_run_order = "";
+    TaskScheduler scheduler;
+    int16_t task_id = scheduler.AddTask({.name = "A", .function = TaskA, .priority = 0, .period_us = 1000});
+    EXPECT_TRUE(scheduler.Update());
+
+    // Runs right away when released, without waiting for its period.
+    inc_time_since_boot_us(200);
+    EXPECT_FALSE(scheduler.Update());
+    scheduler.Release(task_id, 200);
+    EXPECT_TRUE(scheduler.Update());
+    EXPECT_FALSE(scheduler.Update());
+    EXPECT_EQ(task_run_order, "AA");
+
+    // The early release doesn't move the next periodic release.
+    inc_time_since_boot_us(799);
+    EXPECT_FALSE(scheduler.Update());
+    inc_time_since_boot_us(1);
+    EXPECT_TRUE(scheduler.Update());
+    EXPECT_EQ(task_run_order, "AAA");
+    EXPECT_EQ(scheduler.GetTaskStats(task_id).num_runs, 3u);
+}
+
+TEST(TaskScheduler, BudgetOverrun) {
+    set_time_since_boot_us(0);
+    slow_task_runtime_us = 600;
+    TaskScheduler scheduler;
+    int16_t task_id =
+        scheduler.AddTask({.name = "S", .function = SlowTask, .priority = 0, .period_us = 1000, .budget_us = 500});
+    EXPECT_TRUE(scheduler.Update());
+    slow_task_runtime_us = 400;
+    inc_time_since_boot_us(400);
+    EXPECT_TRUE(scheduler.Update());
+
+    TaskScheduler::TaskStats stats = scheduler.GetTaskStats(task_id);
+    EXPECT_EQ(stats.num_runs, 2u);
+    EXPECT_EQ(stats.num_budget_overruns, 1u);
+    EXPECT_EQ(stats.max_runtime_us, 600u);
+}
@@ -0,0 +1,232 @@
+#include <cmath>
+#include <random>
+
+#include "gtest/gtest.h"
+#include "trigger_level_controller.hh"
+
+namespace {
+
+const uint32_t kMetricsIntervalMs = 1000;
+
+/**
+ * Simulates the receive chain for one metrics interval at a time, so that the trigger level controller can be run
+ * closed loop on the host.
+ *
+ * Aircraft have fixed signal levels. A frame is demodulated if it's above the trigger level and a demodulator is
+ * free, and decodes with a probability that grows with its margin above the noise floor. Noise triggers fall off
+ * exponentially as the trigger level rises above the noise floor, and tie up demodulators while they last. This puts
+ * the best trigger level a little above the noise floor: lower and demodulators are busy with noise, higher and weak
+ * aircraft get cut off.
+ */
+class ReceiverSimulator {
+   public:
+    static const uint16_t kNumSources = 3;
+    static const uint16_t kNumAircraft = 40;
+    static constexpr float kAircraftMinLevelMV = 600.0f;
+    static constexpr float kAircraftMaxLevelMV = 1600.0f;
+    static constexpr float kFramesPerAircraftPerSec = 6.0f;
+    static constexpr float kFullDecodeMarginMV = 150.0f;  // Frames this far above the noise floor always decode.
+    static constexpr float kNoiseTriggersPerSecAtNoiseFloor = 50000.0f;
+    static constexpr float kNoiseTriggerFalloffMV = 40.0f;
+    static constexpr float kDemodDurationSec = 120e-6f;
+
+    ReceiverSimulator(uint32_t seed) : rng_(seed) {}
+
+    /**
+     * Simulates one metrics interval. The interval is split between the previous and current trigger level, since
+     * the firmware doesn't line up trigger level changes with metrics intervals.
+     * @param[in] tl_mv Trigger level for the second half of the interval.
+     * @retval Metrics for the interval.
+     */
+    AircraftDictionary::Metrics Step(int tl_mv) {
+        AircraftDictionary::Metrics metrics;
+        SimulateSeconds(metrics, prev_tl_mv_ < 0 ? tl_mv : prev_tl_mv_, 0.5f);
+        SimulateSeconds(metrics, tl_mv, 0.5f);
+        prev_tl_mv_ = tl_mv;
+        return metrics;
+    }
+
+    /**
+     * Returns the expected number of valid frames per second at a trigger level.
+     */
+    float GetExpectedValidFramesPerSec(int tl_mv) const {
+        float valid_frames_per_sec = 0.0f;
+        for (uint16_t i = 0; i < kNumAircraft; i++) {
+            if (GetAircraftLevelMV(i) > tl_mv) {
+                valid_frames_per_sec += kFramesPerAircraftPerSec * GetDecodeProbability(GetAircraftLevelMV(i));
+            }
+        }
+        return valid_frames_per_sec * GetFreeFraction(tl_mv);
+    }
+
+    /**
+     * Returns the trigger level with the most expected valid frames per second, found by brute force.
+     */
+    int GetBestTLMilliVolts() const {
+        int best_tl_mv = 0;
+        for (int tl_mv = 0; tl_mv <= 3300; tl_mv += 5) {
+            if (GetExpectedValidFramesPerSec(tl_mv) > GetExpectedValidFramesPerSec(best_tl_mv)) {
+                best_tl_mv = tl_mv;
+            }
+        }
+        return best_tl_mv;
+    }
+
+    float noise_floor_mv = 500.0f;
+
+   private:
+    float GetAircraftLevelMV(uint16_t i) const {
+        return kAircraftMinLevelMV + (kAircraftMaxLevelMV - kAircraftMinLevelMV) * i / (kNumAircraft - 1);
+    }
+    float GetDecodeProbability(float level_mv) const {
+        return std::min(std::max((level_mv - noise_floor_mv) / kFullDecodeMarginMV, 0.0f), 1.0f);
+    }
+    float GetNoiseTriggersPerSec(int tl_mv) const {
+        return kNoiseTriggersPerSecAtNoiseFloor * expf(-(tl_mv - noise_floor_mv) / kNoiseTriggerFalloffMV);
+    }
+    float GetFreeFraction(int tl_mv) const {
+        return std::max(1.0f - GetNoiseTriggersPerSec(tl_mv) * kDemodDurationSec / kNumSources, 0.0f);
+    }
+
+    void SimulateSeconds(AircraftDictionary::Metrics &metrics, int tl_mv, float duration_sec) {
+        float free_fraction = GetFreeFraction(tl_mv);
+        uint32_t num_demods =
+            std::poisson_distribution<uint32_t>(std::min(GetNoiseTriggersPerSec(tl_mv) * duration_sec,
+                                                         kNumSources / kDemodDurationSec * duration_sec))(rng_);
+        uint32_t num_valid_frames = 0;
+        for (uint16_t i = 0; i < kNumAircraft; i++) {
+            if (GetAircraftLevelMV(i) <= tl_mv) {
+                continue;
+            }
+            uint32_t num_frames = std::poisson_distribution<uint32_t>(kFramesPerAircraftPerSec * duration_sec)(rng_);
+            uint32_t num_demodulated_frames = std::binomial_distribution<uint32_t>(num_frames, free_fraction)(rng_);
+            num_demods += num_demodulated_frames;
+            num_valid_frames += std::binomial_distribution<uint32_t>(
+                num_demodulated_frames, GetDecodeProbability(GetAircraftLevelMV(i)))(rng_);
+        }
+        // Demods are spread round robin across the state machines.
+        for (uint16_t source = 0; source < kNumSources; source++) {
+            uint16_t num_sources_left = kNumSources - source;
+            uint32_t source_demods = num_demods / num_sources_left;
+            uint32_t source_valid_frames = num_valid_frames / num_sources_left;
+            metrics.demods_1090_by_source[source] += source_demods;
+            metrics.valid_extended_squitter_frames_by_source[source] += source_valid_frames;
+            num_demods -= source_demods;
+            num_valid_frames -= source_valid_frames;
+        }
+    }
+
+    std::mt19937 rng_;
+    int prev_tl_mv_ = -1;
+};
+
+/**
+ * Runs the controller against the simulator for a number of metrics intervals.
+ * @retval Trigger level at the end of the run.
+ */
+int RunClosedLoop(TriggerLevelController &controller, ReceiverSimulator &sim, int tl_mv, uint16_t num_intervals) {
+    for (uint16_t i = 0; i < num_intervals; i++) {
+        tl_mv = controller.Update(sim.Step(tl_mv), sim.noise_floor_mv, kMetricsIntervalMs);
+    }
+    return tl_mv;
+}
+
+}  // namespace
+
+TEST(TriggerLevelController, StaysPutWhenStopped) {
+    TriggerLevelController controller = TriggerLevelController({});
+    AircraftDictionary::Metrics metrics;
+    EXPECT_FALSE(controller.IsEnabled());
+    controller.Start(1300, 500, 0, 3300);
+    EXPECT_TRUE(controller.IsEnabled());
+    EXPECT_EQ(controller.GetMarginMilliVolts(), 800);
+    controller.Stop();
+    EXPECT_EQ(controller.Update(metrics, 500, kMetricsIntervalMs), 1300);
+}
+
+TEST(TriggerLevelController, RaisesMarginWhenDemodsAreNoise) {
+    TriggerLevelController controller = TriggerLevelController({});
+    controller.Start(520, 500, 0, 3300);
+    AircraftDictionary::Metrics metrics;
+    for (uint16_t i = 0; i < 3; i++) {
+        metrics.demods_1090_by_source[i] = 1000;
+        metrics.valid_extended_squitter_frames_by_source[i] = 10;
+    }
+    // Raised right away, with a growing step.
+    int tl_mv = controller.Update(metrics, 500, kMetricsIntervalMs);
+    EXPECT_GT(tl_mv, 520);
+    EXPECT_GT(controller.Update(metrics, 500, kMetricsIntervalMs) - tl_mv, tl_mv - 520);
+    // 990 noise demods of 120us each in 1 second.
+    EXPECT_NEAR(controller.GetLastNoiseOccupancy(), 0.1188f, 1e-4f);
+}
+
+TEST(TriggerLevelController, LowersMarginWhenNothingTriggers) {
+    TriggerLevelController controller = TriggerLevelController({});
+    controller.Start(2000, 500, 0, 3300);
+    AircraftDictionary::Metrics metrics;
+    controller.Update(metrics, 500, kMetricsIntervalMs);  // Settle interval.
+    EXPECT_LT(controller.Update(metrics, 500, kMetricsIntervalMs), 2000);
+    EXPECT_EQ(controller.GetLastNoiseOccupancy(), 0.0f);
+}
+
+TEST(TriggerLevelController, ClampsToLimits) {
+    TriggerLevelController controller = TriggerLevelController({});
+    controller.Start(1000, 500, 900, 1100);
+    AircraftDictionary::Metrics metrics;
+    for (uint16_t i = 0; i < 20; i++) {
+        int tl_mv = controller.Update(metrics, 500, kMetricsIntervalMs);
+        EXPECT_GE(tl_mv, 900);
+        EXPECT_LE(tl_mv, 1100);
+    }
+    // Margin doesn't wind up past the lower limit.
+    EXPECT_GE(controller.GetMarginMilliVolts(), 900 - 500);
+}
+
+TEST(TriggerLevelController, ConvergesFromAbove) {
+    ReceiverSimulator sim = ReceiverSimulator(1);
+    TriggerLevelController controller = TriggerLevelController({});
+    int tl_mv = 2000;
+    controller.Start(tl_mv, sim.noise_floor_mv, 0, 3300);
+    tl_mv = RunClosedLoop(controller, sim, tl_mv, 60);  // One minute of 1 second metrics intervals.
+    float best_valid_frames_per_sec = sim.GetExpectedValidFramesPerSec(sim.GetBestTLMilliVolts());
+    EXPECT_GT(sim.GetExpectedValidFramesPerSec(tl_mv), 0.95f * best_valid_frames_per_sec)
+        << "tl_mv=" << tl_mv << " best_tl_mv=" << sim.GetBestTLMilliVolts();
+}
+
+TEST(TriggerLevelController, ConvergesFromBelow) {
+    ReceiverSimulator sim = ReceiverSimulator(2);
+    TriggerLevelController controller = TriggerLevelController({});
+    int tl_mv = sim.noise_floor_mv + 10;  // Swamped by noise triggers.
+    controller.Start(tl_mv, sim.noise_floor_mv, 0, 3300);
+    tl_mv = RunClosedLoop(controller, sim, tl_mv, 60);
+    float best_valid_frames_per_sec = sim.GetExpectedValidFramesPerSec(sim.GetBestTLMilliVolts());
+    EXPECT_GT(sim.GetExpectedValidFramesPerSec(tl_mv), 0.95f * best_valid_frames_per_sec)
+        << "tl_mv=" << tl_mv << " best_tl_mv=" << sim.GetBestTLMilliVolts();
+}
+
+TEST(TriggerLevelController, TracksNoiseFloor) {
+    ReceiverSimulator sim = ReceiverSimulator(3);
+    TriggerLevelController controller = TriggerLevelController({});
+    int tl_mv = 1300;
+    controller.Start(tl_mv, sim.noise_floor_mv, 0, 3300);
+    tl_mv = RunClosedLoop(controller, sim, tl_mv, 60);
+
+    // Noise floor jumps up, e.g. from local interference. The trigger level follows it within a couple of intervals.
+    sim.noise_floor_mv += 200;
+    tl_mv = RunClosedLoop(controller, sim, tl_mv, 2);
+    float best_valid_frames_per_sec = sim.GetExpectedValidFramesPerSec(sim.GetBestTLMilliVolts());
+    EXPECT_GT(sim.GetExpectedValidFramesPerSec(tl_mv), 0.8f * best_valid_frames_per_sec)
+        << "tl_mv=" << tl_mv << " best_tl_mv=" << sim.GetBestTLMilliVolts();
+
+    // And keeps tracking over a long run with a slowly drifting noise floor.
+    for (uint16_t i = 0; i < 600; i++) {
+        sim.noise_floor_mv = 600 + 100 * sinf(i * 2.0f * static_cast<float>(M_PI) / 600);
+        tl_mv = RunClosedLoop(controller, sim, tl_mv, 1);
+        if (i >= 60) {
+            float expected_valid_frames_per_sec = sim.GetExpectedValidFramesPerSec(tl_mv);
+            best_valid_frames_per_sec = sim.GetExpectedValidFramesPerSec(sim.GetBestTLMilliVolts());
+            ASSERT_GT(expected_valid_frames_per_sec, 0.9f * best_valid_frames_per_sec)
+                << "i=" << i << " tl_mv=" << tl_mv << " best_tl_mv=" << sim.GetBestTLMilliVolts();
+        }
+    }
+}